@@ -6,4 +6,7 @@
 #define JFNT_JFNT_H
 #include "jfnt_error.h"
 #include "jfnt_font.h"
+#include "jfnt_context.h"
+#include "jfnt_layout.h"
+#include "jfnt_async.h"
 #endif //JFNT_JFNT_H
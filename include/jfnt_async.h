@@ -0,0 +1,106 @@
+//
+// Created by jan on 17.10.2026.
+//
+
+#ifndef JFNT_JFNT_ASYNC_H
+#define JFNT_JFNT_ASYNC_H
+#include "jfnt_font.h"
+
+typedef struct jfnt_worker_pool_T jfnt_worker_pool;
+typedef struct jfnt_font_job_T jfnt_font_job;
+
+enum jfnt_font_job_state_T
+{
+    JFNT_FONT_JOB_QUEUED,           //  Waiting for a worker
+    JFNT_FONT_JOB_RUNNING,          //  Worker is creating the preview, or the font when there is no preview
+    JFNT_FONT_JOB_PREVIEW_READY,    //  Preview can be taken, worker is creating the font
+    JFNT_FONT_JOB_DONE,             //  Font can be taken
+    JFNT_FONT_JOB_FAILED,           //  Font could not be created, jfnt_font_job_take_font returns why
+    JFNT_FONT_JOB_CANCELED,
+};
+typedef enum jfnt_font_job_state_T jfnt_font_job_state;
+
+/*
+ * Font to create, which is given either by fc_str, by filename or by mem, in that order. Strings, ranges and callbacks
+ * are copied, but memory and the context of create info must stay valid until the job is destroyed (memory even
+ * longer for lazy fonts, see jfnt_font_create_info).
+ *
+ * When n_preview_ranges is not zero, a preview font with only those ranges, such as ASCII, is created first, so that
+ * text can be drawn with it while the font with all of create_info's ranges is created. Preview is a separate font,
+ * made with the same create info, except that it is not cached. Atlas memory can not be given to jobs with a preview.
+ *
+ * Callback is called with the state once the preview is ready, and once the job is done, failed or was canceled, after
+ * which the state is not changed. It is called on the worker thread, or on the thread which canceled the job, if it
+ * had not yet started. Fonts can be taken from within it, but it must not wait for or destroy the job.
+ */
+struct jfnt_font_job_info_T
+{
+    const char* fc_str;
+    const char* filename;
+    const void* mem;
+    size_t mem_size;
+    unsigned char_size;             //  Used with filename and mem
+    jfnt_font_create_info create_info;
+    unsigned n_preview_ranges;
+    const jfnt_codepoint_range* preview_ranges;
+    void (*callback)(jfnt_font_job* job, jfnt_font_job_state state, void* param);
+    void* callback_param;
+};
+typedef struct jfnt_font_job_info_T jfnt_font_job_info;
+
+/*
+ * Create a pool of thread_count worker threads (at least one), which create fonts of jobs in the order they were
+ * queued. Pool, and the jobs queued on it, are allocated with allocator_callbacks, or DEFAULT_ALLOCATOR when it is
+ * NULL. Fonts are allocated with allocator callbacks of their create info, and report errors through its error
+ * callbacks, on the worker threads, so those (as well as these) must be thread-safe.
+ */
+jfnt_result jfnt_worker_pool_create(
+        const jfnt_allocator_callbacks* allocator_callbacks, unsigned thread_count, jfnt_worker_pool** p_out);
+
+/*
+ * Stop the workers and destroy the pool. All jobs queued on it must be destroyed before.
+ */
+void jfnt_worker_pool_destroy(jfnt_worker_pool* pool);
+
+/*
+ * Queue creation of a font on the pool. Job is returned right away, and must be destroyed with jfnt_font_job_destroy.
+ */
+jfnt_result jfnt_font_create_async(jfnt_worker_pool* pool, const jfnt_font_job_info* info, jfnt_font_job** p_out);
+
+/*
+ * Returns the current state of the job without blocking
+ */
+jfnt_font_job_state jfnt_font_job_poll(const jfnt_font_job* job);
+
+/*
+ * Block until the job is done, failed or was canceled, and return that state. Callback has returned by then.
+ */
+jfnt_font_job_state jfnt_font_job_wait(jfnt_font_job* job);
+
+/*
+ * Cancel the job. Jobs which are still queued never start. Running jobs can not stop in the middle of creating a font,
+ * so the font being created when they are canceled is thrown away once it is done, and the rest of the job is skipped.
+ * A preview which was already created is kept. Canceling a job which already ended does nothing.
+ */
+void jfnt_font_job_cancel(jfnt_font_job* job);
+
+/*
+ * Take the preview font, blocking until it is created, and return the result of creating it. The font then belongs to
+ * the caller. Returns JFNT_RESULT_CANCELED if the job was canceled before the preview was created, and
+ * JFNT_RESULT_BAD_ARGUMENT if the job has no preview or it was already taken.
+ */
+jfnt_result jfnt_font_job_take_preview(jfnt_font_job* job, jfnt_font** p_out);
+
+/*
+ * Take the font, blocking until it is created, and return the result of creating it. The font then belongs to the
+ * caller. Returns JFNT_RESULT_CANCELED if the job was canceled before the font was created, and
+ * JFNT_RESULT_BAD_ARGUMENT if it was already taken.
+ */
+jfnt_result jfnt_font_job_take_font(jfnt_font_job* job, jfnt_font** p_out);
+
+/*
+ * Cancel the job, wait for its worker to be done with it, and destroy it along with the fonts which were not taken
+ */
+void jfnt_font_job_destroy(jfnt_font_job* job);
+
+#endif //JFNT_JFNT_ASYNC_H
@@ -0,0 +1,43 @@
+//
+// Created by jan on 17.10.2026.
+//
+
+#ifndef JFNT_JFNT_CONTEXT_H
+#define JFNT_JFNT_CONTEXT_H
+#include "jfnt_font.h"
+
+/*
+ * Create a context, which owns the FreeType library, the fontconfig configuration and every face opened by fonts
+ * created with it. Faces are kept open and are shared by fonts made from the same file (or memory) and face index, so
+ * creating many sizes of the same face opens its file only once. Each font keeps its own size on the shared face.
+ * Font files are mapped read-only, so that FreeType and the threads rasterizing glyphs all read from one copy of the
+ * file which the system can page in and out as needed. Files must not be truncated while a context has them open.
+ *
+ * Fonts may be created with the same context from multiple threads, but work done on the context's faces, which is
+ * creation and lazy loading of glyphs, is done by one thread at a time. Context must outlive all fonts created with it.
+ * When allocator_callbacks is NULL, DEFAULT_ALLOCATOR is used.
+ */
+jfnt_result jfnt_context_create(const jfnt_allocator_callbacks* allocator_callbacks, jfnt_context** p_out);
+
+/*
+ * Destroy the context and close all of its faces. All fonts created with it must be destroyed before.
+ */
+void jfnt_context_destroy(jfnt_context* context);
+
+/*
+ * Close faces which are not used by any lazy font. These are otherwise kept open until the context is destroyed, so
+ * that fonts created later can use them.
+ */
+void jfnt_context_trim(jfnt_context* context);
+
+/*
+ * Returns the number of faces the context has open and the number of times it had to open one so far
+ */
+unsigned jfnt_context_get_face_count(const jfnt_context* context, unsigned* p_times_opened);
+
+/*
+ * Returns the total size of font files the context currently has mapped
+ */
+size_t jfnt_context_get_mapped_size(const jfnt_context* context);
+
+#endif //JFNT_JFNT_CONTEXT_H
@@ -20,6 +20,12 @@ enum jfnt_result_T
 
     JFNT_RESULT_BAD_ENCODING,
 
+    JFNT_RESULT_ATLAS_FULL,
+
+    JFNT_RESULT_BAD_ARGUMENT,
+
+    JFNT_RESULT_CANCELED,
+
     JFNT_RESULT_COUNT,
 };
 typedef enum jfnt_result_T jfnt_result;
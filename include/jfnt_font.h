@@ -5,16 +5,21 @@
 #ifndef JFNT_JFNT_FONT_H
 #define JFNT_JFNT_FONT_H
 #include <stddef.h>
+#include <stdint.h>
 #include <uchar.h>
 #include "jfnt_error.h"
 
 typedef struct jfnt_font_T jfnt_font;
+typedef struct jfnt_context_T jfnt_context;
 struct jfnt_error_callbacks_T
 {
     void (*report)(const char* message, const char* function, const char* file, int line, void* param);
     void* report_param;
     void (*unsupported_char)(jfnt_font* font, char32_t c, const char* msg, void* param);
     void* char_param;
+    //  Called for each run of requested codepoints with no glyphs in the font when it is created, instead of calling
+    //  unsupported_char for each one of them. Also takes char_param.
+    void (*unsupported_range)(jfnt_font* font, char32_t first, char32_t last, const char* msg, void* param);
 };
 typedef struct jfnt_error_callbacks_T jfnt_error_callbacks;
 
@@ -34,10 +39,13 @@ struct jfnt_glyph_T
     signed short top, left;
     unsigned short w, h;
     unsigned short advance_x, advance_y;
-    unsigned int offset_x;
+    unsigned short face;    //  Position in the fallback chain of the face the glyph came from, 0 being the matched one
+    unsigned int offset_x, offset_y;
 };
 typedef struct jfnt_glyph_T jfnt_glyph;
 
+enum {JFNT_DEFAULT_ATLAS_MAX_WIDTH = 4096};
+
 struct jfnt_codepoint_range_T
 {
     char32_t first;
@@ -45,6 +53,35 @@ struct jfnt_codepoint_range_T
 };
 typedef struct jfnt_codepoint_range_T jfnt_codepoint_range;
 
+enum jfnt_render_mode_T
+{
+    JFNT_RENDER_MODE_COVERAGE = 0,  //  8-bit anti-aliased coverage, meant to be drawn at the size of the font
+    JFNT_RENDER_MODE_SDF,           //  8-bit signed distance field of unhinted outlines, with 128 on the outline and
+                                    //  larger values inside of it, meant to be drawn at any scale
+    JFNT_RENDER_MODE_MSDF,          //  Multi-channel signed distance field, which is not supported by FreeType
+};
+typedef enum jfnt_render_mode_T jfnt_render_mode;
+
+enum {JFNT_DEFAULT_SDF_SPREAD = 8};
+
+enum jfnt_pixel_format_T
+{
+    JFNT_PIXEL_FORMAT_R8 = 0,               //  One byte per pixel, holding the coverage (or distance)
+    JFNT_PIXEL_FORMAT_RGBA8,                //  White with the coverage in alpha, for straight alpha blending
+    JFNT_PIXEL_FORMAT_RGBA8_PREMULTIPLIED,  //  Coverage in all four channels, for premultiplied alpha blending
+    JFNT_PIXEL_FORMAT_R4,                   //  Two pixels per byte, the first one in the high nibble, with the coverage
+                                            //  rounded to 16 levels
+    JFNT_PIXEL_FORMAT_R1,                   //  Eight pixels per byte, the first one in the highest bit, with glyphs
+                                            //  rendered by the monochrome renderer of FreeType. Not for distance fields
+};
+typedef enum jfnt_pixel_format_T jfnt_pixel_format;
+
+/*
+ * Returns the number of bits taken by one pixel of the format, or 0 if the format is not valid. Rows of pixels always
+ * begin on a whole byte.
+ */
+unsigned jfnt_pixel_format_bits(jfnt_pixel_format format);
+
 struct jfnt_font_create_info_T
 {
     const jfnt_allocator_callbacks* allocator_callbacks;
@@ -52,6 +89,45 @@ struct jfnt_font_create_info_T
     unsigned n_ranges;
     const jfnt_codepoint_range* codepoint_ranges;
     int flip;
+    unsigned atlas_max_width;   //  Widest the atlas is allowed to get, 0 means JFNT_DEFAULT_ATLAS_MAX_WIDTH
+    unsigned atlas_padding;     //  Number of empty pixels left on the right and below each glyph in the atlas
+    int lazy;                   //  Keep the face open and rasterize glyphs outside codepoint_ranges when they are first
+                                //  looked up. Memory given to jfnt_font_create_from_memory must then outlive the font
+    unsigned thread_count;      //  Threads used to rasterize codepoint_ranges, 0 or 1 renders on the calling thread
+                                //  only. Allocator callbacks must be thread-safe when more threads are used
+    const char* cache_path;     //  File to map the atlas and glyphs from, if it was made with the same parameters from
+                                //  the same unmodified font file. Otherwise it is (re)written once the font is created.
+                                //  Fontconfig strings are matched first, so that the cache is not used once the string
+                                //  resolves to another file or face. Not used by lazy fonts
+    jfnt_render_mode render_mode;
+    unsigned sdf_spread;        //  Distance in pixels at which distance fields saturate, from 2 to 32, with 0 meaning
+                                //  JFNT_DEFAULT_SDF_SPREAD. Glyph bitmaps extend this much past the outline on each side
+    jfnt_context* context;      //  Context to share the FreeType library, fontconfig and open faces with other fonts. When
+                                //  NULL, the font gets its own
+    int fallback;               //  Take glyphs the matched face does not have from faces which fontconfig sorts after it,
+                                //  all into the same atlas. Only used by jfnt_font_create_from_fc_str
+    size_t atlas_budget;        //  Most pixels the atlas of a lazy font may have, with 0 meaning no limit. When set, the
+                                //  atlas is split into cells which fit any glyph of the face, and glyph i is always in cell
+                                //  i. Once all cells are taken, the glyph used the longest ago is evicted for a new one
+    void (*evicted)(jfnt_font* font, int index, char32_t codepoint, void* param);
+                                //  Called when the glyph at index is evicted, just before the index is given to a new glyph.
+                                //  It is called during a lookup, so it must not look up glyphs of the font itself
+    void* evicted_param;
+    jfnt_pixel_format pixel_format;
+    void* atlas_memory;         //  Memory the atlas is written into, such as a mapped staging buffer, instead of the font
+                                //  allocating its own. It must stay valid as long as the font. Cache is not used with it
+    size_t atlas_stride;        //  Bytes from one row of atlas_memory to the next, which also limits the atlas width
+    unsigned atlas_rows;        //  Number of rows atlas_memory has, beyond which the atlas can not grow
+    int collect_stats;          //  Time phases of creation and count glyphs, allocations and lookups, which can then be
+                                //  read with jfnt_font_get_stats. Fonts which do not collect them only pay for a branch
+    int concurrent;             //  Let any number of threads look glyphs up and lay text out with a lazy font at once,
+                                //  while glyphs are loaded or added with jfnt_font_add_ranges. Lookups which find a
+                                //  glyph take no locks, and tables that grew are kept until jfnt_font_reclaim. Faces
+                                //  without a kern table keep only the kerning of glyphs the font was created with
+    int cell_grid;              //  Render every glyph into a cell of average width x height pixels, positioned against
+                                //  the baseline, with glyph i always in cell i of a regular grid, as described by
+                                //  jfnt_font_get_cell_grid. Only for fonts which are not lazy and render coverage. Cache
+                                //  is not used with it
 };
 typedef struct jfnt_font_create_info_T jfnt_font_create_info;
 
@@ -76,7 +152,10 @@ jfnt_result jfnt_font_create_from_filename(
         const char* filename, unsigned char_size, jfnt_font_create_info create_info, jfnt_font** p_out);
 
 /*
- * Create from fontconfig string
+ * Create from fontconfig string. With the fallback flag of create info set, codepoints the best match has no glyphs for
+ * are looked for in the other faces given by FcFontSort, in the order of the sort, with the glyph's face member telling
+ * which one it was found in. Lazy fonts keep the sorted list and only open the faces from it once a codepoint is first
+ * found in their charset.
  */
 jfnt_result jfnt_font_create_from_fc_str(const char* fc_str, jfnt_font_create_info create_info, jfnt_font** p_out);
 
@@ -85,23 +164,239 @@ jfnt_result jfnt_font_create_from_fc_str(const char* fc_str, jfnt_font_create_in
  */
 void jfnt_font_destroy(jfnt_font* font);
 
+/*
+ * Find indices of glyphs for codepoints. Lazy fonts rasterize glyphs for codepoints they have not seen before, so these
+ * may add new glyphs to the font (see jfnt_font_take_new_glyphs)
+ *
+ * Fonts which are not lazy can be looked up from any number of threads, as long as no ranges are added to them. Lazy
+ * fonts need to be created as concurrent for that, in which case the atlas is still written to as glyphs are added, so
+ * it must only be read while no lookups are made, such as between frames.
+ */
 jfnt_result jfnt_font_find_glyphs_u32(
         const jfnt_font* font, char32_t unsupported_replace, size_t count, const char32_t* codepoints, int* p_indices);
 
+/*
+ * Find indices of glyphs for at most max_len codepoints of a null-terminated UTF-8 string. Overlong encodings,
+ * surrogates, codepoints above U+10FFFF and malformed or truncated sequences are rejected with JFNT_RESULT_BAD_ENCODING
+ */
 jfnt_result jfnt_font_find_glyphs_utf8(
         const jfnt_font* font, const char* utf8, char32_t unsupported_replace, size_t max_len, size_t* p_count,
         int* p_indices);
 
+/*
+ * State kept between chunks of a UTF-8 stream, which holds the beginning of a sequence cut off by the end of the last
+ * chunk. It must be reset before the first chunk. When the stream ends with count_pending not zero, the stream ended
+ * in the middle of a sequence.
+ */
+struct jfnt_utf8_stream_T
+{
+    unsigned char pending[4];
+    unsigned count_pending;
+};
+typedef struct jfnt_utf8_stream_T jfnt_utf8_stream;
+
+void jfnt_utf8_stream_reset(jfnt_utf8_stream* stream);
+
+/*
+ * Find indices of glyphs for the next chunk of size bytes of a UTF-8 stream. The chunk does not need to be
+ * null-terminated and may end in the middle of a sequence, in which case the rest of it is expected at the beginning
+ * of the next chunk. Stops once max_count indices are written to p_indices. Number of bytes of the chunk which were
+ * used up is returned through p_consumed, and the number of indices written through p_count.
+ *
+ * On JFNT_RESULT_BAD_ENCODING the stream is reset and *p_consumed is the position of the invalid sequence within the
+ * chunk. If the sequence began in an earlier chunk, it is instead the position right after the part of it which was in
+ * this chunk, so that decoding can continue from there.
+ */
+jfnt_result jfnt_font_find_glyphs_utf8_stream(
+        const jfnt_font* font, jfnt_utf8_stream* stream, size_t size, const char* utf8, char32_t unsupported_replace,
+        size_t max_count, int* p_indices, size_t* p_consumed, size_t* p_count);
+
 void
 jfnt_font_get_sizes(const jfnt_font* font, unsigned* p_height, unsigned* p_avg_w, unsigned* p_size_h, unsigned* p_size_v);
 
+struct jfnt_cell_grid_T
+{
+    unsigned cell_w, cell_h;    //  Size of a cell, which is the average width and the height of the font
+    unsigned pitch_x, pitch_y;  //  Distance between cells, which is their size with the padding of the atlas
+    unsigned columns;           //  Number of cells in a row of the atlas, which is even when there are wide glyphs
+};
+typedef struct jfnt_cell_grid_T jfnt_cell_grid;
+
+/*
+ * Describes the grid of a font created with cell_grid, so that glyph i is at (i % columns * pitch_x, i / columns *
+ * pitch_y) in the atlas, already positioned in its cell, and every cell of text is drawn the same way.
+ *
+ * Glyphs at least one and a half cells wide, such as CJK ideographs, take two cells and have an advance of two cells.
+ * Lookups find such a glyph at an even index, spanning both of its cells, while index + 1 is its right half alone,
+ * with an advance of zero, for renderers which draw every cell of the screen on its own. Returns
+ * JFNT_RESULT_UNSUPPORTED for fonts without a cell grid.
+ */
+jfnt_result jfnt_font_get_cell_grid(const jfnt_font* font, jfnt_cell_grid* p_grid);
+
 void
 jfnt_font_get_measures(const jfnt_font* font, unsigned* p_height, int* ascent, int* descent);
 
 const jfnt_glyph* jfnt_font_get_glyphs(const jfnt_font* font);
 
+unsigned jfnt_font_get_glyph_count(const jfnt_font* font);
+
+/*
+ * Returns the range of glyphs [*p_first, *p_first + *p_count) which a lazy font or jfnt_font_add_ranges added since the
+ * last call. When any were added, the atlas may have also grown, so jfnt_font_image should be called again. Fonts with
+ * an atlas budget only report indices which were not used before, so cells of evicted glyphs must be uploaded again
+ * once the evicted callback was called for them.
+ */
+void jfnt_font_take_new_glyphs(jfnt_font* font, unsigned* p_first, unsigned* p_count);
+
+/*
+ * Releases tables of glyphs which a concurrent font replaced as it grew. Pointers returned by jfnt_font_get_glyphs stay
+ * valid until then, so it must only be called when no other thread uses the font, such as between frames. Otherwise the
+ * tables are released with the font, and since each one is at least twice the size of the one before, they never take
+ * more memory than the current one.
+ */
+void jfnt_font_reclaim(jfnt_font* font);
+
+/*
+ * Returns the atlas, with pixels in the format the font was created with and rows laid out as given by
+ * jfnt_font_get_image_layout
+ */
 void jfnt_font_image(const jfnt_font* font, unsigned* p_width, unsigned* p_height, const unsigned char** p_data);
 
+/*
+ * Returns the number of bytes between rows of the atlas and the format of its pixels
+ */
+void jfnt_font_get_image_layout(const jfnt_font* font, size_t* p_stride, jfnt_pixel_format* p_format);
+
+/*
+ * Converts a w x h part of the atlas at (x, y) to one byte of coverage per pixel, with rows of dst dst_stride bytes
+ * apart, such as for uploading dirty rectangles of a packed atlas to an API which has no packed formats. Coverage of
+ * RGBA atlases is taken from their alpha.
+ */
+void jfnt_font_image_to_r8(
+        const jfnt_font* font, unsigned x, unsigned y, unsigned w, unsigned h, unsigned char* dst, size_t dst_stride);
+
+struct jfnt_atlas_rect_T
+{
+    unsigned x, y;
+    unsigned w, h;
+};
+typedef struct jfnt_atlas_rect_T jfnt_atlas_rect;
+
+/*
+ * Adds glyphs for codepoints in the ranges which the font does not have yet. They are rasterized with the same number of
+ * threads the font was created with and packed into free space of the atlas, which grows in height if they do not fit.
+ * New glyphs are appended after the existing ones, so indices of those stay valid. Codepoints the font has no glyphs for
+ * are reported to the error callbacks the same way as when the font is created.
+ *
+ * Parts of the atlas which were written to are returned through p_rects, which remains valid until the next call or
+ * until the font is destroyed, so that only those have to be uploaded again. If the height of the atlas changed, the
+ * texture must first be grown to the new size, keeping its contents, with the new part of it being zero.
+ *
+ * Fonts which are not lazy open their face again for this, so memory given to jfnt_font_create_from_memory must still
+ * be valid, and only a lazy font keeps the fallback chain. Fonts mapped from a cache file, with an atlas budget or with a
+ * cell grid can not have glyphs added.
+ */
+jfnt_result jfnt_font_add_ranges(
+        jfnt_font* font, unsigned n_ranges, const jfnt_codepoint_range* ranges, unsigned* p_count_rects,
+        const jfnt_atlas_rect** p_rects);
+
+/*
+ * Starts a new frame for a font with an atlas budget. Glyphs looked up during the current frame are never evicted, so
+ * that indices found during it stay valid until it ends, which means that all glyphs of one frame must fit into the
+ * atlas. Once they do not, lookups fail with JFNT_RESULT_ATLAS_FULL.
+ */
+void jfnt_font_next_frame(jfnt_font* font);
+
+struct jfnt_glyph_cache_stats_T
+{
+    size_t hits;        //  Lookups which found a glyph already in the atlas
+    size_t misses;      //  Glyphs rasterized because they were not in the atlas
+    size_t evictions;   //  Glyphs evicted to make room for others
+    unsigned cells;     //  Number of glyphs the atlas can hold at once
+};
+typedef struct jfnt_glyph_cache_stats_T jfnt_glyph_cache_stats;
+
+/*
+ * Returns counters of the glyph cache of a font with an atlas budget, which are all zero for other fonts
+ */
+void jfnt_font_get_glyph_cache_stats(const jfnt_font* font, jfnt_glyph_cache_stats* p_stats);
+
+enum jfnt_phase_T
+{
+    JFNT_PHASE_MATCH = 0,   //  Fontconfig matching, and sorting of the fallback chain
+    JFNT_PHASE_OPEN_FACE,   //  Opening faces, fallbacks included
+    JFNT_PHASE_METRICS,     //  Measuring the face for the sizes of the font
+    JFNT_PHASE_RASTERIZE,   //  Loading and rendering glyphs, lazily loaded ones included
+    JFNT_PHASE_PACK,        //  Placing glyphs in the atlas
+    JFNT_PHASE_BLIT,        //  Copying rendered glyphs into the atlas
+    JFNT_PHASE_KERNING,     //  Reading kerning pairs of the face
+    JFNT_PHASE_LOOKUP,      //  Building the table from codepoints to glyphs
+    JFNT_PHASE_CACHE,       //  Loading or storing the cache file
+
+    JFNT_PHASE_COUNT,
+};
+typedef enum jfnt_phase_T jfnt_phase;
+
+struct jfnt_font_stats_T
+{
+    uint64_t phase_ns[JFNT_PHASE_COUNT];    //  Time spent in each phase, measured with a monotonic clock
+    size_t glyphs_rasterized;               //  Glyphs rendered into the atlas
+    size_t glyphs_missed;                   //  Requested codepoints which the font has no glyph for
+    size_t glyphs_shared;                   //  Glyphs identical to another one, which share its place in the atlas
+    size_t bytes_shared;                    //  Atlas bytes the shared glyphs would have taken up otherwise
+    size_t allocations;                     //  Calls to allocate and reallocate of the allocator callbacks
+    size_t bytes_allocated;                 //  Bytes asked for by those, with reallocations counting their new size
+    size_t lookups;                         //  Codepoints looked up, replacements included
+    size_t lookups_loaded;                  //  Lookups which a lazy font had to load the glyph for
+    size_t lookups_unsupported;             //  Lookups which found no glyph, so the replacement was used instead
+    double atlas_fill;                      //  Same as returned by jfnt_font_get_atlas_usage
+};
+typedef struct jfnt_font_stats_T jfnt_font_stats;
+
+/*
+ * Returns the statistics of a font created with collect_stats set, which are all zero for other fonts. Timings and
+ * counters keep adding up after creation, as glyphs are looked up, loaded lazily or added with jfnt_font_add_ranges.
+ */
+void jfnt_font_get_stats(const jfnt_font* font, jfnt_font_stats* p_stats);
+
+/*
+ * Returns the name of the phase, such as "rasterize"
+ */
+const char* jfnt_phase_name(jfnt_phase phase);
+
+/*
+ * Returns the fraction of the atlas covered by glyph pixels, optionally also returning the pixel counts themselves
+ */
+double jfnt_font_get_atlas_usage(const jfnt_font* font, size_t* p_glyph_pixels, size_t* p_atlas_pixels);
+
+/*
+ * Returns the number of bytes used by the table mapping codepoints to glyphs. Table has one pointer per 256 codepoints
+ * up to the highest one in the font (up to U+10FFFF for lazy fonts) and a 1 KiB page for each block of 256 codepoints
+ * which has any glyphs, so it is at most (highest codepoint / 256 + 1) * (sizeof(void*) + 1024) bytes.
+ */
+size_t jfnt_font_get_lookup_memory(const jfnt_font* font);
+
+/*
+ * Returns how glyphs in the atlas were rendered, and for distance fields also their spread in pixels. Glyph metrics are
+ * in pixels at the size the font was created with, which is returned through p_pixel_size, so distance field glyphs
+ * drawn at another size are to be scaled by the ratio of the two sizes (see jfnt_layout_info.scale)
+ */
+jfnt_render_mode jfnt_font_get_render_mode(const jfnt_font* font, unsigned* p_spread, float* p_pixel_size);
+
+/*
+ * Finds kerning for each pair of consecutive glyphs in the run of glyph indices. Value p_kerning[i] is the horizontal
+ * adjustment in pixels to be added to the pen position between glyphs indices[i] and indices[i + 1], while the last
+ * element is always zero. Values are the same as given by FT_Get_Kerning in FT_KERNING_DEFAULT mode, but are looked up
+ * from a table extracted when the font was created.
+ */
+jfnt_result jfnt_font_get_kerning(const jfnt_font* font, size_t count, const int* indices, int* p_kerning);
+
+/*
+ * Returns the number of glyph pairs with non-zero kerning the font knows of. Kerning is only known between glyphs of the
+ * first face in the fallback chain.
+ */
+unsigned jfnt_font_get_kerning_pair_count(const jfnt_font* font);
+
 #ifdef __GNUC__
 __attribute__((format(printf, 5, 6)))
 #endif
@@ -0,0 +1,63 @@
+//
+// Created by jan on 17.10.2026.
+//
+
+#ifndef JFNT_JFNT_LAYOUT_H
+#define JFNT_JFNT_LAYOUT_H
+#include "jfnt_font.h"
+
+/*
+ * Glyph placed on the screen. Corners are given in pixels, texture coordinates are normalized to the size of the atlas
+ * and already account for glyphs being flipped in it, so (u0, v0) always belongs to the corner at (x0, y0)
+ */
+struct jfnt_quad_T
+{
+    float x0, y0;   //  Corner at the top of the glyph on the left
+    float x1, y1;   //  Corner at the bottom of the glyph on the right
+    float u0, v0;
+    float u1, v1;
+};
+typedef struct jfnt_quad_T jfnt_quad;
+
+struct jfnt_layout_info_T
+{
+    float origin_x;     //  Pen position of the first glyph, with y being on the baseline
+    float origin_y;
+    int y_up;           //  Pixel y coordinates grow upwards instead of downwards
+    int skip_empty;     //  Do not write quads for glyphs with no pixels, such as spaces
+    int kerning;        //  Move the pen by the kerning between each glyph and the one before it in the same call
+    float scale;        //  Factor by which glyph metrics are scaled, 0 means 1. Meant for distance field fonts
+    size_t stride;      //  Bytes from the beginning of one quad to the next one, 0 means sizeof(jfnt_quad). When it is
+                        //  larger, the rest of each element is left untouched, so other vertex attributes may go there
+};
+typedef struct jfnt_layout_info_T jfnt_layout_info;
+
+/*
+ * Places glyphs with given indices one after another, writing a quad for each into p_quads. Number of quads written
+ * is returned through p_written, which is count unless skip_empty is set. Pen position after the last glyph is returned
+ * through p_pen_x and p_pen_y, if they are not NULL, so that a line may be continued with another call.
+ *
+ * Texture coordinates are computed for the current size of the atlas, which for lazy fonts may grow when new glyphs
+ * are looked up, so these should be laid out only once they were all looked up.
+ */
+jfnt_result jfnt_layout_run(
+        const jfnt_font* font, const jfnt_layout_info* info, size_t count, const int* indices, void* p_quads,
+        size_t* p_written, float* p_pen_x, float* p_pen_y);
+
+/*
+ * Same as jfnt_layout_run, but looks up glyphs for the codepoints first. Glyphs are looked up in chunks, and when a
+ * lazy font's atlas grows while they are, quads laid out before are rescaled, so all of them are for its final size.
+ */
+jfnt_result jfnt_layout_run_u32(
+        const jfnt_font* font, const jfnt_layout_info* info, char32_t unsupported_replace, size_t count,
+        const char32_t* codepoints, void* p_quads, size_t* p_written, float* p_pen_x, float* p_pen_y);
+
+/*
+ * Same as jfnt_layout_run, but looks up glyphs for at most max_len codepoints of a null-terminated UTF-8 string first,
+ * in chunks the same way as jfnt_layout_run_u32 does
+ */
+jfnt_result jfnt_layout_run_utf8(
+        const jfnt_font* font, const jfnt_layout_info* info, const char* utf8, char32_t unsupported_replace,
+        size_t max_len, void* p_quads, size_t* p_written, float* p_pen_x, float* p_pen_y);
+
+#endif //JFNT_JFNT_LAYOUT_H
@@ -0,0 +1,165 @@
+//
+// Created by jan on 17.10.2026.
+//
+
+#include <stdint.h>
+#include <string.h>
+#include "jfnt_arena.h"
+
+enum {ARENA_MIN_BLOCK = 4096};
+
+//  Member of the union with the strictest alignment decides the alignment of all allocations
+union arena_max_align_T
+{
+    long double ld;
+    long long ll;
+    void* ptr;
+    void (*fn)(void);
+};
+typedef union arena_max_align_T arena_max_align;
+
+struct arena_align_probe_T
+{
+    char c;
+    arena_max_align a;
+};
+#define ARENA_ALIGN (offsetof(struct arena_align_probe_T, a))
+
+struct jfnt_arena_block_T
+{
+    jfnt_arena_block* prev;
+    size_t size;
+    size_t used;
+    arena_max_align data[];
+};
+
+static size_t arena_align(size_t size)
+{
+    return (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+static unsigned char* block_data(jfnt_arena_block* block)
+{
+    return (unsigned char*)block->data;
+}
+
+void jfnt_arena_init(jfnt_arena* this)
+{
+    *this = (jfnt_arena){0};
+}
+
+static jfnt_result arena_new_block(jfnt_arena* this, const jfnt_allocator_callbacks* allocator, size_t size)
+{
+    if (size < ARENA_MIN_BLOCK)
+    {
+        size = ARENA_MIN_BLOCK;
+    }
+    if (size > SIZE_MAX - sizeof(jfnt_arena_block))
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    jfnt_arena_block* const block = allocator->allocate(allocator->state, sizeof(*block) + size);
+    if (!block)
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    block->prev = this->current;
+    block->size = size;
+    block->used = 0;
+    this->current = block;
+    this->total_size += size;
+    this->count_blocks += 1;
+    this->count_allocations += 1;
+    return JFNT_RESULT_SUCCESS;
+}
+
+jfnt_result jfnt_arena_reserve(jfnt_arena* this, const jfnt_allocator_callbacks* allocator, size_t size)
+{
+    size = arena_align(size);
+    if (this->current && this->current->size - this->current->used >= size)
+    {
+        return JFNT_RESULT_SUCCESS;
+    }
+    return arena_new_block(this, allocator, size);
+}
+
+void* jfnt_arena_alloc(jfnt_arena* this, const jfnt_allocator_callbacks* allocator, size_t size)
+{
+    size = arena_align(size ? size : 1);
+    if (!this->current || this->current->size - this->current->used < size)
+    {
+        //  Blocks grow along with the arena, so a long run of allocations needs only a few of them
+        const size_t block_size = size > this->total_size ? size : this->total_size;
+        if (arena_new_block(this, allocator, block_size) != JFNT_RESULT_SUCCESS)
+        {
+            return NULL;
+        }
+    }
+    void* const ptr = block_data(this->current) + this->current->used;
+    this->current->used += size;
+    return ptr;
+}
+
+void* jfnt_arena_grow(jfnt_arena* this, const jfnt_allocator_callbacks* allocator, void* ptr, size_t old_size, size_t new_size)
+{
+    jfnt_arena_block* const block = this->current;
+    old_size = arena_align(old_size ? old_size : 1);
+    new_size = arena_align(new_size ? new_size : 1);
+    if (block && (unsigned char*)ptr + old_size == block_data(block) + block->used && block->size - block->used >= new_size - old_size)
+    {
+        block->used += new_size - old_size;
+        return ptr;
+    }
+    void* const new_ptr = jfnt_arena_alloc(this, allocator, new_size);
+    if (new_ptr)
+    {
+        memcpy(new_ptr, ptr, old_size);
+    }
+    return new_ptr;
+}
+
+jfnt_arena_mark jfnt_arena_get_mark(const jfnt_arena* this)
+{
+    return (jfnt_arena_mark){.block = this->current, .used = this->current ? this->current->used : 0};
+}
+
+void jfnt_arena_reset(jfnt_arena* this, const jfnt_allocator_callbacks* allocator, jfnt_arena_mark mark)
+{
+    if (!mark.block && this->count_blocks > 1)
+    {
+        //  Everything is released, so the blocks are merged into one which fits all that was needed
+        const size_t total_size = this->total_size;
+        jfnt_arena_destroy(this, allocator);
+        (void)arena_new_block(this, allocator, total_size);
+        return;
+    }
+    while (this->current && this->current != mark.block)
+    {
+        jfnt_arena_block* const prev = this->current->prev;
+        //  Empty arena keeps its first block, so that it can be reused
+        if (!prev)
+        {
+            break;
+        }
+        this->total_size -= this->current->size;
+        this->count_blocks -= 1;
+        allocator->deallocate(allocator->state, this->current);
+        this->current = prev;
+    }
+    if (this->current)
+    {
+        this->current->used = this->current == mark.block ? mark.used : 0;
+    }
+}
+
+void jfnt_arena_destroy(jfnt_arena* this, const jfnt_allocator_callbacks* allocator)
+{
+    while (this->current)
+    {
+        jfnt_arena_block* const prev = this->current->prev;
+        allocator->deallocate(allocator->state, this->current);
+        this->current = prev;
+    }
+    this->total_size = 0;
+    this->count_blocks = 0;
+}
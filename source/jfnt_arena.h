@@ -0,0 +1,51 @@
+//
+// Created by jan on 17.10.2026.
+//
+
+#ifndef JFNT_JFNT_ARENA_H
+#define JFNT_JFNT_ARENA_H
+#include <stddef.h>
+#include "../include/jfnt_font.h"
+
+//  Bump allocator for temporary memory. Allocations are released all at once by resetting the arena to a mark taken
+//  before them. Memory comes in blocks, and when more than one block was needed, resetting the arena to empty replaces
+//  them with a single block as big as all of them together, so that the same work fits into one block the next time.
+typedef struct jfnt_arena_block_T jfnt_arena_block;
+
+struct jfnt_arena_T
+{
+    jfnt_arena_block* current;      //  Block allocations are made from, which links to the ones filled before it
+    size_t total_size;              //  Combined size of all blocks
+    unsigned count_blocks;
+    size_t count_allocations;       //  Number of times a block was allocated, since the arena was created
+};
+typedef struct jfnt_arena_T jfnt_arena;
+
+struct jfnt_arena_mark_T
+{
+    const jfnt_arena_block* block;
+    size_t used;
+};
+typedef struct jfnt_arena_mark_T jfnt_arena_mark;
+
+void jfnt_arena_init(jfnt_arena* this);
+
+//  Makes sure that at least size bytes can be allocated without allocating another block
+jfnt_result jfnt_arena_reserve(jfnt_arena* this, const jfnt_allocator_callbacks* allocator, size_t size);
+
+//  Memory is aligned for any type and is valid until the arena is reset to a mark taken before it was allocated
+void* jfnt_arena_alloc(jfnt_arena* this, const jfnt_allocator_callbacks* allocator, size_t size);
+
+//  Grows the memory from the last allocation, in place if there is room after it. Otherwise new memory is allocated and
+//  old_size bytes copied to it, with the old memory only released once the arena is reset.
+void* jfnt_arena_grow(jfnt_arena* this, const jfnt_allocator_callbacks* allocator, void* ptr, size_t old_size, size_t new_size);
+
+jfnt_arena_mark jfnt_arena_get_mark(const jfnt_arena* this);
+
+//  Releases everything allocated after the mark was taken
+void jfnt_arena_reset(jfnt_arena* this, const jfnt_allocator_callbacks* allocator, jfnt_arena_mark mark);
+
+//  Releases all blocks
+void jfnt_arena_destroy(jfnt_arena* this, const jfnt_allocator_callbacks* allocator);
+
+#endif //JFNT_JFNT_ARENA_H
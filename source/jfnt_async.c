@@ -0,0 +1,460 @@
+//
+// Created by jan on 17.10.2026.
+//
+
+#include <string.h>
+#include <pthread.h>
+#include "../include/jfnt_async.h"
+
+struct jfnt_font_job_T
+{
+    jfnt_worker_pool* pool;
+    jfnt_font_job* next;            //  Next job in the queue of the pool
+
+    //  Members below are only changed with the lock of the pool held, except for canceled, which is also read by the
+    //  worker while it does not hold it
+    jfnt_font_job_state state;
+    int canceled;
+    int finished;                   //  Final state was set and the callback returned, so the worker is done with the job
+    int preview_ready;
+    int font_ready;
+    jfnt_result preview_result;
+    jfnt_result result;
+    jfnt_font* preview;             //  Set to NULL once it is taken
+    jfnt_font* font;
+
+    //  Copies of the job info, with strings and ranges in the same allocation as the job
+    const char* fc_str;
+    const char* filename;
+    const void* mem;
+    size_t mem_size;
+    unsigned char_size;
+    jfnt_font_create_info create_info;
+    jfnt_allocator_callbacks allocator_callbacks;
+    jfnt_error_callbacks error_callbacks;
+    unsigned n_preview_ranges;
+    const jfnt_codepoint_range* preview_ranges;
+    void (*callback)(jfnt_font_job* job, jfnt_font_job_state state, void* param);
+    void* callback_param;
+};
+
+struct jfnt_worker_pool_T
+{
+    jfnt_allocator_callbacks allocator_callbacks;
+    pthread_mutex_t lock;
+    pthread_cond_t queued;      //  Signaled when a job is queued, or when the pool is stopping
+    pthread_cond_t changed;     //  Broadcast when anything a job can be waited for changes
+    jfnt_font_job* first;
+    jfnt_font_job* last;
+    int stopping;
+    unsigned count_threads;
+    pthread_t* threads;
+};
+
+static void* pool_alloc(const jfnt_worker_pool* this, size_t size)
+{
+    return this->allocator_callbacks.allocate(this->allocator_callbacks.state, size);
+}
+
+static void pool_free(const jfnt_worker_pool* this, void* ptr)
+{
+    this->allocator_callbacks.deallocate(this->allocator_callbacks.state, ptr);
+}
+
+//  Creates one of the fonts of the job, unless it was canceled before. When it is canceled while the font is created,
+//  the font is destroyed once it is done.
+static jfnt_result job_create_font(jfnt_font_job* job, jfnt_font_create_info create_info, jfnt_font** p_out)
+{
+    if (__atomic_load_n(&job->canceled, __ATOMIC_ACQUIRE))
+    {
+        return JFNT_RESULT_CANCELED;
+    }
+    jfnt_font* font = NULL;
+    jfnt_result res;
+    if (job->fc_str)
+    {
+        res = jfnt_font_create_from_fc_str(job->fc_str, create_info, &font);
+    }
+    else if (job->filename)
+    {
+        res = jfnt_font_create_from_filename(job->filename, job->char_size, create_info, &font);
+    }
+    else
+    {
+        res = jfnt_font_create_from_memory(job->mem_size, job->mem, job->char_size, create_info, &font);
+    }
+    if (__atomic_load_n(&job->canceled, __ATOMIC_ACQUIRE))
+    {
+        if (res == JFNT_RESULT_SUCCESS)
+        {
+            jfnt_font_destroy(font);
+        }
+        return JFNT_RESULT_CANCELED;
+    }
+    if (res == JFNT_RESULT_SUCCESS)
+    {
+        *p_out = font;
+    }
+    return res;
+}
+
+//  Sets the final state of the job, calls the callback with it without the lock held, and then marks the job as
+//  finished. Called with the lock held, which is held again once it returns.
+static void job_finish(jfnt_font_job* job, jfnt_font_job_state state)
+{
+    jfnt_worker_pool* const pool = job->pool;
+    job->state = state;
+    pthread_cond_broadcast(&pool->changed);
+    if (job->callback)
+    {
+        pthread_mutex_unlock(&pool->lock);
+        job->callback(job, state, job->callback_param);
+        pthread_mutex_lock(&pool->lock);
+    }
+    job->finished = 1;
+    pthread_cond_broadcast(&pool->changed);
+}
+
+static void job_run(jfnt_font_job* job)
+{
+    jfnt_worker_pool* const pool = job->pool;
+    jfnt_result res;
+    if (job->n_preview_ranges)
+    {
+        jfnt_font_create_info preview_info = job->create_info;
+        preview_info.n_ranges = job->n_preview_ranges;
+        preview_info.codepoint_ranges = job->preview_ranges;
+        //  Cache is made for the ranges of the full font
+        preview_info.cache_path = NULL;
+        jfnt_font* preview = NULL;
+        res = job_create_font(job, preview_info, &preview);
+        pthread_mutex_lock(&pool->lock);
+        job->preview = preview;
+        job->preview_result = res;
+        job->preview_ready = 1;
+        if (res == JFNT_RESULT_SUCCESS)
+        {
+            job->state = JFNT_FONT_JOB_PREVIEW_READY;
+        }
+        pthread_cond_broadcast(&pool->changed);
+        pthread_mutex_unlock(&pool->lock);
+        if (res == JFNT_RESULT_SUCCESS && job->callback)
+        {
+            job->callback(job, JFNT_FONT_JOB_PREVIEW_READY, job->callback_param);
+        }
+    }
+
+    jfnt_font* font = NULL;
+    res = job_create_font(job, job->create_info, &font);
+    pthread_mutex_lock(&pool->lock);
+    job->font = font;
+    job->result = res;
+    job->font_ready = 1;
+    job_finish(job, res == JFNT_RESULT_SUCCESS ? JFNT_FONT_JOB_DONE
+                    : res == JFNT_RESULT_CANCELED ? JFNT_FONT_JOB_CANCELED : JFNT_FONT_JOB_FAILED);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void* worker_main(void* param)
+{
+    jfnt_worker_pool* const pool = param;
+    pthread_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (!pool->first && !pool->stopping)
+        {
+            pthread_cond_wait(&pool->queued, &pool->lock);
+        }
+        jfnt_font_job* const job = pool->first;
+        if (!job)
+        {
+            break;
+        }
+        pool->first = job->next;
+        if (!pool->first)
+        {
+            pool->last = NULL;
+        }
+        job->next = NULL;
+        job->state = JFNT_FONT_JOB_RUNNING;
+        pthread_cond_broadcast(&pool->changed);
+        pthread_mutex_unlock(&pool->lock);
+        job_run(job);
+        pthread_mutex_lock(&pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+jfnt_result jfnt_worker_pool_create(
+        const jfnt_allocator_callbacks* allocator_callbacks, unsigned thread_count, jfnt_worker_pool** p_out)
+{
+    if (!allocator_callbacks)
+    {
+        allocator_callbacks = &DEFAULT_ALLOCATOR;
+    }
+    if (!thread_count)
+    {
+        thread_count = 1;
+    }
+    jfnt_worker_pool* const this = allocator_callbacks->allocate(allocator_callbacks->state, sizeof(*this));
+    if (!this)
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    memset(this, 0, sizeof(*this));
+    this->allocator_callbacks = *allocator_callbacks;
+    this->threads = pool_alloc(this, sizeof(*this->threads) * thread_count);
+    if (!this->threads)
+    {
+        pool_free(this, this);
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    if (pthread_mutex_init(&this->lock, NULL) != 0)
+    {
+        pool_free(this, this->threads);
+        pool_free(this, this);
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    if (pthread_cond_init(&this->queued, NULL) != 0)
+    {
+        pthread_mutex_destroy(&this->lock);
+        pool_free(this, this->threads);
+        pool_free(this, this);
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    if (pthread_cond_init(&this->changed, NULL) != 0)
+    {
+        pthread_cond_destroy(&this->queued);
+        pthread_mutex_destroy(&this->lock);
+        pool_free(this, this->threads);
+        pool_free(this, this);
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    //  Pool works with fewer threads than asked for, as long as it has at least one
+    for (; this->count_threads < thread_count; ++this->count_threads)
+    {
+        if (pthread_create(this->threads + this->count_threads, NULL, worker_main, this) != 0)
+        {
+            break;
+        }
+    }
+    if (!this->count_threads)
+    {
+        jfnt_worker_pool_destroy(this);
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    *p_out = this;
+    return JFNT_RESULT_SUCCESS;
+}
+
+void jfnt_worker_pool_destroy(jfnt_worker_pool* pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->queued);
+    pthread_mutex_unlock(&pool->lock);
+    for (unsigned i = 0; i < pool->count_threads; ++i)
+    {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_cond_destroy(&pool->changed);
+    pthread_cond_destroy(&pool->queued);
+    pthread_mutex_destroy(&pool->lock);
+    pool_free(pool, pool->threads);
+    pool_free(pool, pool);
+}
+
+jfnt_result jfnt_font_create_async(jfnt_worker_pool* pool, const jfnt_font_job_info* info, jfnt_font_job** p_out)
+{
+    if (!info->fc_str && !info->filename && !info->mem)
+    {
+        return JFNT_RESULT_BAD_ARGUMENT;
+    }
+    if (info->n_preview_ranges && (!info->preview_ranges || info->create_info.atlas_memory))
+    {
+        return JFNT_RESULT_BAD_ARGUMENT;
+    }
+    const jfnt_font_create_info* const create_info = &info->create_info;
+    const char* const name = info->fc_str ? info->fc_str : info->filename;
+    const size_t len_name = name ? strlen(name) + 1 : 0;
+    const size_t len_cache = create_info->cache_path ? strlen(create_info->cache_path) + 1 : 0;
+    const size_t size_ranges = sizeof(jfnt_codepoint_range) * (create_info->n_ranges + info->n_preview_ranges);
+    jfnt_font_job* const this = pool_alloc(pool, sizeof(*this) + size_ranges + len_name + len_cache);
+    if (!this)
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    memset(this, 0, sizeof(*this));
+    jfnt_codepoint_range* const ranges = (jfnt_codepoint_range*)(this + 1);
+    char* const strings = (char*)(ranges + create_info->n_ranges + info->n_preview_ranges);
+    if (create_info->n_ranges)
+    {
+        memcpy(ranges, create_info->codepoint_ranges, sizeof(*ranges) * create_info->n_ranges);
+    }
+    if (info->n_preview_ranges)
+    {
+        memcpy(ranges + create_info->n_ranges, info->preview_ranges, sizeof(*ranges) * info->n_preview_ranges);
+    }
+    if (len_name)
+    {
+        memcpy(strings, name, len_name);
+    }
+    if (len_cache)
+    {
+        memcpy(strings + len_name, create_info->cache_path, len_cache);
+    }
+
+    this->pool = pool;
+    this->state = JFNT_FONT_JOB_QUEUED;
+    this->fc_str = info->fc_str ? strings : NULL;
+    this->filename = !info->fc_str && info->filename ? strings : NULL;
+    this->mem = info->mem;
+    this->mem_size = info->mem_size;
+    this->char_size = info->char_size;
+    this->create_info = *create_info;
+    this->create_info.codepoint_ranges = ranges;
+    this->create_info.cache_path = len_cache ? strings + len_name : NULL;
+    if (create_info->allocator_callbacks)
+    {
+        this->allocator_callbacks = *create_info->allocator_callbacks;
+        this->create_info.allocator_callbacks = &this->allocator_callbacks;
+    }
+    if (create_info->error_callbacks)
+    {
+        this->error_callbacks = *create_info->error_callbacks;
+        this->create_info.error_callbacks = &this->error_callbacks;
+    }
+    this->n_preview_ranges = info->n_preview_ranges;
+    this->preview_ranges = ranges + create_info->n_ranges;
+    this->callback = info->callback;
+    this->callback_param = info->callback_param;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->last)
+    {
+        pool->last->next = this;
+    }
+    else
+    {
+        pool->first = this;
+    }
+    pool->last = this;
+    pthread_cond_signal(&pool->queued);
+    pthread_mutex_unlock(&pool->lock);
+    *p_out = this;
+    return JFNT_RESULT_SUCCESS;
+}
+
+jfnt_font_job_state jfnt_font_job_poll(const jfnt_font_job* job)
+{
+    pthread_mutex_lock(&job->pool->lock);
+    const jfnt_font_job_state state = job->state;
+    pthread_mutex_unlock(&job->pool->lock);
+    return state;
+}
+
+jfnt_font_job_state jfnt_font_job_wait(jfnt_font_job* job)
+{
+    jfnt_worker_pool* const pool = job->pool;
+    pthread_mutex_lock(&pool->lock);
+    while (!job->finished)
+    {
+        pthread_cond_wait(&pool->changed, &pool->lock);
+    }
+    const jfnt_font_job_state state = job->state;
+    pthread_mutex_unlock(&pool->lock);
+    return state;
+}
+
+void jfnt_font_job_cancel(jfnt_font_job* job)
+{
+    jfnt_worker_pool* const pool = job->pool;
+    pthread_mutex_lock(&pool->lock);
+    __atomic_store_n(&job->canceled, 1, __ATOMIC_RELEASE);
+    if (job->state == JFNT_FONT_JOB_QUEUED)
+    {
+        //  No worker has it yet, so it is taken out of the queue and ends here
+        jfnt_font_job* prev = NULL;
+        for (jfnt_font_job* it = pool->first; it != job; it = it->next)
+        {
+            prev = it;
+        }
+        if (prev)
+        {
+            prev->next = job->next;
+        }
+        else
+        {
+            pool->first = job->next;
+        }
+        if (pool->last == job)
+        {
+            pool->last = prev;
+        }
+        job->next = NULL;
+        job->preview_result = JFNT_RESULT_CANCELED;
+        job->preview_ready = 1;
+        job->result = JFNT_RESULT_CANCELED;
+        job->font_ready = 1;
+        job_finish(job, JFNT_FONT_JOB_CANCELED);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+//  Takes the font once it is ready, keeping the result of its creation for the next call, which then finds it was taken
+static jfnt_result job_take(
+        jfnt_font_job* job, const int* p_ready, const jfnt_result* p_result, jfnt_font** p_font, jfnt_font** p_out)
+{
+    jfnt_worker_pool* const pool = job->pool;
+    pthread_mutex_lock(&pool->lock);
+    while (!*p_ready)
+    {
+        pthread_cond_wait(&pool->changed, &pool->lock);
+    }
+    jfnt_result res = *p_result;
+    if (res == JFNT_RESULT_SUCCESS)
+    {
+        if (*p_font)
+        {
+            *p_out = *p_font;
+            *p_font = NULL;
+        }
+        else
+        {
+            res = JFNT_RESULT_BAD_ARGUMENT;
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return res;
+}
+
+jfnt_result jfnt_font_job_take_preview(jfnt_font_job* job, jfnt_font** p_out)
+{
+    if (!job->n_preview_ranges)
+    {
+        return JFNT_RESULT_BAD_ARGUMENT;
+    }
+    return job_take(job, &job->preview_ready, &job->preview_result, &job->preview, p_out);
+}
+
+jfnt_result jfnt_font_job_take_font(jfnt_font_job* job, jfnt_font** p_out)
+{
+    return job_take(job, &job->font_ready, &job->result, &job->font, p_out);
+}
+
+void jfnt_font_job_destroy(jfnt_font_job* job)
+{
+    jfnt_font_job_cancel(job);
+    jfnt_font_job_wait(job);
+    //  Worker is done with the job, so nothing else uses it
+    if (job->preview)
+    {
+        jfnt_font_destroy(job->preview);
+    }
+    if (job->font)
+    {
+        jfnt_font_destroy(job->font);
+    }
+    pool_free(job->pool, job);
+}
@@ -0,0 +1,415 @@
+//
+// Created by jan on 17.10.2026.
+//
+
+#include <assert.h>
+#include <string.h>
+#include "jfnt_atlas.h"
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+
+jfnt_result jfnt_skyline_init(jfnt_skyline* this, const jfnt_allocator_callbacks* allocator, unsigned width, unsigned padding)
+{
+    this->capacity_nodes = 64;
+    this->nodes = allocator->allocate(allocator->state, sizeof(*this->nodes) * this->capacity_nodes);
+    if (!this->nodes)
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    this->width = width;
+    this->height = 0;
+    this->padding = padding;
+    this->count_nodes = 1;
+    this->nodes[0] = (jfnt_skyline_node){.x = 0, .y = 0, .width = width};
+    this->used_area = 0;
+    return JFNT_RESULT_SUCCESS;
+}
+
+void jfnt_skyline_destroy(jfnt_skyline* this, const jfnt_allocator_callbacks* allocator)
+{
+    allocator->deallocate(allocator->state, this->nodes);
+    this->nodes = NULL;
+    this->count_nodes = 0;
+    this->capacity_nodes = 0;
+}
+
+//  Returns the lowest y at which a rectangle of width w can be placed starting on node i, or -1 if it does not fit
+static long skyline_fit(const jfnt_skyline* this, unsigned i, unsigned w)
+{
+    const unsigned x = this->nodes[i].x;
+    if (x + w > this->width)
+    {
+        return -1;
+    }
+    unsigned y = 0;
+    unsigned remaining = w;
+    for (unsigned j = i; j < this->count_nodes && remaining; ++j)
+    {
+        const jfnt_skyline_node node = this->nodes[j];
+        if (node.y > y)
+        {
+            y = node.y;
+        }
+        if (node.width >= remaining)
+        {
+            break;
+        }
+        remaining -= node.width;
+    }
+    return (long)y;
+}
+
+//  Finds the node a padded rectangle pw x ph ends up the lowest on, and where its bottom edge would be. The rectangle
+//  must not be wider than the skyline.
+static unsigned skyline_find(const jfnt_skyline* this, unsigned pw, unsigned ph, unsigned long* p_top)
+{
+    unsigned best = this->count_nodes;
+    unsigned long best_top = (unsigned long)-1;
+    for (unsigned i = 0; i < this->count_nodes; ++i)
+    {
+        const long y = skyline_fit(this, i, pw);
+        if (y < 0)
+        {
+            //  Nodes are sorted by x, so none of the following ones will fit either
+            break;
+        }
+        if ((unsigned long)y + ph < best_top)
+        {
+            best_top = (unsigned long)y + ph;
+            best = i;
+        }
+    }
+    assert(best != this->count_nodes);
+    *p_top = best_top;
+    return best;
+}
+
+jfnt_result jfnt_skyline_height_after(const jfnt_skyline* this, unsigned w, unsigned h, unsigned* p_height)
+{
+    if (w == 0 || h == 0)
+    {
+        *p_height = this->height;
+        return JFNT_RESULT_SUCCESS;
+    }
+    if (w + this->padding > this->width)
+    {
+        return JFNT_RESULT_ATLAS_FULL;
+    }
+    unsigned long top;
+    (void)skyline_find(this, w + this->padding, h + this->padding, &top);
+    *p_height = top > this->height ? (unsigned)top : this->height;
+    return JFNT_RESULT_SUCCESS;
+}
+
+jfnt_result jfnt_skyline_insert(
+        jfnt_skyline* this, const jfnt_allocator_callbacks* allocator, unsigned w, unsigned h, unsigned* p_x,
+        unsigned* p_y)
+{
+    if (w == 0 || h == 0)
+    {
+        //  Nothing to draw, so no need to take up any space
+        *p_x = 0;
+        *p_y = 0;
+        return JFNT_RESULT_SUCCESS;
+    }
+    const unsigned pw = w + this->padding;
+    const unsigned ph = h + this->padding;
+    if (pw > this->width)
+    {
+        return JFNT_RESULT_ATLAS_FULL;
+    }
+
+    unsigned long best_top;
+    const unsigned best = skyline_find(this, pw, ph, &best_top);
+
+    if (this->count_nodes == this->capacity_nodes)
+    {
+        const unsigned new_capacity = this->capacity_nodes * 2;
+        jfnt_skyline_node* const new_nodes = allocator->reallocate(allocator->state, this->nodes, sizeof(*new_nodes) * new_capacity);
+        if (!new_nodes)
+        {
+            return JFNT_RESULT_BAD_ALLOC;
+        }
+        this->nodes = new_nodes;
+        this->capacity_nodes = new_capacity;
+    }
+
+    const unsigned x = this->nodes[best].x;
+    const unsigned y = (unsigned)best_top - ph;
+    memmove(this->nodes + best + 1, this->nodes + best, sizeof(*this->nodes) * (this->count_nodes - best));
+    this->nodes[best] = (jfnt_skyline_node){.x = x, .y = (unsigned)best_top, .width = pw};
+    this->count_nodes += 1;
+
+    //  Trim or remove the nodes now covered by the new one
+    unsigned i = best + 1;
+    while (i < this->count_nodes)
+    {
+        const jfnt_skyline_node prev = this->nodes[i - 1];
+        jfnt_skyline_node* const node = this->nodes + i;
+        const unsigned prev_end = prev.x + prev.width;
+        if (node->x >= prev_end)
+        {
+            break;
+        }
+        const unsigned shrink = prev_end - node->x;
+        if (node->width > shrink)
+        {
+            node->x += shrink;
+            node->width -= shrink;
+            break;
+        }
+        memmove(this->nodes + i, this->nodes + i + 1, sizeof(*this->nodes) * (this->count_nodes - i - 1));
+        this->count_nodes -= 1;
+    }
+
+    //  Merge neighbours at the same height
+    for (unsigned j = 0; j + 1 < this->count_nodes;)
+    {
+        if (this->nodes[j].y == this->nodes[j + 1].y)
+        {
+            this->nodes[j].width += this->nodes[j + 1].width;
+            memmove(this->nodes + j + 1, this->nodes + j + 2, sizeof(*this->nodes) * (this->count_nodes - j - 2));
+            this->count_nodes -= 1;
+        }
+        else
+        {
+            j += 1;
+        }
+    }
+
+    if (best_top > this->height)
+    {
+        this->height = (unsigned)best_top;
+    }
+    this->used_area += (size_t)w * h;
+    *p_x = x;
+    *p_y = y;
+    return JFNT_RESULT_SUCCESS;
+}
+
+unsigned jfnt_skyline_pick_width(unsigned max_width, unsigned widest, size_t total_area)
+{
+    unsigned width = 1;
+    while (width < widest || (size_t)width * width < total_area)
+    {
+        width <<= 1;
+    }
+    if (width > max_width)
+    {
+        width = max_width;
+    }
+    return width;
+}
+
+unsigned jfnt_pixel_format_bits(jfnt_pixel_format format)
+{
+    switch (format)
+    {
+    case JFNT_PIXEL_FORMAT_R8:
+        return 8;
+    case JFNT_PIXEL_FORMAT_RGBA8:
+    case JFNT_PIXEL_FORMAT_RGBA8_PREMULTIPLIED:
+        return 32;
+    case JFNT_PIXEL_FORMAT_R4:
+        return 4;
+    case JFNT_PIXEL_FORMAT_R1:
+        return 1;
+    }
+    return 0;
+}
+
+size_t jfnt_row_size(jfnt_pixel_format format, unsigned width)
+{
+    return ((size_t)width * jfnt_pixel_format_bits(format) + 7) / 8;
+}
+
+//  Rounds 8-bit coverage to the nearest of 16 levels
+static unsigned char coverage_to_r4(unsigned char v)
+{
+    return (unsigned char)((v * 15u + 127u) / 255u);
+}
+
+//  Writes a single pixel of a format with several of them in a byte
+static void packed_set(unsigned char* row, jfnt_pixel_format format, unsigned x, unsigned char v)
+{
+    if (format == JFNT_PIXEL_FORMAT_R4)
+    {
+        const unsigned shift = x & 1 ? 0 : 4;
+        row[x / 2] = (unsigned char)((row[x / 2] & ~(0x0F << shift)) | (coverage_to_r4(v) << shift));
+    }
+    else
+    {
+        const unsigned char bit = (unsigned char)(0x80 >> (x & 7));
+        row[x / 8] = (unsigned char)(v >= 0x80 ? row[x / 8] | bit : row[x / 8] & ~bit);
+    }
+}
+
+//  Reads a single pixel of a format with several of them in a byte, as 8-bit coverage
+static unsigned char packed_get(const unsigned char* row, jfnt_pixel_format format, unsigned x)
+{
+    if (format == JFNT_PIXEL_FORMAT_R4)
+    {
+        return (unsigned char)(((row[x / 2] >> (x & 1 ? 0 : 4)) & 0x0F) * 17);
+    }
+    return row[x / 8] & (0x80 >> (x & 7)) ? 0xFF : 0;
+}
+
+void jfnt_bitmap_blit(
+        const jfnt_bitmap* this, unsigned x, unsigned y, const unsigned char* src, ptrdiff_t src_stride, unsigned w,
+        unsigned h, int flip)
+{
+    const unsigned bits = jfnt_pixel_format_bits(this->format);
+    for (unsigned row = 0; row < h; ++row)
+    {
+        const unsigned char* const s = src + (ptrdiff_t)(flip ? h - row - 1 : row) * src_stride;
+        unsigned char* const r = this->data + (size_t)(y + row) * this->stride;
+        unsigned char* const d = r + (size_t)x * bits / 8;
+        switch (this->format)
+        {
+        case JFNT_PIXEL_FORMAT_R8:
+            memcpy(d, s, w);
+            break;
+        case JFNT_PIXEL_FORMAT_RGBA8:
+            for (unsigned i = 0; i < w; ++i)
+            {
+                d[4 * i + 0] = 0xFF;
+                d[4 * i + 1] = 0xFF;
+                d[4 * i + 2] = 0xFF;
+                d[4 * i + 3] = s[i];
+            }
+            break;
+        case JFNT_PIXEL_FORMAT_RGBA8_PREMULTIPLIED:
+            for (unsigned i = 0; i < w; ++i)
+            {
+                memset(d + 4 * i, s[i], 4);
+            }
+            break;
+        case JFNT_PIXEL_FORMAT_R4:
+        case JFNT_PIXEL_FORMAT_R1:
+            //  Glyphs next to each other can share bytes, so only their own bits are written
+            for (unsigned i = 0; i < w; ++i)
+            {
+                packed_set(r, this->format, x + i, s[i]);
+            }
+            break;
+        }
+    }
+}
+
+void jfnt_bitmap_clear(const jfnt_bitmap* this, unsigned x, unsigned y, unsigned w, unsigned h)
+{
+    const unsigned bits = jfnt_pixel_format_bits(this->format);
+    for (unsigned row = 0; row < h; ++row)
+    {
+        unsigned char* const r = this->data + (size_t)(y + row) * this->stride;
+        unsigned char* const d = r + (size_t)x * bits / 8;
+        if (this->format == JFNT_PIXEL_FORMAT_RGBA8)
+        {
+            //  Empty pixels are transparent white, so that filtering does not darken the edges of glyphs
+            for (unsigned i = 0; i < w; ++i)
+            {
+                d[4 * i + 0] = 0xFF;
+                d[4 * i + 1] = 0xFF;
+                d[4 * i + 2] = 0xFF;
+                d[4 * i + 3] = 0;
+            }
+        }
+        else if (bits >= 8)
+        {
+            memset(d, 0, (size_t)w * bits / 8);
+        }
+        else
+        {
+            for (unsigned i = 0; i < w; ++i)
+            {
+                packed_set(r, this->format, x + i, 0);
+            }
+        }
+    }
+}
+
+//  Expands whole bytes of packed pixels, 16 bytes at a time with SSE2, returning the number of bytes done
+#ifdef __SSE2__
+static size_t expand_r4_sse2(const unsigned char* src, size_t count, unsigned char* dst)
+{
+    const __m128i low_nibbles = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        const __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), low_nibbles);
+        const __m128i lo = _mm_and_si128(v, low_nibbles);
+        //  Level l becomes l * 17, which maps 15 to 255
+        __m128i a = _mm_unpacklo_epi8(hi, lo);
+        __m128i b = _mm_unpackhi_epi8(hi, lo);
+        a = _mm_or_si128(a, _mm_slli_epi16(a, 4));
+        b = _mm_or_si128(b, _mm_slli_epi16(b, 4));
+        _mm_storeu_si128((__m128i*)(dst + 2 * i), a);
+        _mm_storeu_si128((__m128i*)(dst + 2 * i + 16), b);
+    }
+    return i;
+}
+
+static size_t expand_r1_sse2(const unsigned char* src, size_t count, unsigned char* dst)
+{
+    const __m128i bits = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, (char)128, 1, 2, 4, 8, 16, 32, 64, (char)128);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2)
+    {
+        //  Each of the two bytes is repeated eight times, then every copy is tested for its own bit
+        __m128i v = _mm_cvtsi32_si128(src[i] | src[i + 1] << 8);
+        v = _mm_unpacklo_epi8(v, v);
+        v = _mm_unpacklo_epi16(v, v);
+        v = _mm_unpacklo_epi32(v, v);
+        v = _mm_cmpeq_epi8(_mm_and_si128(v, bits), bits);
+        _mm_storeu_si128((__m128i*)(dst + 8 * i), v);
+    }
+    return i;
+}
+#endif
+
+void jfnt_bitmap_read_r8(
+        const jfnt_bitmap* this, unsigned x, unsigned y, unsigned w, unsigned h, unsigned char* dst, size_t dst_stride)
+{
+    const unsigned bits = jfnt_pixel_format_bits(this->format);
+    for (unsigned row = 0; row < h; ++row)
+    {
+        const unsigned char* const r = this->data + (size_t)(y + row) * this->stride;
+        unsigned char* const d = dst + row * dst_stride;
+        if (bits >= 8)
+        {
+            const unsigned char* const s = r + (size_t)x * bits / 8;
+            if (bits == 8)
+            {
+                memcpy(d, s, w);
+            }
+            for (unsigned i = 0; bits == 32 && i < w; ++i)
+            {
+                d[i] = s[4 * i + 3];
+            }
+            continue;
+        }
+        const unsigned per_byte = 8 / bits;
+        unsigned i = 0;
+        //  Pixels up to the first whole byte, then whole bytes, then what is left of the last byte
+        for (; i < w && (x + i) % per_byte; ++i)
+        {
+            d[i] = packed_get(r, this->format, x + i);
+        }
+        const unsigned char* const s = r + (x + i) / per_byte;
+        const size_t whole = (w - i) / per_byte;
+        size_t done = 0;
+#ifdef __SSE2__
+        done = this->format == JFNT_PIXEL_FORMAT_R4 ? expand_r4_sse2(s, whole, d + i) : expand_r1_sse2(s, whole, d + i);
+#endif
+        for (unsigned j = (unsigned)(done * per_byte); j < whole * per_byte; ++j)
+        {
+            d[i + j] = packed_get(s, this->format, j);
+        }
+        for (i += (unsigned)(whole * per_byte); i < w; ++i)
+        {
+            d[i] = packed_get(r, this->format, x + i);
+        }
+    }
+}
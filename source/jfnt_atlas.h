@@ -0,0 +1,82 @@
+//
+// Created by jan on 17.10.2026.
+//
+
+#ifndef JFNT_JFNT_ATLAS_H
+#define JFNT_JFNT_ATLAS_H
+#include <stddef.h>
+#include "../include/jfnt_font.h"
+
+//  Atlas image, with rows stride bytes apart and pixels in the given format. Memory given through create info is not
+//  owned by the font, and can only be grown up to capacity_rows.
+struct jfnt_bitmap_T
+{
+    unsigned width;
+    unsigned height;
+    size_t stride;
+    jfnt_pixel_format format;
+    int external;
+    unsigned capacity_rows;
+    unsigned char* data;
+};
+typedef struct jfnt_bitmap_T jfnt_bitmap;
+
+//  Bytes taken by a row of width pixels of the format
+size_t jfnt_row_size(jfnt_pixel_format format, unsigned width);
+
+//  Writes a w x h block of 8-bit values at (x, y), converting them to the format of the bitmap, with rows of src
+//  src_stride bytes apart, which may be negative. When flip is set, the order of rows is reversed.
+void jfnt_bitmap_blit(
+        const jfnt_bitmap* this, unsigned x, unsigned y, const unsigned char* src, ptrdiff_t src_stride, unsigned w,
+        unsigned h, int flip);
+
+//  Fills a w x h block at (x, y) with pixels which have no coverage
+void jfnt_bitmap_clear(const jfnt_bitmap* this, unsigned x, unsigned y, unsigned w, unsigned h);
+
+//  Converts a w x h block at (x, y) to 8-bit coverage, with rows of dst dst_stride bytes apart
+void jfnt_bitmap_read_r8(
+        const jfnt_bitmap* this, unsigned x, unsigned y, unsigned w, unsigned h, unsigned char* dst, size_t dst_stride);
+
+//  Skyline bottom-left rectangle packer used to place glyphs into the atlas. The skyline is the list of segments
+//  describing the top edge of the already packed area, so each new rectangle is put on the segment where it ends up
+//  the lowest.
+struct jfnt_skyline_node_T
+{
+    unsigned x;
+    unsigned y;
+    unsigned width;
+};
+typedef struct jfnt_skyline_node_T jfnt_skyline_node;
+
+struct jfnt_skyline_T
+{
+    unsigned width;
+    unsigned height;
+    unsigned padding;
+    unsigned count_nodes;
+    unsigned capacity_nodes;
+    jfnt_skyline_node* nodes;
+    size_t used_area;
+};
+typedef struct jfnt_skyline_T jfnt_skyline;
+
+jfnt_result jfnt_skyline_init(jfnt_skyline* this, const jfnt_allocator_callbacks* allocator, unsigned width, unsigned padding);
+
+//  Places a rectangle w x h (plus padding on its right and bottom) and returns its top-left corner. Height of the
+//  skyline is unbounded, so this only fails if the rectangle is wider than the atlas or if allocation fails. Empty
+//  rectangles are placed at (0, 0) without taking up any space. Skyline is left as it was when this fails.
+jfnt_result jfnt_skyline_insert(
+        jfnt_skyline* this, const jfnt_allocator_callbacks* allocator, unsigned w, unsigned h, unsigned* p_x,
+        unsigned* p_y);
+
+//  Height the skyline would have if the rectangle w x h was inserted, without inserting it, so that whatever the
+//  rectangle is placed into can be made large enough first.
+jfnt_result jfnt_skyline_height_after(const jfnt_skyline* this, unsigned w, unsigned h, unsigned* p_height);
+
+void jfnt_skyline_destroy(jfnt_skyline* this, const jfnt_allocator_callbacks* allocator);
+
+//  Picks the atlas width for a set of rectangles: the smallest power of two wide enough to fit the widest rectangle
+//  and to make the atlas roughly square, but no wider than max_width.
+unsigned jfnt_skyline_pick_width(unsigned max_width, unsigned widest, size_t total_area);
+
+#endif //JFNT_JFNT_ATLAS_H
@@ -0,0 +1,362 @@
+//
+// Created by jan on 17.10.2026.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "jfnt_cache.h"
+
+//  Bump when the layout of the file or of jfnt_glyph changes
+enum {CACHE_VERSION = 5};
+static const char CACHE_MAGIC[8] = {'J', 'F', 'N', 'T', 'A', 'T', 'L', 'S'};
+static const uint32_t CACHE_BYTE_ORDER = 0x01020304;
+
+struct cache_header_T
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t glyph_size;
+    uint32_t key_size;
+    uint32_t path_size;
+    int32_t face_index;
+    uint64_t source_size;
+    int64_t source_mtime_sec;
+    int64_t source_mtime_nsec;
+
+    uint32_t size_x, size_y;
+    uint32_t height;
+    uint32_t average_width;
+    int32_t ascent, descent;
+    double matrix[4];
+    int32_t flip;
+    uint32_t render_mode;
+    uint32_t sdf_spread;
+    uint32_t count_glyphs;
+    uint32_t bmp_width, bmp_height;
+    uint64_t atlas_used;
+
+    uint32_t kern_capacity;
+    uint32_t kern_count;
+
+    uint64_t glyphs_offset;
+    uint64_t glyph_ids_offset;
+    uint64_t kern_offset;
+    uint64_t bitmap_offset;
+    uint64_t file_size;
+};
+typedef struct cache_header_T cache_header;
+
+//  Header is followed by the key, then the source path, then glyphs, their FreeType ids, kerning pairs and the bitmap
+//  at aligned offsets
+static uint64_t align_offset(uint64_t offset)
+{
+    return (offset + 15) & ~(uint64_t)15;
+}
+
+static uint64_t hash_fnv1a(const void* data, size_t size)
+{
+    const unsigned char* const bytes = data;
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+struct cache_key_params_T
+{
+    uint32_t source;
+    uint32_t char_size;
+    int32_t flip;
+    uint32_t render_mode;
+    uint32_t sdf_spread;
+    uint32_t pixel_format;
+    uint32_t atlas_max_width;
+    uint32_t atlas_padding;
+    uint32_t n_ranges;
+    int32_t fallback;
+    uint64_t mem_size;
+    uint64_t mem_hash;
+};
+typedef struct cache_key_params_T cache_key_params;
+
+jfnt_result jfnt_cache_key_create(
+        const jfnt_font* font, const jfnt_font_create_info* info, jfnt_cache_source source, const char* name,
+        size_t mem_size, const void* mem, unsigned char_size, jfnt_cache_key* p_key)
+{
+    cache_key_params params;
+    memset(&params, 0, sizeof(params));
+    params.source = source;
+    params.char_size = char_size;
+    params.flip = info->flip != 0;
+    params.render_mode = font->render_mode;
+    params.sdf_spread = font->sdf_spread;
+    params.pixel_format = font->bmp.format;
+    params.atlas_max_width = info->atlas_max_width ? info->atlas_max_width : JFNT_DEFAULT_ATLAS_MAX_WIDTH;
+    params.atlas_padding = info->atlas_padding;
+    params.n_ranges = info->n_ranges;
+    //  Only the file of the first face is in the key and checked for changes, so fallback faces installed or removed
+    //  later are not noticed
+    params.fallback = source == JFNT_CACHE_SOURCE_FC && info->fallback;
+    if (source == JFNT_CACHE_SOURCE_MEMORY)
+    {
+        params.mem_size = mem_size;
+        params.mem_hash = hash_fnv1a(mem, mem_size);
+        name = "";
+    }
+
+    const size_t ranges_size = sizeof(*info->codepoint_ranges) * info->n_ranges;
+    const size_t name_size = strlen(name);
+    const size_t size = sizeof(params) + ranges_size + name_size;
+    unsigned char* const data = jfnt_alloc(font, size);
+    if (!data)
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    memcpy(data, &params, sizeof(params));
+    if (ranges_size)
+    {
+        memcpy(data + sizeof(params), info->codepoint_ranges, ranges_size);
+    }
+    memcpy(data + sizeof(params) + ranges_size, name, name_size);
+    *p_key = (jfnt_cache_key){.size = size, .data = data};
+    return JFNT_RESULT_SUCCESS;
+}
+
+void jfnt_cache_key_destroy(const jfnt_font* font, jfnt_cache_key* key)
+{
+    jfnt_free(font, key->data);
+    key->data = NULL;
+    key->size = 0;
+}
+
+int jfnt_cache_load(jfnt_font* font, const char* path, const jfnt_cache_key* key)
+{
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(cache_header))
+    {
+        close(fd);
+        return 0;
+    }
+    const size_t map_size = (size_t)st.st_size;
+    void* const map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return 0;
+    }
+    const unsigned char* const base = map;
+    const cache_header* const header = map;
+
+    if (memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header->version != CACHE_VERSION ||
+        header->byte_order != CACHE_BYTE_ORDER || header->glyph_size != sizeof(jfnt_glyph) ||
+        header->file_size != map_size || header->key_size != key->size ||
+        sizeof(*header) + (uint64_t)header->key_size + header->path_size > header->glyphs_offset ||
+        header->glyphs_offset + (uint64_t)header->count_glyphs * sizeof(jfnt_glyph) > header->glyph_ids_offset ||
+        header->glyph_ids_offset + (uint64_t)header->count_glyphs * sizeof(unsigned) > header->kern_offset ||
+        header->kern_offset + (uint64_t)header->kern_capacity * sizeof(jfnt_kern_entry) > header->bitmap_offset ||
+        (header->kern_capacity & (header->kern_capacity - 1)) != 0 || 2 * (uint64_t)header->kern_count > header->kern_capacity ||
+        header->bitmap_offset + (uint64_t)jfnt_row_size(font->bmp.format, header->bmp_width) * header->bmp_height > map_size ||
+        memcmp(base + sizeof(*header), key->data, key->size) != 0)
+    {
+        munmap(map, map_size);
+        return 0;
+    }
+
+    //  Font file the cache was made from must not have changed since
+    char* face_path = NULL;
+    if (header->path_size)
+    {
+        face_path = jfnt_alloc(font, header->path_size + 1);
+        if (!face_path)
+        {
+            munmap(map, map_size);
+            return 0;
+        }
+        memcpy(face_path, base + sizeof(*header) + header->key_size, header->path_size);
+        face_path[header->path_size] = 0;
+        struct stat source_st;
+        if (stat(face_path, &source_st) != 0 || (uint64_t)source_st.st_size != header->source_size ||
+            (int64_t)source_st.st_mtim.tv_sec != header->source_mtime_sec ||
+            (int64_t)source_st.st_mtim.tv_nsec != header->source_mtime_nsec)
+        {
+            jfnt_free(font, face_path);
+            munmap(map, map_size);
+            return 0;
+        }
+    }
+
+    font->face_path = face_path;
+    font->face_index = header->face_index;
+    font->size_x = header->size_x;
+    font->size_y = header->size_y;
+    font->height = header->height;
+    font->average_width = header->average_width;
+    font->ascent = header->ascent;
+    font->descent = header->descent;
+    font->matrix = (FcMatrix){.xx = header->matrix[0], .xy = header->matrix[1], .yx = header->matrix[2], .yy = header->matrix[3]};
+    font->flip = header->flip;
+    font->render_mode = (jfnt_render_mode)header->render_mode;
+    font->sdf_spread = header->sdf_spread;
+    //  Both are read-only and belong to the mapping
+    font->glyphs = (jfnt_glyph*)(base + header->glyphs_offset);
+    font->count_glyphs = header->count_glyphs;
+    font->capacity_glyphs = header->count_glyphs;
+    font->glyph_ids = (unsigned*)(base + header->glyph_ids_offset);
+    font->kerning = (jfnt_kerning)
+            {
+                    .capacity = header->kern_capacity,
+                    .shift = jfnt_kerning_shift(header->kern_capacity),
+                    .count = header->kern_count,
+                    .entries = (jfnt_kern_entry*)(base + header->kern_offset),
+            };
+    font->bmp = (jfnt_bitmap){
+            .width = header->bmp_width,
+            .height = header->bmp_height,
+            .stride = jfnt_row_size(font->bmp.format, header->bmp_width),
+            .format = font->bmp.format,
+            .external = 0,
+            .capacity_rows = header->bmp_height,
+            .data = (unsigned char*)(base + header->bitmap_offset),
+    };
+    font->atlas_used = header->atlas_used;
+    font->cache_map = map;
+    font->cache_map_size = map_size;
+    return 1;
+}
+
+void jfnt_cache_unmap(jfnt_font* font)
+{
+    if (font->cache_map)
+    {
+        munmap(font->cache_map, font->cache_map_size);
+        font->cache_map = NULL;
+        font->cache_map_size = 0;
+    }
+}
+
+static int write_all(int fd, const void* data, size_t size)
+{
+    const unsigned char* ptr = data;
+    while (size)
+    {
+        const ssize_t written = write(fd, ptr, size);
+        if (written < 0)
+        {
+            return 0;
+        }
+        ptr += written;
+        size -= (size_t)written;
+    }
+    return 1;
+}
+
+static int write_padding(int fd, uint64_t from, uint64_t to)
+{
+    static const unsigned char zeros[16] = {0};
+    return write_all(fd, zeros, (size_t)(to - from));
+}
+
+void jfnt_cache_store(const jfnt_font* font, const char* path, const jfnt_cache_key* key)
+{
+    cache_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.byte_order = CACHE_BYTE_ORDER;
+    header.glyph_size = sizeof(jfnt_glyph);
+    header.key_size = (uint32_t)key->size;
+    header.face_index = font->face_index;
+    if (font->face_path)
+    {
+        struct stat source_st;
+        if (stat(font->face_path, &source_st) != 0)
+        {
+            JFNT_ERROR(font, "Could not stat font file \"%s\" for the cache", font->face_path);
+            return;
+        }
+        header.path_size = (uint32_t)strlen(font->face_path);
+        header.source_size = (uint64_t)source_st.st_size;
+        header.source_mtime_sec = (int64_t)source_st.st_mtim.tv_sec;
+        header.source_mtime_nsec = (int64_t)source_st.st_mtim.tv_nsec;
+    }
+    header.size_x = font->size_x;
+    header.size_y = font->size_y;
+    header.height = font->height;
+    header.average_width = font->average_width;
+    header.ascent = font->ascent;
+    header.descent = font->descent;
+    header.matrix[0] = font->matrix.xx;
+    header.matrix[1] = font->matrix.xy;
+    header.matrix[2] = font->matrix.yx;
+    header.matrix[3] = font->matrix.yy;
+    header.flip = font->flip;
+    header.render_mode = font->render_mode;
+    header.sdf_spread = font->sdf_spread;
+    header.count_glyphs = font->count_glyphs;
+    header.bmp_width = font->bmp.width;
+    header.bmp_height = font->bmp.height;
+    header.atlas_used = font->atlas_used;
+    header.kern_capacity = font->kerning.capacity;
+    header.kern_count = font->kerning.count;
+    const uint64_t path_end = sizeof(header) + header.key_size + header.path_size;
+    header.glyphs_offset = align_offset(path_end);
+    const uint64_t glyphs_end = header.glyphs_offset + (uint64_t)font->count_glyphs * sizeof(jfnt_glyph);
+    header.glyph_ids_offset = align_offset(glyphs_end);
+    const uint64_t glyph_ids_end = header.glyph_ids_offset + (uint64_t)font->count_glyphs * sizeof(unsigned);
+    header.kern_offset = align_offset(glyph_ids_end);
+    const uint64_t kern_end = header.kern_offset + (uint64_t)font->kerning.capacity * sizeof(jfnt_kern_entry);
+    header.bitmap_offset = align_offset(kern_end);
+    const size_t bitmap_size = font->bmp.stride * font->bmp.height;
+    header.file_size = header.bitmap_offset + bitmap_size;
+
+    const size_t path_len = strlen(path);
+    static const char TMP_SUFFIX[] = ".XXXXXX";
+    char* const tmp_path = jfnt_alloc(font, path_len + sizeof(TMP_SUFFIX));
+    if (!tmp_path)
+    {
+        JFNT_ERROR(font, "Could not allocate memory for the cache file name");
+        return;
+    }
+    memcpy(tmp_path, path, path_len);
+    memcpy(tmp_path + path_len, TMP_SUFFIX, sizeof(TMP_SUFFIX));
+    const int fd = mkstemp(tmp_path);
+    if (fd < 0)
+    {
+        JFNT_ERROR(font, "Could not create temporary cache file \"%s\"", tmp_path);
+        jfnt_free(font, tmp_path);
+        return;
+    }
+
+    const int ok = write_all(fd, &header, sizeof(header)) &&
+                   write_all(fd, key->data, key->size) &&
+                   write_all(fd, font->face_path ? font->face_path : "", header.path_size) &&
+                   write_padding(fd, path_end, header.glyphs_offset) &&
+                   write_all(fd, font->glyphs, (size_t)font->count_glyphs * sizeof(jfnt_glyph)) &&
+                   write_padding(fd, glyphs_end, header.glyph_ids_offset) &&
+                   write_all(fd, font->glyph_ids, (size_t)font->count_glyphs * sizeof(unsigned)) &&
+                   write_padding(fd, glyph_ids_end, header.kern_offset) &&
+                   write_all(fd, font->kerning.entries, (size_t)font->kerning.capacity * sizeof(jfnt_kern_entry)) &&
+                   write_padding(fd, kern_end, header.bitmap_offset) &&
+                   write_all(fd, font->bmp.data, bitmap_size) &&
+                   fsync(fd) == 0;
+    if (close(fd) != 0 || !ok || rename(tmp_path, path) != 0)
+    {
+        JFNT_ERROR(font, "Could not write the cache file \"%s\"", path);
+        unlink(tmp_path);
+    }
+    jfnt_free(font, tmp_path);
+}
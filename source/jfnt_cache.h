@@ -0,0 +1,45 @@
+//
+// Created by jan on 17.10.2026.
+//
+
+#ifndef JFNT_JFNT_CACHE_H
+#define JFNT_JFNT_CACHE_H
+#include "jfnt_font_internal.h"
+
+enum jfnt_cache_source_T
+{
+    JFNT_CACHE_SOURCE_MEMORY,
+    JFNT_CACHE_SOURCE_FILE,
+    JFNT_CACHE_SOURCE_FC,
+};
+typedef enum jfnt_cache_source_T jfnt_cache_source;
+
+//  Serialized description of what the font is created from and with which parameters. Cache file is only used when its
+//  key matches this exactly.
+struct jfnt_cache_key_T
+{
+    size_t size;
+    unsigned char* data;
+};
+typedef struct jfnt_cache_key_T jfnt_cache_key;
+
+//  For memory source, name is ignored and contents of memory are hashed instead. For file it is the file name and for
+//  fontconfig it is the fontconfig string, followed by the file and the face index it was matched to.
+jfnt_result jfnt_cache_key_create(
+        const jfnt_font* font, const jfnt_font_create_info* info, jfnt_cache_source source, const char* name,
+        size_t mem_size, const void* mem, unsigned char_size, jfnt_cache_key* p_key);
+
+void jfnt_cache_key_destroy(const jfnt_font* font, jfnt_cache_key* key);
+
+//  Maps the cache file and points glyphs and the atlas of the font into it. Returns non-zero if the file existed, had
+//  the same key and the font file it was made from was not modified since.
+int jfnt_cache_load(jfnt_font* font, const char* path, const jfnt_cache_key* key);
+
+//  Writes the font to a temporary file next to path and renames it over path, so that readers never see a partially
+//  written cache. Failures are only reported, since the font itself is fine.
+void jfnt_cache_store(const jfnt_font* font, const char* path, const jfnt_cache_key* key);
+
+//  Releases the mapping made by jfnt_cache_load
+void jfnt_cache_unmap(jfnt_font* font);
+
+#endif //JFNT_JFNT_CACHE_H
@@ -0,0 +1,256 @@
+//
+// Created by jan on 17.10.2026.
+//
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "jfnt_context_internal.h"
+
+static void* context_alloc(const jfnt_context* this, size_t size)
+{
+    return this->allocator_callbacks.allocate(this->allocator_callbacks.state, size);
+}
+
+static void context_free(const jfnt_context* this, void* ptr)
+{
+    this->allocator_callbacks.deallocate(this->allocator_callbacks.state, ptr);
+}
+
+jfnt_result jfnt_context_create(const jfnt_allocator_callbacks* allocator_callbacks, jfnt_context** p_out)
+{
+    if (!allocator_callbacks)
+    {
+        allocator_callbacks = &DEFAULT_ALLOCATOR;
+    }
+    jfnt_context* const this = allocator_callbacks->allocate(allocator_callbacks->state, sizeof(*this));
+    if (!this)
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    memset(this, 0, sizeof(*this));
+    this->allocator_callbacks = *allocator_callbacks;
+    if (pthread_mutex_init(&this->lock, NULL) != 0)
+    {
+        context_free(this, this);
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    if (FT_Init_FreeType(&this->ft_library) != FT_Err_Ok)
+    {
+        pthread_mutex_destroy(&this->lock);
+        context_free(this, this);
+        return JFNT_RESULT_BAD_FT_CALL;
+    }
+    *p_out = this;
+    return JFNT_RESULT_SUCCESS;
+}
+
+//  Maps the whole file read-only. Files which can not be mapped, such as pipes or empty files, are left for FreeType to
+//  read through its own stream.
+static void* context_map_file(const char* path, size_t* p_size)
+{
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    const size_t size = (size_t)st.st_size;
+    void* const map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return NULL;
+    }
+    *p_size = size;
+    return map;
+}
+
+static void context_close_face(jfnt_context* this, unsigned i)
+{
+    FT_Done_Face(this->faces[i].face);
+    if (this->faces[i].map)
+    {
+        munmap(this->faces[i].map, this->faces[i].map_size);
+        this->mapped_size -= this->faces[i].map_size;
+    }
+    context_free(this, this->faces[i].path);
+    this->faces[i] = this->faces[this->count_faces - 1];
+    this->count_faces -= 1;
+}
+
+void jfnt_context_destroy(jfnt_context* context)
+{
+    while (context->count_faces)
+    {
+        context_close_face(context, context->count_faces - 1);
+    }
+    context_free(context, context->faces);
+    FT_Done_FreeType(context->ft_library);
+    if (context->fc_config)
+    {
+        FcConfigDestroy(context->fc_config);
+    }
+    pthread_mutex_destroy(&context->lock);
+    context_free(context, context);
+}
+
+void jfnt_context_trim(jfnt_context* context)
+{
+    pthread_mutex_lock(&context->lock);
+    for (unsigned i = context->count_faces; i > 0; --i)
+    {
+        if (context->faces[i - 1].refs == 0)
+        {
+            context_close_face(context, i - 1);
+        }
+    }
+    pthread_mutex_unlock(&context->lock);
+}
+
+unsigned jfnt_context_get_face_count(const jfnt_context* context, unsigned* p_times_opened)
+{
+    if (p_times_opened)
+    {
+        *p_times_opened = context->times_opened;
+    }
+    return context->count_faces;
+}
+
+size_t jfnt_context_get_mapped_size(const jfnt_context* context)
+{
+    return context->mapped_size;
+}
+
+jfnt_result jfnt_context_acquire_face(
+        jfnt_context* context, const char* path, const void* mem, size_t mem_size, int index, FT_Face* p_face,
+        FT_Error* p_error)
+{
+    for (unsigned i = 0; i < context->count_faces; ++i)
+    {
+        jfnt_context_face* const f = context->faces + i;
+        if (f->index == index && (path ? f->path && strcmp(f->path, path) == 0 : !f->path && f->mem == mem && f->mem_size == mem_size))
+        {
+            f->refs += 1;
+            *p_face = f->face;
+            return JFNT_RESULT_SUCCESS;
+        }
+    }
+
+    if (context->count_faces == context->capacity_faces)
+    {
+        const unsigned new_capacity = context->capacity_faces ? 2 * context->capacity_faces : 8;
+        jfnt_context_face* const new_faces = context->allocator_callbacks.reallocate(
+                context->allocator_callbacks.state, context->faces, sizeof(*new_faces) * new_capacity);
+        if (!new_faces)
+        {
+            return JFNT_RESULT_BAD_ALLOC;
+        }
+        context->faces = new_faces;
+        context->capacity_faces = new_capacity;
+    }
+    char* path_copy = NULL;
+    if (path)
+    {
+        const size_t len = strlen(path);
+        if (!(path_copy = context_alloc(context, len + 1)))
+        {
+            return JFNT_RESULT_BAD_ALLOC;
+        }
+        memcpy(path_copy, path, len + 1);
+    }
+    size_t map_size = 0;
+    void* const map = path ? context_map_file(path, &map_size) : NULL;
+    FT_Face face;
+    FT_Error ft_error;
+    if (map)
+    {
+        ft_error = FT_New_Memory_Face(context->ft_library, map, (FT_Long)map_size, index, &face);
+    }
+    else if (path)
+    {
+        ft_error = FT_New_Face(context->ft_library, path, index, &face);
+    }
+    else
+    {
+        ft_error = FT_New_Memory_Face(context->ft_library, mem, (FT_Long)mem_size, index, &face);
+    }
+    if (ft_error != FT_Err_Ok)
+    {
+        if (map)
+        {
+            munmap(map, map_size);
+        }
+        context_free(context, path_copy);
+        *p_error = ft_error;
+        return JFNT_RESULT_BAD_FT_CALL;
+    }
+    context->faces[context->count_faces] = (jfnt_context_face)
+            {
+                    .path = path_copy,
+                    .mem = mem,
+                    .mem_size = mem_size,
+                    .map = map,
+                    .map_size = map_size,
+                    .index = index,
+                    .face = face,
+                    .refs = 1,
+            };
+    context->count_faces += 1;
+    context->times_opened += 1;
+    context->mapped_size += map_size;
+    *p_face = face;
+    return JFNT_RESULT_SUCCESS;
+}
+
+void jfnt_context_release_face(jfnt_context* context, FT_Face face)
+{
+    for (unsigned i = 0; i < context->count_faces; ++i)
+    {
+        if (context->faces[i].face == face)
+        {
+            context->faces[i].refs -= 1;
+            return;
+        }
+    }
+}
+
+const void* jfnt_context_face_data(const jfnt_context* context, FT_Face face, size_t* p_size)
+{
+    *p_size = 0;
+    for (unsigned i = 0; i < context->count_faces; ++i)
+    {
+        const jfnt_context_face* const f = context->faces + i;
+        if (f->face == face)
+        {
+            *p_size = f->map ? f->map_size : f->mem_size;
+            return f->map ? f->map : f->mem;
+        }
+    }
+    return NULL;
+}
+
+jfnt_result jfnt_context_fontconfig(jfnt_context* context, FcConfig** p_config)
+{
+    if (!context->fc_config)
+    {
+        if (!FcInit())
+        {
+            return JFNT_RESULT_NO_FC;
+        }
+        //  Keeps the configuration alive even if the current one gets replaced
+        if (!(context->fc_config = FcConfigReference(NULL)))
+        {
+            return JFNT_RESULT_NO_FC;
+        }
+    }
+    *p_config = context->fc_config;
+    return JFNT_RESULT_SUCCESS;
+}
@@ -0,0 +1,61 @@
+//
+// Created by jan on 17.10.2026.
+//
+
+#ifndef JFNT_JFNT_CONTEXT_INTERNAL_H
+#define JFNT_JFNT_CONTEXT_INTERNAL_H
+#include "../include/jfnt_context.h"
+
+#include <pthread.h>
+#include <fontconfig/fontconfig.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+//  Face opened either from a file, in which case path is set, or from memory. Files are mapped read-only when they can
+//  be, with FreeType reading glyph data straight from the mapping, which lives as long as the face.
+struct jfnt_context_face_T
+{
+    char* path;
+    const void* mem;
+    size_t mem_size;
+    void* map;
+    size_t map_size;
+    int index;
+    FT_Face face;
+    unsigned refs;      //  Number of fonts which currently use the face
+};
+typedef struct jfnt_context_face_T jfnt_context_face;
+
+struct jfnt_context_T
+{
+    jfnt_allocator_callbacks allocator_callbacks;
+    pthread_mutex_t lock;   //  Held while faces or the library are used
+    FT_Library ft_library;
+    FcConfig* fc_config;    //  Only initialized once the first font is created from a fontconfig string
+
+    unsigned count_faces;
+    unsigned capacity_faces;
+    jfnt_context_face* faces;
+    unsigned times_opened;
+    size_t mapped_size;     //  Total size of mappings of all open faces
+};
+
+//  Functions below must be called with the lock held
+
+//  Returns the face for the file, or the memory when path is NULL, opening it if the context has not already.
+//  Reference count of the face is incremented. FreeType error is returned through p_error for JFNT_RESULT_BAD_FT_CALL.
+jfnt_result jfnt_context_acquire_face(
+        jfnt_context* context, const char* path, const void* mem, size_t mem_size, int index, FT_Face* p_face,
+        FT_Error* p_error);
+
+//  Decrements the reference count of the face, which is kept open
+void jfnt_context_release_face(jfnt_context* context, FT_Face face);
+
+//  Returns the memory the face is read from, which is the mapping of its file, or the memory it was opened from. When
+//  the file could not be mapped, NULL is returned. Memory stays valid while the face is acquired.
+const void* jfnt_context_face_data(const jfnt_context* context, FT_Face face, size_t* p_size);
+
+//  Returns the fontconfig configuration, initializing fontconfig the first time
+jfnt_result jfnt_context_fontconfig(jfnt_context* context, FcConfig** p_config);
+
+#endif //JFNT_JFNT_CONTEXT_INTERNAL_H
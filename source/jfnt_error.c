@@ -14,6 +14,9 @@ static const struct {const char* message; const char* name;} RESULT_MESSAGES[JFN
                 [JFNT_RESULT_UNSUPPORTED] = {.message = "Requested character was not supported by the font, nor could a suitable replacement be found", .name = "JFNT_RESULT_UNSUPPORTED"},
                 [JFNT_RESULT_BAD_ENCODING] = {.message = "String was not encoded according to the expected format", .name = "JFNT_RESULT_BAD_ENCODING"},
                 [JFNT_RESULT_NO_FC] = {.message = "Fontconfig could not be initialized", .name = "JFNT_RESULT_NO_FC"},
+                [JFNT_RESULT_ATLAS_FULL] = {.message = "Glyphs could not be fit into the atlas", .name = "JFNT_RESULT_ATLAS_FULL"},
+                [JFNT_RESULT_BAD_ARGUMENT] = {.message = "Function was called with an invalid argument", .name = "JFNT_RESULT_BAD_ARGUMENT"},
+                [JFNT_RESULT_CANCELED] = {.message = "Operation was canceled before it was done", .name = "JFNT_RESULT_CANCELED"},
         };
 
 const char* jfnt_result_to_str(jfnt_result res)
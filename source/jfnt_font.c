@@ -3,36 +3,14 @@
 //
 
 #include <assert.h>
-#include "../include/jfnt_font.h"
-
-#include <fontconfig/fontconfig.h>
-#include <ft2build.h>
-#include FT_FREETYPE_H
-
-struct jfnt_bitmap_T
-{
-    unsigned width;
-    unsigned height;
-    unsigned char* data;
-};
-typedef struct jfnt_bitmap_T jfnt_bitmap;
-struct jfnt_font_T
-{
-    jfnt_allocator_callbacks allocator_callbacks;
-    jfnt_error_callbacks error_callbacks;
-
-    unsigned count_glyphs;
-    unsigned capacity_glyphs;
-    jfnt_glyph* glyphs;
-
-    unsigned int size_x, size_y;
-    unsigned int height;
-    jfnt_bitmap bmp;
-    unsigned tex_w;
-    unsigned tex_h;
-    unsigned average_width;
-    int ascent; int descent;
-};
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include "jfnt_font_internal.h"
+#include "jfnt_raster.h"
+#include "jfnt_cache.h"
+#include "jfnt_utf8.h"
+#include FT_MODULE_H
 
 static void* default_alloc_fn(void* state, size_t size)
 {
@@ -73,11 +51,28 @@ static const unsigned EXTENT_CHAR_COLS[] =
 
 static const size_t EXTENT_TEST_CHAR_COUNT = sizeof(EXTENT_TEST_CHAR_ARRAY) / sizeof(*EXTENT_TEST_CHAR_ARRAY);
 
-static FcPattern* font_match(FcPattern* pat, FcResult* res)
+//  Codepoints decoded from UTF-8 on the stack at a time, before they are looked up
+enum {UTF8_DECODE_CHUNK = 256};
+
+//  How many glyphs of font's height the atlas of a lazy font is made wide enough for
+enum {LAZY_RESERVED_GLYPHS = 256};
+
+static char* font_strdup(const jfnt_font* this, const char* str)
+{
+    const size_t len = strlen(str);
+    char* const copy = jfnt_alloc(this, len + 1);
+    if (copy)
+    {
+        memcpy(copy, str, len + 1);
+    }
+    return copy;
+}
+
+static FcPattern* font_match(FcConfig* config, FcPattern* pat, FcResult* res)
 {
-    FcConfigSubstitute(NULL, pat, FcMatchPattern);
+    FcConfigSubstitute(config, pat, FcMatchPattern);
     FcDefaultSubstitute(pat);
-    return FcFontMatch(NULL, pat, res);
+    return FcFontMatch(config, pat, res);
 }
 
 static const char* const FC_ERRORS[] =
@@ -89,22 +84,220 @@ static const char* const FC_ERRORS[] =
                 [FcResultOutOfMemory] = "FcResultOutOfMemory"
         };
 
-static void load_font_data_from_face(jfnt_font* this, const FcMatrix* mtx, unsigned font_x_size, unsigned font_y_size, FT_Face face)
+static int matrix_is_identity(const FcMatrix* mtx)
 {
-    unsigned height;
-    FT_Set_Char_Size(face, font_x_size, font_y_size, 0, 0);
-    if (mtx->xx != 1.0 || mtx->xy != 0 || mtx->yx != 0 || mtx->yy != 1)
-    {
-        FT_Matrix ft_mat = {
-                .xx = (FT_Fixed) (0x10000L * mtx->xx),
-                .xy = (FT_Fixed) (0x10000L * mtx->xy),
-                .yx = (FT_Fixed) (0x10000L * mtx->yx),
-                .yy = (FT_Fixed) (0x10000L * mtx->yy),
-        };
+    return mtx->xx == 1.0 && mtx->xy == 0 && mtx->yx == 0 && mtx->yy == 1;
+}
+
+static FT_Matrix matrix_to_ft(const FcMatrix* mtx)
+{
+    const FT_Matrix ft_mat = {
+            .xx = (FT_Fixed) (0x10000L * mtx->xx),
+            .xy = (FT_Fixed) (0x10000L * mtx->xy),
+            .yx = (FT_Fixed) (0x10000L * mtx->yx),
+            .yy = (FT_Fixed) (0x10000L * mtx->yy),
+    };
+    return ft_mat;
+}
 
+//  Transform and the spread are always set, since the face (and its library) may be shared with fonts which have
+//  different ones
+static void font_setup_rendering(const jfnt_font* font, FT_Face face)
+{
+    if (font->render_mode == JFNT_RENDER_MODE_SDF)
+    {
+        //  Outlines and bitmaps have separate renderers, which both have the property
+        const FT_Int spread = (FT_Int)font->sdf_spread;
+        (void)FT_Property_Set(face->glyph->library, "sdf", "spread", &spread);
+        (void)FT_Property_Set(face->glyph->library, "bsdf", "spread", &spread);
+    }
+    if (!matrix_is_identity(&font->matrix))
+    {
+        FT_Matrix ft_mat = matrix_to_ft(&font->matrix);
         FT_Set_Transform(face, &ft_mat, NULL);
+    }
+    else
+    {
+        FT_Set_Transform(face, NULL, NULL);
+    }
+}
+
+FT_Error jfnt_font_load_glyph(const jfnt_font* font, FT_Face face, FT_UInt glyph_index)
+{
+    if (font->bmp.format == JFNT_PIXEL_FORMAT_R1)
+    {
+        //  Hinted for the monochrome renderer, which gives crisper glyphs than thresholding their coverage would
+        return FT_Load_Glyph(face, glyph_index, FT_LOAD_RENDER | FT_LOAD_TARGET_MONO);
+    }
+    if (font->render_mode != JFNT_RENDER_MODE_SDF)
+    {
+        return FT_Load_Glyph(face, glyph_index, FT_LOAD_RENDER);
+    }
+    //  Hinting only makes sense for the size the glyph is rendered at, while distance fields get scaled. Field is made
+    //  from the rendered coverage bitmap instead of directly from the outline, which is over twice as fast and differs
+    //  by less than one level on average.
+    FT_Error ft_error = FT_Load_Glyph(face, glyph_index, FT_LOAD_NO_HINTING | FT_LOAD_RENDER);
+    if (ft_error == FT_Err_Ok)
+    {
+        ft_error = FT_Render_Glyph(face->glyph, FT_RENDER_MODE_SDF);
+    }
+    //  Unhinted advances are not whole pixels, so they are rounded instead of truncated
+    face->glyph->advance.x = (face->glyph->advance.x + 32) & -64;
+    face->glyph->advance.y = (face->glyph->advance.y + 32) & -64;
+    return ft_error;
+}
+
+void jfnt_font_setup_face(const jfnt_font* font, FT_Face face)
+{
+    FT_Set_Char_Size(face, font->size_x, font->size_y, 0, 0);
+    font_setup_rendering(font, face);
+}
+
+//  Gets the face from the context of the font and gives the font its own size on it, so that fonts of different sizes
+//  can share the face. Context must be locked.
+static jfnt_result font_open_face(
+        jfnt_font* this, const char* filename, const void* mem, size_t mem_size, int index, FT_Face* p_face)
+{
+    FT_Face face;
+    FT_Error ft_error;
+    const uint64_t begin = jfnt_stats_begin(this);
+    const jfnt_result res = jfnt_context_acquire_face(this->context, filename, mem, mem_size, index, &face, &ft_error);
+    jfnt_stats_end(this, JFNT_PHASE_OPEN_FACE, begin);
+    if (res == JFNT_RESULT_BAD_FT_CALL)
+    {
+        JFNT_ERROR(this, "Could not create new FT face from %s, reason: %s", filename ? filename : "memory", FT_Error_String(ft_error));
+    }
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    if ((ft_error = FT_New_Size(face, &this->ft_size)) != FT_Err_Ok)
+    {
+        JFNT_ERROR(this, "Could not create new FT size, reason: %s", FT_Error_String(ft_error));
+        jfnt_context_release_face(this->context, face);
+        return JFNT_RESULT_BAD_FT_CALL;
+    }
+    FT_Activate_Size(this->ft_size);
+    this->face = face;
+    *p_face = face;
+    return JFNT_RESULT_SUCCESS;
+}
+
+//  Context must be locked
+static void font_close_face(jfnt_font* this)
+{
+    FT_Done_Size(this->ft_size);
+    jfnt_context_release_face(this->context, this->face);
+    this->ft_size = NULL;
+    this->face = NULL;
+}
+
+//  Makes the face ready for loading glyphs of this font, as other fonts may have used it since. Context must be locked.
+static void font_activate_face(const jfnt_font* this)
+{
+    FT_Activate_Size(this->ft_size);
+    font_setup_rendering(this, this->face);
+}
+
+//  Opens the face of a fallback, giving it a size set up the same as the first face. Faces which can not be opened are
+//  reported and skipped from then on. Context must be locked.
+static jfnt_result font_open_fallback(jfnt_font* this, unsigned i)
+{
+    jfnt_font_fallback* const f = this->fallbacks + i;
+    if (f->face)
+    {
+        return JFNT_RESULT_SUCCESS;
+    }
+    FT_Face face;
+    FT_Error ft_error;
+    const uint64_t begin = jfnt_stats_begin(this);
+    const jfnt_result res = jfnt_context_acquire_face(this->context, f->path, NULL, 0, f->index, &face, &ft_error);
+    jfnt_stats_end(this, JFNT_PHASE_OPEN_FACE, begin);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        JFNT_ERROR(this, "Could not open fallback face from \"%s\", reason: %s", f->path, res == JFNT_RESULT_BAD_FT_CALL ? FT_Error_String(ft_error) : jfnt_result_message(res));
+        f->charset = NULL;
+        return res;
+    }
+    if ((ft_error = FT_New_Size(face, &f->ft_size)) != FT_Err_Ok)
+    {
+        JFNT_ERROR(this, "Could not create new FT size for fallback face from \"%s\", reason: %s", f->path, FT_Error_String(ft_error));
+        jfnt_context_release_face(this->context, face);
+        f->charset = NULL;
+        return JFNT_RESULT_BAD_FT_CALL;
+    }
+    FT_Activate_Size(f->ft_size);
+    jfnt_font_setup_face(this, face);
+    f->face = face;
+    return JFNT_RESULT_SUCCESS;
+}
 
+//  Context must be locked
+static void font_activate_fallback(const jfnt_font* this, const jfnt_font_fallback* f)
+{
+    FT_Activate_Size(f->ft_size);
+    font_setup_rendering(this, f->face);
+}
+
+//  Closes the faces of the fallback chain and drops the chain. Context must be locked.
+static void font_close_fallbacks(jfnt_font* this)
+{
+    for (unsigned i = 0; i < this->count_fallbacks; ++i)
+    {
+        if (this->fallbacks[i].face)
+        {
+            FT_Done_Size(this->fallbacks[i].ft_size);
+            jfnt_context_release_face(this->context, this->fallbacks[i].face);
+        }
+    }
+    jfnt_free(this, this->fallbacks);
+    if (this->fallback_set)
+    {
+        FcFontSetDestroy(this->fallback_set);
+    }
+    this->fallbacks = NULL;
+    this->count_fallbacks = 0;
+    this->fallback_set = NULL;
+}
+
+//  Whether the charset has any of the codepoints in the ranges, which is checked a page of 256 codepoints at a time
+static int charset_intersects(const FcCharSet* charset, unsigned n_ranges, const jfnt_codepoint_range* ranges)
+{
+    FcChar32 map[FC_CHARSET_MAP_SIZE];
+    FcChar32 next;
+    for (FcChar32 base = FcCharSetFirstPage(charset, map, &next); base != FC_CHARSET_DONE; base = FcCharSetNextPage(charset, map, &next))
+    {
+        for (unsigned i = 0; i < n_ranges; ++i)
+        {
+            if (ranges[i].last < base || ranges[i].first > base + 0xFF)
+            {
+                continue;
+            }
+            const unsigned lo = ranges[i].first > base ? ranges[i].first - base : 0;
+            const unsigned hi = ranges[i].last < base + 0xFF ? ranges[i].last - base : 0xFF;
+            for (unsigned bit = lo; bit <= hi; ++bit)
+            {
+                if (map[bit >> 5] >> (bit & 31) & 1)
+                {
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
 
+static void load_font_data_from_face(jfnt_font* this, const FcMatrix* mtx, unsigned font_x_size, unsigned font_y_size, FT_Face face)
+{
+    const uint64_t begin = jfnt_stats_begin(this);
+    unsigned height;
+    this->size_x = font_x_size;
+    this->size_y = font_y_size;
+    this->matrix = *mtx;
+    jfnt_font_setup_face(this, face);
+    if (!matrix_is_identity(mtx))
+    {
+        FT_Matrix ft_mat = matrix_to_ft(mtx);
         FT_Vector v;
 
         v.x = 0;
@@ -122,10 +315,9 @@ static void load_font_data_from_face(jfnt_font* this, const FcMatrix* mtx, unsig
     }
 
     this->height = height;
-    this->size_x = font_x_size;
-    this->size_y = font_y_size;
 
     //  Compute jfnt_font sizes
+    this->average_width = 0;
     for (unsigned i = 0; i < EXTENT_TEST_CHAR_COUNT; ++i)
     {
         const FcChar32 cp = EXTENT_TEST_CHAR_ARRAY[i];
@@ -151,13 +343,11 @@ static void load_font_data_from_face(jfnt_font* this, const FcMatrix* mtx, unsig
             this->average_width = advance;
         }
     }
-
+    jfnt_stats_end(this, JFNT_PHASE_METRICS, begin);
 }
 
 static jfnt_result
-font_create_from_pattern(
-        jfnt_font* this, FcPattern* pattern, const char* prefix, const char* name, FT_Library ft_library,
-        FT_Face* p_face)
+font_create_from_pattern(jfnt_font* this, FcPattern* pattern, const char* prefix, const char* name)
 {
     FcResult fc_result;
     assert(pattern);
@@ -178,7 +368,7 @@ font_create_from_pattern(
     switch ((fc_result = FcPatternGetInteger(pattern, FC_INDEX, 0, &font_id)))
     {
     case FcResultNoMatch:
-        filename = NULL;
+        font_id = 0;
         break;
     case FcResultMatch:break;
     default:
@@ -244,597 +434,2439 @@ font_create_from_pattern(
     this->average_width = char_width;
 
     FT_Face  face;
-    FT_Error ft_res = FT_New_Face(ft_library, (const char*)filename, font_id, &face);
-    if (ft_res != FT_Err_Ok)
+    jfnt_result res = font_open_face(this, (const char*)filename, NULL, 0, font_id, &face);
+    if (res != JFNT_RESULT_SUCCESS)
     {
-        JFNT_ERROR(this, "Could not create new face for jfnt_font %s \"%s\" from file \"%s\", reason: %s\n", prefix, name, filename,
-                   FT_Error_String(ft_res));
-        return JFNT_RESULT_BAD_FT_CALL;
+        JFNT_ERROR(this, "Could not create new face for jfnt_font %s \"%s\" from file \"%s\"\n", prefix, name, filename);
+        return res;
+    }
+
+    this->face_path = font_strdup(this, (const char*)filename);
+    if (!this->face_path)
+    {
+        return JFNT_RESULT_BAD_ALLOC;
     }
+    this->face_index = font_id;
 
     load_font_data_from_face(this, mtx, font_x_size, font_y_size, face);
-    this->average_width = char_width;
+    //  Width fontconfig gives for monospace fonts takes precedence, but most patterns do not have it
+    if (char_width > 0)
+    {
+        this->average_width = char_width;
+    }
 
     FcPatternDestroy(pattern);
-    *p_face = face;
 
     return JFNT_RESULT_SUCCESS;
 }
 
 
-static void font_add_to_bitmap(const jfnt_bitmap* dst, const jfnt_bitmap* source, unsigned offset_x)
+void jfnt_copy_bitmap(unsigned char* dst, size_t dst_stride, const FT_Bitmap* bitmap, int flip)
 {
-    for (unsigned row = 0; row < source->height; ++row)
+    const unsigned char* const src = jfnt_ft_bitmap_top(bitmap);
+    const unsigned w = bitmap->width;
+    const unsigned h = bitmap->rows;
+    for (unsigned row = 0; row < h; ++row)
     {
-        memcpy(dst->data + (row) * dst->width + offset_x, source->data + (row) * source->width, source->width);
+        const unsigned src_row = flip ? h - row - 1 : row;
+        const unsigned char* const s = src + (ptrdiff_t)src_row * bitmap->pitch;
+        unsigned char* const d = dst + row * dst_stride;
+        if (bitmap->pixel_mode != FT_PIXEL_MODE_MONO)
+        {
+            memcpy(d, s, w);
+            continue;
+        }
+        for (unsigned i = 0; i < w; ++i)
+        {
+            d[i] = s[i / 8] & (0x80 >> (i & 7)) ? 0xFF : 0;
+        }
     }
 }
 
-static jfnt_result
-ft_font_load(FT_Face font, unsigned range_count, const jfnt_codepoint_range* range_array, jfnt_font* fnt, int flip)
+//  Copies the rendered glyph into its place in the atlas, which must have been reserved for it with the size given by
+//  the glyph's w and h. Flipping and conversion to the pixel format of the atlas are done in the same pass.
+static void font_render_into_atlas(jfnt_font* fnt, FT_GlyphSlot glyph, jfnt_glyph* g)
 {
-    unsigned n_chars = 0;
-    unsigned max_w = 0, max_h = 0, total_w = 0;
-    for (unsigned i_range = 0; i_range < range_count; ++i_range)
+    g->advance_x = glyph->advance.x >> 6;
+    g->advance_y = glyph->advance.y >> 6;
+    g->left = (short)glyph->bitmap_left;
+    g->top = (short)glyph->bitmap_top;
+    const uint64_t begin = jfnt_stats_begin(fnt);
+    if (glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO)
     {
-        const jfnt_codepoint_range range = range_array[i_range];
-        n_chars += 1 + range.last - range.first;
-
-        FT_GlyphSlot glyph = font->glyph;
-        FT_Error ft_res;
-        for (FT_ULong c = range.first; c <= range.last; ++c)
+        jfnt_bitmap_blit(&fnt->bmp, g->offset_x, g->offset_y, jfnt_ft_bitmap_top(&glyph->bitmap), glyph->bitmap.pitch, g->w, g->h, fnt->flip);
+    }
+    else
+    {
+        //  Monochrome bitmaps are expanded first, since the atlas is written from 8-bit pixels
+        const jfnt_arena_mark mark = jfnt_arena_get_mark(&fnt->scratch);
+        unsigned char* const pixels = jfnt_arena_alloc(&fnt->scratch, &fnt->allocator_callbacks, (size_t)g->w * g->h);
+        if (pixels)
         {
-            if ((ft_res = FT_Load_Char(font, c, FT_LOAD_BITMAP_METRICS_ONLY)) != FT_Err_Ok)
-            {
-                if (fnt->error_callbacks.unsupported_char)
-                {
-                    fnt->error_callbacks.unsupported_char(fnt, c, FT_Error_String(ft_res), fnt->error_callbacks.char_param);
-                }
-                continue;
-            }
-            const unsigned bmp_w = glyph->bitmap.width;
-            const unsigned bmp_h = glyph->bitmap.rows;
-
-            if (max_w < bmp_w) max_w = bmp_w;
-            if (max_h < bmp_h) max_h = bmp_h;
-            total_w += (bmp_w + 1);
+            jfnt_copy_bitmap(pixels, g->w, &glyph->bitmap, fnt->flip);
+            jfnt_bitmap_blit(&fnt->bmp, g->offset_x, g->offset_y, pixels, g->w, g->w, g->h, 0);
         }
-        if (total_w) total_w -= 1;
+        jfnt_arena_reset(&fnt->scratch, &fnt->allocator_callbacks, mark);
     }
+    jfnt_stats_end(fnt, JFNT_PHASE_BLIT, begin);
+}
 
-    unsigned char* const tmp = flip ? jfnt_alloc(fnt, max_w) : NULL;
-    if (flip && !tmp)
-    {
-        return JFNT_RESULT_BAD_ALLOC;
-    }
-    jfnt_bitmap bmp = {.width = total_w, .height = max_h, .data = jfnt_alloc(fnt, total_w * max_h)};
-    if (!bmp.data)
+//  Widest the atlas may be, which memory given for it may limit further
+static unsigned font_max_atlas_width(const jfnt_font* this, const jfnt_font_create_info* info)
+{
+    unsigned max_width = info->atlas_max_width ? info->atlas_max_width : JFNT_DEFAULT_ATLAS_MAX_WIDTH;
+    const size_t stride_pixels = this->bmp.stride * 8 / jfnt_pixel_format_bits(this->bmp.format);
+    if (this->bmp.external && stride_pixels < max_width)
     {
-        jfnt_free(fnt, tmp);
-        return JFNT_RESULT_BAD_ALLOC;
+        max_width = (unsigned)stride_pixels;
     }
-    memset(bmp.data, 0, sizeof(total_w * max_h));
+    return max_width;
+}
 
-    jfnt_glyph* const glyphs = jfnt_alloc(fnt, n_chars * sizeof(*glyphs));
-    if (!glyphs)
+//  Sets up an empty atlas of the given size, in memory given for it by create info if there is any, otherwise in memory
+//  of its own. Format and memory are taken from the bitmap of the font, which font_check_info prepared.
+static jfnt_result font_alloc_atlas(jfnt_font* this, unsigned width, unsigned height, jfnt_bitmap* p_bmp)
+{
+    jfnt_bitmap bmp = this->bmp;
+    bmp.width = width;
+    bmp.height = height;
+    if (bmp.external)
     {
-        jfnt_free(fnt, tmp);
-        jfnt_free(fnt, bmp.data);
-        return JFNT_RESULT_BAD_ALLOC;
+        if (height > bmp.capacity_rows)
+        {
+            JFNT_ERROR(this, "Atlas needs %u rows, but the memory given for it only has %u", height, bmp.capacity_rows);
+            return JFNT_RESULT_ATLAS_FULL;
+        }
     }
-
-    unsigned i_char = 0;
-    unsigned current_x = 0;
-    for (unsigned i_range = 0; i_range < range_count; ++i_range)
+    else
     {
-        const jfnt_codepoint_range range = range_array[i_range];
-
-        FT_GlyphSlot glyph = font->glyph;
-        for (FT_ULong c = range.first; c <= range.last; ++c)
+        bmp.stride = jfnt_row_size(bmp.format, width);
+        const size_t size = bmp.stride * height;
+        if (!(bmp.data = jfnt_alloc(this, size ? size : 1)))
         {
-            if (FT_Load_Char(font, c, FT_LOAD_RENDER) != FT_Err_Ok)
-            {
-                continue;
-            }
-            const unsigned advance_x = glyph->advance.x >> 6;
-            const unsigned advance_y = glyph->advance.y >> 6;
-
-            const unsigned bmp_w = glyph->bitmap.width;
-            const unsigned bmp_h = glyph->bitmap.rows;
-
-            glyphs[i_char].advance_x = advance_x;
-            glyphs[i_char].advance_y = advance_y;
-            glyphs[i_char].w = bmp_w;
-            glyphs[i_char].h = bmp_h;
-            glyphs[i_char].left = (short)glyph->bitmap_left;
-            glyphs[i_char].top = (short)glyph->bitmap_top;
-            glyphs[i_char].offset_x = current_x;
-            glyphs[i_char].codepoint = (char32_t)c;
-
-
-            if (flip)
-            {
-                for (unsigned r = 0; r < bmp_h / 2; ++r)
-                {
-                    memcpy(tmp, glyph->bitmap.buffer + (bmp_w * r), bmp_w);
-                    memcpy(glyph->bitmap.buffer + (bmp_w * r), glyph->bitmap.buffer + (bmp_w * (bmp_h - r - 1)), bmp_w);
-                    memcpy(glyph->bitmap.buffer + (bmp_w * (bmp_h - r - 1)), tmp, bmp_w);
-                }
-            }
-            const jfnt_bitmap t = {.data = glyph->bitmap.buffer, .width = bmp_w, .height = bmp_h};
-            font_add_to_bitmap(&bmp, &t, current_x);
-
-            current_x += (bmp_w + 1);
-            i_char += 1;
+            return JFNT_RESULT_BAD_ALLOC;
         }
     }
-    jfnt_free(fnt, tmp);
-
-    fnt->bmp = bmp;
-    fnt->glyphs = glyphs;
-    fnt->capacity_glyphs = n_chars;
-    fnt->count_glyphs = n_chars;
+    jfnt_bitmap_clear(&bmp, 0, 0, width, height);
+    *p_bmp = bmp;
     return JFNT_RESULT_SUCCESS;
 }
 
-static jfnt_result font_create_from_fc_name(jfnt_font* this, const char* name, FT_Library ft_lib, FT_Face* p_face)
+static void font_free_atlas(const jfnt_font* this, jfnt_bitmap* bmp)
 {
-    const FcBool loaded_fc = FcInit();
-    if (!loaded_fc)
-    {
-        JFNT_ERROR(this, "Could not initialize fontconfig");
-        return JFNT_RESULT_NO_FC;
-    }
-
-    FcPattern* pattern = FcNameParse((const unsigned char*)name);
-    if (!pattern)
+    if (!bmp->external)
     {
-        JFNT_ERROR(this, "Could not create jfnt_font from name \"%s\", reason: invalid name\n", name);
-        return JFNT_RESULT_NO_FC_MATCH;
+        jfnt_free(this, bmp->data);
     }
-    FcResult fc_result;
-    FcPattern* const match = font_match(pattern, &fc_result);
-
-    const jfnt_result res = font_create_from_pattern(this, match, "from name", name, ft_lib, p_face);
-
-    FcPatternDestroy(pattern);
-
-    return res;
+    bmp->data = NULL;
 }
 
+struct glyph_pack_entry_T
+{
+    unsigned index;
+    unsigned w, h;
+};
+typedef struct glyph_pack_entry_T glyph_pack_entry;
 
-const jfnt_allocator_callbacks DEFAULT_ALLOCATOR =
-        {
-        .state = (void*)0xBadBeefCafe,
-        .allocate = default_alloc_fn,
-        .reallocate = default_realloc_fn,
-        .deallocate = default_free_fn,
-        };
-
-jfnt_result
-jfnt_font_create_from_memory(
-        size_t size, const void* mem, unsigned char_size, jfnt_font_create_info create_info, jfnt_font** p_out)
+static int glyph_pack_entry_cmp(const void* a, const void* b)
 {
-    jfnt_font_create_info info = create_info;
-    if (!info.allocator_callbacks)
+    const glyph_pack_entry* const e1 = a;
+    const glyph_pack_entry* const e2 = b;
+    //  Tallest first, then widest first, ties resolved by index, so that the packing is deterministic
+    if (e1->h != e2->h)
     {
-        info.allocator_callbacks = &DEFAULT_ALLOCATOR;
+        return e1->h > e2->h ? -1 : +1;
     }
-    jfnt_font* const this = info.allocator_callbacks->allocate(info.allocator_callbacks->state, sizeof(*this));
-    if (!this)
+    if (e1->w != e2->w)
     {
-        return JFNT_RESULT_BAD_ALLOC;
+        return e1->w > e2->w ? -1 : +1;
     }
-#ifndef NDEBUG
-    memset(this, 0xAB, sizeof(*this));
-#endif
-    this->allocator_callbacks = *info.allocator_callbacks;
-    this->error_callbacks = *info.error_callbacks;
+    return e1->index < e2->index ? -1 : (e1->index > e2->index);
+}
 
-    FT_Library ft_library;
-    FT_Error ft_error = FT_Init_FreeType(&ft_library);
-    if (ft_error != FT_Err_Ok)
+static uint64_t glyph_pixels_hash(unsigned w, unsigned h, const unsigned char* pixels)
+{
+    //  FNV-1a
+    uint64_t hash = 0xCBF29CE484222325u ^ ((uint64_t)w << 32 | h);
+    const size_t size = (size_t)w * h;
+    for (size_t i = 0; i < size; ++i)
     {
-        JFNT_ERROR(this, "Could not init FreeType library, reason: %s", FT_Error_String(ft_error));
-        info.allocator_callbacks->deallocate(info.allocator_callbacks->state, this);
-        return JFNT_RESULT_BAD_FT_CALL;
+        hash = (hash ^ pixels[i]) * 0x100000001B3u;
     }
+    return hash;
+}
 
-    FT_Face face;
-    ft_error = FT_New_Memory_Face(ft_library, mem, (FT_Long)size, 0, &face);
-    if (ft_error != FT_Err_Ok)
+//  Finds glyphs with the same pixels as an earlier one, which are then not packed, but share its place in the atlas.
+//  Identical glyphs come from codepoints mapped to the same glyph index, or from different glyphs that look the same.
+//  Index of the glyph each one shares with is written to the array returned through p_shared, which is the glyph itself
+//  for ones that are packed. It is allocated from the scratch of the font.
+static jfnt_result font_find_shared_glyphs(
+        jfnt_font* fnt, unsigned count, const jfnt_glyph* glyphs, const unsigned char* const* pixels, unsigned** p_shared)
+{
+    size_t capacity = 16;
+    while (capacity < 2 * (size_t)count)
     {
-        JFNT_ERROR(this, "Could not create new FT memory face, reason: %s", FT_Error_String(ft_error));
-        info.allocator_callbacks->deallocate(info.allocator_callbacks->state, this);
-        FT_Done_FreeType(ft_library);
-        return JFNT_RESULT_BAD_FT_CALL;
+        capacity *= 2;
     }
-
-    ft_error = FT_Select_Charmap(face, FT_ENCODING_UNICODE);
-    if (ft_error != FT_Err_Ok)
+    //  Table of glyph indices plus one, with zero for empty entries, paired with their hashes
+    unsigned* const table = jfnt_arena_alloc(&fnt->scratch, &fnt->allocator_callbacks, sizeof(*table) * capacity);
+    uint64_t* const hashes = jfnt_arena_alloc(&fnt->scratch, &fnt->allocator_callbacks, sizeof(*hashes) * capacity);
+    unsigned* const shared = jfnt_arena_alloc(&fnt->scratch, &fnt->allocator_callbacks, sizeof(*shared) * (count ? count : 1));
+    if (!table || !hashes || !shared)
     {
-        JFNT_ERROR(this, "Could not select FT Face encoding, reason: %s", FT_Error_String(ft_error));
-        info.allocator_callbacks->deallocate(info.allocator_callbacks->state, this);
-        FT_Done_Face(face);
-        FT_Done_FreeType(ft_library);
-        return JFNT_RESULT_BAD_FT_CALL;
+        return JFNT_RESULT_BAD_ALLOC;
     }
-
-//    ft_error = FT_Set_Pixel_Sizes(face, 0, char_size);
-//    if (ft_error != FT_Err_Ok)
-//    {
-//        JFNT_ERROR(this, "Could not set FT Face size, reason: %s", FT_Error_String(ft_error));
-//        info.allocator_callbacks->deallocate(info.allocator_callbacks->state, this);
-//        FT_Done_Face(face);
-//        FT_Done_FreeType(ft_library);
-//        return JFNT_RESULT_BAD_FT_CALL;
-//    }
-
-    FcMatrix mtx;
-    FcMatrixInit(&mtx);
-    load_font_data_from_face(this, &mtx, char_size, char_size, face);
-
-    jfnt_result res = ft_font_load(face, info.n_ranges, info.codepoint_ranges, this, info.flip);
-
-    FT_Done_Face(face);
-    FT_Done_FreeType(ft_library);
-    if (res != JFNT_RESULT_SUCCESS)
+    memset(table, 0, sizeof(*table) * capacity);
+    for (unsigned i = 0; i < count; ++i)
     {
-        JFNT_ERROR(this, "Could not select FT Face encoding, reason: %s", FT_Error_String(ft_error));
-        info.allocator_callbacks->deallocate(info.allocator_callbacks->state, this);
-        return res;
+        const jfnt_glyph* const g = glyphs + i;
+        shared[i] = i;
+        if (g->w == 0 || g->h == 0)
+        {
+            continue;
+        }
+        const uint64_t hash = glyph_pixels_hash(g->w, g->h, pixels[i]);
+        size_t pos = (size_t)hash & (capacity - 1);
+        for (; table[pos] != 0; pos = (pos + 1) & (capacity - 1))
+        {
+            const unsigned j = table[pos] - 1;
+            if (hashes[pos] == hash && glyphs[j].w == g->w && glyphs[j].h == g->h &&
+                (pixels[j] == pixels[i] || memcmp(pixels[j], pixels[i], (size_t)g->w * g->h) == 0))
+            {
+                shared[i] = j;
+                break;
+            }
+        }
+        if (shared[i] == i)
+        {
+            table[pos] = i + 1;
+            hashes[pos] = hash;
+        }
+        else
+        {
+            jfnt_stats_count(fnt, &fnt->stats.glyphs_shared, 1);
+            jfnt_stats_count(fnt, &fnt->stats.bytes_shared, (size_t)g->w * g->h * jfnt_pixel_format_bits(fnt->bmp.format) / 8);
+        }
     }
-
-    *p_out = this;
+    *p_shared = shared;
     return JFNT_RESULT_SUCCESS;
 }
 
-void* jfnt_alloc(const jfnt_font* font, size_t size)
+//  Places glyphs into the atlas tallest first, which is what keeps the skyline flat. Glyphs which share the place of
+//  another one, as found by font_find_shared_glyphs, are not packed themselves.
+static jfnt_result font_insert_glyphs(
+        jfnt_font* fnt, jfnt_skyline* packer, unsigned count, jfnt_glyph* glyphs, const unsigned* shared)
 {
-    return font->allocator_callbacks.allocate(font->allocator_callbacks.state, size);
+    const jfnt_arena_mark mark = jfnt_arena_get_mark(&fnt->scratch);
+    glyph_pack_entry* const entries = jfnt_arena_alloc(&fnt->scratch, &fnt->allocator_callbacks, sizeof(*entries) * count);
+    if (!entries)
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    unsigned count_entries = 0;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (!shared || shared[i] == i)
+        {
+            entries[count_entries] = (glyph_pack_entry){.index = i, .w = glyphs[i].w, .h = glyphs[i].h};
+            count_entries += 1;
+        }
+    }
+    qsort(entries, count_entries, sizeof(*entries), glyph_pack_entry_cmp);
+    for (unsigned i = 0; i < count_entries; ++i)
+    {
+        jfnt_glyph* const g = glyphs + entries[i].index;
+        unsigned x, y;
+        const jfnt_result res = jfnt_skyline_insert(packer, &fnt->allocator_callbacks, g->w, g->h, &x, &y);
+        if (res != JFNT_RESULT_SUCCESS)
+        {
+            JFNT_ERROR(fnt, "Could not pack glyph U+%04X into the atlas, reason: %s", (unsigned)g->codepoint, jfnt_result_message(res));
+            jfnt_arena_reset(&fnt->scratch, &fnt->allocator_callbacks, mark);
+            return res;
+        }
+        g->offset_x = x;
+        g->offset_y = y;
+    }
+    for (unsigned i = 0; shared && i < count; ++i)
+    {
+        glyphs[i].offset_x = glyphs[shared[i]].offset_x;
+        glyphs[i].offset_y = glyphs[shared[i]].offset_y;
+    }
+    jfnt_arena_reset(&fnt->scratch, &fnt->allocator_callbacks, mark);
+    return JFNT_RESULT_SUCCESS;
+}
+
+static jfnt_result font_pack_glyphs(
+        jfnt_font* fnt, unsigned count, jfnt_glyph* glyphs, const unsigned char* const* pixels, unsigned max_width,
+        unsigned padding, size_t reserve_area, jfnt_skyline* p_packer)
+{
+    const jfnt_arena_mark mark = jfnt_arena_get_mark(&fnt->scratch);
+    unsigned* shared;
+    jfnt_result res = font_find_shared_glyphs(fnt, count, glyphs, pixels, &shared);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        jfnt_arena_reset(&fnt->scratch, &fnt->allocator_callbacks, mark);
+        return res;
+    }
+    //  Only glyphs which are packed take up space, so empty and shared ones do not count towards the width
+    unsigned widest = 1;
+    size_t total_area = 0;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (glyphs[i].w == 0 || glyphs[i].h == 0 || shared[i] != i)
+        {
+            continue;
+        }
+        if (glyphs[i].w + padding > widest)
+        {
+            widest = glyphs[i].w + padding;
+        }
+        total_area += (size_t)(glyphs[i].w + padding) * (glyphs[i].h + padding);
+    }
+    if (widest > max_width)
+    {
+        JFNT_ERROR(fnt, "Widest glyph needs %u pixels, but the atlas can be at most %u pixels wide", widest, max_width);
+        jfnt_arena_reset(&fnt->scratch, &fnt->allocator_callbacks, mark);
+        return JFNT_RESULT_ATLAS_FULL;
+    }
+
+    res = jfnt_skyline_init(p_packer, &fnt->allocator_callbacks, jfnt_skyline_pick_width(max_width, widest, total_area + reserve_area), padding);
+    if (res == JFNT_RESULT_SUCCESS && (res = font_insert_glyphs(fnt, p_packer, count, glyphs, shared)) != JFNT_RESULT_SUCCESS)
+    {
+        jfnt_skyline_destroy(p_packer, &fnt->allocator_callbacks);
+    }
+    jfnt_arena_reset(&fnt->scratch, &fnt->allocator_callbacks, mark);
+    return res;
+}
+
+//  Creates the lookup for glyphs the font was created with and resets the state related to lazy loading
+static jfnt_result font_build_lookup(jfnt_font* fnt)
+{
+    const unsigned n_chars = fnt->count_glyphs;
+    //  Lazy fonts may get any codepoint later, while others can only ever have the ones they were created with
+    char32_t max_codepoint = fnt->lazy ? JFNT_LOOKUP_MAX_CODEPOINT : 0;
+    for (unsigned i = 0; i < n_chars; ++i)
+    {
+        if (fnt->glyphs[i].codepoint > max_codepoint)
+        {
+            max_codepoint = fnt->glyphs[i].codepoint;
+        }
+    }
+    jfnt_result res = jfnt_lookup_init(
+            &fnt->lookup, &fnt->allocator_callbacks, max_codepoint,
+            fnt->lazy ? JFNT_LOOKUP_UNKNOWN : JFNT_LOOKUP_UNSUPPORTED);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    //  When ranges overlap, the first glyph for the codepoint is the one that is found
+    for (unsigned i = n_chars; i > 0; --i)
+    {
+        if ((res = jfnt_lookup_set(&fnt->lookup, &fnt->allocator_callbacks, fnt->glyphs[i - 1].codepoint, (int)(i - 1))) != JFNT_RESULT_SUCCESS)
+        {
+            jfnt_lookup_destroy(&fnt->lookup, &fnt->allocator_callbacks);
+            return res;
+        }
+    }
+
+    fnt->reported_glyphs = n_chars;
+    return JFNT_RESULT_SUCCESS;
+}
+
+//  Lazy fonts modify their atlas, so they can not use a read-only mapping of it, nor can the atlas be in a mapping when
+//  it is supposed to be in memory given by the caller
+static int font_uses_cache(const jfnt_font_create_info* info)
+{
+    return info->cache_path && !info->lazy && !info->atlas_memory && !info->cell_grid;
+}
+
+//  Tries to load the font from the cache file, if the create info specifies it
+static int font_load_cached(
+        jfnt_font* this, const jfnt_font_create_info* info, jfnt_cache_source source, const char* name,
+        size_t mem_size, const void* mem, unsigned char_size)
+{
+    if (!font_uses_cache(info))
+    {
+        return 0;
+    }
+    const uint64_t begin = jfnt_stats_begin(this);
+    jfnt_cache_key key;
+    int loaded = 0;
+    if (jfnt_cache_key_create(this, info, source, name, mem_size, mem, char_size, &key) == JFNT_RESULT_SUCCESS)
+    {
+        loaded = jfnt_cache_load(this, info->cache_path, &key);
+        jfnt_cache_key_destroy(this, &key);
+    }
+    jfnt_stats_end(this, JFNT_PHASE_CACHE, begin);
+    if (!loaded)
+    {
+        return 0;
+    }
+    this->lazy = 0;
+    const uint64_t lookup_begin = jfnt_stats_begin(this);
+    const jfnt_result res = font_build_lookup(this);
+    jfnt_stats_end(this, JFNT_PHASE_LOOKUP, lookup_begin);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        jfnt_cache_unmap(this);
+        jfnt_free(this, this->face_path);
+        this->face_path = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+static void font_store_cached(
+        jfnt_font* this, const jfnt_font_create_info* info, jfnt_cache_source source, const char* name,
+        size_t mem_size, const void* mem, unsigned char_size)
+{
+    if (!font_uses_cache(info))
+    {
+        return;
+    }
+    const uint64_t begin = jfnt_stats_begin(this);
+    jfnt_cache_key key;
+    if (jfnt_cache_key_create(this, info, source, name, mem_size, mem, char_size, &key) != JFNT_RESULT_SUCCESS)
+    {
+        JFNT_ERROR(this, "Could not create the key for the cache file \"%s\"", info->cache_path);
+    }
+    else
+    {
+        jfnt_cache_store(this, info->cache_path, &key);
+        jfnt_cache_key_destroy(this, &key);
+    }
+    jfnt_stats_end(this, JFNT_PHASE_CACHE, begin);
+}
+
+//  Id of the glyph used for kerning. Glyphs of fallback faces have the position of the face in the chain above the
+//  FreeType id, which keeps them apart from the glyphs of the first face and means they never kern.
+static unsigned font_glyph_id(unsigned face, FT_UInt glyph_id)
+{
+    return face << 16 | glyph_id;
+}
+
+//  Finds FreeType ids of glyphs and extracts kerning between them. Lazy fonts keep all pairs of the face, since any
+//  glyph may get loaded later.
+static jfnt_result font_load_kerning(jfnt_font* this, FT_Face face)
+{
+    const unsigned n_chars = this->count_glyphs;
+    this->glyph_ids = jfnt_alloc(this, sizeof(*this->glyph_ids) * (n_chars ? n_chars : 1));
+    if (!this->glyph_ids)
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    for (unsigned i = 0; i < n_chars; ++i)
+    {
+        const jfnt_glyph* const g = this->glyphs + i;
+        const FT_Face glyph_face = g->face ? this->fallbacks[g->face - 1].face : face;
+        this->glyph_ids[i] = font_glyph_id(g->face, FT_Get_Char_Index(glyph_face, g->codepoint));
+    }
+    const jfnt_result res = jfnt_kerning_load(&this->kerning, &this->allocator_callbacks, face, n_chars, this->glyph_ids, this->lazy);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        JFNT_ERROR(this, "Could not extract kerning pairs of the font, reason: %s", jfnt_result_message(res));
+        jfnt_free(this, this->glyph_ids);
+        this->glyph_ids = NULL;
+    }
+    return res;
+}
+
+static jfnt_result font_rasterize_face(
+        jfnt_font* this, const jfnt_raster_face* face, unsigned thread_count, unsigned n_ranges,
+        const jfnt_codepoint_range* ranges, jfnt_range_list* p_missing, jfnt_staged_glyphs* p_out)
+{
+    const uint64_t begin = jfnt_stats_begin(this);
+    const jfnt_result res = jfnt_rasterize_ranges(this, face, thread_count, n_ranges, ranges, p_missing, p_out);
+    jfnt_stats_end(this, JFNT_PHASE_RASTERIZE, begin);
+    if (res == JFNT_RESULT_SUCCESS)
+    {
+        jfnt_stats_count(this, &this->stats.glyphs_rasterized, p_out->count);
+    }
+    return res;
+}
+
+//  Renders the requested ranges from the first face, then whatever it did not have from each face of the fallback chain
+//  in turn, until there is nothing left or the chain runs out. Faces whose charset has none of what is left are skipped
+//  without being opened.
+static jfnt_result font_rasterize_chain(
+        jfnt_font* this, FT_Face face, unsigned thread_count, unsigned n_ranges, const jfnt_codepoint_range* ranges,
+        jfnt_staged_glyphs* p_out)
+{
+    jfnt_raster_face first =
+            {
+                    .face = face,
+                    .path = this->face_path,
+                    .index = this->face_index,
+            };
+    //  Workers read from the same memory as the face, which for files is the mapping the context made
+    first.mem = jfnt_context_face_data(this->context, face, &first.mem_size);
+    if (!this->fallback_set)
+    {
+        return font_rasterize_face(this, &first, thread_count, n_ranges, ranges, NULL, p_out);
+    }
+    jfnt_range_list missing = {0};
+    jfnt_staged_glyphs staged;
+    jfnt_result res = font_rasterize_face(this, &first, thread_count, n_ranges, ranges, &missing, &staged);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        jfnt_range_list_destroy(this, &missing);
+        return res;
+    }
+    for (unsigned i = 0; i < this->count_fallbacks && missing.count && res == JFNT_RESULT_SUCCESS; ++i)
+    {
+        const jfnt_font_fallback* const f = this->fallbacks + i;
+        if (!f->charset || !charset_intersects(f->charset, missing.count, missing.ranges) || font_open_fallback(this, i) != JFNT_RESULT_SUCCESS)
+        {
+            continue;
+        }
+        //  Lazy fonts may have used the face with another size since it was opened
+        font_activate_fallback(this, f);
+        jfnt_raster_face source = {.face = f->face, .path = f->path, .index = f->index, .id = (unsigned short)(i + 1)};
+        source.mem = jfnt_context_face_data(this->context, f->face, &source.mem_size);
+        jfnt_range_list still_missing = {0};
+        jfnt_staged_glyphs found;
+        res = font_rasterize_face(this, &source, thread_count, missing.count, missing.ranges, &still_missing, &found);
+        if (res == JFNT_RESULT_SUCCESS)
+        {
+            res = jfnt_staged_glyphs_append(this, &staged, &found);
+        }
+        jfnt_range_list_destroy(this, &missing);
+        missing = still_missing;
+    }
+    if (res == JFNT_RESULT_SUCCESS)
+    {
+        for (unsigned i = 0; i < missing.count; ++i)
+        {
+            jfnt_report_unsupported(this, missing.ranges[i].first, missing.ranges[i].last, "Font has no glyph for the codepoints");
+        }
+        *p_out = staged;
+    }
+    else
+    {
+        jfnt_staged_glyphs_release(this, &staged);
+    }
+    jfnt_range_list_destroy(this, &missing);
+    return res;
+}
+
+//  Top-left corner of cell i of a font whose atlas is split into a regular grid of cells, either by an atlas budget or
+//  by cell_grid
+static void font_cell_origin(const jfnt_font* this, unsigned i, unsigned* p_x, unsigned* p_y)
+{
+    *p_x = i % this->cell_columns * this->cell_w;
+    *p_y = i / this->cell_columns * this->cell_h;
+}
+
+//  Splits the atlas of a font with a budget into cells big enough for any glyph of the face, as given by its bounding
+//  box, and allocates the atlas and frame stamps of glyphs. Atlas is as close to square as the budget allows.
+static jfnt_result font_init_cells(jfnt_font* this, FT_Face face, const jfnt_font_create_info* info, jfnt_bitmap* p_bmp)
+{
+    unsigned glyph_w, glyph_h;
+    if (FT_IS_SCALABLE(face))
+    {
+        glyph_w = (unsigned)((FT_MulFix(face->bbox.xMax - face->bbox.xMin, face->size->metrics.x_scale) + 63) >> 6);
+        glyph_h = (unsigned)((FT_MulFix(face->bbox.yMax - face->bbox.yMin, face->size->metrics.y_scale) + 63) >> 6);
+    }
+    else
+    {
+        glyph_w = (unsigned)(face->size->metrics.max_advance >> 6);
+        glyph_h = (unsigned)(face->size->metrics.height >> 6);
+    }
+    //  Outlines are rounded outwards to whole pixels on each side, and distance fields extend past them by the spread
+    this->cell_w = glyph_w + 2 + 2 * this->sdf_spread + info->atlas_padding;
+    this->cell_h = glyph_h + 2 + 2 * this->sdf_spread + info->atlas_padding;
+    this->cell_padding = info->atlas_padding;
+
+    const size_t budget = info->atlas_budget;
+    const unsigned max_width = font_max_atlas_width(this, info);
+    unsigned width = 1;
+    while (width * 2 <= max_width && (size_t)width * 2 * width * 2 <= budget)
+    {
+        width *= 2;
+    }
+    if (width < this->cell_w)
+    {
+        width = this->cell_w;
+    }
+    if (width > max_width || (size_t)width * this->cell_h > budget)
+    {
+        JFNT_ERROR(this, "Atlas budget of %zu pixels can not fit a single glyph cell of %u x %u pixels", budget, this->cell_w, this->cell_h);
+        return JFNT_RESULT_ATLAS_FULL;
+    }
+    this->cell_columns = width / this->cell_w;
+    unsigned rows = (unsigned)(budget / width / this->cell_h);
+    if (this->bmp.external && rows > this->bmp.capacity_rows / this->cell_h)
+    {
+        rows = this->bmp.capacity_rows / this->cell_h;
+    }
+    if (!rows)
+    {
+        JFNT_ERROR(this, "Memory given for the atlas has %u rows, which is not enough for a glyph cell of %u", this->bmp.capacity_rows, this->cell_h);
+        return JFNT_RESULT_ATLAS_FULL;
+    }
+    this->count_cells = this->cell_columns * rows;
+
+    this->glyph_frames = jfnt_alloc(this, sizeof(*this->glyph_frames) * this->count_cells);
+    if (!this->glyph_frames)
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    memset(this->glyph_frames, 0, sizeof(*this->glyph_frames) * this->count_cells);
+    const jfnt_result res = font_alloc_atlas(this, width, rows * this->cell_h, p_bmp);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        jfnt_free(this, this->glyph_frames);
+        this->glyph_frames = NULL;
+        return res;
+    }
+    this->cache_stats.cells = this->count_cells;
+    return JFNT_RESULT_SUCCESS;
+}
+
+//  Puts glyph i into cell i of an atlas with a budget
+static jfnt_result font_place_in_cells(
+        jfnt_font* fnt, FT_Face face, const jfnt_font_create_info* info, unsigned count, jfnt_glyph* glyphs,
+        jfnt_bitmap* p_bmp)
+{
+    jfnt_result res = font_init_cells(fnt, face, info, p_bmp);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    if (count > fnt->count_cells)
+    {
+        JFNT_ERROR(fnt, "Font was created with %u glyphs, but its atlas budget only has room for %u", count, fnt->count_cells);
+        res = JFNT_RESULT_ATLAS_FULL;
+    }
+    size_t used = 0;
+    for (unsigned i = 0; i < count && res == JFNT_RESULT_SUCCESS; ++i)
+    {
+        jfnt_glyph* const g = glyphs + i;
+        if (g->w + info->atlas_padding > fnt->cell_w || g->h + info->atlas_padding > fnt->cell_h)
+        {
+            JFNT_ERROR(fnt, "Glyph U+%04X of %u x %u pixels does not fit into an atlas cell", (unsigned)g->codepoint, g->w, g->h);
+            res = JFNT_RESULT_ATLAS_FULL;
+            break;
+        }
+        font_cell_origin(fnt, i, &g->offset_x, &g->offset_y);
+        used += (size_t)g->w * g->h;
+    }
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        font_free_atlas(fnt, p_bmp);
+        jfnt_free(fnt, fnt->glyph_frames);
+        fnt->glyph_frames = NULL;
+        fnt->count_cells = 0;
+        return res;
+    }
+    fnt->atlas_used = used;
+    return JFNT_RESULT_SUCCESS;
+}
+
+//  Number of cells a glyph takes in a cell grid. Glyphs at least one and a half cells wide take two, which are the wide
+//  characters of EXTENT_CHAR_COLS, such as CJK ideographs.
+static unsigned font_grid_columns(unsigned advance, unsigned cell_w)
+{
+    return 2 * advance >= 3 * cell_w ? 2 : 1;
+}
+
+//  Lays glyphs out in a grid of cells of average_width x height pixels, with glyph i in cell i, and allocates the atlas.
+//  Wide glyphs come first, each at an even index and followed by a glyph for its right half, so that with an even number
+//  of columns both of their cells are in the same row. Glyphs of the grid are returned through p_glyphs, each with the
+//  index of the glyph it is drawn from in p_sources, which is allocated from the scratch of the font, or UINT_MAX for
+//  right halves of wide glyphs.
+static jfnt_result font_place_in_grid(
+        jfnt_font* fnt, const jfnt_font_create_info* info, unsigned count, const jfnt_glyph* glyphs,
+        unsigned* p_count, jfnt_glyph** p_glyphs, unsigned** p_sources, jfnt_bitmap* p_bmp)
+{
+    const unsigned cell_w = fnt->average_width;
+    const unsigned cell_h = fnt->height;
+    if (!cell_w || !cell_h)
+    {
+        JFNT_ERROR(fnt, "Font has cells of %u x %u pixels, so it can not have a cell grid", cell_w, cell_h);
+        return JFNT_RESULT_UNSUPPORTED;
+    }
+    unsigned count_wide = 0;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        count_wide += font_grid_columns(glyphs[i].advance_x, cell_w) == 2;
+    }
+    const unsigned grid_count = count + count_wide;
+    fnt->cell_w = cell_w + info->atlas_padding;
+    fnt->cell_h = cell_h + info->atlas_padding;
+    fnt->cell_padding = info->atlas_padding;
+
+    unsigned max_columns = font_max_atlas_width(fnt, info) / fnt->cell_w;
+    if (count_wide)
+    {
+        max_columns &= ~1u;
+    }
+    if (!max_columns)
+    {
+        JFNT_ERROR(fnt, "Atlas of at most %u pixels in width can not fit a row of grid cells %u pixels wide", font_max_atlas_width(fnt, info), fnt->cell_w);
+        return JFNT_RESULT_ATLAS_FULL;
+    }
+    //  Atlas is as close to square as its width allows
+    unsigned columns = 1;
+    while (columns < max_columns && (size_t)columns * columns * fnt->cell_w < (size_t)grid_count * fnt->cell_h)
+    {
+        columns += 1;
+    }
+    if (count_wide && (columns & 1))
+    {
+        columns += 1;
+    }
+    fnt->cell_columns = columns;
+    const unsigned rows = (grid_count + columns - 1) / columns;
+
+    jfnt_glyph* const grid = jfnt_alloc(fnt, sizeof(*grid) * (grid_count ? grid_count : 1));
+    unsigned* const sources = jfnt_arena_alloc(&fnt->scratch, &fnt->allocator_callbacks, sizeof(*sources) * (grid_count ? grid_count : 1));
+    if (!grid || !sources)
+    {
+        jfnt_free(fnt, grid);
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    unsigned next_wide = 0, next_narrow = 2 * count_wide;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        const jfnt_glyph* const g = glyphs + i;
+        const unsigned cols = font_grid_columns(g->advance_x, cell_w);
+        const unsigned index = cols == 2 ? next_wide : next_narrow;
+        if (cols == 2)
+        {
+            next_wide += 2;
+        }
+        else
+        {
+            next_narrow += 1;
+        }
+        jfnt_glyph* const cell = grid + index;
+        *cell = (jfnt_glyph){
+                .codepoint = g->codepoint,
+                .top = (signed short)fnt->ascent,
+                .left = 0,
+                .w = (unsigned short)(cols * cell_w),
+                .h = (unsigned short)cell_h,
+                .advance_x = (unsigned short)(cols * cell_w),
+                .advance_y = g->advance_y,
+                .face = g->face,
+        };
+        font_cell_origin(fnt, index, &cell->offset_x, &cell->offset_y);
+        sources[index] = i;
+        if (cols == 2)
+        {
+            //  Right half is never found by a lookup, since the whole glyph comes before it
+            jfnt_glyph* const half = cell + 1;
+            *half = *cell;
+            half->left = (signed short)cell_w;
+            half->w = (unsigned short)cell_w;
+            half->advance_x = 0;
+            font_cell_origin(fnt, index + 1, &half->offset_x, &half->offset_y);
+            sources[index + 1] = UINT_MAX;
+        }
+    }
+
+    const jfnt_result res = font_alloc_atlas(fnt, columns * fnt->cell_w, rows * fnt->cell_h, p_bmp);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        jfnt_free(fnt, grid);
+        return res;
+    }
+    fnt->atlas_used = (size_t)grid_count * cell_w * cell_h;
+    *p_count = grid_count;
+    *p_glyphs = grid;
+    *p_sources = sources;
+    return JFNT_RESULT_SUCCESS;
+}
+
+//  Copies pixels of a glyph into its cell of the grid, with the baseline at the ascent below the top of the cell, and
+//  cuts off whatever falls outside of the cell
+static void font_blit_into_cell(
+        const jfnt_font* fnt, const jfnt_bitmap* bmp, const jfnt_glyph* cell, const jfnt_glyph* g,
+        const unsigned char* pixels)
+{
+    int x = g->left;
+    int y = fnt->ascent - g->top;
+    if (fnt->flip)
+    {
+        //  Rows of the glyph were flipped when it was staged, so the cell is flipped as a whole
+        y = (int)cell->h - y - (int)g->h;
+    }
+    unsigned src_x = 0, src_y = 0;
+    if (x < 0)
+    {
+        src_x = (unsigned)-x;
+        x = 0;
+    }
+    if (y < 0)
+    {
+        src_y = (unsigned)-y;
+        y = 0;
+    }
+    if (src_x >= g->w || src_y >= g->h || (unsigned)x >= cell->w || (unsigned)y >= cell->h)
+    {
+        return;
+    }
+    unsigned w = g->w - src_x;
+    unsigned h = g->h - src_y;
+    if (w > cell->w - (unsigned)x)
+    {
+        w = cell->w - (unsigned)x;
+    }
+    if (h > cell->h - (unsigned)y)
+    {
+        h = cell->h - (unsigned)y;
+    }
+    jfnt_bitmap_blit(bmp, cell->offset_x + x, cell->offset_y + y, pixels + (size_t)src_y * g->w + src_x, g->w, w, h, 0);
+}
+
+//  Packs glyphs with the skyline packer, which is then kept for adding more of them, and allocates the atlas
+static jfnt_result font_pack_atlas(
+        jfnt_font* fnt, const jfnt_font_create_info* info, unsigned count, jfnt_glyph* glyphs,
+        const unsigned char* const* pixels, jfnt_skyline* p_packer, jfnt_bitmap* p_bmp)
+{
+    const unsigned max_width = font_max_atlas_width(fnt, info);
+    //  Lazy fonts will have glyphs added later, so leave some room for them when picking the atlas width
+    const size_t cell_size = fnt->height + info->atlas_padding;
+    const size_t reserve_area = info->lazy ? LAZY_RESERVED_GLYPHS * cell_size * cell_size : 0;
+    jfnt_result res = font_pack_glyphs(fnt, count, glyphs, pixels, max_width, info->atlas_padding, reserve_area, p_packer);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    if ((res = font_alloc_atlas(fnt, p_packer->width, p_packer->height, p_bmp)) != JFNT_RESULT_SUCCESS)
+    {
+        jfnt_skyline_destroy(p_packer, &fnt->allocator_callbacks);
+        return res;
+    }
+    fnt->atlas_used = p_packer->used_area;
+    return JFNT_RESULT_SUCCESS;
+}
+
+static jfnt_result
+ft_font_load(FT_Face font, const jfnt_font_create_info* info, jfnt_font* fnt)
+{
+    fnt->lazy = info->lazy;
+    fnt->flip = info->flip;
+    fnt->thread_count = info->thread_count;
+
+    jfnt_staged_glyphs staged;
+    jfnt_result res = font_rasterize_chain(fnt, font, info->thread_count, info->n_ranges, info->codepoint_ranges, &staged);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    unsigned n_chars = staged.count;
+    jfnt_glyph* glyphs = staged.glyphs;
+    staged.glyphs = NULL;
+
+    jfnt_skyline packer = {0};
+    jfnt_bitmap bmp;
+    const jfnt_arena_mark mark = jfnt_arena_get_mark(&fnt->scratch);
+    unsigned grid_count = 0;
+    jfnt_glyph* grid_glyphs = NULL;
+    unsigned* grid_sources = NULL;
+    uint64_t begin = jfnt_stats_begin(fnt);
+    if (info->cell_grid)
+    {
+        res = font_place_in_grid(fnt, info, n_chars, glyphs, &grid_count, &grid_glyphs, &grid_sources, &bmp);
+    }
+    else if (info->atlas_budget)
+    {
+        res = font_place_in_cells(fnt, font, info, n_chars, glyphs, &bmp);
+    }
+    else
+    {
+        res = font_pack_atlas(fnt, info, n_chars, glyphs, staged.pixels, &packer, &bmp);
+    }
+    jfnt_stats_end(fnt, JFNT_PHASE_PACK, begin);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        jfnt_arena_reset(&fnt->scratch, &fnt->allocator_callbacks, mark);
+        jfnt_staged_glyphs_release(fnt, &staged);
+        jfnt_free(fnt, glyphs);
+        return res;
+    }
+
+    //  Glyphs were already flipped when staged
+    begin = jfnt_stats_begin(fnt);
+    if (grid_glyphs)
+    {
+        for (unsigned i = 0; i < grid_count; ++i)
+        {
+            const unsigned src = grid_sources[i];
+            if (src != UINT_MAX)
+            {
+                font_blit_into_cell(fnt, &bmp, grid_glyphs + i, glyphs + src, staged.pixels[src]);
+            }
+        }
+        jfnt_free(fnt, glyphs);
+        glyphs = grid_glyphs;
+        n_chars = grid_count;
+    }
+    else
+    {
+        for (unsigned i_char = 0; i_char < n_chars; ++i_char)
+        {
+            const jfnt_glyph* const g = glyphs + i_char;
+            jfnt_bitmap_blit(&bmp, g->offset_x, g->offset_y, staged.pixels[i_char], g->w, g->w, g->h, 0);
+        }
+    }
+    jfnt_stats_end(fnt, JFNT_PHASE_BLIT, begin);
+    jfnt_arena_reset(&fnt->scratch, &fnt->allocator_callbacks, mark);
+    jfnt_staged_glyphs_release(fnt, &staged);
+    fnt->bmp = bmp;
+
+    fnt->glyphs = glyphs;
+    fnt->capacity_glyphs = n_chars;
+    fnt->count_glyphs = n_chars;
+    begin = jfnt_stats_begin(fnt);
+    res = font_load_kerning(fnt, font);
+    jfnt_stats_end(fnt, JFNT_PHASE_KERNING, begin);
+    if (res == JFNT_RESULT_SUCCESS)
+    {
+        begin = jfnt_stats_begin(fnt);
+        res = font_build_lookup(fnt);
+        jfnt_stats_end(fnt, JFNT_PHASE_LOOKUP, begin);
+        if (res != JFNT_RESULT_SUCCESS)
+        {
+            jfnt_kerning_destroy(&fnt->kerning, &fnt->allocator_callbacks);
+            jfnt_free(fnt, fnt->glyph_ids);
+        }
+    }
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        if (packer.nodes)
+        {
+            jfnt_skyline_destroy(&packer, &fnt->allocator_callbacks);
+        }
+        jfnt_free(fnt, fnt->glyph_frames);
+        fnt->glyph_frames = NULL;
+        fnt->count_cells = 0;
+        jfnt_free(fnt, glyphs);
+        font_free_atlas(fnt, &fnt->bmp);
+        return res;
+    }
+
+    fnt->packer = packer;
+    return JFNT_RESULT_SUCCESS;
+}
+
+//  Runs the loading of glyphs from the face of the font, which stays open only when the font is lazy
+static jfnt_result font_load_from_face(jfnt_font* this, const jfnt_font_create_info* info)
+{
+    //  Scratch is sized for the character map, the table of shared glyphs and the packing order of a face with this many
+    //  glyphs, which covers the temporary memory of the first face in a single block
+    const size_t scratch_size = (size_t)this->face->num_glyphs * (
+            sizeof(char32_t) + sizeof(glyph_pack_entry) + sizeof(unsigned) + 2 * (sizeof(unsigned) + sizeof(uint64_t)));
+    jfnt_result res = jfnt_arena_reserve(&this->scratch, &this->allocator_callbacks, scratch_size);
+    if (res == JFNT_RESULT_SUCCESS)
+    {
+        res = ft_font_load(this->face, info, this);
+    }
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        jfnt_free(this, this->face_path);
+        this->face_path = NULL;
+    }
+    return res;
+}
+
+//  Opens the face from the file, or from memory if filename is NULL, and sets it up with the character size
+static jfnt_result font_create_from_source(
+        jfnt_font* this, const char* filename, const void* mem, size_t mem_size, unsigned char_size)
+{
+    FT_Face face;
+    jfnt_result res = font_open_face(this, filename, mem, mem_size, 0, &face);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        return res;
+    }
+
+    const FT_Error ft_error = FT_Select_Charmap(face, FT_ENCODING_UNICODE);
+    if (ft_error != FT_Err_Ok)
+    {
+        JFNT_ERROR(this, "Could not select FT Face encoding, reason: %s", FT_Error_String(ft_error));
+        return JFNT_RESULT_BAD_FT_CALL;
+    }
+
+    if (filename && !(this->face_path = font_strdup(this, filename)))
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+
+    FcMatrix mtx;
+    FcMatrixInit(&mtx);
+    load_font_data_from_face(this, &mtx, char_size, char_size, face);
+    return JFNT_RESULT_SUCCESS;
+}
+
+//  Keeps the faces fontconfig sorts for the pattern as the fallback chain of the font, in the same order. Those which add
+//  nothing to the charsets of faces before them are trimmed away by fontconfig.
+static jfnt_result font_sort_fallbacks(jfnt_font* this, FcConfig* config, FcPattern* pattern)
+{
+    FcResult fc_result;
+    const uint64_t begin = jfnt_stats_begin(this);
+    FcFontSet* const set = FcFontSort(config, pattern, FcTrue, NULL, &fc_result);
+    jfnt_stats_end(this, JFNT_PHASE_MATCH, begin);
+    if (!set)
+    {
+        JFNT_ERROR(this, "Could not sort fonts for the fallback chain, reason: %s", FC_ERRORS[fc_result]);
+        return JFNT_RESULT_BAD_FC_CALL;
+    }
+    //  Face positions in the chain have to fit into jfnt_glyph
+    const unsigned count = set->nfont < 0xFFFF ? (unsigned)set->nfont : 0xFFFF;
+    jfnt_font_fallback* const fallbacks = jfnt_alloc(this, sizeof(*fallbacks) * (count ? count : 1));
+    if (!fallbacks)
+    {
+        FcFontSetDestroy(set);
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    for (unsigned i = 0; i < count; ++i)
+    {
+        jfnt_font_fallback* const f = fallbacks + i;
+        *f = (jfnt_font_fallback){0};
+        FcChar8* file;
+        FcCharSet* charset;
+        if (FcPatternGetString(set->fonts[i], FC_FILE, 0, &file) != FcResultMatch ||
+            FcPatternGetCharSet(set->fonts[i], FC_CHARSET, 0, &charset) != FcResultMatch)
+        {
+            continue;
+        }
+        if (FcPatternGetInteger(set->fonts[i], FC_INDEX, 0, &f->index) != FcResultMatch)
+        {
+            f->index = 0;
+        }
+        f->path = (const char*)file;
+        //  Best match is usually first in the set as well, but there is no point in asking it again
+        if (f->index != this->face_index || strcmp(f->path, this->face_path) != 0)
+        {
+            f->charset = charset;
+        }
+    }
+    this->fallback_set = set;
+    this->count_fallbacks = count;
+    this->fallbacks = fallbacks;
+    return JFNT_RESULT_SUCCESS;
+}
+
+static jfnt_result font_create_from_fc_name(jfnt_font* this, const char* name, int fallback)
+{
+    const uint64_t begin = jfnt_stats_begin(this);
+    FcConfig* config;
+    if (jfnt_context_fontconfig(this->context, &config) != JFNT_RESULT_SUCCESS)
+    {
+        JFNT_ERROR(this, "Could not initialize fontconfig");
+        return JFNT_RESULT_NO_FC;
+    }
+
+    FcPattern* pattern = FcNameParse((const unsigned char*)name);
+    if (!pattern)
+    {
+        JFNT_ERROR(this, "Could not create jfnt_font from name \"%s\", reason: invalid name\n", name);
+        return JFNT_RESULT_NO_FC_MATCH;
+    }
+    FcResult fc_result;
+    FcPattern* const match = font_match(config, pattern, &fc_result);
+    jfnt_stats_end(this, JFNT_PHASE_MATCH, begin);
+
+    jfnt_result res = font_create_from_pattern(this, match, "from name", name);
+    if (res == JFNT_RESULT_SUCCESS && fallback)
+    {
+        //  Pattern was already substituted when it was matched
+        res = font_sort_fallbacks(this, config, pattern);
+        if (res != JFNT_RESULT_SUCCESS)
+        {
+            //  Face itself is closed with the context, but the font is not loaded, which would otherwise free the path
+            jfnt_free(this, this->face_path);
+            this->face_path = NULL;
+        }
+    }
+
+    FcPatternDestroy(pattern);
+
+    return res;
+}
+
+static void* stats_allocate(void* state, size_t size)
+{
+    jfnt_font* const this = state;
+    jfnt_stats_count(this, &this->stats.allocations, 1);
+    jfnt_stats_count(this, &this->stats.bytes_allocated, size);
+    return this->stats_allocator.allocate(this->stats_allocator.state, size);
+}
+
+static void* stats_reallocate(void* state, void* ptr, size_t new_size)
+{
+    jfnt_font* const this = state;
+    jfnt_stats_count(this, &this->stats.allocations, 1);
+    jfnt_stats_count(this, &this->stats.bytes_allocated, new_size);
+    return this->stats_allocator.reallocate(this->stats_allocator.state, ptr, new_size);
+}
+
+static void stats_deallocate(void* state, void* ptr)
+{
+    //  Font itself is released through this as well, so the callbacks must be copied out of it first
+    const jfnt_allocator_callbacks allocator = ((const jfnt_font*)state)->stats_allocator;
+    allocator.deallocate(allocator.state, ptr);
+}
+
+//  Checks the options of create info which can be wrong and sets the corresponding members of the font
+static jfnt_result font_check_info(jfnt_font* this, const jfnt_font_create_info* info)
+{
+    switch (info->render_mode)
+    {
+    case JFNT_RENDER_MODE_COVERAGE:
+    case JFNT_RENDER_MODE_SDF:
+        break;
+    case JFNT_RENDER_MODE_MSDF:
+        JFNT_ERROR(this, "Multi-channel distance fields can not be rendered by FreeType");
+        return JFNT_RESULT_UNSUPPORTED;
+    default:
+        JFNT_ERROR(this, "Unknown render mode %d", (int)info->render_mode);
+        return JFNT_RESULT_BAD_ARGUMENT;
+    }
+    const unsigned spread = info->sdf_spread ? info->sdf_spread : JFNT_DEFAULT_SDF_SPREAD;
+    if (spread < 2 || spread > 32)
+    {
+        JFNT_ERROR(this, "Distance field spread %u is outside of the range from 2 to 32", spread);
+        return JFNT_RESULT_BAD_ARGUMENT;
+    }
+    if (info->atlas_budget && !info->lazy)
+    {
+        JFNT_ERROR(this, "Only lazy fonts can have an atlas budget, since others never get any new glyphs");
+        return JFNT_RESULT_BAD_ARGUMENT;
+    }
+    if (!jfnt_pixel_format_bits(info->pixel_format))
+    {
+        JFNT_ERROR(this, "Unknown pixel format %d", (int)info->pixel_format);
+        return JFNT_RESULT_BAD_ARGUMENT;
+    }
+    if (info->pixel_format == JFNT_PIXEL_FORMAT_R1 && info->render_mode == JFNT_RENDER_MODE_SDF)
+    {
+        JFNT_ERROR(this, "Distance fields need more than one bit per pixel");
+        return JFNT_RESULT_BAD_ARGUMENT;
+    }
+    if (info->concurrent && !info->lazy)
+    {
+        JFNT_ERROR(this, "Only lazy fonts need to be concurrent, since others can be looked up from any thread already");
+        return JFNT_RESULT_BAD_ARGUMENT;
+    }
+    if (info->concurrent && info->atlas_budget)
+    {
+        JFNT_ERROR(this, "Fonts with an atlas budget can not be concurrent, since their glyphs are evicted in place");
+        return JFNT_RESULT_BAD_ARGUMENT;
+    }
+    if (info->cell_grid && info->lazy)
+    {
+        JFNT_ERROR(this, "Lazy fonts can not have a cell grid, since all of its glyphs are laid out when it is created");
+        return JFNT_RESULT_BAD_ARGUMENT;
+    }
+    if (info->cell_grid && info->render_mode != JFNT_RENDER_MODE_COVERAGE)
+    {
+        JFNT_ERROR(this, "Cell grid is drawn at the size of the font, so it can only be used with coverage");
+        return JFNT_RESULT_BAD_ARGUMENT;
+    }
+    if (info->atlas_memory && (info->atlas_stride < jfnt_row_size(info->pixel_format, 1) || !info->atlas_rows))
+    {
+        JFNT_ERROR(this, "Memory given for the atlas must have room for at least one pixel, but its stride is %zu and it has %u rows", info->atlas_stride, info->atlas_rows);
+        return JFNT_RESULT_BAD_ARGUMENT;
+    }
+    this->bmp = (jfnt_bitmap){
+            .width = 0,
+            .height = 0,
+            .stride = info->atlas_stride,
+            .format = info->pixel_format,
+            .external = info->atlas_memory != NULL,
+            .capacity_rows = info->atlas_rows,
+            .data = info->atlas_memory,
+    };
+    this->render_mode = info->render_mode;
+    this->sdf_spread = info->render_mode == JFNT_RENDER_MODE_SDF ? spread : 0;
+    this->count_cells = 0;
+    this->cell_grid = info->cell_grid != 0;
+    this->concurrent = info->concurrent != 0;
+    this->count_retired = 0;
+    this->capacity_retired = 0;
+    this->retired = NULL;
+    this->frame = 0;
+    this->glyph_frames = NULL;
+    this->cache_stats = (jfnt_glyph_cache_stats){0};
+    this->evicted = info->evicted;
+    this->evicted_param = info->evicted_param;
+    this->collect_stats = info->collect_stats != 0;
+    this->stats = (jfnt_font_stats){0};
+    if (this->collect_stats)
+    {
+        //  Allocation of the font itself was already made
+        this->stats.allocations = 1;
+        this->stats.bytes_allocated = sizeof(*this);
+        this->stats_allocator = this->allocator_callbacks;
+        this->allocator_callbacks = (jfnt_allocator_callbacks){
+                .state = this,
+                .allocate = stats_allocate,
+                .reallocate = stats_reallocate,
+                .deallocate = stats_deallocate,
+        };
+    }
+    return JFNT_RESULT_SUCCESS;
+}
+
+//  Gives the font the context from create info, or its own one if there is none
+static jfnt_result font_attach_context(jfnt_font* this, const jfnt_font_create_info* info)
+{
+    this->face = NULL;
+    this->ft_size = NULL;
+    this->fallback_set = NULL;
+    this->count_fallbacks = 0;
+    this->fallbacks = NULL;
+    if (info->context)
+    {
+        this->context = info->context;
+        this->own_context = 0;
+        return JFNT_RESULT_SUCCESS;
+    }
+    this->own_context = 1;
+    return jfnt_context_create(&this->allocator_callbacks, &this->context);
+}
+
+//  Closes the face of the font and lets go of the context, which is destroyed if it belongs to the font
+static void font_detach_context(jfnt_font* this)
+{
+    if (!this->context)
+    {
+        return;
+    }
+    if (this->face || this->fallback_set)
+    {
+        pthread_mutex_lock(&this->context->lock);
+        if (this->face)
+        {
+            font_close_face(this);
+        }
+        font_close_fallbacks(this);
+        pthread_mutex_unlock(&this->context->lock);
+    }
+    if (this->own_context)
+    {
+        jfnt_context_destroy(this->context);
+    }
+    this->context = NULL;
+}
+
+//  Loads the font with the context locked, then keeps the context only if the font is lazy
+static jfnt_result font_create_with_context(
+        jfnt_font* this, const jfnt_font_create_info* info, const char* fc_str, const char* filename, const void* mem,
+        size_t mem_size, unsigned char_size)
+{
+    //  Fonts from fontconfig strings may already have it from matching the cache name
+    jfnt_result res = this->context ? JFNT_RESULT_SUCCESS : font_attach_context(this, info);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        JFNT_ERROR(this, "Could not create the context for the font, reason: %s", jfnt_result_message(res));
+        return res;
+    }
+    pthread_mutex_lock(&this->context->lock);
+    if (fc_str)
+    {
+        res = font_create_from_fc_name(this, fc_str, info->fallback);
+    }
+    else
+    {
+        res = font_create_from_source(this, filename, mem, mem_size, char_size);
+    }
+    if (res == JFNT_RESULT_SUCCESS)
+    {
+        res = font_load_from_face(this, info);
+    }
+    pthread_mutex_unlock(&this->context->lock);
+    if (res != JFNT_RESULT_SUCCESS || !info->lazy)
+    {
+        font_detach_context(this);
+        jfnt_arena_destroy(&this->scratch, &this->allocator_callbacks);
+    }
+    else
+    {
+        //  Lazy fonts keep the scratch for adding ranges later, merged into a single block if more were needed
+        jfnt_arena_reset(&this->scratch, &this->allocator_callbacks, (jfnt_arena_mark){0});
+    }
+    return res;
+}
+
+//  Cache of a font from a fontconfig string is keyed by the string together with the file and face fontconfig matches it
+//  to, so that it is not used once the same string resolves to another face, such as after fonts were installed. Context
+//  is attached to the font for the match and kept for creating it. Returns NULL when the name could not be matched, in
+//  which case the cache is not used and creating the font reports why.
+static char* font_fc_cache_name(jfnt_font* this, const jfnt_font_create_info* info, const char* fc_str)
+{
+    if (font_attach_context(this, info) != JFNT_RESULT_SUCCESS)
+    {
+        this->context = NULL;
+        return NULL;
+    }
+    const uint64_t begin = jfnt_stats_begin(this);
+    char* cache_name = NULL;
+    pthread_mutex_lock(&this->context->lock);
+    FcConfig* config;
+    FcPattern* const pattern = jfnt_context_fontconfig(this->context, &config) == JFNT_RESULT_SUCCESS
+                               ? FcNameParse((const unsigned char*)fc_str) : NULL;
+    if (pattern)
+    {
+        FcResult fc_result;
+        FcPattern* const match = font_match(config, pattern, &fc_result);
+        FcChar8* file;
+        if (match && FcPatternGetString(match, FC_FILE, 0, &file) == FcResultMatch)
+        {
+            int index;
+            if (FcPatternGetInteger(match, FC_INDEX, 0, &index) != FcResultMatch)
+            {
+                index = 0;
+            }
+            const size_t size = strlen(fc_str) + strlen((const char*)file) + 16;
+            if ((cache_name = jfnt_alloc(this, size)))
+            {
+                snprintf(cache_name, size, "%s\n%s\n%d", fc_str, (const char*)file, index);
+            }
+        }
+        if (match)
+        {
+            FcPatternDestroy(match);
+        }
+        FcPatternDestroy(pattern);
+    }
+    pthread_mutex_unlock(&this->context->lock);
+    jfnt_stats_end(this, JFNT_PHASE_MATCH, begin);
+    return cache_name;
+}
+
+const jfnt_allocator_callbacks DEFAULT_ALLOCATOR =
+        {
+        .state = (void*)0xBadBeefCafe,
+        .allocate = default_alloc_fn,
+        .reallocate = default_realloc_fn,
+        .deallocate = default_free_fn,
+        };
+
+jfnt_result
+jfnt_font_create_from_memory(
+        size_t size, const void* mem, unsigned char_size, jfnt_font_create_info create_info, jfnt_font** p_out)
+{
+    jfnt_font_create_info info = create_info;
+    if (!info.allocator_callbacks)
+    {
+        info.allocator_callbacks = &DEFAULT_ALLOCATOR;
+    }
+    jfnt_font* const this = info.allocator_callbacks->allocate(info.allocator_callbacks->state, sizeof(*this));
+    if (!this)
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+#ifndef NDEBUG
+    memset(this, 0xAB, sizeof(*this));
+#endif
+    this->allocator_callbacks = *info.allocator_callbacks;
+    this->error_callbacks = *info.error_callbacks;
+    this->face_path = NULL;
+    this->face_index = 0;
+    this->face_mem = mem;
+    this->face_mem_size = size;
+    this->cache_map = NULL;
+    this->context = NULL;
+    this->packer = (jfnt_skyline){0};
+    this->count_dirty_rects = 0;
+    this->dirty_rects = NULL;
+    jfnt_arena_init(&this->scratch);
+    const jfnt_result check_res = font_check_info(this, &info);
+    if (check_res != JFNT_RESULT_SUCCESS)
+    {
+        info.allocator_callbacks->deallocate(info.allocator_callbacks->state, this);
+        return check_res;
+    }
+    if (font_load_cached(this, &info, JFNT_CACHE_SOURCE_MEMORY, NULL, size, mem, char_size))
+    {
+        *p_out = this;
+        return JFNT_RESULT_SUCCESS;
+    }
+
+    const jfnt_result res = font_create_with_context(this, &info, NULL, NULL, mem, size, char_size);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        JFNT_ERROR(this, "Could not create font from memory, reason: %s (%s)", jfnt_result_to_str(res), jfnt_result_message(res));
+        info.allocator_callbacks->deallocate(info.allocator_callbacks->state, this);
+        return res;
+    }
+
+    font_store_cached(this, &info, JFNT_CACHE_SOURCE_MEMORY, NULL, size, mem, char_size);
+    *p_out = this;
+    return JFNT_RESULT_SUCCESS;
+}
+
+void* jfnt_alloc(const jfnt_font* font, size_t size)
+{
+    return font->allocator_callbacks.allocate(font->allocator_callbacks.state, size);
+}
+
+void* jfnt_realloc(const jfnt_font* font, void* ptr, size_t new_size)
+{
+    return font->allocator_callbacks.reallocate(font->allocator_callbacks.state, ptr, new_size);;
+}
+
+void jfnt_free(const jfnt_font* font, void* ptr)
+{
+    font->allocator_callbacks.deallocate(font->allocator_callbacks.state, ptr);
+}
+
+void jfnt_report_error(const jfnt_font* font, const char* file, int line, const char* function, const char* fmt, ...)
+{
+    if (!font->error_callbacks.report)
+    {
+        return;
+    }
+    //  Most messages fit on the stack, so only the long ones are formatted a second time into allocated memory
+    char stack_buffer[256];
+    va_list args, cpy;
+    va_start(args, fmt);
+    va_copy(cpy, args);
+    const int len = vsnprintf(stack_buffer, sizeof(stack_buffer), fmt, args);
+    va_end(args);
+    if (len <= 0)
+    {
+        va_end(cpy);
+        return;
+    }
+    char* buffer = stack_buffer;
+    if ((size_t)len >= sizeof(stack_buffer))
+    {
+        if (!(buffer = jfnt_alloc(font, (size_t)len + 1)))
+        {
+            va_end(cpy);
+            return;
+        }
+        (void) vsnprintf(buffer, (size_t)len + 1, fmt, cpy);
+    }
+    va_end(cpy);
+    font->error_callbacks.report(buffer, function, file, line, font->error_callbacks.report_param);
+    if (buffer != stack_buffer)
+    {
+        jfnt_free(font, buffer);
+    }
+}
+
+jfnt_result jfnt_font_create_from_filename(
+        const char* filename, unsigned char_size, jfnt_font_create_info create_info, jfnt_font** p_out)
+{
+    jfnt_font_create_info info = create_info;
+    if (!info.allocator_callbacks)
+    {
+        info.allocator_callbacks = &DEFAULT_ALLOCATOR;
+    }
+    jfnt_font* const this = info.allocator_callbacks->allocate(info.allocator_callbacks->state, sizeof(*this));
+    if (!this)
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+#ifndef NDEBUG
+    memset(this, 0xAB, sizeof(*this));
+#endif
+    this->allocator_callbacks = *info.allocator_callbacks;
+    this->error_callbacks = *info.error_callbacks;
+    this->face_path = NULL;
+    this->face_index = 0;
+    this->face_mem = NULL;
+    this->face_mem_size = 0;
+    this->cache_map = NULL;
+    this->context = NULL;
+    this->packer = (jfnt_skyline){0};
+    this->count_dirty_rects = 0;
+    this->dirty_rects = NULL;
+    jfnt_arena_init(&this->scratch);
+    const jfnt_result check_res = font_check_info(this, &info);
+    if (check_res != JFNT_RESULT_SUCCESS)
+    {
+        info.allocator_callbacks->deallocate(info.allocator_callbacks->state, this);
+        return check_res;
+    }
+    if (font_load_cached(this, &info, JFNT_CACHE_SOURCE_FILE, filename, 0, NULL, char_size))
+    {
+        *p_out = this;
+        return JFNT_RESULT_SUCCESS;
+    }
+
+    const jfnt_result res = font_create_with_context(this, &info, NULL, filename, NULL, 0, char_size);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        JFNT_ERROR(this, "Could not create font from file \"%s\", reason: %s (%s)", filename, jfnt_result_to_str(res), jfnt_result_message(res));
+        info.allocator_callbacks->deallocate(info.allocator_callbacks->state, this);
+        return res;
+    }
+
+    font_store_cached(this, &info, JFNT_CACHE_SOURCE_FILE, filename, 0, NULL, char_size);
+    *p_out = this;
+    return JFNT_RESULT_SUCCESS;
+}
+
+jfnt_result jfnt_font_create_from_fc_str(const char* fc_str, jfnt_font_create_info create_info, jfnt_font** p_out)
+{
+    jfnt_font_create_info info = create_info;
+    if (!info.allocator_callbacks)
+    {
+        info.allocator_callbacks = &DEFAULT_ALLOCATOR;
+    }
+    jfnt_font* const this = info.allocator_callbacks->allocate(info.allocator_callbacks->state, sizeof(*this));
+    if (!this)
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+#ifndef NDEBUG
+    memset(this, 0xAB, sizeof(*this));
+#endif
+    this->allocator_callbacks = *info.allocator_callbacks;
+    this->error_callbacks = *info.error_callbacks;
+    this->face_path = NULL;
+    this->face_index = 0;
+    this->face_mem = NULL;
+    this->face_mem_size = 0;
+    this->cache_map = NULL;
+    this->context = NULL;
+    this->packer = (jfnt_skyline){0};
+    this->count_dirty_rects = 0;
+    this->dirty_rects = NULL;
+    jfnt_arena_init(&this->scratch);
+    const jfnt_result check_res = font_check_info(this, &info);
+    if (check_res != JFNT_RESULT_SUCCESS)
+    {
+        info.allocator_callbacks->deallocate(info.allocator_callbacks->state, this);
+        return check_res;
+    }
+    char* const cache_name = font_uses_cache(&info) ? font_fc_cache_name(this, &info, fc_str) : NULL;
+    if (cache_name && font_load_cached(this, &info, JFNT_CACHE_SOURCE_FC, cache_name, 0, NULL, 0))
+    {
+        jfnt_free(this, cache_name);
+        font_detach_context(this);
+        *p_out = this;
+        return JFNT_RESULT_SUCCESS;
+    }
+
+    const jfnt_result res = font_create_with_context(this, &info, fc_str, NULL, NULL, 0, 0);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        JFNT_ERROR(this, "Could not create font from FC string, reason: %s (%s)", jfnt_result_to_str(res), jfnt_result_message(res));
+        jfnt_free(this, cache_name);
+        info.allocator_callbacks->deallocate(info.allocator_callbacks->state, this);
+        return res;
+    }
+
+    if (cache_name)
+    {
+        font_store_cached(this, &info, JFNT_CACHE_SOURCE_FC, cache_name, 0, NULL, 0);
+        jfnt_free(this, cache_name);
+    }
+    *p_out = this;
+    return JFNT_RESULT_SUCCESS;
 }
 
-void* jfnt_realloc(const jfnt_font* font, void* ptr, size_t new_size)
+void jfnt_font_destroy(jfnt_font* font)
 {
-    return font->allocator_callbacks.reallocate(font->allocator_callbacks.state, ptr, new_size);;
+    if (font->cache_map)
+    {
+        //  Glyphs and the atlas belong to the mapping
+        jfnt_cache_unmap(font);
+        font->glyphs = NULL;
+        font->bmp.data = NULL;
+        font->glyph_ids = NULL;
+        font->kerning.entries = NULL;
+    }
+    if (font->packer.nodes)
+    {
+        jfnt_skyline_destroy(&font->packer, &font->allocator_callbacks);
+    }
+    font_detach_context(font);
+    jfnt_free(font, font->dirty_rects);
+    jfnt_free(font, font->glyph_frames);
+    jfnt_arena_destroy(&font->scratch, &font->allocator_callbacks);
+    font_free_atlas(font, &font->bmp);
+    jfnt_free(font, font->glyphs);
+    jfnt_free(font, font->glyph_ids);
+    jfnt_font_reclaim(font);
+    jfnt_free(font, font->retired);
+    jfnt_kerning_destroy(&font->kerning, &font->allocator_callbacks);
+    jfnt_lookup_destroy(&font->lookup, &font->allocator_callbacks);
+    jfnt_free(font, font->face_path);
+    jfnt_free(font, font);
 }
 
-void jfnt_free(const jfnt_font* font, void* ptr)
+static jfnt_result font_grow_atlas(jfnt_font* this, unsigned min_height)
 {
-    font->allocator_callbacks.deallocate(font->allocator_callbacks.state, ptr);
+    if (min_height <= this->bmp.height)
+    {
+        return JFNT_RESULT_SUCCESS;
+    }
+    unsigned new_height = this->bmp.height ? this->bmp.height : 1;
+    while (new_height < min_height)
+    {
+        new_height *= 2;
+    }
+    if (this->bmp.external)
+    {
+        //  Memory given for the atlas can not be reallocated, so the atlas can only grow into the rows it has left
+        if (min_height > this->bmp.capacity_rows)
+        {
+            JFNT_ERROR(this, "Atlas needs %u rows, but the memory given for it only has %u", min_height, this->bmp.capacity_rows);
+            return JFNT_RESULT_ATLAS_FULL;
+        }
+        if (new_height > this->bmp.capacity_rows)
+        {
+            new_height = this->bmp.capacity_rows;
+        }
+    }
+    else
+    {
+        unsigned char* const new_data = jfnt_realloc(this, this->bmp.data, this->bmp.stride * new_height);
+        if (!new_data)
+        {
+            return JFNT_RESULT_BAD_ALLOC;
+        }
+        this->bmp.data = new_data;
+    }
+    const unsigned old_height = this->bmp.height;
+    __atomic_store_n(&this->bmp.height, new_height, __ATOMIC_RELAXED);
+    jfnt_bitmap_clear(&this->bmp, 0, old_height, this->bmp.width, new_height - old_height);
+    return JFNT_RESULT_SUCCESS;
 }
 
-void jfnt_report_error(const jfnt_font* font, const char* file, int line, const char* function, const char* fmt, ...)
+//  Finds the cell for a new glyph of a font with an atlas budget. Until all cells are taken, the next one is used,
+//  after that the glyph used the longest ago is evicted and its cell cleared. Glyphs used during the current frame are
+//  never evicted.
+static jfnt_result font_claim_cell(jfnt_font* this, unsigned w, unsigned h, unsigned* p_index)
 {
-    if (!font->error_callbacks.report)
+    if (w + this->cell_padding > this->cell_w || h + this->cell_padding > this->cell_h)
+    {
+        return JFNT_RESULT_UNSUPPORTED;
+    }
+    if (this->count_glyphs < this->count_cells)
+    {
+        *p_index = this->count_glyphs;
+        return JFNT_RESULT_SUCCESS;
+    }
+    unsigned oldest = 0;
+    for (unsigned i = 1; i < this->count_cells; ++i)
+    {
+        if (this->glyph_frames[i] < this->glyph_frames[oldest])
+        {
+            oldest = i;
+        }
+    }
+    if (this->glyph_frames[oldest] == this->frame)
+    {
+        JFNT_ERROR(this, "All %u glyphs in the atlas were used during the current frame, so none can be evicted", this->count_cells);
+        return JFNT_RESULT_ATLAS_FULL;
+    }
+    const char32_t evicted = this->glyphs[oldest].codepoint;
+    //  Codepoint may have had more glyphs if creation ranges overlapped, so only the one that is found gets forgotten
+    if (jfnt_lookup_get(&this->lookup, evicted) == (int)oldest)
+    {
+        (void)jfnt_lookup_set(&this->lookup, &this->allocator_callbacks, evicted, JFNT_LOOKUP_UNKNOWN);
+    }
+    this->cache_stats.evictions += 1;
+    if (this->evicted)
+    {
+        this->evicted(this, (int)oldest, evicted, this->evicted_param);
+    }
+    unsigned x, y;
+    font_cell_origin(this, oldest, &x, &y);
+    jfnt_bitmap_clear(&this->bmp, x, y, this->cell_w, this->cell_h);
+    *p_index = oldest;
+    return JFNT_RESULT_SUCCESS;
+}
+
+//  Replaces a table of a concurrent font with a bigger copy, since other threads may be reading the old one, which is
+//  retired until it can be released. Other fonts reallocate it.
+static void* font_grow_shared_table(jfnt_font* this, void* table, size_t old_size, size_t new_size)
+{
+    if (!this->concurrent)
+    {
+        return jfnt_realloc(this, table, new_size);
+    }
+    if (this->count_retired == this->capacity_retired)
+    {
+        const unsigned new_capacity = this->capacity_retired ? this->capacity_retired * 2 : 8;
+        void** const new_retired = jfnt_realloc(this, this->retired, sizeof(*new_retired) * new_capacity);
+        if (!new_retired)
+        {
+            return NULL;
+        }
+        this->retired = new_retired;
+        this->capacity_retired = new_capacity;
+    }
+    void* const new_table = jfnt_alloc(this, new_size);
+    if (!new_table)
+    {
+        return NULL;
+    }
+    if (table)
+    {
+        memcpy(new_table, table, old_size);
+        this->retired[this->count_retired++] = table;
+    }
+    return new_table;
+}
+
+//  Grows tables of glyphs and their ids to the new capacity, publishing the new ones for readers of concurrent fonts
+static jfnt_result font_grow_glyph_tables(jfnt_font* this, unsigned new_capacity)
+{
+    //  Retired tables take less memory than the current one only as long as each is at least twice as big as the last
+    if (this->concurrent && new_capacity < this->capacity_glyphs * 2)
+    {
+        new_capacity = this->capacity_glyphs * 2;
+    }
+    jfnt_glyph* const new_glyphs = font_grow_shared_table(
+            this, this->glyphs, sizeof(*new_glyphs) * this->count_glyphs, sizeof(*new_glyphs) * new_capacity);
+    if (!new_glyphs)
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    __atomic_store_n(&this->glyphs, new_glyphs, __ATOMIC_RELEASE);
+    unsigned* const new_ids = font_grow_shared_table(
+            this, this->glyph_ids, sizeof(*new_ids) * this->count_glyphs, sizeof(*new_ids) * new_capacity);
+    if (!new_ids)
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    __atomic_store_n(&this->glyph_ids, new_ids, __ATOMIC_RELEASE);
+    this->capacity_glyphs = new_capacity;
+    return JFNT_RESULT_SUCCESS;
+}
+
+//  Adds kerning pairs of a new glyph of the first face, if the face has to be asked for them one at a time. The table
+//  of pairs is rebuilt in place as it grows, so concurrent fonts keep only the pairs they were created with.
+static jfnt_result font_kern_new_glyph(jfnt_font* this, unsigned count_ids, FT_UInt glyph_id)
+{
+    if (this->concurrent)
+    {
+        return JFNT_RESULT_SUCCESS;
+    }
+    return jfnt_kerning_add_glyph(&this->kerning, &this->allocator_callbacks, this->face, count_ids, this->glyph_ids, glyph_id);
+}
+
+//  Rasterizes a glyph for a codepoint which was not yet seen by a lazy font and puts it in the lookup
+static jfnt_result font_load_lazy_glyph(jfnt_font* this, char32_t c, int* p_idx)
+{
+    //  Makes sure the page exists, so that the glyph can always be put into it once loaded
+    jfnt_result res = jfnt_lookup_set(&this->lookup, &this->allocator_callbacks, c, JFNT_LOOKUP_UNKNOWN);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    //  Once all cells of an atlas with a budget are taken, indices of evicted glyphs are reused
+    if (this->count_glyphs == this->capacity_glyphs && (!this->count_cells || this->count_glyphs < this->count_cells))
+    {
+        unsigned new_capacity = this->capacity_glyphs ? this->capacity_glyphs * 2 : 64;
+        if (this->count_cells && new_capacity > this->count_cells)
+        {
+            new_capacity = this->count_cells;
+        }
+        if ((res = font_grow_glyph_tables(this, new_capacity)) != JFNT_RESULT_SUCCESS)
+        {
+            return res;
+        }
+    }
+
+    //  Whatever is found is kept in the lookup, so the fallback chain is only searched once for each codepoint. Charsets
+    //  are checked first, so that faces which do not have the codepoint are never opened.
+    FT_Face face = this->face;
+    unsigned face_id = 0;
+    FT_UInt glyph_id = FT_Get_Char_Index(face, c);
+    for (unsigned i = 0; glyph_id == 0 && i < this->count_fallbacks; ++i)
+    {
+        const jfnt_font_fallback* const f = this->fallbacks + i;
+        if (!f->charset || !FcCharSetHasChar(f->charset, c) || font_open_fallback(this, i) != JFNT_RESULT_SUCCESS)
+        {
+            continue;
+        }
+        font_activate_fallback(this, f);
+        face = f->face;
+        face_id = i + 1;
+        glyph_id = FT_Get_Char_Index(face, c);
+    }
+
+    int idx = -1;
+    FT_Error ft_res = FT_Err_Ok;
+    if (glyph_id != 0)
+    {
+        const uint64_t begin = jfnt_stats_begin(this);
+        ft_res = jfnt_font_load_glyph(this, face, glyph_id);
+        jfnt_stats_end(this, JFNT_PHASE_RASTERIZE, begin);
+    }
+    if (glyph_id == 0)
+    {
+        if (this->error_callbacks.unsupported_char)
+        {
+            this->error_callbacks.unsupported_char(this, c, "Font has no glyph for the codepoint", this->error_callbacks.char_param);
+        }
+    }
+    else if (ft_res != FT_Err_Ok)
+    {
+        if (this->error_callbacks.unsupported_char)
+        {
+            this->error_callbacks.unsupported_char(this, c, FT_Error_String(ft_res), this->error_callbacks.char_param);
+        }
+    }
+    else if (this->count_cells)
+    {
+        FT_GlyphSlot glyph = face->glyph;
+        unsigned index;
+        if ((res = font_claim_cell(this, glyph->bitmap.width, glyph->bitmap.rows, &index)) == JFNT_RESULT_UNSUPPORTED)
+        {
+            if (this->error_callbacks.unsupported_char)
+            {
+                this->error_callbacks.unsupported_char(this, c, "Glyph does not fit into an atlas cell", this->error_callbacks.char_param);
+            }
+        }
+        else if (res != JFNT_RESULT_SUCCESS)
+        {
+            return res;
+        }
+        else
+        {
+            jfnt_glyph* const g = this->glyphs + index;
+            this->atlas_used -= index < this->count_glyphs ? (size_t)g->w * g->h : 0;
+            *g = (jfnt_glyph){.codepoint = c, .w = glyph->bitmap.width, .h = glyph->bitmap.rows, .face = (unsigned short)face_id};
+            font_cell_origin(this, index, &g->offset_x, &g->offset_y);
+            font_render_into_atlas(this, glyph, g);
+            this->atlas_used += (size_t)g->w * g->h;
+            if (face_id == 0 && (res = font_kern_new_glyph(this, this->count_glyphs, glyph_id)) != JFNT_RESULT_SUCCESS)
+            {
+                return res;
+            }
+            this->glyph_ids[index] = font_glyph_id(face_id, glyph_id);
+            this->glyph_frames[index] = this->frame;
+            this->cache_stats.misses += 1;
+            idx = (int)index;
+            if (index == this->count_glyphs)
+            {
+                this->count_glyphs += 1;
+            }
+        }
+    }
+    else
+    {
+        FT_GlyphSlot glyph = face->glyph;
+        jfnt_glyph* const g = this->glyphs + this->count_glyphs;
+        *g = (jfnt_glyph){.codepoint = c, .w = glyph->bitmap.width, .h = glyph->bitmap.rows, .face = (unsigned short)face_id};
+        //  Everything which can fail is done before the glyph is packed, so a failure leaves no space taken in the
+        //  packer. Kerning pairs are keyed by glyph ids, so pairs of a glyph which then is not added are only unused.
+        unsigned x, y, height;
+        res = jfnt_skyline_height_after(&this->packer, g->w, g->h, &height);
+        if (res == JFNT_RESULT_SUCCESS)
+        {
+            res = font_grow_atlas(this, height);
+        }
+        if (res == JFNT_RESULT_SUCCESS && face_id == 0)
+        {
+            res = font_kern_new_glyph(this, this->count_glyphs, glyph_id);
+        }
+        if (res == JFNT_RESULT_SUCCESS)
+        {
+            res = jfnt_skyline_insert(&this->packer, &this->allocator_callbacks, g->w, g->h, &x, &y);
+        }
+        if (res != JFNT_RESULT_SUCCESS)
+        {
+            JFNT_ERROR(this, "Could not pack glyph U+%04X into the atlas, reason: %s", (unsigned)c, jfnt_result_message(res));
+            return res;
+        }
+        g->offset_x = x;
+        g->offset_y = y;
+        font_render_into_atlas(this, glyph, g);
+        this->atlas_used = this->packer.used_area;
+        this->glyph_ids[this->count_glyphs] = font_glyph_id(face_id, glyph_id);
+        idx = (int)this->count_glyphs;
+        //  Glyph is published before it is put into the lookup, so any thread which finds it also sees it in the table
+        __atomic_store_n(&this->count_glyphs, this->count_glyphs + 1, __ATOMIC_RELEASE);
+    }
+
+    (void)jfnt_lookup_set(&this->lookup, &this->allocator_callbacks, c, idx);
+    jfnt_stats_count(this, idx >= 0 ? &this->stats.glyphs_rasterized : &this->stats.glyphs_missed, 1);
+    *p_idx = idx;
+    return JFNT_RESULT_SUCCESS;
+}
+
+static jfnt_result find_glyph(const jfnt_font* font, char32_t c, int* p_idx)
+{
+    const int idx = jfnt_lookup_get(&font->lookup, c);
+    jfnt_stats_count(font, (size_t*)&font->stats.lookups, 1);
+    if (idx != JFNT_LOOKUP_UNKNOWN)
+    {
+        if (idx == -1)
+        {
+            jfnt_stats_count(font, (size_t*)&font->stats.lookups_unsupported, 1);
+        }
+        if (font->glyph_frames && idx >= 0)
+        {
+            //  Stamps are only written by the thread which looks glyphs up, like the glyphs of a lazy font themselves
+            jfnt_font* const this = (jfnt_font*)font;
+            this->glyph_frames[idx] = this->frame;
+            this->cache_stats.hits += 1;
+        }
+        *p_idx = idx;
+        return JFNT_RESULT_SUCCESS;
+    }
+    //  Lazy fonts are only logically const, as their glyph cache gets filled in as codepoints get looked up
+    jfnt_font* const this = (jfnt_font*)font;
+    pthread_mutex_lock(&this->context->lock);
+    //  Another thread may have loaded the glyph while this one was waiting for the lock
+    const int loaded = jfnt_lookup_get(&this->lookup, c);
+    if (loaded != JFNT_LOOKUP_UNKNOWN)
+    {
+        pthread_mutex_unlock(&this->context->lock);
+        *p_idx = loaded;
+        return JFNT_RESULT_SUCCESS;
+    }
+    font_activate_face(this);
+    const jfnt_result res = font_load_lazy_glyph(this, c, p_idx);
+    pthread_mutex_unlock(&this->context->lock);
+    jfnt_stats_count(this, &this->stats.lookups_loaded, 1);
+    if (res == JFNT_RESULT_SUCCESS && *p_idx == -1)
+    {
+        jfnt_stats_count(this, &this->stats.lookups_unsupported, 1);
+    }
+    return res;
+}
+
+//  Replacement glyph is only looked up once it is needed, and the index of it is then kept in *p_replace
+static jfnt_result resolve_codepoints(
+        const jfnt_font* font, char32_t unsupported_replace, int* p_replace, size_t count, const char32_t* codepoints,
+        int* p_indices)
+{
+    jfnt_result res;
+    for (size_t i = 0; i < count; ++i)
+    {
+        int idx;
+        if ((res = find_glyph(font, codepoints[i], &idx)) != JFNT_RESULT_SUCCESS)
+        {
+            return res;
+        }
+        if (idx == -1)
+        {
+            if (*p_replace == -1)
+            {
+                if ((res = find_glyph(font, unsupported_replace, p_replace)) != JFNT_RESULT_SUCCESS)
+                {
+                    return res;
+                }
+                if (*p_replace == -1)
+                {
+                    JFNT_ERROR(font, "The unsupported replacement character U+%04hX (%lc) was not supported by the font", unsupported_replace, (wchar_t)unsupported_replace);
+                    return JFNT_RESULT_UNSUPPORTED;
+                }
+            }
+            idx = *p_replace;
+        }
+        p_indices[i] = idx;
+    }
+
+    return JFNT_RESULT_SUCCESS;
+}
+
+jfnt_result jfnt_font_find_glyphs_u32(
+        const jfnt_font* font, char32_t unsupported_replace, size_t count, const char32_t* codepoints, int* p_indices)
+{
+    int i_replace = -1;
+    return resolve_codepoints(font, unsupported_replace, &i_replace, count, codepoints, p_indices);
+}
+
+const jfnt_glyph* jfnt_font_get_glyphs(const jfnt_font* font)
+{
+    return jfnt_font_load_glyphs(font);
+}
+
+unsigned jfnt_font_get_glyph_count(const jfnt_font* font)
+{
+    return jfnt_font_load_count(font);
+}
+
+void jfnt_font_take_new_glyphs(jfnt_font* font, unsigned* p_first, unsigned* p_count)
+{
+    const unsigned count = jfnt_font_load_count(font);
+    *p_first = font->reported_glyphs;
+    *p_count = count - font->reported_glyphs;
+    font->reported_glyphs = count;
+}
+
+void jfnt_font_reclaim(jfnt_font* font)
+{
+    for (unsigned i = 0; i < font->count_retired; ++i)
+    {
+        jfnt_free(font, font->retired[i]);
+    }
+    font->count_retired = 0;
+}
+
+static int codepoint_range_cmp(const void* a, const void* b)
+{
+    const jfnt_codepoint_range* const r1 = a;
+    const jfnt_codepoint_range* const r2 = b;
+    return r1->first < r2->first ? -1 : (r1->first > r2->first);
+}
+
+//  Collects codepoints of the ranges which the font does not have a glyph for yet, sorted and with no overlaps, so that
+//  each one is only rasterized once. Lazy fonts already know they have no glyph for some codepoints, which are skipped.
+static jfnt_result font_select_new_ranges(
+        const jfnt_font* this, unsigned n_ranges, const jfnt_codepoint_range* ranges, jfnt_range_list* p_out)
+{
+    jfnt_range_list list = {0};
+    jfnt_result res = JFNT_RESULT_SUCCESS;
+    for (unsigned i = 0; i < n_ranges && res == JFNT_RESULT_SUCCESS; ++i)
+    {
+        const char32_t last = ranges[i].last < JFNT_LOOKUP_MAX_CODEPOINT ? ranges[i].last : JFNT_LOOKUP_MAX_CODEPOINT;
+        char32_t run_first = 0;
+        int in_run = 0;
+        for (char32_t c = ranges[i].first; c <= last && res == JFNT_RESULT_SUCCESS; ++c)
+        {
+            const int idx = jfnt_lookup_get(&this->lookup, c);
+            const int is_new = idx == JFNT_LOOKUP_UNKNOWN || (idx == JFNT_LOOKUP_UNSUPPORTED && !this->lazy);
+            if (is_new && !in_run)
+            {
+                run_first = c;
+            }
+            else if (!is_new && in_run)
+            {
+                res = jfnt_range_list_add(this, &list, run_first, c - 1);
+            }
+            in_run = is_new;
+        }
+        if (in_run && res == JFNT_RESULT_SUCCESS)
+        {
+            res = jfnt_range_list_add(this, &list, run_first, last);
+        }
+    }
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        jfnt_range_list_destroy(this, &list);
+        return res;
+    }
+
+    qsort(list.ranges, list.count, sizeof(*list.ranges), codepoint_range_cmp);
+    unsigned count = 0;
+    for (unsigned i = 0; i < list.count; ++i)
+    {
+        if (count && list.ranges[i].first <= list.ranges[count - 1].last + 1)
+        {
+            if (list.ranges[i].last > list.ranges[count - 1].last)
+            {
+                list.ranges[count - 1].last = list.ranges[i].last;
+            }
+        }
+        else
+        {
+            list.ranges[count] = list.ranges[i];
+            count += 1;
+        }
+    }
+    list.count = count;
+    *p_out = list;
+    return JFNT_RESULT_SUCCESS;
+}
+
+static int atlas_rect_cmp(const void* a, const void* b)
+{
+    const jfnt_atlas_rect* const r1 = a;
+    const jfnt_atlas_rect* const r2 = b;
+    if (r1->y != r2->y)
+    {
+        return r1->y < r2->y ? -1 : +1;
+    }
+    return r1->x < r2->x ? -1 : (r1->x > r2->x);
+}
+
+//  Replaces dirty rectangles of the font with those of glyphs [first, first + count). Glyphs placed next to each other
+//  on the same skyline segment are merged into one rectangle, with only padding between them, so that there are few of
+//  them to upload.
+static jfnt_result font_mark_dirty(jfnt_font* this, unsigned first, unsigned count)
+{
+    jfnt_atlas_rect* const rects = jfnt_realloc(this, this->dirty_rects, sizeof(*rects) * (count ? count : 1));
+    if (!rects)
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    this->dirty_rects = rects;
+    unsigned n = 0;
+    for (unsigned i = first; i < first + count; ++i)
+    {
+        const jfnt_glyph* const g = this->glyphs + i;
+        if (g->w && g->h)
+        {
+            rects[n] = (jfnt_atlas_rect){.x = g->offset_x, .y = g->offset_y, .w = g->w, .h = g->h};
+            n += 1;
+        }
+    }
+    qsort(rects, n, sizeof(*rects), atlas_rect_cmp);
+    unsigned count_merged = 0;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        jfnt_atlas_rect* const prev = count_merged ? rects + count_merged - 1 : NULL;
+        if (prev && prev->y == rects[i].y && rects[i].x <= prev->x + prev->w + this->packer.padding)
+        {
+            prev->w = rects[i].x + rects[i].w - prev->x;
+            if (rects[i].h > prev->h)
+            {
+                prev->h = rects[i].h;
+            }
+        }
+        else
+        {
+            rects[count_merged] = rects[i];
+            count_merged += 1;
+        }
+    }
+    this->count_dirty_rects = count_merged;
+    return JFNT_RESULT_SUCCESS;
+}
+
+//  Renders new ranges with the face of the font, which must be set up for it with the context locked, and packs the
+//  glyphs into the atlas. Glyphs are only counted once everything succeeded, though they might have taken up space in
+//  the atlas before that.
+static jfnt_result font_add_ranges_locked(jfnt_font* this, unsigned n_ranges, const jfnt_codepoint_range* ranges)
+{
+    jfnt_staged_glyphs staged;
+    jfnt_result res = font_rasterize_chain(this, this->face, this->thread_count, n_ranges, ranges, &staged);
+    if (res != JFNT_RESULT_SUCCESS)
     {
-        return;
+        return res;
     }
-    va_list args, cpy;
-    va_start(args, fmt);
-    va_copy(cpy, args);
-    const int len = vsnprintf(NULL, 0, fmt, cpy);
-    va_end(cpy);
-    if (len <= 0)
+    const unsigned first = this->count_glyphs;
+    const unsigned count = first + staged.count;
+    if (count > this->capacity_glyphs && (res = font_grow_glyph_tables(this, count)) != JFNT_RESULT_SUCCESS)
     {
-        va_end(args);
-        return;
+        jfnt_staged_glyphs_release(this, &staged);
+        return res;
     }
-    char* const buffer = jfnt_alloc(font, len + 1);
-    if (!buffer)
+    if (staged.count)
     {
-        return;
+        memcpy(this->glyphs + first, staged.glyphs, sizeof(*staged.glyphs) * staged.count);
     }
-    (void) vsnprintf(buffer, len + 1, fmt, args);
-    va_end(args);
-    font->error_callbacks.report(buffer, function, file, line, font->error_callbacks.report_param);
-    jfnt_free(font, buffer);
-}
 
-jfnt_result jfnt_font_create_from_filename(
-        const char* filename, unsigned char_size, jfnt_font_create_info create_info, jfnt_font** p_out)
-{
-    jfnt_font_create_info info = create_info;
-    if (!info.allocator_callbacks)
+    uint64_t begin = jfnt_stats_begin(this);
+    const jfnt_arena_mark mark = jfnt_arena_get_mark(&this->scratch);
+    unsigned* shared;
+    if ((res = font_find_shared_glyphs(this, staged.count, this->glyphs + first, staged.pixels, &shared)) == JFNT_RESULT_SUCCESS &&
+        (res = font_insert_glyphs(this, &this->packer, staged.count, this->glyphs + first, shared)) == JFNT_RESULT_SUCCESS)
     {
-        info.allocator_callbacks = &DEFAULT_ALLOCATOR;
+        res = font_grow_atlas(this, this->packer.height);
     }
-    jfnt_font* const this = info.allocator_callbacks->allocate(info.allocator_callbacks->state, sizeof(*this));
-    if (!this)
+    jfnt_arena_reset(&this->scratch, &this->allocator_callbacks, mark);
+    jfnt_stats_end(this, JFNT_PHASE_PACK, begin);
+    if (res != JFNT_RESULT_SUCCESS)
     {
-        return JFNT_RESULT_BAD_ALLOC;
+        jfnt_staged_glyphs_release(this, &staged);
+        return res;
     }
-#ifndef NDEBUG
-    memset(this, 0xAB, sizeof(*this));
-#endif
-    this->allocator_callbacks = *info.allocator_callbacks;
-    this->error_callbacks = *info.error_callbacks;
-
-    FT_Library ft_library;
-    FT_Error ft_error = FT_Init_FreeType(&ft_library);
-    if (ft_error != FT_Err_Ok)
+    //  Glyphs were already flipped when staged
+    begin = jfnt_stats_begin(this);
+    for (unsigned i = 0; i < staged.count; ++i)
     {
-        JFNT_ERROR(this, "Could not init FreeType library, reason: %s", FT_Error_String(ft_error));
-        info.allocator_callbacks->deallocate(info.allocator_callbacks->state, this);
-        return JFNT_RESULT_BAD_FT_CALL;
+        const jfnt_glyph* const g = this->glyphs + first + i;
+        jfnt_bitmap_blit(&this->bmp, g->offset_x, g->offset_y, staged.pixels[i], g->w, g->w, g->h, 0);
     }
+    jfnt_stats_end(this, JFNT_PHASE_BLIT, begin);
+    jfnt_staged_glyphs_release(this, &staged);
+    this->atlas_used = this->packer.used_area;
 
-    FT_Face face;
-    ft_error = FT_New_Face(ft_library, filename, 0, &face);
-    if (ft_error != FT_Err_Ok)
+    for (unsigned i = first; i < count; ++i)
     {
-        JFNT_ERROR(this, "Could not create new FT memory face, reason: %s", FT_Error_String(ft_error));
-        info.allocator_callbacks->deallocate(info.allocator_callbacks->state, this);
-        FT_Done_FreeType(ft_library);
-        return JFNT_RESULT_BAD_FT_CALL;
+        const jfnt_glyph* const g = this->glyphs + i;
+        const FT_Face glyph_face = g->face ? this->fallbacks[g->face - 1].face : this->face;
+        this->glyph_ids[i] = font_glyph_id(g->face, FT_Get_Char_Index(glyph_face, g->codepoint));
+    }
+    //  Lazy fonts already have all pairs of the face, unless they have to be asked for one at a time, while others only
+    //  have pairs between glyphs they were created with
+    begin = jfnt_stats_begin(this);
+    if (this->lazy)
+    {
+        for (unsigned i = first; i < count && res == JFNT_RESULT_SUCCESS; ++i)
+        {
+            if (this->glyphs[i].face == 0)
+            {
+                res = font_kern_new_glyph(this, i, this->glyph_ids[i]);
+            }
+        }
+    }
+    else
+    {
+        jfnt_kerning kerning;
+        if ((res = jfnt_kerning_load(&kerning, &this->allocator_callbacks, this->face, count, this->glyph_ids, 0)) == JFNT_RESULT_SUCCESS)
+        {
+            jfnt_kerning_destroy(&this->kerning, &this->allocator_callbacks);
+            this->kerning = kerning;
+        }
+    }
+    jfnt_stats_end(this, JFNT_PHASE_KERNING, begin);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        JFNT_ERROR(this, "Could not extract kerning pairs of the new glyphs, reason: %s", jfnt_result_message(res));
+        return res;
     }
 
-    ft_error = FT_Select_Charmap(face, FT_ENCODING_UNICODE);
-    if (ft_error != FT_Err_Ok)
+    if ((res = font_mark_dirty(this, first, count - first)) != JFNT_RESULT_SUCCESS)
     {
-        JFNT_ERROR(this, "Could not select FT Face encoding, reason: %s", FT_Error_String(ft_error));
-        info.allocator_callbacks->deallocate(info.allocator_callbacks->state, this);
-        FT_Done_Face(face);
-        FT_Done_FreeType(ft_library);
-        return JFNT_RESULT_BAD_FT_CALL;
+        return res;
     }
 
-    FcMatrix mtx;
-    FcMatrixInit(&mtx);
-    load_font_data_from_face(this, &mtx, char_size, char_size, face);
+    begin = jfnt_stats_begin(this);
+    char32_t max_codepoint = 0;
+    for (unsigned i = first; i < count; ++i)
+    {
+        if (this->glyphs[i].codepoint > max_codepoint)
+        {
+            max_codepoint = this->glyphs[i].codepoint;
+        }
+    }
+    res = jfnt_lookup_reserve(&this->lookup, &this->allocator_callbacks, max_codepoint);
+    if (res == JFNT_RESULT_SUCCESS)
+    {
+        //  Glyphs are published before they are put into the lookup, so any thread which finds them also sees them in the
+        //  table. Should the lookup fail to take some, those are just never found.
+        __atomic_store_n(&this->count_glyphs, count, __ATOMIC_RELEASE);
+    }
+    for (unsigned i = first; i < count && res == JFNT_RESULT_SUCCESS; ++i)
+    {
+        res = jfnt_lookup_set(&this->lookup, &this->allocator_callbacks, this->glyphs[i].codepoint, (int)i);
+    }
+    jfnt_stats_end(this, JFNT_PHASE_LOOKUP, begin);
+    return res;
+}
 
-    jfnt_result res = ft_font_load(face, info.n_ranges, info.codepoint_ranges, this, info.flip);
-    FT_Done_Face(face);
-    FT_Done_FreeType(ft_library);
+//  Picks the ranges which the font does not have yet and adds glyphs for them. Lazy fonts must have the context locked,
+//  so that glyphs loaded by lookups from other threads in the meantime are not added again.
+static jfnt_result font_add_new_ranges(jfnt_font* font, unsigned n_ranges, const jfnt_codepoint_range* ranges)
+{
+    font->count_dirty_rects = 0;
+    jfnt_range_list new_ranges;
+    jfnt_result res = font_select_new_ranges(font, n_ranges, ranges, &new_ranges);
     if (res != JFNT_RESULT_SUCCESS)
     {
-        JFNT_ERROR(this, "Could not select FT Face encoding, reason: %s", FT_Error_String(ft_error));
-        info.allocator_callbacks->deallocate(info.allocator_callbacks->state, this);
         return res;
     }
+    if (!new_ranges.count)
+    {
+        jfnt_range_list_destroy(font, &new_ranges);
+        return JFNT_RESULT_SUCCESS;
+    }
 
-    *p_out = this;
-    return JFNT_RESULT_SUCCESS;
+    if (font->lazy)
+    {
+        font_activate_face(font);
+        res = font_add_ranges_locked(font, new_ranges.count, new_ranges.ranges);
+        //  Scratch is used by lookups which load glyphs as well, so it is reset before the lock is released
+        jfnt_arena_reset(&font->scratch, &font->allocator_callbacks, (jfnt_arena_mark){0});
+    }
+    else
+    {
+        //  Face was closed once the font was created, so it is opened again with a context of its own
+        const jfnt_font_create_info info = {0};
+        if ((res = font_attach_context(font, &info)) != JFNT_RESULT_SUCCESS)
+        {
+            JFNT_ERROR(font, "Could not create the context for the font, reason: %s", jfnt_result_message(res));
+            jfnt_range_list_destroy(font, &new_ranges);
+            return res;
+        }
+        pthread_mutex_lock(&font->context->lock);
+        FT_Face face;
+        if ((res = font_open_face(font, font->face_path, font->face_mem, font->face_mem_size, font->face_index, &face)) == JFNT_RESULT_SUCCESS)
+        {
+            //  Same as the original face, which is either explicitly set to Unicode, or was picked by FreeType by default
+            (void)FT_Select_Charmap(face, FT_ENCODING_UNICODE);
+            jfnt_font_setup_face(font, face);
+            res = font_add_ranges_locked(font, new_ranges.count, new_ranges.ranges);
+        }
+        pthread_mutex_unlock(&font->context->lock);
+        font_detach_context(font);
+        jfnt_arena_destroy(&font->scratch, &font->allocator_callbacks);
+    }
+    jfnt_range_list_destroy(font, &new_ranges);
+    return res;
 }
 
-jfnt_result jfnt_font_create_from_fc_str(const char* fc_str, jfnt_font_create_info create_info, jfnt_font** p_out)
+jfnt_result jfnt_font_add_ranges(
+        jfnt_font* font, unsigned n_ranges, const jfnt_codepoint_range* ranges, unsigned* p_count_rects,
+        const jfnt_atlas_rect** p_rects)
 {
-    jfnt_font_create_info info = create_info;
-    if (!info.allocator_callbacks)
+    if (font->cache_map)
     {
-        info.allocator_callbacks = &DEFAULT_ALLOCATOR;
+        JFNT_ERROR(font, "Font was mapped from a cache file, so glyphs can not be added to it");
+        return JFNT_RESULT_UNSUPPORTED;
     }
-    jfnt_font* const this = info.allocator_callbacks->allocate(info.allocator_callbacks->state, sizeof(*this));
-    if (!this)
+    if (font->count_cells)
     {
-        return JFNT_RESULT_BAD_ALLOC;
+        JFNT_ERROR(font, "Font has an atlas budget, so glyphs can only be added to it by looking them up");
+        return JFNT_RESULT_UNSUPPORTED;
     }
-#ifndef NDEBUG
-    memset(this, 0xAB, sizeof(*this));
-#endif
-    this->allocator_callbacks = *info.allocator_callbacks;
-    this->error_callbacks = *info.error_callbacks;
-
-    FT_Library ft_library;
-    FT_Error ft_error = FT_Init_FreeType(&ft_library);
-    if (ft_error != FT_Err_Ok)
+    if (font->cell_grid)
     {
-        JFNT_ERROR(this, "Could not init FreeType library, reason: %s", FT_Error_String(ft_error));
-        info.allocator_callbacks->deallocate(info.allocator_callbacks->state, this);
-        return JFNT_RESULT_BAD_FT_CALL;
+        JFNT_ERROR(font, "Font has a cell grid, which is laid out only once when the font is created");
+        return JFNT_RESULT_UNSUPPORTED;
     }
-
-    FT_Face face;
-    jfnt_result res = font_create_from_fc_name(this, fc_str, ft_library, &face);
-    if (res != JFNT_RESULT_SUCCESS)
+    jfnt_result res;
+    if (font->lazy)
     {
-        JFNT_ERROR(this, "Could not create font from FC string, reason: %s (%s)", jfnt_result_to_str(res), jfnt_result_message(res));
-        info.allocator_callbacks->deallocate(info.allocator_callbacks->state, this);
-        FT_Done_FreeType(ft_library);
-        return res;
+        pthread_mutex_lock(&font->context->lock);
+        res = font_add_new_ranges(font, n_ranges, ranges);
+        pthread_mutex_unlock(&font->context->lock);
+    }
+    else
+    {
+        res = font_add_new_ranges(font, n_ranges, ranges);
     }
-    res = ft_font_load(face, info.n_ranges, info.codepoint_ranges, this, info.flip);
-    
-    FT_Done_Face(face);
-    FT_Done_FreeType(ft_library);
     if (res != JFNT_RESULT_SUCCESS)
     {
-        JFNT_ERROR(this, "Could not select FT Face encoding, reason: %s", FT_Error_String(ft_error));
-        info.allocator_callbacks->deallocate(info.allocator_callbacks->state, this);
+        JFNT_ERROR(font, "Could not add glyphs to the font, reason: %s (%s)", jfnt_result_to_str(res), jfnt_result_message(res));
         return res;
     }
-
-
-    *p_out = this;
+    *p_count_rects = font->count_dirty_rects;
+    *p_rects = font->dirty_rects;
     return JFNT_RESULT_SUCCESS;
 }
 
-void jfnt_font_destroy(jfnt_font* font)
+void jfnt_font_next_frame(jfnt_font* font)
 {
-    jfnt_free(font, font->bmp.data);
-    jfnt_free(font, font->glyphs);
-    jfnt_free(font, font);
+    font->frame += 1;
 }
 
-static int find_glyph(const jfnt_font* font, char32_t c)
+void jfnt_font_get_glyph_cache_stats(const jfnt_font* font, jfnt_glyph_cache_stats* p_stats)
 {
-    //  Use binary search to narrow down the search to 8
-    unsigned len = font->count_glyphs;
-    unsigned pos = 0;
-    while (len > 8)
+    *p_stats = font->cache_stats;
+}
+
+//  Decodes and looks up codepoints until max_count of them are found or the input runs out. When the decoder stops at
+//  an invalid or an incomplete sequence, its status is returned through p_status and the sequence is at *p_consumed.
+static jfnt_result find_glyphs_utf8_bytes(
+        const jfnt_font* font, size_t size, const unsigned char* bytes, char32_t unsupported_replace, int* p_replace,
+        size_t max_count, int* p_indices, size_t* p_consumed, size_t* p_count, jfnt_utf8_status* p_status)
+{
+    const jfnt_utf8_isa isa = jfnt_utf8_best_isa();
+    char32_t codepoints[UTF8_DECODE_CHUNK];
+    jfnt_utf8_status status = JFNT_UTF8_OK;
+    size_t pos = 0;
+    size_t count = 0;
+    while (pos < size && count < max_count && status == JFNT_UTF8_OK)
     {
-        unsigned step = (len) / 2;
-        if (font->glyphs[pos + step].codepoint > c)
-        {
-            len = step;
-        }
-        else //  font->glyphs[pos + step].codepoint <= c
+        const size_t max_out = max_count - count < UTF8_DECODE_CHUNK ? max_count - count : UTF8_DECODE_CHUNK;
+        size_t consumed, written;
+        status = jfnt_utf8_decode_isa(isa, bytes + pos, size - pos, codepoints, max_out, &consumed, &written);
+        const jfnt_result res = resolve_codepoints(font, unsupported_replace, p_replace, written, codepoints, p_indices + count);
+        if (res != JFNT_RESULT_SUCCESS)
         {
-            pos += step;
-            len -= step;
+            return res;
         }
+        pos += consumed;
+        count += written;
     }
-
-    while (font->glyphs[pos].codepoint < c)
-    {
-        pos += 1;
-    }
-
-    return font->glyphs[pos].codepoint == c ? (int)pos : -1;
+    *p_consumed = pos;
+    *p_count = count;
+    *p_status = status;
+    return JFNT_RESULT_SUCCESS;
 }
 
-jfnt_result jfnt_font_find_glyphs_u32(
-        const jfnt_font* font, char32_t unsupported_replace, size_t count, const char32_t* codepoints, int* p_indices)
+jfnt_result jfnt_font_find_glyphs_utf8(
+        const jfnt_font* font, const char* utf8, char32_t unsupported_replace, size_t max_len, size_t* p_count,
+        int* p_indices)
 {
+    //  No codepoint takes more than 4 bytes, so there is no need to look any further for the end of the string
+    const size_t len = strnlen(utf8, max_len < SIZE_MAX / 4 ? max_len * 4 : SIZE_MAX);
+    const unsigned char* const bytes = (const unsigned char*)utf8;
     int i_replace = -1;
-    for (size_t i = 0; i < count; ++i)
+    size_t consumed, count;
+    jfnt_utf8_status status;
+    const jfnt_result res = find_glyphs_utf8_bytes(
+            font, len, bytes, unsupported_replace, &i_replace, max_len, p_indices, &consumed, &count, &status);
+    if (res != JFNT_RESULT_SUCCESS)
     {
-        int idx = find_glyph(font, codepoints[i]);
-        if (idx == -1)
-        {
-            if (i_replace == -1)
-            {
-                i_replace = find_glyph(font, unsupported_replace);
-                if (i_replace == -1)
-                {
-                    JFNT_ERROR(font, "The unsupported replacement character U+%04hX (%lc) was not supported by the font", unsupported_replace, (wchar_t)unsupported_replace);
-                    return JFNT_RESULT_UNSUPPORTED;
-                }
-            }
-            idx = i_replace;
-        }
-        p_indices[i] = idx;
+        return res;
     }
-
+    if (status != JFNT_UTF8_OK)
+    {
+        JFNT_ERROR(font, "Invalid UTF-8 sequence beginning with byte %02hhX at index %zu: %s", bytes[consumed], consumed, jfnt_utf8_status_message(status));
+        return JFNT_RESULT_BAD_ENCODING;
+    }
+    *p_count = count;
     return JFNT_RESULT_SUCCESS;
 }
 
-const jfnt_glyph* jfnt_font_get_glyphs(const jfnt_font* font)
+void jfnt_utf8_stream_reset(jfnt_utf8_stream* stream)
 {
-    return font->glyphs;
+    stream->count_pending = 0;
 }
 
-jfnt_result jfnt_font_find_glyphs_utf8(
-        const jfnt_font* font, const char* utf8, char32_t unsupported_replace, size_t max_len, size_t* p_count,
-        int* p_indices)
+jfnt_result jfnt_font_find_glyphs_utf8_stream(
+        const jfnt_font* font, jfnt_utf8_stream* stream, size_t size, const char* utf8, char32_t unsupported_replace,
+        size_t max_count, int* p_indices, size_t* p_consumed, size_t* p_count)
 {
+    const unsigned char* const bytes = (const unsigned char*)utf8;
     int i_replace = -1;
-    size_t i = 0;
-    for (const unsigned char* ptr = (const unsigned char*)utf8; *ptr && i < max_len; ++ptr)
+    size_t pos = 0;
+    size_t count = 0;
+    jfnt_result res;
+
+    if (stream->count_pending && max_count)
     {
-        const unsigned char zb = *ptr;
-        char32_t c = zb;
-        if (c < 0x80)
-        {
-            //  One byte character
-            ;   //  No-op
-        }
-        else if ((zb & 0xE0) == 0xC0)
-        {
-            //  2 byte codepoint
-            ptr += 1;
-            unsigned char b = *ptr;
-            if ((b & 0xC0) != 0x80)
-            {
-                JFNT_ERROR(font,
-                           "Continuation byte expected to follow in %u index following %02hhX, instead %02hhX was found",
-                           (unsigned) (ptr - (const unsigned char*) utf8), zb, b);
-                return JFNT_RESULT_BAD_ENCODING;
-            }
-            c <<= 6;
-            c |= (0x3F & b);
-        }
-        else if ((zb & 0xF0) == 0xE0)
+        //  Complete the sequence left over from the previous chunk, whose lead byte was already found to be valid
+        const unsigned char lead = stream->pending[0];
+        const unsigned length = lead < 0xE0 ? 2 : (lead < 0xF0 ? 3 : 4);
+        while (stream->count_pending < length && pos < size && (bytes[pos] & 0xC0) == 0x80)
         {
-            //  Three byte codepoint
-            ptr += 1;
-            unsigned char b1 = *ptr;
-            if ((b1 & 0xC0) != 0x80)
-            {
-                JFNT_ERROR(font,
-                           "Continuation byte expected to follow in %u index following %02hhX, instead %02hhX was found",
-                           (unsigned) (ptr - (const unsigned char*) utf8), zb, b1);
-                return JFNT_RESULT_BAD_ENCODING;
-            }
-            c <<= 6;
-            c |= (0x3F & b1);
-
-            ptr += 1;
-            unsigned char b2 = *ptr;
-            if ((b2 & 0xC0) != 0x80)
-            {
-                JFNT_ERROR(font,
-                           "Continuation byte expected to follow in %u index following %02hhX %02hhx, instead %02hhX was found",
-                           (unsigned) (ptr - (const unsigned char*) utf8), zb, b1, b2);
-                return JFNT_RESULT_BAD_ENCODING;
-            }
-            c <<= 6;
-            c |= (0x3F & b2);
+            stream->pending[stream->count_pending] = bytes[pos];
+            stream->count_pending += 1;
+            pos += 1;
         }
-        else if ((zb & 0xF8) == 0xF0)
+        if (stream->count_pending < length && pos == size)
         {
-            //  Four byte codepoint
-            ptr += 1;
-            unsigned char b1 = *ptr;
-            if ((b1 & 0xC0) != 0x80)
-            {
-                JFNT_ERROR(font,
-                           "Continuation byte expected to follow in %u index following %02hhX, instead %02hhX was found",
-                           (unsigned) (ptr - (const unsigned char*) utf8), zb, b1);
-                return JFNT_RESULT_BAD_ENCODING;
-            }
-            c <<= 6;
-            c |= (0x3F & b1);
-
-            ptr += 1;
-            unsigned char b2 = *ptr;
-            if ((b2 & 0xC0) != 0x80)
-            {
-                JFNT_ERROR(font,
-                           "Continuation byte expected to follow in %u index following %02hhX %02hhx, instead %02hhX was found",
-                           (unsigned) (ptr - (const unsigned char*) utf8), zb, b1, b2);
-                return JFNT_RESULT_BAD_ENCODING;
-            }
-            c <<= 6;
-            c |= (0x3F & b2);
-
-            ptr += 1;
-            unsigned char b3 = *ptr;
-            if ((b3 & 0xC0) != 0x80)
-            {
-                JFNT_ERROR(font,
-                           "Continuation byte expected to follow in %u index following %02hhX %02hhx %02hhx, instead %02hhX was found",
-                           (unsigned) (ptr - (const unsigned char*) utf8), zb, b1, b2, b3);
-                return JFNT_RESULT_BAD_ENCODING;
-            }
-            c <<= 6;
-            c |= (0x3F & b3);
+            *p_consumed = pos;
+            *p_count = 0;
+            return JFNT_RESULT_SUCCESS;
         }
-        else
+        char32_t c;
+        size_t consumed, written;
+        const jfnt_utf8_status status = jfnt_utf8_decode(stream->pending, stream->count_pending, &c, 1, &consumed, &written);
+        stream->count_pending = 0;
+        if (status != JFNT_UTF8_OK)
         {
-            JFNT_ERROR(font, "Byte %02hhx is invalid in UTF-8 encoding", zb);
+            JFNT_ERROR(font, "Invalid UTF-8 sequence beginning with byte %02hhX in the previous chunk: %s", lead,
+                       jfnt_utf8_status_message(status == JFNT_UTF8_TRUNCATED ? JFNT_UTF8_BAD_CONTINUATION : status));
+            *p_consumed = pos;
+            *p_count = 0;
             return JFNT_RESULT_BAD_ENCODING;
         }
-
-
-        int idx = find_glyph(font, c);
-        if (idx == -1)
+        if ((res = resolve_codepoints(font, unsupported_replace, &i_replace, 1, &c, p_indices)) != JFNT_RESULT_SUCCESS)
         {
-            if (i_replace == -1)
-            {
-                i_replace = find_glyph(font, unsupported_replace);
-                if (i_replace == -1)
-                {
-                    JFNT_ERROR(font, "The unsupported replacement character U+%04hX (%lc) was not supported by the font", unsupported_replace, (wchar_t)unsupported_replace);
-                    return JFNT_RESULT_UNSUPPORTED;
-                }
-            }
-            idx = i_replace;
+            return res;
         }
-        p_indices[i] = idx;
-        i += 1;
+        count = 1;
+    }
+
+    size_t consumed, found;
+    jfnt_utf8_status status;
+    res = find_glyphs_utf8_bytes(
+            font, size - pos, bytes + pos, unsupported_replace, &i_replace, max_count - count, p_indices + count,
+            &consumed, &found, &status);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    pos += consumed;
+    count += found;
+    if (status == JFNT_UTF8_TRUNCATED)
+    {
+        //  Decoder only reports this when the rest of the chunk is a valid beginning of a sequence
+        stream->count_pending = (unsigned)(size - pos);
+        memcpy(stream->pending, bytes + pos, size - pos);
+        pos = size;
+    }
+    *p_consumed = pos;
+    *p_count = count;
+    if (status != JFNT_UTF8_OK && status != JFNT_UTF8_TRUNCATED)
+    {
+        JFNT_ERROR(font, "Invalid UTF-8 sequence beginning with byte %02hhX at index %zu: %s", bytes[pos], pos, jfnt_utf8_status_message(status));
+        return JFNT_RESULT_BAD_ENCODING;
     }
-    *p_count = i;
     return JFNT_RESULT_SUCCESS;
 }
 
@@ -845,6 +2877,75 @@ void jfnt_font_image(const jfnt_font* font, unsigned int* p_width, unsigned int*
     *p_data = font->bmp.data;
 }
 
+void jfnt_font_get_image_layout(const jfnt_font* font, size_t* p_stride, jfnt_pixel_format* p_format)
+{
+    if (p_stride)
+    {
+        *p_stride = font->bmp.stride;
+    }
+    if (p_format)
+    {
+        *p_format = font->bmp.format;
+    }
+}
+
+void jfnt_font_image_to_r8(
+        const jfnt_font* font, unsigned x, unsigned y, unsigned w, unsigned h, unsigned char* dst, size_t dst_stride)
+{
+    jfnt_bitmap_read_r8(&font->bmp, x, y, w, h, dst, dst_stride);
+}
+
+double jfnt_font_get_atlas_usage(const jfnt_font* font, size_t* p_glyph_pixels, size_t* p_atlas_pixels)
+{
+    const size_t atlas_pixels = (size_t)font->bmp.width * font->bmp.height;
+    if (p_glyph_pixels)
+    {
+        *p_glyph_pixels = font->atlas_used;
+    }
+    if (p_atlas_pixels)
+    {
+        *p_atlas_pixels = atlas_pixels;
+    }
+    return atlas_pixels ? (double)font->atlas_used / (double)atlas_pixels : 0.0;
+}
+
+void jfnt_font_get_stats(const jfnt_font* font, jfnt_font_stats* p_stats)
+{
+    if (!font->collect_stats)
+    {
+        *p_stats = (jfnt_font_stats){0};
+        return;
+    }
+    *p_stats = font->stats;
+    p_stats->atlas_fill = jfnt_font_get_atlas_usage(font, NULL, NULL);
+}
+
+const char* jfnt_phase_name(jfnt_phase phase)
+{
+    static const char* const NAMES[JFNT_PHASE_COUNT] =
+            {
+                    [JFNT_PHASE_MATCH] = "match",
+                    [JFNT_PHASE_OPEN_FACE] = "open_face",
+                    [JFNT_PHASE_METRICS] = "metrics",
+                    [JFNT_PHASE_RASTERIZE] = "rasterize",
+                    [JFNT_PHASE_PACK] = "pack",
+                    [JFNT_PHASE_BLIT] = "blit",
+                    [JFNT_PHASE_KERNING] = "kerning",
+                    [JFNT_PHASE_LOOKUP] = "lookup",
+                    [JFNT_PHASE_CACHE] = "cache",
+            };
+    if ((unsigned)phase >= JFNT_PHASE_COUNT)
+    {
+        return "unknown";
+    }
+    return NAMES[phase];
+}
+
+size_t jfnt_font_get_lookup_memory(const jfnt_font* font)
+{
+    return jfnt_lookup_memory(&font->lookup);
+}
+
 void
 jfnt_font_get_sizes(const jfnt_font* font, unsigned* p_height, unsigned* p_avg_w, unsigned* p_size_h, unsigned* p_size_v)
 {
@@ -866,6 +2967,23 @@ jfnt_font_get_sizes(const jfnt_font* font, unsigned* p_height, unsigned* p_avg_w
     }
 }
 
+jfnt_result jfnt_font_get_cell_grid(const jfnt_font* font, jfnt_cell_grid* p_grid)
+{
+    if (!font->cell_grid)
+    {
+        JFNT_ERROR(font, "Font was not created with a cell grid");
+        return JFNT_RESULT_UNSUPPORTED;
+    }
+    *p_grid = (jfnt_cell_grid){
+            .cell_w = font->cell_w - font->cell_padding,
+            .cell_h = font->cell_h - font->cell_padding,
+            .pitch_x = font->cell_w,
+            .pitch_y = font->cell_h,
+            .columns = font->cell_columns,
+    };
+    return JFNT_RESULT_SUCCESS;
+}
+
 void
 jfnt_font_get_measures(const jfnt_font* font, unsigned* p_height, int* ascent, int* descent)
 {
@@ -882,3 +3000,48 @@ jfnt_font_get_measures(const jfnt_font* font, unsigned* p_height, int* ascent, i
         *descent = font->descent;
     }
 }
+
+jfnt_result jfnt_font_get_kerning(const jfnt_font* font, size_t count, const int* indices, int* p_kerning)
+{
+    const unsigned count_glyphs = jfnt_font_load_count(font);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if ((unsigned)indices[i] >= count_glyphs)
+        {
+            JFNT_ERROR(font, "Glyph index %d at position %zu is not valid for a font with %u glyphs", indices[i], i, count_glyphs);
+            return JFNT_RESULT_BAD_ARGUMENT;
+        }
+    }
+    if (!count)
+    {
+        return JFNT_RESULT_SUCCESS;
+    }
+    const unsigned* const ids = jfnt_font_load_glyph_ids(font);
+    unsigned left = ids[indices[0]];
+    for (size_t i = 1; i < count; ++i)
+    {
+        const unsigned right = ids[indices[i]];
+        p_kerning[i - 1] = jfnt_kerning_get(&font->kerning, left, right);
+        left = right;
+    }
+    p_kerning[count - 1] = 0;
+    return JFNT_RESULT_SUCCESS;
+}
+
+unsigned jfnt_font_get_kerning_pair_count(const jfnt_font* font)
+{
+    return font->kerning.count;
+}
+
+jfnt_render_mode jfnt_font_get_render_mode(const jfnt_font* font, unsigned* p_spread, float* p_pixel_size)
+{
+    if (p_spread)
+    {
+        *p_spread = font->sdf_spread;
+    }
+    if (p_pixel_size)
+    {
+        *p_pixel_size = (float)font->size_y / 64.0f;
+    }
+    return font->render_mode;
+}
@@ -0,0 +1,192 @@
+//
+// Created by jan on 17.10.2026.
+//
+
+#ifndef JFNT_JFNT_FONT_INTERNAL_H
+#define JFNT_JFNT_FONT_INTERNAL_H
+#include "../include/jfnt_font.h"
+#include "jfnt_atlas.h"
+#include "jfnt_arena.h"
+#include "jfnt_lookup.h"
+#include "jfnt_kerning.h"
+#include "jfnt_context_internal.h"
+
+#include <time.h>
+#include <fontconfig/fontconfig.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_SIZES_H
+
+//  Face of the fallback chain after the first one, which is opened when it is first needed
+struct jfnt_font_fallback_T
+{
+    const char* path;           //  Belongs to the pattern in the sorted font set
+    int index;
+    const FcCharSet* charset;   //  NULL when the face is the same as the first one, so it is skipped
+    FT_Face face;
+    FT_Size ft_size;
+};
+typedef struct jfnt_font_fallback_T jfnt_font_fallback;
+
+struct jfnt_font_T
+{
+    jfnt_allocator_callbacks allocator_callbacks;
+    jfnt_error_callbacks error_callbacks;
+
+    //  Concurrent fonts publish grown tables of glyphs and glyph ids by storing the pointer to them before the count, both
+    //  with release order, so readers load the count first. Tables they replaced are retired, and kept until the font
+    //  is destroyed or jfnt_font_reclaim is called, since readers may still be using them.
+    unsigned count_glyphs;
+    unsigned capacity_glyphs;
+    jfnt_glyph* glyphs;
+    int concurrent;
+    unsigned count_retired;
+    unsigned capacity_retired;
+    void** retired;
+
+    //  Maps codepoints to indices of glyphs. Glyphs get appended as they are lazily loaded, so their indices stay valid.
+    jfnt_lookup lookup;
+
+    //  FreeType glyph index of each glyph, which is what kerning pairs are keyed by
+    unsigned* glyph_ids;
+    jfnt_kerning kerning;
+
+    //  Where the face came from, so that it can be opened again by worker threads
+    char* face_path;
+    int face_index;
+    const void* face_mem;
+    size_t face_mem_size;
+    FcMatrix matrix;
+
+    //  Context is only kept for fonts which are created with lazy flag set. Face belongs to the context and may be
+    //  shared with other fonts, so the font has its own size on it, which must be activated before the face is used.
+    jfnt_context* context;
+    int own_context;
+    FT_Face face;
+    FT_Size ft_size;
+    //  Faces fontconfig sorted after the one above, which is kept just as long as the context. Glyph with face member of
+    //  i came from fallbacks[i - 1].
+    FcFontSet* fallback_set;
+    unsigned count_fallbacks;
+    jfnt_font_fallback* fallbacks;
+    //  Packer is kept after creation, so that more glyphs can go into the same atlas, unless the font came from a cache
+    jfnt_skyline packer;
+    unsigned thread_count;
+    unsigned count_dirty_rects;
+    jfnt_atlas_rect* dirty_rects;   //  Parts of the atlas written to by the last call to jfnt_font_add_ranges
+    //  Temporary memory used while glyphs are rasterized and packed, on the thread that creates the font or adds ranges
+    //  to it. Only lazy fonts keep it between calls.
+    jfnt_arena scratch;
+    //  With stats collected, allocator callbacks of the font count what is allocated and pass it on to these
+    int collect_stats;
+    jfnt_allocator_callbacks stats_allocator;
+    jfnt_font_stats stats;
+    //  Atlas of a font with a budget is a grid of count_cells cells of equal size, with glyph i in cell i, and the frame
+    //  each glyph was last looked up in. No packer is used then.
+    unsigned count_cells;
+    unsigned cell_w, cell_h;        //  Including the padding
+    unsigned cell_padding;
+    unsigned cell_columns;
+    unsigned long frame;
+    unsigned long* glyph_frames;
+    //  Cell grid has cells of the same members as the ones of a budget, but every glyph is laid out in its cell once
+    int cell_grid;
+    jfnt_glyph_cache_stats cache_stats;
+    void (*evicted)(jfnt_font* font, int index, char32_t codepoint, void* param);
+    void* evicted_param;
+    int lazy;
+    int flip;
+    jfnt_render_mode render_mode;
+    unsigned sdf_spread;
+    unsigned reported_glyphs;
+
+    //  Set when glyphs and the atlas are in a mapped cache file
+    void* cache_map;
+    size_t cache_map_size;
+
+    unsigned int size_x, size_y;
+    unsigned int height;
+    jfnt_bitmap bmp;
+    size_t atlas_used;
+    unsigned tex_w;
+    unsigned tex_h;
+    unsigned average_width;
+    int ascent; int descent;
+};
+
+//  Current time of the monotonic clock, which is only read when the font collects stats
+static inline uint64_t jfnt_stats_begin(const jfnt_font* font)
+{
+    if (!font->collect_stats)
+    {
+        return 0;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+//  Adds the time since begin to the phase. Phases are only timed by the thread holding the lock of the context, or the
+//  one creating the font.
+static inline void jfnt_stats_end(jfnt_font* font, jfnt_phase phase, uint64_t begin)
+{
+    if (font->collect_stats)
+    {
+        font->stats.phase_ns[phase] += jfnt_stats_begin(font) - begin;
+    }
+}
+
+//  Counters may be bumped by several threads at once, such as ones looking glyphs up in the same font
+static inline void jfnt_stats_count(const jfnt_font* font, size_t* counter, size_t value)
+{
+    if (font->collect_stats)
+    {
+        __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+    }
+}
+
+//  Number of glyphs, which readers must load before the tables of glyphs and their ids
+static inline unsigned jfnt_font_load_count(const jfnt_font* font)
+{
+    return __atomic_load_n(&font->count_glyphs, __ATOMIC_ACQUIRE);
+}
+
+//  Table with at least as many glyphs as the count loaded before it, which may be replaced as soon as it is loaded, but
+//  stays valid until it is reclaimed
+static inline const jfnt_glyph* jfnt_font_load_glyphs(const jfnt_font* font)
+{
+    return __atomic_load_n(&font->glyphs, __ATOMIC_ACQUIRE);
+}
+
+static inline const unsigned* jfnt_font_load_glyph_ids(const jfnt_font* font)
+{
+    return __atomic_load_n(&font->glyph_ids, __ATOMIC_ACQUIRE);
+}
+
+//  Height of the atlas, which a lazy font can grow while glyphs of it are being laid out
+static inline unsigned jfnt_font_load_atlas_height(const jfnt_font* font)
+{
+    return __atomic_load_n(&font->bmp.height, __ATOMIC_RELAXED);
+}
+
+//  Sets the size and the transformation of the font on the face
+void jfnt_font_setup_face(const jfnt_font* font, FT_Face face);
+
+//  Loads the glyph into the glyph slot of the face, rendered the way the font wants it
+FT_Error jfnt_font_load_glyph(const jfnt_font* font, FT_Face face, FT_UInt glyph_index);
+
+//  Copies a rendered bitmap as 8-bit pixels, optionally reversing the order of rows. Monochrome bitmaps are expanded, with
+//  set bits becoming full coverage.
+void jfnt_copy_bitmap(unsigned char* dst, size_t dst_stride, const FT_Bitmap* bitmap, int flip);
+
+//  Top row of a rendered bitmap. FreeType stores bitmaps with a negative pitch bottom-up, with buffer at the bottom row.
+static inline const unsigned char* jfnt_ft_bitmap_top(const FT_Bitmap* bitmap)
+{
+    if (bitmap->pitch < 0 && bitmap->rows)
+    {
+        return bitmap->buffer - (ptrdiff_t)bitmap->pitch * (ptrdiff_t)(bitmap->rows - 1);
+    }
+    return bitmap->buffer;
+}
+
+#endif //JFNT_JFNT_FONT_INTERNAL_H
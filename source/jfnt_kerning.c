@@ -0,0 +1,309 @@
+//
+// Created by jan on 17.10.2026.
+//
+
+#include <string.h>
+#include "jfnt_kerning.h"
+#include FT_TRUETYPE_TABLES_H
+#include FT_TRUETYPE_TAGS_H
+
+static jfnt_result kerning_resize(jfnt_kerning* this, const jfnt_allocator_callbacks* allocator, unsigned capacity)
+{
+    jfnt_kern_entry* const entries = allocator->allocate(allocator->state, sizeof(*entries) * capacity);
+    if (!entries)
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    for (unsigned i = 0; i < capacity; ++i)
+    {
+        entries[i] = (jfnt_kern_entry){.pair = JFNT_KERN_EMPTY_PAIR, .value = 0};
+    }
+    const unsigned shift = jfnt_kerning_shift(capacity);
+    for (unsigned i = 0; i < this->capacity; ++i)
+    {
+        const jfnt_kern_entry e = this->entries[i];
+        if (e.pair == JFNT_KERN_EMPTY_PAIR)
+        {
+            continue;
+        }
+        uint32_t j = jfnt_kerning_hash(e.pair, shift);
+        while (entries[j].pair != JFNT_KERN_EMPTY_PAIR)
+        {
+            j = (j + 1) & (capacity - 1);
+        }
+        entries[j] = e;
+    }
+    if (this->entries)
+    {
+        allocator->deallocate(allocator->state, this->entries);
+    }
+    this->entries = entries;
+    this->capacity = capacity;
+    this->shift = shift;
+    return JFNT_RESULT_SUCCESS;
+}
+
+//  Makes room for count pairs, so that the table does not have to grow while they are inserted
+static jfnt_result kerning_reserve(jfnt_kerning* this, const jfnt_allocator_callbacks* allocator, size_t count)
+{
+    if (!count)
+    {
+        return JFNT_RESULT_SUCCESS;
+    }
+    unsigned capacity = this->capacity ? this->capacity : 64;
+    while (capacity < 2 * count)
+    {
+        capacity *= 2;
+    }
+    return capacity == this->capacity ? JFNT_RESULT_SUCCESS : kerning_resize(this, allocator, capacity);
+}
+
+//  Adds value to the pair, or replaces it when override is set
+static jfnt_result kerning_insert(
+        jfnt_kerning* this, const jfnt_allocator_callbacks* allocator, unsigned left, unsigned right, int32_t value,
+        int override)
+{
+    //  Kept at most half full, so that probe sequences stay short
+    if (2 * (this->count + 1) > this->capacity)
+    {
+        const jfnt_result res = kerning_resize(this, allocator, this->capacity ? 2 * this->capacity : 64);
+        if (res != JFNT_RESULT_SUCCESS)
+        {
+            return res;
+        }
+    }
+    const uint32_t pair = (uint32_t)left << 16 | right;
+    uint32_t i = jfnt_kerning_hash(pair, this->shift);
+    while (this->entries[i].pair != JFNT_KERN_EMPTY_PAIR && this->entries[i].pair != pair)
+    {
+        i = (i + 1) & (this->capacity - 1);
+    }
+    if (this->entries[i].pair == JFNT_KERN_EMPTY_PAIR)
+    {
+        this->entries[i] = (jfnt_kern_entry){.pair = pair, .value = value};
+        this->count += 1;
+    }
+    else
+    {
+        this->entries[i].value = override ? value : this->entries[i].value + value;
+    }
+    return JFNT_RESULT_SUCCESS;
+}
+
+//  Same scaling as done by FT_Get_Kerning in FT_KERNING_DEFAULT mode
+static int32_t kerning_to_pixels(FT_Face face, int32_t value)
+{
+    FT_Pos scaled = FT_MulFix(value, face->size->metrics.x_scale);
+    //  FreeType makes kerning smaller for small sizes, so that it does not get too big
+    if (face->size->metrics.x_ppem < 25)
+    {
+        scaled = FT_MulDiv(scaled, face->size->metrics.x_ppem, 25);
+    }
+    return (int32_t)(((scaled + 32) & -64) / 64);
+}
+
+static unsigned read_u16(const unsigned char* p)
+{
+    return (unsigned)p[0] << 8 | p[1];
+}
+
+//  Reads format 0 subtables of a version 0 kern table, which are the only ones FT_Get_Kerning uses as well. Pairs with
+//  glyphs which are not in the wanted set are skipped, unless the set is NULL.
+static jfnt_result kerning_read_table(
+        jfnt_kerning* raw, const jfnt_allocator_callbacks* allocator, size_t size, const unsigned char* table,
+        const unsigned char* wanted)
+{
+    if (size < 4 || read_u16(table) != 0)
+    {
+        return JFNT_RESULT_SUCCESS;
+    }
+    const unsigned n_tables = read_u16(table + 2);
+    const unsigned char* p = table + 4;
+    const unsigned char* const end = table + size;
+    for (unsigned i_table = 0; i_table < n_tables && end - p >= 6; ++i_table)
+    {
+        const unsigned length = read_u16(p + 2);
+        const unsigned coverage = read_u16(p + 4);
+        const unsigned char* next = length > (size_t)(end - p) ? end : p + length;
+        //  Horizontal format 0 only, with nothing but the override bit allowed to be set besides
+        if (length > 6 + 8 && (coverage & ~8u) == 0x0001 && end - p >= 14)
+        {
+            const unsigned char* pairs = p + 14;
+            unsigned n_pairs = read_u16(p + 6);
+            //  Length is only 16 bits, so large subtables may claim to be shorter than their pairs actually are
+            if ((size_t)(end - pairs) / 6 < n_pairs)
+            {
+                n_pairs = (unsigned)((size_t)(end - pairs) / 6);
+            }
+            if (pairs + 6 * (size_t)n_pairs > next)
+            {
+                next = pairs + 6 * (size_t)n_pairs;
+            }
+            //  Count of the subtable is an upper bound, since pairs may repeat or be skipped
+            const jfnt_result reserved = kerning_reserve(raw, allocator, raw->count + (size_t)n_pairs);
+            if (reserved != JFNT_RESULT_SUCCESS)
+            {
+                return reserved;
+            }
+            for (unsigned i = 0; i < n_pairs; ++i)
+            {
+                const unsigned left = read_u16(pairs + 6 * i);
+                const unsigned right = read_u16(pairs + 6 * i + 2);
+                const int32_t value = (int16_t)read_u16(pairs + 6 * i + 4);
+                if (wanted && (!(wanted[left >> 3] & (1 << (left & 7))) || !(wanted[right >> 3] & (1 << (right & 7)))))
+                {
+                    continue;
+                }
+                const jfnt_result res = kerning_insert(raw, allocator, left, right, value, (coverage & 8) != 0);
+                if (res != JFNT_RESULT_SUCCESS)
+                {
+                    return res;
+                }
+            }
+        }
+        p = next;
+    }
+    return JFNT_RESULT_SUCCESS;
+}
+
+static jfnt_result kerning_load_sfnt(
+        jfnt_kerning* this, const jfnt_allocator_callbacks* allocator, FT_Face face, unsigned count_ids,
+        const unsigned* ids, int all_pairs)
+{
+    FT_ULong size = 0;
+    if (FT_Load_Sfnt_Table(face, TTAG_kern, 0, NULL, &size) != FT_Err_Ok || size == 0)
+    {
+        return JFNT_RESULT_SUCCESS;
+    }
+    unsigned char* const table = allocator->allocate(allocator->state, size);
+    //  Glyph ids in SFNT fonts are 16-bit, so this is at most 8 KiB
+    unsigned char* const wanted = all_pairs ? NULL : allocator->allocate(allocator->state, 0x10000 / 8);
+    jfnt_result res = JFNT_RESULT_BAD_ALLOC;
+    if (!table || (!all_pairs && !wanted))
+    {
+        goto end;
+    }
+    if (FT_Load_Sfnt_Table(face, TTAG_kern, 0, table, &size) != FT_Err_Ok)
+    {
+        res = JFNT_RESULT_BAD_FT_CALL;
+        goto end;
+    }
+    if (wanted)
+    {
+        memset(wanted, 0, 0x10000 / 8);
+        for (unsigned i = 0; i < count_ids; ++i)
+        {
+            if (ids[i] <= 0xFFFF)
+            {
+                wanted[ids[i] >> 3] |= (unsigned char)(1 << (ids[i] & 7));
+            }
+        }
+    }
+
+    //  Values of subtables are summed in font units, and only then scaled
+    jfnt_kerning raw = {0};
+    if ((res = kerning_read_table(&raw, allocator, size, table, wanted)) == JFNT_RESULT_SUCCESS &&
+        (res = kerning_reserve(this, allocator, raw.count)) == JFNT_RESULT_SUCCESS)
+    {
+        for (unsigned i = 0; i < raw.capacity && res == JFNT_RESULT_SUCCESS; ++i)
+        {
+            const jfnt_kern_entry e = raw.entries[i];
+            if (e.pair == JFNT_KERN_EMPTY_PAIR)
+            {
+                continue;
+            }
+            const int32_t value = kerning_to_pixels(face, e.value);
+            if (value != 0)
+            {
+                res = kerning_insert(this, allocator, e.pair >> 16, e.pair & 0xFFFF, value, 1);
+            }
+        }
+    }
+    jfnt_kerning_destroy(&raw, allocator);
+
+end:
+    if (wanted)
+    {
+        allocator->deallocate(allocator->state, wanted);
+    }
+    if (table)
+    {
+        allocator->deallocate(allocator->state, table);
+    }
+    return res;
+}
+
+static jfnt_result kerning_add_pair(
+        jfnt_kerning* this, const jfnt_allocator_callbacks* allocator, FT_Face face, unsigned left, unsigned right)
+{
+    FT_Vector v;
+    if (left > 0xFFFF || right > 0xFFFF || FT_Get_Kerning(face, left, right, FT_KERNING_DEFAULT, &v) != FT_Err_Ok || (v.x >> 6) == 0)
+    {
+        return JFNT_RESULT_SUCCESS;
+    }
+    return kerning_insert(this, allocator, left, right, (int32_t)(v.x >> 6), 1);
+}
+
+jfnt_result jfnt_kerning_load(
+        jfnt_kerning* this, const jfnt_allocator_callbacks* allocator, FT_Face face, unsigned count_ids,
+        const unsigned* ids, int all_pairs)
+{
+    *this = (jfnt_kerning){0};
+    if (!FT_HAS_KERNING(face))
+    {
+        return JFNT_RESULT_SUCCESS;
+    }
+    if (FT_IS_SFNT(face))
+    {
+        const jfnt_result res = kerning_load_sfnt(this, allocator, face, count_ids, ids, all_pairs);
+        if (res != JFNT_RESULT_SUCCESS)
+        {
+            jfnt_kerning_destroy(this, allocator);
+        }
+        return res;
+    }
+
+    //  Kerning of other formats can only be had one pair at a time
+    this->per_pair = 1;
+    for (unsigned i = 0; i < count_ids; ++i)
+    {
+        for (unsigned j = 0; j < count_ids; ++j)
+        {
+            const jfnt_result res = kerning_add_pair(this, allocator, face, ids[i], ids[j]);
+            if (res != JFNT_RESULT_SUCCESS)
+            {
+                jfnt_kerning_destroy(this, allocator);
+                return res;
+            }
+        }
+    }
+    return JFNT_RESULT_SUCCESS;
+}
+
+jfnt_result jfnt_kerning_add_glyph(
+        jfnt_kerning* this, const jfnt_allocator_callbacks* allocator, FT_Face face, unsigned count_ids,
+        const unsigned* ids, unsigned new_id)
+{
+    if (!this->per_pair)
+    {
+        return JFNT_RESULT_SUCCESS;
+    }
+    jfnt_result res = kerning_add_pair(this, allocator, face, new_id, new_id);
+    for (unsigned i = 0; i < count_ids && res == JFNT_RESULT_SUCCESS; ++i)
+    {
+        if ((res = kerning_add_pair(this, allocator, face, ids[i], new_id)) == JFNT_RESULT_SUCCESS)
+        {
+            res = kerning_add_pair(this, allocator, face, new_id, ids[i]);
+        }
+    }
+    return res;
+}
+
+void jfnt_kerning_destroy(jfnt_kerning* this, const jfnt_allocator_callbacks* allocator)
+{
+    if (this->entries)
+    {
+        allocator->deallocate(allocator->state, this->entries);
+    }
+    *this = (jfnt_kerning){0};
+}
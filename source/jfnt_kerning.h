@@ -0,0 +1,85 @@
+//
+// Created by jan on 17.10.2026.
+//
+
+#ifndef JFNT_JFNT_KERNING_H
+#define JFNT_JFNT_KERNING_H
+#include <stdint.h>
+#include "../include/jfnt_font.h"
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+//  Kerning of glyph pairs in pixels, kept in an open addressing hash table keyed by FreeType glyph ids of both glyphs.
+//  Only pairs with non-zero kerning are stored.
+struct jfnt_kern_entry_T
+{
+    uint32_t pair;      //  Id of the left glyph in the high half, id of the right one in the low half
+    int32_t value;
+};
+typedef struct jfnt_kern_entry_T jfnt_kern_entry;
+
+//  Glyph id 0xFFFF can not exist, as SFNT fonts have at most 0xFFFF glyphs
+#define JFNT_KERN_EMPTY_PAIR UINT32_C(0xFFFFFFFF)
+
+struct jfnt_kerning_T
+{
+    unsigned capacity;  //  Power of two, or 0 when there are no pairs
+    unsigned shift;     //  32 - log2(capacity), hash is taken from the top bits of the product
+    unsigned count;
+    jfnt_kern_entry* entries;
+    int per_pair;       //  Face had no kern table, so pairs come from FT_Get_Kerning and new glyphs need their own
+};
+typedef struct jfnt_kerning_T jfnt_kerning;
+
+//  Extracts kerning of all pairs of glyphs with given ids. SFNT faces have their kern table read directly, and when
+//  all_pairs is set, every pair in it is kept, so that glyphs added later need no more work. Other faces are asked for
+//  each pair with FT_Get_Kerning. Values are the same as given by FT_Get_Kerning with FT_KERNING_DEFAULT.
+jfnt_result jfnt_kerning_load(
+        jfnt_kerning* this, const jfnt_allocator_callbacks* allocator, FT_Face face, unsigned count_ids,
+        const unsigned* ids, int all_pairs);
+
+//  Adds pairs of a new glyph with the glyphs already loaded, if the table needs it
+jfnt_result jfnt_kerning_add_glyph(
+        jfnt_kerning* this, const jfnt_allocator_callbacks* allocator, FT_Face face, unsigned count_ids,
+        const unsigned* ids, unsigned new_id);
+
+void jfnt_kerning_destroy(jfnt_kerning* this, const jfnt_allocator_callbacks* allocator);
+
+static inline unsigned jfnt_kerning_shift(unsigned capacity)
+{
+    unsigned shift = 32;
+    for (unsigned c = capacity; c > 1; c >>= 1)
+    {
+        shift -= 1;
+    }
+    return shift;
+}
+
+static inline uint32_t jfnt_kerning_hash(uint32_t pair, unsigned shift)
+{
+    return (uint32_t)(pair * 0x9E3779B1u) >> shift;
+}
+
+static inline int jfnt_kerning_get(const jfnt_kerning* this, unsigned left, unsigned right)
+{
+    if (!this->count || (left | right) > 0xFFFF)
+    {
+        return 0;
+    }
+    const uint32_t pair = (uint32_t)left << 16 | right;
+    for (uint32_t i = jfnt_kerning_hash(pair, this->shift);; i = (i + 1) & (this->capacity - 1))
+    {
+        const jfnt_kern_entry e = this->entries[i];
+        if (e.pair == pair)
+        {
+            return e.value;
+        }
+        if (e.pair == JFNT_KERN_EMPTY_PAIR)
+        {
+            return 0;
+        }
+    }
+}
+
+#endif //JFNT_JFNT_KERNING_H
@@ -0,0 +1,250 @@
+//
+// Created by jan on 17.10.2026.
+//
+
+#include <stdint.h>
+#include <string.h>
+#include "../include/jfnt_layout.h"
+#include "jfnt_font_internal.h"
+
+//  Number of glyphs looked up at once by the codepoint and UTF-8 variants
+enum {LAYOUT_CHUNK = 256};
+
+static jfnt_result layout_check_info(const jfnt_font* font, const jfnt_layout_info* info)
+{
+    if (info->stride != 0 && info->stride < sizeof(jfnt_quad))
+    {
+        JFNT_ERROR(font, "Quad stride %zu is less than the size of a quad (%zu)", info->stride, sizeof(jfnt_quad));
+        return JFNT_RESULT_BAD_ARGUMENT;
+    }
+    if (!(info->scale >= 0.0f))
+    {
+        JFNT_ERROR(font, "Layout scale %g is not a positive number", (double)info->scale);
+        return JFNT_RESULT_BAD_ARGUMENT;
+    }
+    return JFNT_RESULT_SUCCESS;
+}
+
+//  Lays out glyphs starting at the pen position, which is updated, and writes quads starting at out, with texture
+//  coordinates for an atlas atlas_h rows high. Index of the glyph laid out last is kept in *p_prev (-1 when there was
+//  none), so that kerning works across chunks.
+static jfnt_result layout_glyphs(
+        const jfnt_font* font, const jfnt_layout_info* info, unsigned atlas_h, size_t count, const int* indices,
+        unsigned char* out, size_t* p_written, float* p_pen_x, float* p_pen_y, int* p_prev)
+{
+    const size_t stride = info->stride ? info->stride : sizeof(jfnt_quad);
+    const unsigned count_glyphs = jfnt_font_load_count(font);
+    const jfnt_glyph* const glyphs = jfnt_font_load_glyphs(font);
+    const float inv_w = font->bmp.width ? 1.0f / (float)font->bmp.width : 0.0f;
+    const float inv_h = atlas_h ? 1.0f / (float)atlas_h : 0.0f;
+    //  Picking these up front leaves the loop with no branches other than for skipping empty glyphs
+    const float y_dir = info->y_up ? -1.0f : 1.0f;
+    const float v0_rows = font->flip ? 1.0f : 0.0f;
+    const float v1_rows = font->flip ? 0.0f : 1.0f;
+    const int skip_empty = info->skip_empty;
+    //  Without any pairs in the font, kerning can be skipped entirely
+    const jfnt_kerning* const kerning = info->kerning && font->kerning.count ? &font->kerning : NULL;
+    const unsigned* const glyph_ids = jfnt_font_load_glyph_ids(font);
+    const float scale = info->scale != 0.0f ? info->scale : 1.0f;
+
+    float pen_x = *p_pen_x;
+    float pen_y = *p_pen_y;
+    int prev = *p_prev;
+    size_t written = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const int idx = indices[i];
+        if ((unsigned)idx >= count_glyphs)
+        {
+            JFNT_ERROR(font, "Glyph index %d at position %zu is not valid for a font with %u glyphs", idx, i, count_glyphs);
+            *p_written = written;
+            *p_pen_x = pen_x;
+            *p_pen_y = pen_y;
+            *p_prev = prev;
+            return JFNT_RESULT_BAD_ARGUMENT;
+        }
+        if (kerning && prev >= 0)
+        {
+            pen_x += scale * (float)jfnt_kerning_get(kerning, glyph_ids[prev], glyph_ids[idx]);
+        }
+        prev = idx;
+        const jfnt_glyph* const g = glyphs + idx;
+        const float w = (float)g->w;
+        const float h = (float)g->h;
+        const float scaled_w = scale * w;
+        const float scaled_h = scale * h;
+        if (!skip_empty || (g->w && g->h))
+        {
+            jfnt_quad q;
+            q.x0 = pen_x + scale * (float)g->left;
+            q.x1 = q.x0 + scaled_w;
+            q.y0 = pen_y - y_dir * scale * (float)g->top;
+            q.y1 = q.y0 + y_dir * scaled_h;
+            q.u0 = (float)g->offset_x * inv_w;
+            q.u1 = ((float)g->offset_x + w) * inv_w;
+            q.v0 = ((float)g->offset_y + v0_rows * h) * inv_h;
+            q.v1 = ((float)g->offset_y + v1_rows * h) * inv_h;
+            //  Stride does not have to keep the quads aligned
+            memcpy(out + written * stride, &q, sizeof(q));
+            written += 1;
+        }
+        //  FreeType's advance points up, same as top
+        pen_x += scale * (float)g->advance_x;
+        pen_y -= y_dir * scale * (float)g->advance_y;
+    }
+    *p_written = written;
+    *p_pen_x = pen_x;
+    *p_pen_y = pen_y;
+    *p_prev = prev;
+    return JFNT_RESULT_SUCCESS;
+}
+
+//  Looking up a chunk of a run may grow the atlas of a lazy font, which only gets taller, so quads of the earlier chunks
+//  are rescaled from the height they were laid out for to the new one. Glyphs keep their place in the atlas as it grows.
+static void layout_rescale_v(unsigned char* out, size_t stride, size_t count, unsigned old_h, unsigned new_h)
+{
+    const float factor = (float)old_h / (float)new_h;
+    for (size_t i = 0; i < count; ++i)
+    {
+        jfnt_quad q;
+        memcpy(&q, out + i * stride, sizeof(q));
+        q.v0 *= factor;
+        q.v1 *= factor;
+        memcpy(out + i * stride, &q, sizeof(q));
+    }
+}
+
+//  Height of the atlas for laying out the chunk which was just looked up. Quads already written are rescaled when the
+//  lookup made the atlas grow.
+static unsigned layout_chunk_height(
+        const jfnt_font* font, const jfnt_layout_info* info, unsigned char* out, size_t written, unsigned laid_h)
+{
+    const unsigned atlas_h = jfnt_font_load_atlas_height(font);
+    if (written && laid_h && atlas_h != laid_h)
+    {
+        layout_rescale_v(out, info->stride ? info->stride : sizeof(jfnt_quad), written, laid_h, atlas_h);
+    }
+    return atlas_h;
+}
+
+static void layout_return_pen(float pen_x, float pen_y, float* p_pen_x, float* p_pen_y)
+{
+    if (p_pen_x)
+    {
+        *p_pen_x = pen_x;
+    }
+    if (p_pen_y)
+    {
+        *p_pen_y = pen_y;
+    }
+}
+
+jfnt_result jfnt_layout_run(
+        const jfnt_font* font, const jfnt_layout_info* info, size_t count, const int* indices, void* p_quads,
+        size_t* p_written, float* p_pen_x, float* p_pen_y)
+{
+    jfnt_result res = layout_check_info(font, info);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    float pen_x = info->origin_x;
+    float pen_y = info->origin_y;
+    int prev = -1;
+    res = layout_glyphs(
+            font, info, jfnt_font_load_atlas_height(font), count, indices, p_quads, p_written, &pen_x, &pen_y, &prev);
+    layout_return_pen(pen_x, pen_y, p_pen_x, p_pen_y);
+    return res;
+}
+
+jfnt_result jfnt_layout_run_u32(
+        const jfnt_font* font, const jfnt_layout_info* info, char32_t unsupported_replace, size_t count,
+        const char32_t* codepoints, void* p_quads, size_t* p_written, float* p_pen_x, float* p_pen_y)
+{
+    jfnt_result res = layout_check_info(font, info);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    const size_t stride = info->stride ? info->stride : sizeof(jfnt_quad);
+    unsigned char* const out = p_quads;
+    int indices[LAYOUT_CHUNK];
+    float pen_x = info->origin_x;
+    float pen_y = info->origin_y;
+    int prev = -1;
+    size_t written = 0;
+    unsigned laid_h = 0;
+    for (size_t pos = 0; pos < count; pos += LAYOUT_CHUNK)
+    {
+        const size_t n = count - pos < LAYOUT_CHUNK ? count - pos : LAYOUT_CHUNK;
+        if ((res = jfnt_font_find_glyphs_u32(font, unsupported_replace, n, codepoints + pos, indices)) != JFNT_RESULT_SUCCESS)
+        {
+            break;
+        }
+        laid_h = layout_chunk_height(font, info, out, written, laid_h);
+        size_t chunk_written;
+        res = layout_glyphs(
+                font, info, laid_h, n, indices, out + written * stride, &chunk_written, &pen_x, &pen_y, &prev);
+        written += chunk_written;
+        if (res != JFNT_RESULT_SUCCESS)
+        {
+            break;
+        }
+    }
+    *p_written = written;
+    layout_return_pen(pen_x, pen_y, p_pen_x, p_pen_y);
+    return res;
+}
+
+jfnt_result jfnt_layout_run_utf8(
+        const jfnt_font* font, const jfnt_layout_info* info, const char* utf8, char32_t unsupported_replace,
+        size_t max_len, void* p_quads, size_t* p_written, float* p_pen_x, float* p_pen_y)
+{
+    jfnt_result res = layout_check_info(font, info);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    const size_t stride = info->stride ? info->stride : sizeof(jfnt_quad);
+    unsigned char* const out = p_quads;
+    //  Same limit on the length as used by jfnt_font_find_glyphs_utf8, since no codepoint takes more than 4 bytes
+    const size_t size = strnlen(utf8, max_len < SIZE_MAX / 4 ? max_len * 4 : SIZE_MAX);
+    jfnt_utf8_stream stream;
+    jfnt_utf8_stream_reset(&stream);
+    int indices[LAYOUT_CHUNK];
+    float pen_x = info->origin_x;
+    float pen_y = info->origin_y;
+    int prev = -1;
+    size_t pos = 0;
+    size_t count = 0;
+    size_t written = 0;
+    unsigned laid_h = 0;
+    while (pos < size && count < max_len)
+    {
+        const size_t max_count = max_len - count < LAYOUT_CHUNK ? max_len - count : LAYOUT_CHUNK;
+        size_t consumed, found;
+        if ((res = jfnt_font_find_glyphs_utf8_stream(font, &stream, size - pos, utf8 + pos, unsupported_replace, max_count, indices, &consumed, &found)) != JFNT_RESULT_SUCCESS)
+        {
+            break;
+        }
+        pos += consumed;
+        count += found;
+        laid_h = layout_chunk_height(font, info, out, written, laid_h);
+        size_t chunk_written;
+        res = layout_glyphs(
+                font, info, laid_h, found, indices, out + written * stride, &chunk_written, &pen_x, &pen_y, &prev);
+        written += chunk_written;
+        if (res != JFNT_RESULT_SUCCESS)
+        {
+            break;
+        }
+    }
+    if (res == JFNT_RESULT_SUCCESS && stream.count_pending)
+    {
+        JFNT_ERROR(font, "String ends in the middle of a UTF-8 sequence beginning with byte %02hhX", stream.pending[0]);
+        res = JFNT_RESULT_BAD_ENCODING;
+    }
+    *p_written = written;
+    layout_return_pen(pen_x, pen_y, p_pen_x, p_pen_y);
+    return res;
+}
@@ -0,0 +1,99 @@
+//
+// Created by jan on 17.10.2026.
+//
+
+#include <string.h>
+#include "jfnt_lookup.h"
+
+jfnt_result jfnt_lookup_init(jfnt_lookup* this, const jfnt_allocator_callbacks* allocator, char32_t max_codepoint, int empty)
+{
+    if (max_codepoint > JFNT_LOOKUP_MAX_CODEPOINT)
+    {
+        max_codepoint = JFNT_LOOKUP_MAX_CODEPOINT;
+    }
+    this->count_pages = (max_codepoint >> JFNT_LOOKUP_PAGE_BITS) + 1;
+    this->allocated_pages = 0;
+    this->empty = empty;
+    this->pages = allocator->allocate(allocator->state, sizeof(*this->pages) * this->count_pages);
+    if (!this->pages)
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    for (unsigned i = 0; i < this->count_pages; ++i)
+    {
+        this->pages[i] = NULL;
+    }
+    return JFNT_RESULT_SUCCESS;
+}
+
+jfnt_result jfnt_lookup_reserve(jfnt_lookup* this, const jfnt_allocator_callbacks* allocator, char32_t max_codepoint)
+{
+    if (max_codepoint > JFNT_LOOKUP_MAX_CODEPOINT)
+    {
+        max_codepoint = JFNT_LOOKUP_MAX_CODEPOINT;
+    }
+    const unsigned count_pages = (max_codepoint >> JFNT_LOOKUP_PAGE_BITS) + 1;
+    if (count_pages <= this->count_pages)
+    {
+        return JFNT_RESULT_SUCCESS;
+    }
+    int** const new_pages = allocator->reallocate(allocator->state, this->pages, sizeof(*new_pages) * count_pages);
+    if (!new_pages)
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    for (unsigned i = this->count_pages; i < count_pages; ++i)
+    {
+        new_pages[i] = NULL;
+    }
+    this->pages = new_pages;
+    this->count_pages = count_pages;
+    return JFNT_RESULT_SUCCESS;
+}
+
+jfnt_result jfnt_lookup_set(jfnt_lookup* this, const jfnt_allocator_callbacks* allocator, char32_t c, int index)
+{
+    const size_t page = c >> JFNT_LOOKUP_PAGE_BITS;
+    if (page >= this->count_pages)
+    {
+        //  Such codepoints can never be looked up
+        return JFNT_RESULT_SUCCESS;
+    }
+    int* entries = this->pages[page];
+    if (!entries)
+    {
+        entries = allocator->allocate(allocator->state, sizeof(*entries) * JFNT_LOOKUP_PAGE_SIZE);
+        if (!entries)
+        {
+            return JFNT_RESULT_BAD_ALLOC;
+        }
+        for (unsigned i = 0; i < JFNT_LOOKUP_PAGE_SIZE; ++i)
+        {
+            entries[i] = this->empty;
+        }
+        __atomic_store_n(&this->pages[page], entries, __ATOMIC_RELEASE);
+        this->allocated_pages += 1;
+    }
+    __atomic_store_n(&entries[c & (JFNT_LOOKUP_PAGE_SIZE - 1)], index, __ATOMIC_RELEASE);
+    return JFNT_RESULT_SUCCESS;
+}
+
+void jfnt_lookup_destroy(jfnt_lookup* this, const jfnt_allocator_callbacks* allocator)
+{
+    for (unsigned i = 0; i < this->count_pages; ++i)
+    {
+        if (this->pages[i])
+        {
+            allocator->deallocate(allocator->state, this->pages[i]);
+        }
+    }
+    allocator->deallocate(allocator->state, this->pages);
+    this->pages = NULL;
+    this->count_pages = 0;
+    this->allocated_pages = 0;
+}
+
+size_t jfnt_lookup_memory(const jfnt_lookup* this)
+{
+    return sizeof(*this->pages) * this->count_pages + sizeof(int) * JFNT_LOOKUP_PAGE_SIZE * (size_t)this->allocated_pages;
+}
@@ -0,0 +1,63 @@
+//
+// Created by jan on 17.10.2026.
+//
+
+#ifndef JFNT_JFNT_LOOKUP_H
+#define JFNT_JFNT_LOOKUP_H
+#include "../include/jfnt_font.h"
+
+//  Two level table mapping codepoints to glyph indices. Top level is indexed by codepoint >> 8 and only the pages
+//  that contain any glyphs are allocated, so a lookup is always two loads with no searching. Pages and entries are
+//  published with release stores, so that one thread may set entries while others get them, as long as the top level
+//  is never reserved past its size from init while they do.
+enum
+{
+    JFNT_LOOKUP_PAGE_BITS = 8,
+    JFNT_LOOKUP_PAGE_SIZE = 1 << JFNT_LOOKUP_PAGE_BITS,
+    JFNT_LOOKUP_MAX_CODEPOINT = 0x10FFFF,
+};
+
+enum
+{
+    JFNT_LOOKUP_UNSUPPORTED = -1,   //  Font has no glyph for the codepoint
+    JFNT_LOOKUP_UNKNOWN = -2,       //  Lazy font did not try to load the codepoint yet
+};
+
+struct jfnt_lookup_T
+{
+    unsigned count_pages;
+    unsigned allocated_pages;
+    int empty;                      //  Value of entries in pages which are not allocated
+    int** pages;
+};
+typedef struct jfnt_lookup_T jfnt_lookup;
+
+//  Codepoints above max_codepoint are always unsupported, as are ones above JFNT_LOOKUP_MAX_CODEPOINT
+jfnt_result jfnt_lookup_init(jfnt_lookup* this, const jfnt_allocator_callbacks* allocator, char32_t max_codepoint, int empty);
+
+//  Grows the table so that codepoints up to max_codepoint can be set, which are unsupported until they are
+jfnt_result jfnt_lookup_reserve(jfnt_lookup* this, const jfnt_allocator_callbacks* allocator, char32_t max_codepoint);
+
+jfnt_result jfnt_lookup_set(jfnt_lookup* this, const jfnt_allocator_callbacks* allocator, char32_t c, int index);
+
+void jfnt_lookup_destroy(jfnt_lookup* this, const jfnt_allocator_callbacks* allocator);
+
+//  Memory taken by the table, which is at most (max_codepoint / 256 + 1) * (sizeof(int*) + 256 * sizeof(int))
+size_t jfnt_lookup_memory(const jfnt_lookup* this);
+
+static inline int jfnt_lookup_get(const jfnt_lookup* this, char32_t c)
+{
+    const size_t page = c >> JFNT_LOOKUP_PAGE_BITS;
+    if (page >= this->count_pages)
+    {
+        return JFNT_LOOKUP_UNSUPPORTED;
+    }
+    const int* const entries = __atomic_load_n(&this->pages[page], __ATOMIC_ACQUIRE);
+    if (!entries)
+    {
+        return this->empty;
+    }
+    return __atomic_load_n(&entries[c & (JFNT_LOOKUP_PAGE_SIZE - 1)], __ATOMIC_ACQUIRE);
+}
+
+#endif //JFNT_JFNT_LOOKUP_H
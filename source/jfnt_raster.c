@@ -0,0 +1,649 @@
+//
+// Created by jan on 17.10.2026.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "jfnt_raster.h"
+
+struct raster_miss_T
+{
+    char32_t codepoint;
+    FT_Error error;
+};
+typedef struct raster_miss_T raster_miss;
+
+//  Entry of the table from glyph indices to glyphs of the job which were rendered for them, with index 0 marking an
+//  empty entry, since character maps never point codepoints at the missing glyph
+struct raster_seen_T
+{
+    FT_UInt glyph_index;
+    unsigned glyph;
+};
+typedef struct raster_seen_T raster_seen;
+
+struct jfnt_raster_job_T
+{
+    const jfnt_font* font;
+    const jfnt_raster_face* source;
+    FT_Face face;                       //  When NULL, the job opens its own library and face of the source
+    const char32_t* codepoints;         //  Part of the codepoints which are both requested and covered by the face
+    size_t count;
+
+    unsigned count_glyphs;
+    unsigned capacity_glyphs;
+    jfnt_glyph* glyphs;
+    size_t* offsets;
+
+    size_t size_pixels;
+    size_t capacity_pixels;
+    unsigned char* pixels;
+
+    unsigned count_misses;
+    unsigned capacity_misses;
+    raster_miss* misses;
+
+    size_t capacity_seen;               //  Power of two, at least twice the number of codepoints
+    raster_seen* seen;
+
+    jfnt_result result;
+    FT_Error ft_error;
+};
+
+static jfnt_result job_add_miss(jfnt_raster_job* job, char32_t c, FT_Error error)
+{
+    if (job->count_misses == job->capacity_misses)
+    {
+        const unsigned new_capacity = job->capacity_misses ? job->capacity_misses * 2 : 64;
+        raster_miss* const new_misses = jfnt_realloc(job->font, job->misses, sizeof(*new_misses) * new_capacity);
+        if (!new_misses)
+        {
+            return JFNT_RESULT_BAD_ALLOC;
+        }
+        job->misses = new_misses;
+        job->capacity_misses = new_capacity;
+    }
+    job->misses[job->count_misses] = (raster_miss){.codepoint = c, .error = error};
+    job->count_misses += 1;
+    return JFNT_RESULT_SUCCESS;
+}
+
+//  Every codepoint of the job is in the character map, so nearly all of them get a glyph. Pixels are estimated from the
+//  metrics of the font, as half the cell of an average glyph, so that most jobs allocate their memory just once.
+static jfnt_result job_reserve(jfnt_raster_job* job)
+{
+    const jfnt_font* const font = job->font;
+    const unsigned capacity = job->count ? (unsigned)job->count : 1;
+    if (!(job->glyphs = jfnt_alloc(font, sizeof(*job->glyphs) * capacity)) ||
+        !(job->offsets = jfnt_alloc(font, sizeof(*job->offsets) * capacity)))
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    job->capacity_glyphs = capacity;
+    const size_t cell = (size_t)(font->average_width + 2 * font->sdf_spread) * (font->height + 2 * font->sdf_spread);
+    const size_t capacity_pixels = capacity * (cell / 2 > 64 ? cell / 2 : 64);
+    if (!(job->pixels = jfnt_alloc(font, capacity_pixels)))
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    job->capacity_pixels = capacity_pixels;
+    size_t capacity_seen = 16;
+    while (capacity_seen < 2 * job->count)
+    {
+        capacity_seen *= 2;
+    }
+    if (!(job->seen = jfnt_alloc(font, sizeof(*job->seen) * capacity_seen)))
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    memset(job->seen, 0, sizeof(*job->seen) * capacity_seen);
+    job->capacity_seen = capacity_seen;
+    return JFNT_RESULT_SUCCESS;
+}
+
+//  Entry for the glyph index, which is either the one holding it, or the empty one where it belongs
+static raster_seen* job_find_seen(jfnt_raster_job* job, FT_UInt glyph_index)
+{
+    size_t i = ((size_t)glyph_index * 0x9E3779B1u) & (job->capacity_seen - 1);
+    while (job->seen[i].glyph_index != 0 && job->seen[i].glyph_index != glyph_index)
+    {
+        i = (i + 1) & (job->capacity_seen - 1);
+    }
+    return job->seen + i;
+}
+
+static jfnt_result job_grow_glyphs(jfnt_raster_job* job)
+{
+    const unsigned new_capacity = job->capacity_glyphs ? job->capacity_glyphs * 2 : 64;
+    jfnt_glyph* const new_glyphs = jfnt_realloc(job->font, job->glyphs, sizeof(*new_glyphs) * new_capacity);
+    if (!new_glyphs)
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    job->glyphs = new_glyphs;
+    size_t* const new_offsets = jfnt_realloc(job->font, job->offsets, sizeof(*new_offsets) * new_capacity);
+    if (!new_offsets)
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    job->offsets = new_offsets;
+    job->capacity_glyphs = new_capacity;
+    return JFNT_RESULT_SUCCESS;
+}
+
+//  Codepoint mapped to a glyph which was already rendered gets a copy of its metrics and the same pixels
+static jfnt_result job_share_glyph(jfnt_raster_job* job, char32_t c, unsigned glyph)
+{
+    if (job->count_glyphs == job->capacity_glyphs)
+    {
+        const jfnt_result res = job_grow_glyphs(job);
+        if (res != JFNT_RESULT_SUCCESS)
+        {
+            return res;
+        }
+    }
+    job->glyphs[job->count_glyphs] = job->glyphs[glyph];
+    job->glyphs[job->count_glyphs].codepoint = c;
+    job->offsets[job->count_glyphs] = job->offsets[glyph];
+    job->count_glyphs += 1;
+    return JFNT_RESULT_SUCCESS;
+}
+
+static jfnt_result job_add_glyph(jfnt_raster_job* job, char32_t c, FT_GlyphSlot glyph)
+{
+    if (job->count_glyphs == job->capacity_glyphs)
+    {
+        const jfnt_result res = job_grow_glyphs(job);
+        if (res != JFNT_RESULT_SUCCESS)
+        {
+            return res;
+        }
+    }
+    const unsigned w = glyph->bitmap.width;
+    const unsigned h = glyph->bitmap.rows;
+    const size_t size = (size_t)w * h;
+    if (job->size_pixels + size > job->capacity_pixels)
+    {
+        size_t new_capacity = job->capacity_pixels ? job->capacity_pixels : 4096;
+        while (new_capacity < job->size_pixels + size)
+        {
+            new_capacity *= 2;
+        }
+        unsigned char* const new_pixels = jfnt_realloc(job->font, job->pixels, new_capacity);
+        if (!new_pixels)
+        {
+            return JFNT_RESULT_BAD_ALLOC;
+        }
+        job->pixels = new_pixels;
+        job->capacity_pixels = new_capacity;
+    }
+    jfnt_copy_bitmap(job->pixels + job->size_pixels, w, &glyph->bitmap, job->font->flip);
+
+    job->glyphs[job->count_glyphs] = (jfnt_glyph)
+            {
+                    .codepoint = c,
+                    .w = w,
+                    .h = h,
+                    .left = (short)glyph->bitmap_left,
+                    .top = (short)glyph->bitmap_top,
+                    .advance_x = glyph->advance.x >> 6,
+                    .advance_y = glyph->advance.y >> 6,
+                    .face = job->source->id,
+            };
+    job->offsets[job->count_glyphs] = job->size_pixels;
+    job->count_glyphs += 1;
+    job->size_pixels += size;
+    return JFNT_RESULT_SUCCESS;
+}
+
+static jfnt_result job_open_face(jfnt_raster_job* job, FT_Library* p_library, FT_Face* p_face)
+{
+    const jfnt_font* const font = job->font;
+    const jfnt_raster_face* const source = job->source;
+    FT_Library library;
+    FT_Error ft_error = FT_Init_FreeType(&library);
+    if (ft_error != FT_Err_Ok)
+    {
+        job->ft_error = ft_error;
+        return JFNT_RESULT_BAD_FT_CALL;
+    }
+    FT_Face face;
+    if (source->mem)
+    {
+        ft_error = FT_New_Memory_Face(library, source->mem, (FT_Long)source->mem_size, source->index, &face);
+    }
+    else
+    {
+        ft_error = FT_New_Face(library, source->path, source->index, &face);
+    }
+    if (ft_error != FT_Err_Ok)
+    {
+        job->ft_error = ft_error;
+        FT_Done_FreeType(library);
+        return JFNT_RESULT_BAD_FT_CALL;
+    }
+    //  Same as the original face, which is either explicitly set to Unicode, or was picked by FreeType by default
+    (void)FT_Select_Charmap(face, FT_ENCODING_UNICODE);
+    jfnt_font_setup_face(font, face);
+    *p_library = library;
+    *p_face = face;
+    return JFNT_RESULT_SUCCESS;
+}
+
+static void* job_run(void* param)
+{
+    jfnt_raster_job* const job = param;
+    FT_Library library = NULL;
+    FT_Face face = job->face;
+    if (!face && (job->result = job_open_face(job, &library, &face)) != JFNT_RESULT_SUCCESS)
+    {
+        return NULL;
+    }
+
+    jfnt_result res = job_reserve(job);
+    for (size_t i = 0; i < job->count && res == JFNT_RESULT_SUCCESS; ++i)
+    {
+        //  Codepoints which map to the same glyph, such as compatibility forms, have it rendered only once
+        const char32_t c = job->codepoints[i];
+        const FT_UInt glyph_index = FT_Get_Char_Index(face, c);
+        raster_seen* const seen = job_find_seen(job, glyph_index);
+        FT_Error ft_res;
+        if (seen->glyph_index != 0)
+        {
+            res = job_share_glyph(job, c, seen->glyph);
+        }
+        else if ((ft_res = jfnt_font_load_glyph(job->font, face, glyph_index)) != FT_Err_Ok)
+        {
+            res = job_add_miss(job, c, ft_res);
+        }
+        else if ((res = job_add_glyph(job, c, face->glyph)) == JFNT_RESULT_SUCCESS)
+        {
+            *seen = (raster_seen){.glyph_index = glyph_index, .glyph = job->count_glyphs - 1};
+        }
+    }
+    job->result = res;
+    jfnt_free(job->font, job->seen);
+    job->seen = NULL;
+
+    if (library)
+    {
+        FT_Done_Face(face);
+        FT_Done_FreeType(library);
+    }
+    return NULL;
+}
+
+jfnt_result jfnt_staged_glyphs_append(const jfnt_font* font, jfnt_staged_glyphs* staged, jfnt_staged_glyphs* src)
+{
+    const unsigned count = staged->count + src->count;
+    const unsigned count_jobs = staged->count_jobs + src->count_jobs;
+    jfnt_glyph* const glyphs = jfnt_realloc(font, staged->glyphs, sizeof(*glyphs) * (count ? count : 1));
+    if (!glyphs)
+    {
+        jfnt_staged_glyphs_release(font, src);
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    staged->glyphs = glyphs;
+    const unsigned char** const pixels = jfnt_realloc(font, staged->pixels, sizeof(*pixels) * (count ? count : 1));
+    if (!pixels)
+    {
+        jfnt_staged_glyphs_release(font, src);
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    staged->pixels = pixels;
+    //  Jobs own the pixels, so they have to be moved over as well
+    jfnt_raster_job* const jobs = jfnt_realloc(font, staged->jobs, sizeof(*jobs) * count_jobs);
+    if (!jobs)
+    {
+        jfnt_staged_glyphs_release(font, src);
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    staged->jobs = jobs;
+    if (src->count)
+    {
+        memcpy(glyphs + staged->count, src->glyphs, sizeof(*glyphs) * src->count);
+        memcpy(pixels + staged->count, src->pixels, sizeof(*pixels) * src->count);
+    }
+    memcpy(jobs + staged->count_jobs, src->jobs, sizeof(*jobs) * src->count_jobs);
+    staged->count = count;
+    staged->count_jobs = count_jobs;
+    src->count_jobs = 0;
+    jfnt_staged_glyphs_release(font, src);
+    return JFNT_RESULT_SUCCESS;
+}
+
+void jfnt_staged_glyphs_release(const jfnt_font* font, jfnt_staged_glyphs* staged)
+{
+    for (unsigned i = 0; i < staged->count_jobs; ++i)
+    {
+        jfnt_raster_job* const job = staged->jobs + i;
+        jfnt_free(font, job->glyphs);
+        jfnt_free(font, job->offsets);
+        jfnt_free(font, job->pixels);
+        jfnt_free(font, job->misses);
+    }
+    jfnt_free(font, staged->jobs);
+    jfnt_free(font, staged->codepoints);
+    jfnt_free(font, staged->pixels);
+    jfnt_free(font, staged->glyphs);
+    *staged = (jfnt_staged_glyphs){0};
+}
+
+//  Codepoints the face has glyphs for, which FT_Get_Next_Char gives in ascending order. They are put in the scratch of
+//  the font.
+static jfnt_result face_codepoints(jfnt_font* font, FT_Face face, size_t* p_count, char32_t** p_codepoints)
+{
+    size_t capacity = face->num_glyphs > 0 ? (size_t)face->num_glyphs : 256;
+    size_t count = 0;
+    char32_t* codepoints = jfnt_arena_alloc(&font->scratch, &font->allocator_callbacks, sizeof(*codepoints) * capacity);
+    if (!codepoints)
+    {
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    FT_UInt glyph_index;
+    for (FT_ULong c = FT_Get_First_Char(face, &glyph_index); glyph_index != 0; c = FT_Get_Next_Char(face, c, &glyph_index))
+    {
+        //  More codepoints than glyphs is possible, since many can map to the same glyph
+        if (count == capacity)
+        {
+            char32_t* const new_codepoints = jfnt_arena_grow(
+                    &font->scratch, &font->allocator_callbacks, codepoints, sizeof(*new_codepoints) * capacity,
+                    sizeof(*new_codepoints) * capacity * 2);
+            if (!new_codepoints)
+            {
+                return JFNT_RESULT_BAD_ALLOC;
+            }
+            capacity *= 2;
+            codepoints = new_codepoints;
+        }
+        codepoints[count] = (char32_t)c;
+        count += 1;
+    }
+    *p_count = count;
+    *p_codepoints = codepoints;
+    return JFNT_RESULT_SUCCESS;
+}
+
+//  Index of the first codepoint which is not less than c
+static size_t lower_bound(size_t count, const char32_t* codepoints, char32_t c)
+{
+    size_t first = 0;
+    while (count)
+    {
+        const size_t half = count / 2;
+        if (codepoints[first + half] < c)
+        {
+            first += half + 1;
+            count -= half + 1;
+        }
+        else
+        {
+            count = half;
+        }
+    }
+    return first;
+}
+
+//  Index of the first codepoint which is greater than c
+static size_t upper_bound(size_t count, const char32_t* codepoints, char32_t c)
+{
+    size_t first = 0;
+    while (count)
+    {
+        const size_t half = count / 2;
+        if (codepoints[first + half] <= c)
+        {
+            first += half + 1;
+            count -= half + 1;
+        }
+        else
+        {
+            count = half;
+        }
+    }
+    return first;
+}
+
+void jfnt_report_unsupported(jfnt_font* font, char32_t first, char32_t last, const char* msg)
+{
+    jfnt_stats_count(font, &font->stats.glyphs_missed, last - first + 1);
+    const jfnt_error_callbacks* const callbacks = &font->error_callbacks;
+    if (callbacks->unsupported_range)
+    {
+        callbacks->unsupported_range(font, first, last, msg, callbacks->char_param);
+    }
+    else if (callbacks->unsupported_char)
+    {
+        for (char32_t c = first; c <= last && c >= first; ++c)
+        {
+            callbacks->unsupported_char(font, c, msg, callbacks->char_param);
+        }
+    }
+}
+
+void jfnt_range_list_destroy(const jfnt_font* font, jfnt_range_list* list)
+{
+    jfnt_free(font, list->ranges);
+    *list = (jfnt_range_list){0};
+}
+
+jfnt_result jfnt_range_list_add(const jfnt_font* font, jfnt_range_list* list, char32_t first, char32_t last)
+{
+    if (list->count == list->capacity)
+    {
+        const unsigned new_capacity = list->capacity ? list->capacity * 2 : 64;
+        jfnt_codepoint_range* const new_ranges = jfnt_realloc(font, list->ranges, sizeof(*new_ranges) * new_capacity);
+        if (!new_ranges)
+        {
+            return JFNT_RESULT_BAD_ALLOC;
+        }
+        list->ranges = new_ranges;
+        list->capacity = new_capacity;
+    }
+    list->ranges[list->count] = (jfnt_codepoint_range){.first = first, .last = last};
+    list->count += 1;
+    return JFNT_RESULT_SUCCESS;
+}
+
+//  Either adds the codepoints to the list of missing ones, or reports them right away if there is no list
+static jfnt_result add_missing(jfnt_font* font, jfnt_range_list* p_missing, char32_t first, char32_t last)
+{
+    if (p_missing)
+    {
+        return jfnt_range_list_add(font, p_missing, first, last);
+    }
+    jfnt_report_unsupported(font, first, last, "Font has no glyph for the codepoints");
+    return JFNT_RESULT_SUCCESS;
+}
+
+//  Intersects the ranges with codepoints of the face, keeping the order of ranges, and passes on the parts of ranges
+//  which the face does not cover to add_missing
+static jfnt_result select_codepoints(
+        jfnt_font* font, FT_Face face, unsigned n_ranges, const jfnt_codepoint_range* ranges, jfnt_range_list* p_missing,
+        size_t* p_count, char32_t** p_codepoints)
+{
+    const jfnt_arena_mark mark = jfnt_arena_get_mark(&font->scratch);
+    size_t n_covered;
+    char32_t* covered;
+    jfnt_result res = face_codepoints(font, face, &n_covered, &covered);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        jfnt_arena_reset(&font->scratch, &font->allocator_callbacks, mark);
+        return res;
+    }
+    size_t count = 0;
+    for (unsigned i_range = 0; i_range < n_ranges; ++i_range)
+    {
+        if (ranges[i_range].first <= ranges[i_range].last)
+        {
+            count += upper_bound(n_covered, covered, ranges[i_range].last) - lower_bound(n_covered, covered, ranges[i_range].first);
+        }
+    }
+    char32_t* const codepoints = jfnt_alloc(font, sizeof(*codepoints) * (count ? count : 1));
+    if (!codepoints)
+    {
+        jfnt_arena_reset(&font->scratch, &font->allocator_callbacks, mark);
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+
+    size_t pos = 0;
+    for (unsigned i_range = 0; i_range < n_ranges && res == JFNT_RESULT_SUCCESS; ++i_range)
+    {
+        const jfnt_codepoint_range range = ranges[i_range];
+        if (range.first > range.last)
+        {
+            continue;
+        }
+        const size_t begin = lower_bound(n_covered, covered, range.first);
+        const size_t end = upper_bound(n_covered, covered, range.last);
+        char32_t next = range.first;
+        for (size_t i = begin; i < end && res == JFNT_RESULT_SUCCESS; ++i)
+        {
+            if (covered[i] != next)
+            {
+                res = add_missing(font, p_missing, next, covered[i] - 1);
+            }
+            codepoints[pos] = covered[i];
+            pos += 1;
+            next = covered[i] + 1;
+        }
+        if (res == JFNT_RESULT_SUCCESS && (begin == end || covered[end - 1] != range.last))
+        {
+            res = add_missing(font, p_missing, next, range.last);
+        }
+    }
+    jfnt_arena_reset(&font->scratch, &font->allocator_callbacks, mark);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        jfnt_free(font, codepoints);
+        return res;
+    }
+    *p_count = count;
+    *p_codepoints = codepoints;
+    return JFNT_RESULT_SUCCESS;
+}
+
+jfnt_result jfnt_rasterize_ranges(
+        jfnt_font* font, const jfnt_raster_face* face, unsigned thread_count, unsigned n_ranges,
+        const jfnt_codepoint_range* ranges, jfnt_range_list* p_missing, jfnt_staged_glyphs* p_out)
+{
+    size_t n_requested;
+    char32_t* codepoints;
+    jfnt_result res = select_codepoints(font, face->face, n_ranges, ranges, p_missing, &n_requested, &codepoints);
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        return res;
+    }
+    unsigned n_jobs = thread_count ? thread_count : 1;
+    if (n_jobs > n_requested)
+    {
+        n_jobs = n_requested ? (unsigned)n_requested : 1;
+    }
+
+    jfnt_staged_glyphs staged = {.codepoints = codepoints, .count_jobs = n_jobs, .jobs = jfnt_alloc(font, sizeof(*staged.jobs) * n_jobs)};
+    if (!staged.jobs)
+    {
+        jfnt_free(font, codepoints);
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    for (unsigned i = 0; i < n_jobs; ++i)
+    {
+        const size_t first = n_requested * i / n_jobs;
+        const size_t last = n_requested * (i + 1) / n_jobs;
+        staged.jobs[i] = (jfnt_raster_job)
+                {
+                        .font = font,
+                        .source = face,
+                        //  The first job runs on the calling thread, so it can use the face which is already open
+                        .face = i == 0 ? face->face : NULL,
+                        .codepoints = codepoints + first,
+                        .count = last - first,
+                        .result = JFNT_RESULT_SUCCESS,
+                };
+    }
+
+    const jfnt_arena_mark mark = jfnt_arena_get_mark(&font->scratch);
+    pthread_t* const threads = n_jobs > 1 ? jfnt_arena_alloc(&font->scratch, &font->allocator_callbacks, sizeof(*threads) * (n_jobs - 1)) : NULL;
+    if (n_jobs > 1 && !threads)
+    {
+        jfnt_staged_glyphs_release(font, &staged);
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    unsigned n_started = 1;
+    for (; n_started < n_jobs; ++n_started)
+    {
+        if (pthread_create(threads + n_started - 1, NULL, job_run, staged.jobs + n_started) != 0)
+        {
+            JFNT_ERROR(font, "Could not create a worker thread, running job %u on the calling thread", n_started);
+            break;
+        }
+    }
+    //  Jobs that could not be given their own thread are done on this one
+    job_run(staged.jobs + 0);
+    for (unsigned i = n_started; i < n_jobs; ++i)
+    {
+        job_run(staged.jobs + i);
+    }
+    for (unsigned i = 1; i < n_started; ++i)
+    {
+        pthread_join(threads[i - 1], NULL);
+    }
+    jfnt_arena_reset(&font->scratch, &font->allocator_callbacks, mark);
+
+    unsigned n_glyphs = 0;
+    for (unsigned i = 0; i < n_jobs; ++i)
+    {
+        const jfnt_raster_job* const job = staged.jobs + i;
+        if (job->result != JFNT_RESULT_SUCCESS && res == JFNT_RESULT_SUCCESS)
+        {
+            res = job->result;
+            if (res == JFNT_RESULT_BAD_FT_CALL)
+            {
+                JFNT_ERROR(font, "Worker %u could not open the face, reason: %s", i, FT_Error_String(job->ft_error));
+            }
+        }
+        n_glyphs += job->count_glyphs;
+    }
+    if (res != JFNT_RESULT_SUCCESS)
+    {
+        jfnt_staged_glyphs_release(font, &staged);
+        return res;
+    }
+
+    //  Report codepoints which failed to load in order, from this thread
+    for (unsigned i = 0; i < n_jobs; ++i)
+    {
+        const jfnt_raster_job* const job = staged.jobs + i;
+        for (unsigned j = 0; j < job->count_misses; ++j)
+        {
+            jfnt_report_unsupported(font, job->misses[j].codepoint, job->misses[j].codepoint, FT_Error_String(job->misses[j].error));
+        }
+    }
+
+    staged.glyphs = jfnt_alloc(font, sizeof(*staged.glyphs) * (n_glyphs ? n_glyphs : 1));
+    staged.pixels = jfnt_alloc(font, sizeof(*staged.pixels) * (n_glyphs ? n_glyphs : 1));
+    if (!staged.glyphs || !staged.pixels)
+    {
+        jfnt_staged_glyphs_release(font, &staged);
+        return JFNT_RESULT_BAD_ALLOC;
+    }
+    unsigned pos = 0;
+    for (unsigned i = 0; i < n_jobs; ++i)
+    {
+        const jfnt_raster_job* const job = staged.jobs + i;
+        if (job->count_glyphs)
+        {
+            memcpy(staged.glyphs + pos, job->glyphs, sizeof(*job->glyphs) * job->count_glyphs);
+        }
+        for (unsigned j = 0; j < job->count_glyphs; ++j)
+        {
+            staged.pixels[pos + j] = job->pixels + job->offsets[j];
+        }
+        pos += job->count_glyphs;
+    }
+    staged.count = n_glyphs;
+
+    *p_out = staged;
+    return JFNT_RESULT_SUCCESS;
+}
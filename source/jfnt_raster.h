@@ -0,0 +1,67 @@
+//
+// Created by jan on 17.10.2026.
+//
+
+#ifndef JFNT_JFNT_RASTER_H
+#define JFNT_JFNT_RASTER_H
+#include "jfnt_font_internal.h"
+
+typedef struct jfnt_raster_job_T jfnt_raster_job;
+
+//  Face to render glyphs from. Worker threads open their own copy of it from memory when it is set, which is the mapping
+//  of the file for faces the context could map, otherwise from the file.
+struct jfnt_raster_face_T
+{
+    FT_Face face;
+    const char* path;
+    const void* mem;
+    size_t mem_size;
+    int index;
+    unsigned short id;      //  Position of the face in the fallback chain of the font, which each glyph records
+};
+typedef struct jfnt_raster_face_T jfnt_raster_face;
+
+//  Growing list of codepoint ranges
+struct jfnt_range_list_T
+{
+    unsigned count;
+    unsigned capacity;
+    jfnt_codepoint_range* ranges;
+};
+typedef struct jfnt_range_list_T jfnt_range_list;
+
+//  Glyphs rendered into a staging area before they are packed into the atlas
+struct jfnt_staged_glyphs_T
+{
+    unsigned count;
+    jfnt_glyph* glyphs;             //  Metrics of loaded glyphs, in the same order as their codepoints were requested
+    const unsigned char** pixels;   //  Tightly packed w x h pixels of each glyph, already flipped if the font is
+    char32_t* codepoints;           //  Requested codepoints which the face covers, split between jobs
+    unsigned count_jobs;
+    jfnt_raster_job* jobs;          //  Owns the memory of pixels
+};
+typedef struct jfnt_staged_glyphs_T jfnt_staged_glyphs;
+
+//  Renders all codepoints in the ranges which the face has in its character map, so that only those are ever loaded.
+//  With thread_count above 1 the codepoints are split into contiguous parts, with each worker opening its own library
+//  and face. Results are merged in the order of codepoints, so they are identical regardless of the number of threads.
+//  Codepoints the face has no glyphs for are appended to p_missing, so that they can be tried with another face, or when
+//  it is NULL, reported from the calling thread, as whole ranges where the callback for that is set.
+jfnt_result jfnt_rasterize_ranges(
+        jfnt_font* font, const jfnt_raster_face* face, unsigned thread_count, unsigned n_ranges,
+        const jfnt_codepoint_range* ranges, jfnt_range_list* p_missing, jfnt_staged_glyphs* p_out);
+
+//  Moves glyphs staged from another face to the end of staged glyphs, releasing what is left of src
+jfnt_result jfnt_staged_glyphs_append(const jfnt_font* font, jfnt_staged_glyphs* staged, jfnt_staged_glyphs* src);
+
+//  Releases the staging memory. Glyph array is released as well, unless it was taken by setting it to NULL.
+void jfnt_staged_glyphs_release(const jfnt_font* font, jfnt_staged_glyphs* staged);
+
+//  Reports codepoints from first to last to the error callbacks of the font as unsupported
+void jfnt_report_unsupported(jfnt_font* font, char32_t first, char32_t last, const char* msg);
+
+jfnt_result jfnt_range_list_add(const jfnt_font* font, jfnt_range_list* list, char32_t first, char32_t last);
+
+void jfnt_range_list_destroy(const jfnt_font* font, jfnt_range_list* list);
+
+#endif //JFNT_JFNT_RASTER_H
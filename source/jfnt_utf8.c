@@ -0,0 +1,421 @@
+//
+// Created by jan on 17.10.2026.
+//
+
+#include "jfnt_utf8.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+    #define JFNT_UTF8_X86
+    #include <immintrin.h>
+#endif
+
+static const char* const STATUS_MESSAGES[] =
+        {
+                [JFNT_UTF8_OK] = "Success",
+                [JFNT_UTF8_TRUNCATED] = "Input ends in the middle of a sequence",
+                [JFNT_UTF8_BAD_LEAD] = "Byte can not begin a sequence",
+                [JFNT_UTF8_BAD_CONTINUATION] = "Continuation byte was expected",
+                [JFNT_UTF8_OVERLONG] = "Codepoint is encoded with more bytes than needed (overlong encoding)",
+                [JFNT_UTF8_SURROGATE] = "Codepoint is a UTF-16 surrogate",
+                [JFNT_UTF8_TOO_LARGE] = "Codepoint is above U+10FFFF",
+        };
+
+const char* jfnt_utf8_status_message(jfnt_utf8_status status)
+{
+    if (status < JFNT_UTF8_OK || status > JFNT_UTF8_TOO_LARGE)
+        return "Invalid";
+    return STATUS_MESSAGES[status];
+}
+
+//  Decodes a single sequence which begins with a non-ASCII byte, checking everything the SIMD kernels reject
+static jfnt_utf8_status decode_one(const unsigned char* src, size_t size, char32_t* p_c, unsigned* p_len)
+{
+    const unsigned lead = src[0];
+    unsigned len;
+    char32_t c;
+    char32_t min;
+    if (lead < 0xC0)
+    {
+        return JFNT_UTF8_BAD_LEAD;
+    }
+    else if (lead < 0xC2)
+    {
+        //  Would always decode below U+0080
+        return JFNT_UTF8_OVERLONG;
+    }
+    else if (lead < 0xE0)
+    {
+        len = 2;
+        c = lead & 0x1F;
+        min = 0x80;
+    }
+    else if (lead < 0xF0)
+    {
+        len = 3;
+        c = lead & 0x0F;
+        min = 0x800;
+    }
+    else if (lead < 0xF5)
+    {
+        len = 4;
+        c = lead & 0x07;
+        min = 0x10000;
+    }
+    else if (lead < 0xF8)
+    {
+        //  Would always decode above U+10FFFF
+        return JFNT_UTF8_TOO_LARGE;
+    }
+    else
+    {
+        return JFNT_UTF8_BAD_LEAD;
+    }
+
+    for (unsigned i = 1; i < len; ++i)
+    {
+        if (i >= size)
+        {
+            return JFNT_UTF8_TRUNCATED;
+        }
+        const unsigned b = src[i];
+        if ((b & 0xC0) != 0x80)
+        {
+            return JFNT_UTF8_BAD_CONTINUATION;
+        }
+        c = (c << 6) | (b & 0x3F);
+    }
+    if (c < min)
+    {
+        return JFNT_UTF8_OVERLONG;
+    }
+    if (c >= 0xD800 && c <= 0xDFFF)
+    {
+        return JFNT_UTF8_SURROGATE;
+    }
+    if (c > 0x10FFFF)
+    {
+        return JFNT_UTF8_TOO_LARGE;
+    }
+    *p_c = c;
+    *p_len = len;
+    return JFNT_UTF8_OK;
+}
+
+static jfnt_utf8_status decode_scalar(
+        const unsigned char* src, size_t size, char32_t* out, size_t max_out, size_t* p_consumed, size_t* p_written)
+{
+    jfnt_utf8_status status = JFNT_UTF8_OK;
+    size_t i = 0;
+    size_t o = 0;
+    while (i < size && o < max_out)
+    {
+        if (src[i] < 0x80)
+        {
+            out[o] = src[i];
+            i += 1;
+            o += 1;
+            continue;
+        }
+        unsigned len;
+        if ((status = decode_one(src + i, size - i, out + o, &len)) != JFNT_UTF8_OK)
+        {
+            break;
+        }
+        i += len;
+        o += 1;
+    }
+    *p_consumed = i;
+    *p_written = o;
+    return status;
+}
+
+#ifdef JFNT_UTF8_X86
+//  Each of the kernels decodes a block of sequences of the same length. They write out a full block of codepoints, but
+//  only return how many of the leading ones are valid, so that a run of them can end anywhere in the block. Anything
+//  they do not accept is left to decode_one, which also figures out what is wrong with it.
+
+//  Writes 16 codepoints, returns the number of leading ASCII bytes
+static unsigned sse2_ascii(const unsigned char* src, char32_t* out)
+{
+    const __m128i v = _mm_loadu_si128((const __m128i*)src);
+    const unsigned non_ascii = (unsigned)_mm_movemask_epi8(v);
+    const unsigned n = (unsigned)__builtin_ctz(non_ascii | 0x10000);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lo = _mm_unpacklo_epi8(v, zero);
+    _mm_storeu_si128((__m128i*)(out + 0), _mm_unpacklo_epi16(lo, zero));
+    _mm_storeu_si128((__m128i*)(out + 4), _mm_unpackhi_epi16(lo, zero));
+    //  Short runs are common in mixed text, so the second half is only written when needed
+    if (n > 8)
+    {
+        const __m128i hi = _mm_unpackhi_epi8(v, zero);
+        _mm_storeu_si128((__m128i*)(out + 8), _mm_unpacklo_epi16(hi, zero));
+        _mm_storeu_si128((__m128i*)(out + 12), _mm_unpackhi_epi16(hi, zero));
+    }
+    return n;
+}
+
+//  Writes 8 codepoints, returns the number of leading valid two byte sequences
+static unsigned sse2_two_byte(const unsigned char* src, char32_t* out)
+{
+    const __m128i v = _mm_loadu_si128((const __m128i*)src);
+    //  Each 16-bit lane holds one sequence, with the lead byte in the low half
+    const __m128i pattern = _mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short)0xC0E0)), _mm_set1_epi16((short)0x80C0));
+    //  Lead bytes 0xC0 and 0xC1 are overlong
+    const __m128i overlong = _mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16(0x001E)), _mm_setzero_si128());
+    const unsigned valid = (unsigned)_mm_movemask_epi8(_mm_andnot_si128(overlong, pattern));
+    const __m128i c = _mm_or_si128(
+            _mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi16(0x1F)), 6),
+            _mm_and_si128(_mm_srli_epi16(v, 8), _mm_set1_epi16(0x3F)));
+    const __m128i zero = _mm_setzero_si128();
+    _mm_storeu_si128((__m128i*)(out + 0), _mm_unpacklo_epi16(c, zero));
+    _mm_storeu_si128((__m128i*)(out + 4), _mm_unpackhi_epi16(c, zero));
+    return (unsigned)__builtin_ctz(~valid) / 2;
+}
+
+//  Writes 4 codepoints, returns the number of leading valid four byte sequences
+static unsigned sse2_four_byte(const unsigned char* src, char32_t* out)
+{
+    const __m128i v = _mm_loadu_si128((const __m128i*)src);
+    const __m128i pattern = _mm_cmpeq_epi32(_mm_and_si128(v, _mm_set1_epi32((int)0xC0C0C0F8)), _mm_set1_epi32((int)0x808080F0));
+    const __m128i c = _mm_or_si128(
+            _mm_or_si128(
+                    _mm_slli_epi32(_mm_and_si128(v, _mm_set1_epi32(0x07)), 18),
+                    _mm_slli_epi32(_mm_and_si128(v, _mm_set1_epi32(0x3F00)), 4)),
+            _mm_or_si128(
+                    _mm_srli_epi32(_mm_and_si128(v, _mm_set1_epi32(0x3F0000)), 10),
+                    _mm_and_si128(_mm_srli_epi32(v, 24), _mm_set1_epi32(0x3F))));
+    const __m128i in_range = _mm_and_si128(
+            _mm_cmpgt_epi32(c, _mm_set1_epi32(0xFFFF)), _mm_cmplt_epi32(c, _mm_set1_epi32(0x110000)));
+    const unsigned valid = (unsigned)_mm_movemask_ps(_mm_castsi128_ps(_mm_and_si128(pattern, in_range)));
+    _mm_storeu_si128((__m128i*)out, c);
+    return (unsigned)__builtin_ctz(~valid);
+}
+
+static jfnt_utf8_status decode_sse2(
+        const unsigned char* src, size_t size, char32_t* out, size_t max_out, size_t* p_consumed, size_t* p_written)
+{
+    size_t i = 0;
+    size_t o = 0;
+    while (size - i >= 16 && max_out - o >= 16)
+    {
+        const unsigned lead = src[i];
+        unsigned n;
+        //  Kernels are only worth it if the next sequence is of the same length as well
+        if (lead < 0x80)
+        {
+            if (src[i + 1] >= 0x80)
+            {
+                out[o] = lead;
+                i += 1;
+                o += 1;
+                continue;
+            }
+            n = sse2_ascii(src + i, out + o);
+            i += n;
+            o += n;
+            continue;
+        }
+        else if (lead < 0xE0)
+        {
+            if ((src[i + 2] & 0xE0) == 0xC0 && (n = sse2_two_byte(src + i, out + o)))
+            {
+                i += 2 * n;
+                o += n;
+                continue;
+            }
+        }
+        else if (lead < 0xF0)
+        {
+            //  There is no SSE2 kernel for three byte sequences, and going through the checks above for each of them
+            //  is slower than decoding them with the scalar decoder, so a run of them is decoded in one go instead
+            do
+            {
+                const jfnt_utf8_status status = decode_one(src + i, size - i, out + o, &n);
+                if (status != JFNT_UTF8_OK)
+                {
+                    *p_consumed = i;
+                    *p_written = o;
+                    return status;
+                }
+                i += n;
+                o += 1;
+            } while (size - i >= 16 && max_out - o >= 16 && (src[i] & 0xF0) == 0xE0);
+            continue;
+        }
+        else
+        {
+            if ((src[i + 4] & 0xF8) == 0xF0 && (n = sse2_four_byte(src + i, out + o)))
+            {
+                i += 4 * n;
+                o += n;
+                continue;
+            }
+        }
+        const jfnt_utf8_status status = decode_one(src + i, size - i, out + o, &n);
+        if (status != JFNT_UTF8_OK)
+        {
+            *p_consumed = i;
+            *p_written = o;
+            return status;
+        }
+        i += n;
+        o += 1;
+    }
+    size_t consumed, written;
+    const jfnt_utf8_status status = decode_scalar(src + i, size - i, out + o, max_out - o, &consumed, &written);
+    *p_consumed = i + consumed;
+    *p_written = o + written;
+    return status;
+}
+
+//  Writes 32 codepoints, returns the number of leading ASCII bytes
+__attribute__((target("avx2")))
+static unsigned avx2_ascii(const unsigned char* src, char32_t* out)
+{
+    const __m256i v = _mm256_loadu_si256((const __m256i*)src);
+    const unsigned non_ascii = (unsigned)_mm256_movemask_epi8(v);
+    const unsigned n = non_ascii ? (unsigned)__builtin_ctz(non_ascii) : 32;
+    //  Short runs are common in mixed text, so the second half is only written when needed
+    _mm256_storeu_si256((__m256i*)(out + 0), _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + 0))));
+    _mm256_storeu_si256((__m256i*)(out + 8), _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + 8))));
+    if (n > 16)
+    {
+        _mm256_storeu_si256((__m256i*)(out + 16), _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + 16))));
+        _mm256_storeu_si256((__m256i*)(out + 24), _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + 24))));
+    }
+    return n;
+}
+
+//  Writes 8 codepoints, returns the number of leading valid three byte sequences. Reads 28 bytes.
+__attribute__((target("avx2")))
+static unsigned avx2_three_byte(const unsigned char* src, char32_t* out)
+{
+    //  Sequences 0-3 go into the low lane and 4-7 into the high one, then each gets spread over a 32-bit element
+    const __m256i v = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)src)),
+            _mm_loadu_si128((const __m128i*)(src + 12)), 1);
+    const __m256i spread = _mm256_setr_epi8(
+            0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+            0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i x = _mm256_shuffle_epi8(v, spread);
+    const __m256i pattern = _mm256_cmpeq_epi32(_mm256_and_si256(x, _mm256_set1_epi32(0xC0C0F0)), _mm256_set1_epi32(0x8080E0));
+    const __m256i c = _mm256_or_si256(
+            _mm256_or_si256(
+                    _mm256_slli_epi32(_mm256_and_si256(x, _mm256_set1_epi32(0x0F)), 12),
+                    _mm256_srli_epi32(_mm256_and_si256(x, _mm256_set1_epi32(0x3F00)), 2)),
+            _mm256_and_si256(_mm256_srli_epi32(x, 16), _mm256_set1_epi32(0x3F)));
+    const __m256i not_overlong = _mm256_cmpgt_epi32(c, _mm256_set1_epi32(0x7FF));
+    const __m256i surrogate = _mm256_cmpeq_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0xF800)), _mm256_set1_epi32(0xD800));
+    const unsigned valid = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_andnot_si256(surrogate, _mm256_and_si256(pattern, not_overlong))));
+    _mm256_storeu_si256((__m256i*)out, c);
+    return (unsigned)__builtin_ctz(~valid);
+}
+
+__attribute__((target("avx2")))
+static jfnt_utf8_status decode_avx2(
+        const unsigned char* src, size_t size, char32_t* out, size_t max_out, size_t* p_consumed, size_t* p_written)
+{
+    size_t i = 0;
+    size_t o = 0;
+    while (size - i >= 32 && max_out - o >= 32)
+    {
+        const unsigned lead = src[i];
+        unsigned n;
+        //  Kernels are only worth it if the next sequence is of the same length as well. Runs of two and four byte
+        //  sequences in real text are short, so the narrower kernels do better for them.
+        if (lead < 0x80)
+        {
+            if (src[i + 1] >= 0x80)
+            {
+                out[o] = lead;
+                i += 1;
+                o += 1;
+                continue;
+            }
+            n = avx2_ascii(src + i, out + o);
+            i += n;
+            o += n;
+            continue;
+        }
+        else if (lead < 0xE0)
+        {
+            if ((src[i + 2] & 0xE0) == 0xC0 && (n = sse2_two_byte(src + i, out + o)))
+            {
+                i += 2 * n;
+                o += n;
+                continue;
+            }
+        }
+        else if (lead < 0xF0)
+        {
+            if ((src[i + 3] & 0xF0) == 0xE0 && (n = avx2_three_byte(src + i, out + o)))
+            {
+                i += 3 * n;
+                o += n;
+                continue;
+            }
+        }
+        else
+        {
+            if ((src[i + 4] & 0xF8) == 0xF0 && (n = sse2_four_byte(src + i, out + o)))
+            {
+                i += 4 * n;
+                o += n;
+                continue;
+            }
+        }
+        const jfnt_utf8_status status = decode_one(src + i, size - i, out + o, &n);
+        if (status != JFNT_UTF8_OK)
+        {
+            *p_consumed = i;
+            *p_written = o;
+            return status;
+        }
+        i += n;
+        o += 1;
+    }
+    //  Rest is too short for full blocks
+    size_t consumed, written;
+    const jfnt_utf8_status status = decode_sse2(src + i, size - i, out + o, max_out - o, &consumed, &written);
+    *p_consumed = i + consumed;
+    *p_written = o + written;
+    return status;
+}
+#endif
+
+jfnt_utf8_isa jfnt_utf8_best_isa(void)
+{
+#ifdef JFNT_UTF8_X86
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return JFNT_UTF8_ISA_AVX2;
+    }
+    //  Part of the x86-64 baseline, and required for this to be defined on 32-bit x86
+    return JFNT_UTF8_ISA_SSE2;
+#else
+    return JFNT_UTF8_ISA_SCALAR;
+#endif
+}
+
+jfnt_utf8_status jfnt_utf8_decode_isa(
+        jfnt_utf8_isa isa, const unsigned char* src, size_t size, char32_t* out, size_t max_out, size_t* p_consumed,
+        size_t* p_written)
+{
+    switch (isa)
+    {
+#ifdef JFNT_UTF8_X86
+    case JFNT_UTF8_ISA_AVX2:
+        return decode_avx2(src, size, out, max_out, p_consumed, p_written);
+    case JFNT_UTF8_ISA_SSE2:
+        return decode_sse2(src, size, out, max_out, p_consumed, p_written);
+#endif
+    default:
+        return decode_scalar(src, size, out, max_out, p_consumed, p_written);
+    }
+}
+
+jfnt_utf8_status jfnt_utf8_decode(
+        const unsigned char* src, size_t size, char32_t* out, size_t max_out, size_t* p_consumed, size_t* p_written)
+{
+    return jfnt_utf8_decode_isa(jfnt_utf8_best_isa(), src, size, out, max_out, p_consumed, p_written);
+}
@@ -0,0 +1,46 @@
+//
+// Created by jan on 17.10.2026.
+//
+
+#ifndef JFNT_JFNT_UTF8_H
+#define JFNT_JFNT_UTF8_H
+#include <stddef.h>
+#include <uchar.h>
+
+enum jfnt_utf8_status_T
+{
+    JFNT_UTF8_OK = 0,               //  All input was decoded, or the output was filled up
+    JFNT_UTF8_TRUNCATED,            //  Input ends in the middle of a sequence
+    JFNT_UTF8_BAD_LEAD,             //  Byte can not begin a sequence
+    JFNT_UTF8_BAD_CONTINUATION,     //  Sequence is cut short by a byte which is not a continuation byte
+    JFNT_UTF8_OVERLONG,             //  Codepoint is encoded with more bytes than needed
+    JFNT_UTF8_SURROGATE,            //  Codepoint is in the range U+D800 to U+DFFF
+    JFNT_UTF8_TOO_LARGE,            //  Codepoint is above U+10FFFF
+};
+typedef enum jfnt_utf8_status_T jfnt_utf8_status;
+
+//  Instruction sets the decoder has an implementation for
+enum jfnt_utf8_isa_T
+{
+    JFNT_UTF8_ISA_SCALAR,
+    JFNT_UTF8_ISA_SSE2,
+    JFNT_UTF8_ISA_AVX2,
+};
+typedef enum jfnt_utf8_isa_T jfnt_utf8_isa;
+
+const char* jfnt_utf8_status_message(jfnt_utf8_status status);
+
+//  Best instruction set supported by both the build and the CPU it runs on
+jfnt_utf8_isa jfnt_utf8_best_isa(void);
+
+//  Decodes and validates at most max_out codepoints from size bytes of src. Decoding stops at the first sequence which
+//  is invalid or incomplete, in which case its offset is returned through p_consumed.
+jfnt_utf8_status jfnt_utf8_decode(
+        const unsigned char* src, size_t size, char32_t* out, size_t max_out, size_t* p_consumed, size_t* p_written);
+
+//  Same as jfnt_utf8_decode, but with an explicitly chosen implementation, which must be supported
+jfnt_utf8_status jfnt_utf8_decode_isa(
+        jfnt_utf8_isa isa, const unsigned char* src, size_t size, char32_t* out, size_t max_out, size_t* p_consumed,
+        size_t* p_written);
+
+#endif //JFNT_JFNT_UTF8_H
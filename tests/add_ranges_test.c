@@ -0,0 +1,146 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt_font.h"
+#include <string.h>
+
+static const jfnt_codepoint_range FIRST_RANGES[] = {{.first = 0x20, .last = 0x7E}};
+static const jfnt_codepoint_range MORE_RANGES[] = {{.first = 0x400, .last = 0x4FF}, {.first = 0x20, .last = 0x17F}, {.first = 0x410, .last = 0x42F}};
+static const jfnt_codepoint_range ALL_RANGES[] = {{.first = 0x20, .last = 0x17F}, {.first = 0x400, .last = 0x4FF}};
+
+static jfnt_font* create_font(unsigned n_ranges, const jfnt_codepoint_range* ranges, int lazy)
+{
+    const jfnt_font_create_info create_info =
+            {
+                    .n_ranges = n_ranges,
+                    .codepoint_ranges = ranges,
+                    .flip = 1,
+                    .atlas_padding = 1,
+                    .lazy = lazy,
+                    .thread_count = 2,
+            };
+    return test_create_font("DejaVu Sans Mono:size=16", create_info, JFNT_RESULT_SUCCESS);
+}
+
+static int rect_contains(unsigned count, const jfnt_atlas_rect* rects, const jfnt_glyph* g)
+{
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (rects[i].x <= g->offset_x && g->offset_x + g->w <= rects[i].x + rects[i].w &&
+            rects[i].y <= g->offset_y && g->offset_y + g->h <= rects[i].y + rects[i].h)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int same_pixels(const jfnt_font* a, const jfnt_glyph* ga, const jfnt_font* b, const jfnt_glyph* gb)
+{
+    unsigned wa, ha, wb, hb;
+    const unsigned char* da, * db;
+    jfnt_font_image(a, &wa, &ha, &da);
+    jfnt_font_image(b, &wb, &hb, &db);
+    for (unsigned row = 0; row < ga->h; ++row)
+    {
+        if (memcmp(da + (size_t)(ga->offset_y + row) * wa + ga->offset_x, db + (size_t)(gb->offset_y + row) * wb + gb->offset_x, ga->w) != 0)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+//  Adds more ranges to the font and checks the new glyphs against those of a font created with all of them at once
+static void check_add(jfnt_font* font, const jfnt_font* reference)
+{
+    const unsigned old_count = jfnt_font_get_glyph_count(font);
+    jfnt_glyph* const old_glyphs = malloc(sizeof(*old_glyphs) * (old_count ? old_count : 1));
+    ASSERT(old_glyphs);
+    memcpy(old_glyphs, jfnt_font_get_glyphs(font), sizeof(*old_glyphs) * old_count);
+    unsigned old_w, old_h;
+    const unsigned char* img;
+    jfnt_font_image(font, &old_w, &old_h, &img);
+    unsigned char* const old_img = malloc((size_t)old_w * old_h);
+    ASSERT(old_img);
+    memcpy(old_img, img, (size_t)old_w * old_h);
+
+    unsigned count_rects;
+    const jfnt_atlas_rect* rects;
+    JFNT_TEST_CALL(jfnt_font_add_ranges(font, sizeof(MORE_RANGES) / sizeof(*MORE_RANGES), MORE_RANGES, &count_rects, &rects), JFNT_RESULT_SUCCESS);
+    const unsigned count = jfnt_font_get_glyph_count(font);
+    const jfnt_glyph* const glyphs = jfnt_font_get_glyphs(font);
+    printf("Added %u glyphs, %u rectangles to upload\n", count - old_count, count_rects);
+    ASSERT(count == jfnt_font_get_glyph_count(reference));
+    ASSERT(count_rects > 0 && count_rects <= count - old_count);
+
+    //  Old glyphs stay where they were, and so do their pixels
+    ASSERT(memcmp(glyphs, old_glyphs, sizeof(*old_glyphs) * old_count) == 0);
+    unsigned w, h;
+    jfnt_font_image(font, &w, &h, &img);
+    ASSERT(w == old_w && h >= old_h);
+    size_t outside = 0;
+    for (unsigned y = 0; y < old_h; ++y)
+    {
+        for (unsigned x = 0; x < w; ++x)
+        {
+            int dirty = 0;
+            for (unsigned i = 0; i < count_rects && !dirty; ++i)
+            {
+                dirty = rects[i].x <= x && x < rects[i].x + rects[i].w && rects[i].y <= y && y < rects[i].y + rects[i].h;
+            }
+            if (!dirty)
+            {
+                outside += img[(size_t)y * w + x] != old_img[(size_t)y * w + x];
+            }
+        }
+    }
+    ASSERT(outside == 0);
+
+    //  New glyphs are all in the dirty rectangles, and look the same as in the reference
+    for (unsigned i = old_count; i < count; ++i)
+    {
+        const jfnt_glyph* const g = glyphs + i;
+        int idx;
+        JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(font, '?', 1, &g->codepoint, &idx), JFNT_RESULT_SUCCESS);
+        ASSERT(idx == (int)i);
+        JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(reference, '?', 1, &g->codepoint, &idx), JFNT_RESULT_SUCCESS);
+        const jfnt_glyph* const ref = jfnt_font_get_glyphs(reference) + idx;
+        ASSERT(ref->codepoint == g->codepoint && ref->w == g->w && ref->h == g->h && ref->advance_x == g->advance_x);
+        ASSERT(!g->w || !g->h || rect_contains(count_rects, rects, g));
+        ASSERT(same_pixels(font, g, reference, ref));
+    }
+
+    //  Kerning is known for pairs with the new glyphs
+    ASSERT(jfnt_font_get_kerning_pair_count(font) >= jfnt_font_get_kerning_pair_count(reference));
+
+    //  Nothing is added twice
+    JFNT_TEST_CALL(jfnt_font_add_ranges(font, sizeof(ALL_RANGES) / sizeof(*ALL_RANGES), ALL_RANGES, &count_rects, &rects), JFNT_RESULT_SUCCESS);
+    ASSERT(count_rects == 0);
+    ASSERT(jfnt_font_get_glyph_count(font) == count);
+
+    free(old_img);
+    free(old_glyphs);
+}
+
+int main()
+{
+    jfnt_font* const reference = create_font(sizeof(ALL_RANGES) / sizeof(*ALL_RANGES), ALL_RANGES, 0);
+
+    jfnt_font* const font = create_font(sizeof(FIRST_RANGES) / sizeof(*FIRST_RANGES), FIRST_RANGES, 0);
+    check_add(font, reference);
+    ASSERT(jfnt_font_get_kerning_pair_count(font) == jfnt_font_get_kerning_pair_count(reference));
+    jfnt_font_destroy(font);
+
+    jfnt_font* const lazy = create_font(sizeof(FIRST_RANGES) / sizeof(*FIRST_RANGES), FIRST_RANGES, 1);
+    unsigned first, count;
+    jfnt_font_take_new_glyphs(lazy, &first, &count);
+    check_add(lazy, reference);
+    jfnt_font_take_new_glyphs(lazy, &first, &count);
+    ASSERT(first + count == jfnt_font_get_glyph_count(reference));
+    jfnt_font_destroy(lazy);
+
+    jfnt_font_destroy(reference);
+    return 0;
+}
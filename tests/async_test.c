@@ -0,0 +1,154 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt_async.h"
+#include <sched.h>
+
+static const jfnt_codepoint_range PREVIEW_RANGES[] = {{.first = 0x20, .last = 0x7E}};
+static const jfnt_codepoint_range RANGES[] = {{.first = 0x20, .last = 0x52F}, {.first = 0x1E00, .last = 0x22FF}};
+
+//  States the callback was called with, in order
+struct calls_T
+{
+    unsigned count;
+    jfnt_font_job_state states[4];
+    unsigned preview_glyphs;
+    int hold;       //  Worker stays in the preview callback while this is set
+};
+
+static void job_callback(jfnt_font_job* job, jfnt_font_job_state state, void* param)
+{
+    struct calls_T* const calls = param;
+    ASSERT(calls->count < 4);
+    calls->states[calls->count] = state;
+    __atomic_fetch_add(&calls->count, 1, __ATOMIC_RELEASE);
+    if (state == JFNT_FONT_JOB_PREVIEW_READY)
+    {
+        //  Preview can be used right away from the callback
+        jfnt_font* preview;
+        JFNT_TEST_CALL(jfnt_font_job_take_preview(job, &preview), JFNT_RESULT_SUCCESS);
+        calls->preview_glyphs = jfnt_font_get_glyph_count(preview);
+        jfnt_font_destroy(preview);
+        while (__atomic_load_n(&calls->hold, __ATOMIC_ACQUIRE))
+        {
+            sched_yield();
+        }
+    }
+}
+
+static jfnt_result queue_job(
+        jfnt_worker_pool* pool, test_allocator* counts, const char* fc_str, const char* filename, int preview,
+        struct calls_T* calls, jfnt_font_job** p_job)
+{
+    //  Fonts are created on workers, and counts are shared by all of them
+    const jfnt_allocator_callbacks allocator = test_allocator_callbacks(counts);
+    const jfnt_error_callbacks callbacks = {.report = test_report_callback};
+    //  Everything the info points to is copied, so it can be on the stack
+    const jfnt_font_job_info info =
+            {
+                    .fc_str = fc_str,
+                    .filename = filename,
+                    .char_size = 16 * 64,
+                    .create_info =
+                            {
+                                    .allocator_callbacks = &allocator,
+                                    .error_callbacks = &callbacks,
+                                    .n_ranges = 2,
+                                    .codepoint_ranges = RANGES,
+                                    .atlas_padding = 1,
+                            },
+                    .n_preview_ranges = preview ? 1 : 0,
+                    .preview_ranges = PREVIEW_RANGES,
+                    .callback = calls ? job_callback : NULL,
+                    .callback_param = calls,
+            };
+    return jfnt_font_create_async(pool, &info, p_job);
+}
+
+static void check_font(const jfnt_font* font, char32_t c)
+{
+    int idx;
+    JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(font, 0, 1, &c, &idx), JFNT_RESULT_SUCCESS);
+    ASSERT(jfnt_font_get_glyphs(font)[idx].codepoint == c);
+}
+
+int main()
+{
+    test_allocator pool_counts = {0};
+    test_allocator counts = {0};
+    const jfnt_allocator_callbacks pool_allocator = test_allocator_callbacks(&pool_counts);
+    jfnt_worker_pool* pool;
+    JFNT_TEST_CALL(jfnt_worker_pool_create(&pool_allocator, 1, &pool), JFNT_RESULT_SUCCESS);
+
+    //  Job needs something to create the font from
+    jfnt_font_job* job;
+    JFNT_TEST_CALL(queue_job(pool, &counts, NULL, NULL, 0, NULL, &job), JFNT_RESULT_BAD_ARGUMENT);
+
+    //  Preview comes first, then the font with all ranges
+    struct calls_T calls = {.hold = 1};
+    JFNT_TEST_CALL(queue_job(pool, &counts, "DejaVu Sans:size=16", NULL, 1, &calls, &job), JFNT_RESULT_SUCCESS);
+    //  Second job waits behind the first one, which keeps the only worker busy, so it is canceled before it starts
+    while (__atomic_load_n(&calls.count, __ATOMIC_ACQUIRE) == 0)
+    {
+        sched_yield();
+    }
+    ASSERT(jfnt_font_job_poll(job) == JFNT_FONT_JOB_PREVIEW_READY);
+    struct calls_T canceled_calls = {0};
+    jfnt_font_job* canceled;
+    JFNT_TEST_CALL(queue_job(pool, &counts, "DejaVu Sans:size=16", NULL, 1, &canceled_calls, &canceled), JFNT_RESULT_SUCCESS);
+    ASSERT(jfnt_font_job_poll(canceled) == JFNT_FONT_JOB_QUEUED);
+    jfnt_font_job_cancel(canceled);
+    ASSERT(jfnt_font_job_poll(canceled) == JFNT_FONT_JOB_CANCELED);
+    ASSERT(canceled_calls.count == 1 && canceled_calls.states[0] == JFNT_FONT_JOB_CANCELED);
+    jfnt_font* font;
+    JFNT_TEST_CALL(jfnt_font_job_take_preview(canceled, &font), JFNT_RESULT_CANCELED);
+    JFNT_TEST_CALL(jfnt_font_job_take_font(canceled, &font), JFNT_RESULT_CANCELED);
+    ASSERT(jfnt_font_job_wait(canceled) == JFNT_FONT_JOB_CANCELED);
+    jfnt_font_job_destroy(canceled);
+    __atomic_store_n(&calls.hold, 0, __ATOMIC_RELEASE);
+
+    JFNT_TEST_CALL(jfnt_font_job_take_font(job, &font), JFNT_RESULT_SUCCESS);
+    ASSERT(jfnt_font_job_wait(job) == JFNT_FONT_JOB_DONE);
+    ASSERT(calls.count == 2 && calls.states[0] == JFNT_FONT_JOB_PREVIEW_READY && calls.states[1] == JFNT_FONT_JOB_DONE);
+    printf("Preview had %u glyphs, font has %u\n", calls.preview_glyphs, jfnt_font_get_glyph_count(font));
+    ASSERT(calls.preview_glyphs == PREVIEW_RANGES[0].last - PREVIEW_RANGES[0].first + 1);
+    ASSERT(jfnt_font_get_glyph_count(font) > calls.preview_glyphs);
+    check_font(font, 'A');
+    check_font(font, 0x416);
+    //  Fonts are only taken once
+    jfnt_font* again;
+    JFNT_TEST_CALL(jfnt_font_job_take_font(job, &again), JFNT_RESULT_BAD_ARGUMENT);
+    JFNT_TEST_CALL(jfnt_font_job_take_preview(job, &again), JFNT_RESULT_BAD_ARGUMENT);
+    jfnt_font_job_destroy(job);
+    //  Font outlives its job
+    check_font(font, 0x1E00);
+    jfnt_font_destroy(font);
+
+    //  Failure is reported through the callback and by taking the font
+    calls = (struct calls_T){0};
+    JFNT_TEST_CALL(queue_job(pool, &counts, NULL, "/nonexistent/font.ttf", 0, &calls, &job), JFNT_RESULT_SUCCESS);
+    ASSERT(jfnt_font_job_wait(job) == JFNT_FONT_JOB_FAILED);
+    ASSERT(calls.count == 1 && calls.states[0] == JFNT_FONT_JOB_FAILED);
+    ASSERT(jfnt_font_job_take_font(job, &font) != JFNT_RESULT_SUCCESS);
+    JFNT_TEST_CALL(jfnt_font_job_take_preview(job, &font), JFNT_RESULT_BAD_ARGUMENT);
+    jfnt_font_job_destroy(job);
+
+    //  Jobs destroyed while running, or with fonts not taken, leave nothing behind
+    jfnt_font_job* jobs[4];
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        JFNT_TEST_CALL(queue_job(pool, &counts, "DejaVu Sans:size=16", NULL, i % 2, NULL, jobs + i), JFNT_RESULT_SUCCESS);
+    }
+    ASSERT(jfnt_font_job_wait(jobs[0]) == JFNT_FONT_JOB_DONE);
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        jfnt_font_job_destroy(jobs[i]);
+    }
+
+    jfnt_worker_pool_destroy(pool);
+    printf("Pool made %zu allocations, fonts made %zu\n", pool_counts.allocations, counts.allocations);
+    ASSERT(pool_counts.live == 0 && counts.live == 0);
+    ASSERT(pool_counts.allocations > 0 && counts.allocations > 0);
+    return 0;
+}
@@ -0,0 +1,80 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt_font.h"
+
+static const jfnt_codepoint_range RANGES[] = {{.first = 0x20, .last = 0x52F}};
+
+static jfnt_font* create_font(unsigned max_width, unsigned padding, jfnt_result expected)
+{
+    const jfnt_font_create_info create_info =
+            {
+                    .n_ranges = 1,
+                    .codepoint_ranges = RANGES,
+                    .atlas_max_width = max_width,
+                    .atlas_padding = padding,
+            };
+    return test_create_font("DejaVu Sans:size=24", create_info, expected);
+}
+
+//  Glyphs, with the padding on their right and bottom, are inside the atlas and do not overlap each other, unless they
+//  are identical and share their place
+static void check_packing(const jfnt_font* font, unsigned max_width, unsigned padding)
+{
+    unsigned width, height;
+    const unsigned char* img;
+    jfnt_font_image(font, &width, &height, &img);
+    ASSERT(width <= max_width);
+    const jfnt_glyph* const glyphs = jfnt_font_get_glyphs(font);
+    const unsigned count = jfnt_font_get_glyph_count(font);
+    size_t glyph_pixels = 0;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        const jfnt_glyph a = glyphs[i];
+        if (a.w == 0 || a.h == 0)
+        {
+            continue;
+        }
+        ASSERT(a.offset_x + a.w + padding <= width && a.offset_y + a.h + padding <= height);
+        int shared = 0;
+        for (unsigned j = 0; j < i; ++j)
+        {
+            const jfnt_glyph b = glyphs[j];
+            if (b.w == 0 || b.h == 0)
+            {
+                continue;
+            }
+            if (a.offset_x == b.offset_x && a.offset_y == b.offset_y && a.w == b.w && a.h == b.h)
+            {
+                shared = 1;
+                continue;
+            }
+            ASSERT(a.offset_x + a.w + padding <= b.offset_x || b.offset_x + b.w + padding <= a.offset_x ||
+                   a.offset_y + a.h + padding <= b.offset_y || b.offset_y + b.h + padding <= a.offset_y);
+        }
+        glyph_pixels += shared ? 0 : (size_t)a.w * a.h;
+    }
+    size_t used, atlas;
+    const double fill = jfnt_font_get_atlas_usage(font, &used, &atlas);
+    printf("Atlas %ux%u with padding %u is %.1f %% full\n", width, height, padding, 100.0 * fill);
+    ASSERT(used == glyph_pixels && atlas == (size_t)width * height);
+}
+
+int main()
+{
+    const unsigned max_widths[] = {JFNT_DEFAULT_ATLAS_MAX_WIDTH, 256, 64};
+    for (unsigned i = 0; i < sizeof(max_widths) / sizeof(*max_widths); ++i)
+    {
+        for (unsigned padding = 0; padding < 4; ++padding)
+        {
+            jfnt_font* const font = create_font(max_widths[i], padding, JFNT_RESULT_SUCCESS);
+            check_packing(font, max_widths[i], padding);
+            jfnt_font_destroy(font);
+        }
+    }
+
+    //  Glyphs wider than the atlas may get can not be packed
+    ASSERT(create_font(8, 1, JFNT_RESULT_ATLAS_FULL) == NULL);
+    return 0;
+}
@@ -0,0 +1,137 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt_font.h"
+#include <string.h>
+
+enum {FIRST_CODEPOINT = 0x21, BUDGET = 256 * 256};
+
+static const jfnt_codepoint_range ALL_RANGES[] = {{.first = 0x21, .last = 0x24F}};
+
+struct evictions_T
+{
+    unsigned count;
+    int last_index;
+    char32_t last_codepoint;
+};
+
+static void count_eviction(jfnt_font* font, int index, char32_t codepoint, void* param)
+{
+    struct evictions_T* const evictions = param;
+    ASSERT(index >= 0 && (unsigned)index < jfnt_font_get_glyph_count(font));
+    ASSERT(jfnt_font_get_glyphs(font)[index].codepoint == codepoint);
+    evictions->count += 1;
+    evictions->last_index = index;
+    evictions->last_codepoint = codepoint;
+}
+
+static jfnt_font* create_font(int lazy, size_t budget, struct evictions_T* evictions, jfnt_result expected)
+{
+    const jfnt_font_create_info create_info =
+            {
+                    .n_ranges = lazy ? 0 : 1,
+                    .codepoint_ranges = ALL_RANGES,
+                    .atlas_padding = 1,
+                    .lazy = lazy,
+                    .atlas_budget = budget,
+                    .evicted = count_eviction,
+                    .evicted_param = evictions,
+            };
+    return test_create_font("DejaVu Sans Mono:size=16", create_info, expected);
+}
+
+//  Glyph must look the same as the one for the same codepoint in the reference font
+static void check_glyph(const jfnt_font* font, int idx, const jfnt_font* reference)
+{
+    const jfnt_glyph* const g = jfnt_font_get_glyphs(font) + idx;
+    int ref_idx;
+    JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(reference, '?', 1, &g->codepoint, &ref_idx), JFNT_RESULT_SUCCESS);
+    const jfnt_glyph* const ref = jfnt_font_get_glyphs(reference) + ref_idx;
+    ASSERT(ref->codepoint == g->codepoint && ref->w == g->w && ref->h == g->h);
+    unsigned w, h, ref_w, ref_h;
+    const unsigned char* img, * ref_img;
+    jfnt_font_image(font, &w, &h, &img);
+    jfnt_font_image(reference, &ref_w, &ref_h, &ref_img);
+    for (unsigned row = 0; row < g->h; ++row)
+    {
+        ASSERT(memcmp(img + (size_t)(g->offset_y + row) * w + g->offset_x, ref_img + (size_t)(ref->offset_y + row) * ref_w + ref->offset_x, g->w) == 0);
+    }
+}
+
+int main()
+{
+    struct evictions_T evictions = {0};
+    //  Only lazy fonts can have a budget
+    ASSERT(create_font(0, BUDGET, &evictions, JFNT_RESULT_BAD_ARGUMENT) == NULL);
+    jfnt_font* const reference = create_font(0, 0, &evictions, JFNT_RESULT_SUCCESS);
+    jfnt_font* const font = create_font(1, BUDGET, &evictions, JFNT_RESULT_SUCCESS);
+
+    jfnt_glyph_cache_stats stats;
+    jfnt_font_get_glyph_cache_stats(font, &stats);
+    unsigned w, h;
+    const unsigned char* img;
+    jfnt_font_image(font, &w, &h, &img);
+    printf("Atlas of %u x %u pixels has %u cells\n", w, h, stats.cells);
+    ASSERT((size_t)w * h <= BUDGET);
+    ASSERT(stats.cells > 2 && stats.cells < ALL_RANGES[0].last - ALL_RANGES[0].first);
+
+    //  Fill all cells during one frame, then the next glyph can not be put anywhere
+    const unsigned cells = stats.cells;
+    for (unsigned i = 0; i < cells; ++i)
+    {
+        const char32_t c = FIRST_CODEPOINT + i;
+        int idx;
+        JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(font, '?', 1, &c, &idx), JFNT_RESULT_SUCCESS);
+        ASSERT(idx == (int)i);
+    }
+    ASSERT(jfnt_font_get_glyph_count(font) == cells);
+    {
+        const char32_t c = FIRST_CODEPOINT + cells;
+        int idx;
+        JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(font, '?', 1, &c, &idx), JFNT_RESULT_ATLAS_FULL);
+    }
+
+    //  Glyph used in the last frame is kept, and the one used the longest ago is evicted instead
+    jfnt_font_next_frame(font);
+    {
+        const char32_t c = FIRST_CODEPOINT;
+        int idx;
+        JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(font, '?', 1, &c, &idx), JFNT_RESULT_SUCCESS);
+        ASSERT(idx == 0);
+    }
+    jfnt_font_next_frame(font);
+    {
+        const char32_t c = FIRST_CODEPOINT + cells;
+        int idx;
+        JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(font, '?', 1, &c, &idx), JFNT_RESULT_SUCCESS);
+        ASSERT(evictions.count == 1);
+        ASSERT(idx == 1 && evictions.last_index == 1 && evictions.last_codepoint == FIRST_CODEPOINT + 1);
+        check_glyph(font, idx, reference);
+    }
+
+    //  Cycling through more glyphs than there are cells keeps evicting, and glyphs stay correct after cells are reused
+    for (unsigned frame = 0; frame < 8; ++frame)
+    {
+        jfnt_font_next_frame(font);
+        for (char32_t c = ALL_RANGES[0].first + frame; c <= ALL_RANGES[0].last; c += cells / 2)
+        {
+            int idx;
+            JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(font, '?', 1, &c, &idx), JFNT_RESULT_SUCCESS);
+            //  Codepoints the font does not have are replaced
+            ASSERT(jfnt_font_get_glyphs(font)[idx].codepoint == c || jfnt_font_get_glyphs(font)[idx].codepoint == '?');
+            check_glyph(font, idx, reference);
+        }
+    }
+    ASSERT(jfnt_font_get_glyph_count(font) == cells);
+
+    jfnt_font_get_glyph_cache_stats(font, &stats);
+    printf("Hits: %zu, misses: %zu, evictions: %zu\n", stats.hits, stats.misses, stats.evictions);
+    ASSERT(stats.evictions == evictions.count);
+    ASSERT(stats.misses == cells + stats.evictions);
+    ASSERT(stats.hits > 0);
+
+    jfnt_font_destroy(font);
+    jfnt_font_destroy(reference);
+    return 0;
+}
@@ -0,0 +1,133 @@
+//
+// Created by jan on 17.10.2026.
+//
+//  For nftw
+#define _XOPEN_SOURCE 700
+#include "test_common.h"
+#include "../include/jfnt_font.h"
+#include <string.h>
+#include <unistd.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <fontconfig/fontconfig.h>
+
+static const jfnt_codepoint_range RANGES[] = {{.first = 0x20, .last = 0x7E}};
+//  Only the sans face is installed at first, so fontconfig picks it for this name, until the serif face is installed
+static const char FC_STR[] = "DejaVu Serif:size=16";
+
+static void copy_file(const char* from, const char* to)
+{
+    FILE* const in = fopen(from, "rb");
+    FILE* const out = fopen(to, "wb");
+    ASSERT(in && out);
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), in)) != 0)
+    {
+        ASSERT(fwrite(buffer, 1, n, out) == n);
+    }
+    fclose(in);
+    fclose(out);
+}
+
+static int remove_entry(const char* path, const struct stat* st, int flag, struct FTW* ftw)
+{
+    (void)st;
+    (void)flag;
+    (void)ftw;
+    return remove(path);
+}
+
+//  Cache is written to a new file which is then renamed over the old one, so the file is only the same one when the font
+//  was mapped from it
+static ino_t cache_file(const char* cache_path)
+{
+    struct stat st;
+    return cache_path && stat(cache_path, &st) == 0 ? st.st_ino : 0;
+}
+
+static jfnt_font* create_font(const char* cache_path, int* p_written)
+{
+    const ino_t before = cache_file(cache_path);
+    const jfnt_font_create_info create_info =
+            {
+                    .n_ranges = 1,
+                    .codepoint_ranges = RANGES,
+                    .atlas_padding = 1,
+                    .cache_path = cache_path,
+            };
+    jfnt_font* const font = test_create_font(FC_STR, create_info, JFNT_RESULT_SUCCESS);
+    *p_written = cache_file(cache_path) != before;
+    return font;
+}
+
+//  Fonts have the same glyphs and the same atlas
+static int same_font(const jfnt_font* a, const jfnt_font* b)
+{
+    const unsigned count = jfnt_font_get_glyph_count(a);
+    unsigned w_a, h_a, w_b, h_b;
+    const unsigned char* img_a, * img_b;
+    jfnt_font_image(a, &w_a, &h_a, &img_a);
+    jfnt_font_image(b, &w_b, &h_b, &img_b);
+    return count == jfnt_font_get_glyph_count(b) &&
+           memcmp(jfnt_font_get_glyphs(a), jfnt_font_get_glyphs(b), sizeof(jfnt_glyph) * count) == 0 &&
+           w_a == w_b && h_a == h_b && memcmp(img_a, img_b, (size_t)w_a * h_a) == 0;
+}
+
+int main()
+{
+    char* const sans_file = test_find_font_file("DejaVu Sans");
+    char* const serif_file = test_find_font_file("DejaVu Serif");
+    ASSERT(strcmp(sans_file, serif_file) != 0);
+
+    //  Fontconfig is pointed at a directory of fonts which the test installs fonts into
+    char dir[] = "/tmp/jfnt_cache_test_XXXXXX";
+    ASSERT(mkdtemp(dir));
+    char fonts_dir[64], conf_path[64], cache_path[64], sans_path[64], serif_path[64];
+    snprintf(fonts_dir, sizeof(fonts_dir), "%s/fonts", dir);
+    snprintf(conf_path, sizeof(conf_path), "%s/fonts.conf", dir);
+    snprintf(cache_path, sizeof(cache_path), "%s/atlas.cache", dir);
+    snprintf(sans_path, sizeof(sans_path), "%s/sans.ttf", fonts_dir);
+    snprintf(serif_path, sizeof(serif_path), "%s/serif.ttf", fonts_dir);
+    ASSERT(mkdir(fonts_dir, 0700) == 0);
+    FILE* const conf = fopen(conf_path, "w");
+    ASSERT(conf);
+    fprintf(conf, "<?xml version=\"1.0\"?>\n<fontconfig><dir>%s</dir><cachedir>%s/fc</cachedir></fontconfig>\n", fonts_dir, dir);
+    fclose(conf);
+    copy_file(sans_file, sans_path);
+    ASSERT(setenv("FONTCONFIG_FILE", conf_path, 1) == 0);
+    ASSERT(FcInitReinitialize());
+
+    //  Second font is mapped from the cache written by the first
+    int written_cache;
+    jfnt_font* const written = create_font(cache_path, &written_cache);
+    ASSERT(written_cache);
+    jfnt_font* const cached = create_font(cache_path, &written_cache);
+    ASSERT(!written_cache);
+    ASSERT(same_font(written, cached));
+    jfnt_font_destroy(cached);
+
+    //  Once the better match is installed, the same string resolves to it, while the file the cache was made from is
+    //  left as it was, so the cache must not be used anymore
+    copy_file(serif_file, serif_path);
+    ASSERT(FcInitReinitialize());
+    jfnt_font* const uncached = create_font(NULL, &written_cache);
+    jfnt_font* const recreated = create_font(cache_path, &written_cache);
+    printf("Font after installing the serif face %s the cache\n", written_cache ? "rewrote" : "was mapped from");
+    ASSERT(written_cache);
+    ASSERT(same_font(recreated, uncached) && !same_font(recreated, written));
+    jfnt_font_destroy(recreated);
+    jfnt_font_destroy(uncached);
+    jfnt_font_destroy(written);
+
+    //  Cache is rewritten for the new face
+    jfnt_font* const rewritten = create_font(cache_path, &written_cache);
+    ASSERT(!written_cache);
+    jfnt_font_destroy(rewritten);
+
+    //  Fontconfig also left its cache of the fonts directory in there
+    ASSERT(nftw(dir, remove_entry, 8, FTW_DEPTH | FTW_PHYS) == 0);
+    free(serif_file);
+    free(sans_file);
+    return 0;
+}
@@ -0,0 +1,138 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt_font.h"
+#include <string.h>
+
+static const jfnt_codepoint_range MONO_RANGES[] = {{.first = 0x20, .last = 0x7E}, {.first = 0x2500, .last = 0x257F}};
+static const jfnt_codepoint_range WIDE_RANGES[] = {{.first = 0x20, .last = 0x7E}, {.first = 0x1670, .last = 0x1677}, {.first = 0x2030, .last = 0x2031}};
+
+static jfnt_font* create_font(
+        const char* name, unsigned n_ranges, const jfnt_codepoint_range* ranges, int cell_grid, int lazy, int flip,
+        jfnt_result expected)
+{
+    const jfnt_font_create_info create_info =
+            {
+                    .n_ranges = n_ranges,
+                    .codepoint_ranges = ranges,
+                    .atlas_padding = 1,
+                    .lazy = lazy,
+                    .flip = flip,
+                    .cell_grid = cell_grid,
+            };
+    return test_create_font(name, create_info, expected);
+}
+
+//  Glyph i is in cell i, spans the whole cell, or two for wide glyphs, and has the pixels of the same glyph of the
+//  reference font inside it, at the same position against the baseline
+static unsigned check_grid(const jfnt_font* font, const jfnt_font* reference, int flip)
+{
+    jfnt_cell_grid grid;
+    JFNT_TEST_CALL(jfnt_font_get_cell_grid(font, &grid), JFNT_RESULT_SUCCESS);
+    unsigned height, avg_w;
+    int ascent;
+    jfnt_font_get_sizes(font, &height, &avg_w, NULL, NULL);
+    jfnt_font_get_measures(font, NULL, &ascent, NULL);
+    printf("Cells of %u x %u pixels, %u in a row\n", grid.cell_w, grid.cell_h, grid.columns);
+    ASSERT(grid.cell_w == avg_w && grid.cell_h == height);
+    ASSERT(grid.pitch_x == grid.cell_w + 1 && grid.pitch_y == grid.cell_h + 1);
+
+    unsigned w, h, ref_w, ref_h;
+    const unsigned char* img, * ref_img;
+    jfnt_font_image(font, &w, &h, &img);
+    jfnt_font_image(reference, &ref_w, &ref_h, &ref_img);
+    ASSERT(grid.columns * grid.pitch_x <= w);
+
+    const jfnt_glyph* const glyphs = jfnt_font_get_glyphs(font);
+    const unsigned count = jfnt_font_get_glyph_count(font);
+    unsigned count_wide = 0;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        const jfnt_glyph* const g = glyphs + i;
+        ASSERT(g->offset_x == i % grid.columns * grid.pitch_x && g->offset_y == i / grid.columns * grid.pitch_y);
+        ASSERT(g->h == grid.cell_h && g->top == ascent);
+        int idx;
+        JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(font, 0, 1, &g->codepoint, &idx), JFNT_RESULT_SUCCESS);
+        if (g->advance_x == 0)
+        {
+            //  Right half of the wide glyph before it
+            ASSERT(idx == (int)i - 1 && g->left == (int)grid.cell_w && g->w == grid.cell_w);
+            continue;
+        }
+        ASSERT(idx == (int)i && g->left == 0);
+        if (g->w == 2 * grid.cell_w)
+        {
+            count_wide += 1;
+            ASSERT(i % 2 == 0 && grid.columns % 2 == 0);
+            ASSERT(i + 1 < count && glyphs[i + 1].codepoint == g->codepoint && glyphs[i + 1].advance_x == 0);
+        }
+        else
+        {
+            ASSERT(g->w == grid.cell_w);
+        }
+        ASSERT(g->advance_x == g->w);
+
+        //  Every pixel of the cell is either the one of the reference glyph at that position, or zero outside of it
+        int ref_idx;
+        JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(reference, 0, 1, &g->codepoint, &ref_idx), JFNT_RESULT_SUCCESS);
+        const jfnt_glyph* const ref = jfnt_font_get_glyphs(reference) + ref_idx;
+        for (unsigned y = 0; y < g->h; ++y)
+        {
+            //  Flipped cells are upside down as a whole, so rows are compared in the order they are drawn in
+            const int row = flip ? (int)g->h - 1 - (int)y : (int)y;
+            const int ref_y = row - (ascent - ref->top);
+            for (unsigned x = 0; x < g->w; ++x)
+            {
+                const int ref_x = (int)x - ref->left;
+                const unsigned char v = img[(size_t)(g->offset_y + y) * w + g->offset_x + x];
+                if (ref_x < 0 || ref_y < 0 || ref_x >= (int)ref->w || ref_y >= (int)ref->h)
+                {
+                    ASSERT(v == 0);
+                    continue;
+                }
+                const unsigned ref_row = flip ? ref->h - 1 - (unsigned)ref_y : (unsigned)ref_y;
+                ASSERT(v == ref_img[(size_t)(ref->offset_y + ref_row) * ref_w + ref->offset_x + (unsigned)ref_x]);
+            }
+        }
+    }
+    return count_wide;
+}
+
+int main()
+{
+    //  Lazy fonts can not have a grid
+    ASSERT(create_font("DejaVu Sans Mono:size=16", 0, MONO_RANGES, 1, 1, 0, JFNT_RESULT_BAD_ARGUMENT) == NULL);
+
+    for (int flip = 0; flip < 2; ++flip)
+    {
+        jfnt_font* const reference = create_font("DejaVu Sans Mono:size=16", 2, MONO_RANGES, 0, 0, flip, JFNT_RESULT_SUCCESS);
+        jfnt_font* const font = create_font("DejaVu Sans Mono:size=16", 2, MONO_RANGES, 1, 0, flip, JFNT_RESULT_SUCCESS);
+        ASSERT(jfnt_font_get_glyph_count(font) == jfnt_font_get_glyph_count(reference));
+        //  Monospace font has no wide glyphs in these ranges
+        ASSERT(check_grid(font, reference, flip) == 0);
+
+        //  Grid is laid out once, so no more glyphs can be added
+        static const jfnt_codepoint_range MORE_RANGES[] = {{.first = 0x400, .last = 0x4FF}};
+        unsigned count_rects;
+        const jfnt_atlas_rect* rects;
+        JFNT_TEST_CALL(jfnt_font_add_ranges(font, 1, MORE_RANGES, &count_rects, &rects), JFNT_RESULT_UNSUPPORTED);
+        jfnt_font_destroy(font);
+
+        //  Other fonts have no grid
+        jfnt_cell_grid grid;
+        JFNT_TEST_CALL(jfnt_font_get_cell_grid(reference, &grid), JFNT_RESULT_UNSUPPORTED);
+        jfnt_font_destroy(reference);
+    }
+
+    //  Some syllabics and the per ten thousand sign of a proportional font are wide enough to take two cells
+    jfnt_font* const reference = create_font("DejaVu Sans:size=16", 3, WIDE_RANGES, 0, 0, 0, JFNT_RESULT_SUCCESS);
+    jfnt_font* const font = create_font("DejaVu Sans:size=16", 3, WIDE_RANGES, 1, 0, 0, JFNT_RESULT_SUCCESS);
+    const unsigned count_wide = check_grid(font, reference, 0);
+    printf("Font has %u wide glyphs\n", count_wide);
+    ASSERT(count_wide > 0);
+    ASSERT(jfnt_font_get_glyph_count(font) == jfnt_font_get_glyph_count(reference) + count_wide);
+    jfnt_font_destroy(font);
+    jfnt_font_destroy(reference);
+    return 0;
+}
@@ -0,0 +1,118 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt_font.h"
+#include "../include/jfnt_layout.h"
+#include <pthread.h>
+
+enum {READER_COUNT = 8, ROUNDS = 4, CHUNK = 64};
+
+static const jfnt_codepoint_range INITIAL_RANGES[] = {{.first = 0x20, .last = 0x7E}};
+//  Readers go through codepoints which the writer adds ranges for at the same time
+static const jfnt_codepoint_range READ_RANGES[] = {{.first = 0x20, .last = 0x52F}, {.first = 0x1E00, .last = 0x1FFF}};
+static const jfnt_codepoint_range WRITE_RANGES[] = {{.first = 0x370, .last = 0x3FF}, {.first = 0x1E00, .last = 0x1EFF}, {.first = 0x2000, .last = 0x22FF}};
+
+struct reader_T
+{
+    const jfnt_font* font;
+    unsigned seed;
+    size_t lookups;
+};
+
+static jfnt_font* create_font(int lazy, jfnt_result expected)
+{
+    const jfnt_font_create_info create_info =
+            {
+                    .n_ranges = 1,
+                    .codepoint_ranges = INITIAL_RANGES,
+                    .atlas_padding = 1,
+                    .lazy = lazy,
+                    .concurrent = 1,
+            };
+    return test_create_font("DejaVu Sans:size=16", create_info, expected);
+}
+
+//  Looks up chunks of codepoints starting at random places and lays them out, checking that every glyph found is the
+//  one for its codepoint
+static void* reader_main(void* param)
+{
+    struct reader_T* const reader = param;
+    char32_t codepoints[CHUNK];
+    int indices[CHUNK];
+    jfnt_quad quads[CHUNK];
+    const jfnt_layout_info layout = {.kerning = 1};
+    for (unsigned round = 0; round < ROUNDS; ++round)
+    {
+        for (unsigned r = 0; r < sizeof(READ_RANGES) / sizeof(*READ_RANGES); ++r)
+        {
+            const unsigned span = READ_RANGES[r].last - READ_RANGES[r].first + 1;
+            for (unsigned n = 0; n < span; n += CHUNK)
+            {
+                reader->seed = reader->seed * 1103515245u + 12345u;
+                const char32_t first = READ_RANGES[r].first + (reader->seed >> 8) % span;
+                for (unsigned i = 0; i < CHUNK; ++i)
+                {
+                    codepoints[i] = READ_RANGES[r].first + (first - READ_RANGES[r].first + i) % span;
+                }
+                ASSERT(jfnt_font_find_glyphs_u32(reader->font, '?', CHUNK, codepoints, indices) == JFNT_RESULT_SUCCESS);
+                const jfnt_glyph* const glyphs = jfnt_font_get_glyphs(reader->font);
+                for (unsigned i = 0; i < CHUNK; ++i)
+                {
+                    ASSERT(glyphs[indices[i]].codepoint == codepoints[i] || glyphs[indices[i]].codepoint == '?');
+                }
+                size_t written;
+                float pen_x = 0, pen_y = 0;
+                ASSERT(jfnt_layout_run(reader->font, &layout, CHUNK, indices, quads, &written, &pen_x, &pen_y) == JFNT_RESULT_SUCCESS);
+                ASSERT(written == CHUNK);
+                reader->lookups += CHUNK;
+            }
+        }
+    }
+    return NULL;
+}
+
+int main()
+{
+    //  Fonts which are not lazy do not change, so they need not be concurrent
+    ASSERT(create_font(0, JFNT_RESULT_BAD_ARGUMENT) == NULL);
+
+    jfnt_font* const font = create_font(1, JFNT_RESULT_SUCCESS);
+    pthread_t threads[READER_COUNT];
+    struct reader_T readers[READER_COUNT];
+    for (unsigned i = 0; i < READER_COUNT; ++i)
+    {
+        readers[i] = (struct reader_T){.font = font, .seed = i + 1};
+        ASSERT(pthread_create(threads + i, NULL, reader_main, readers + i) == 0);
+    }
+    //  Writer adds ranges while readers load glyphs on their own
+    for (unsigned i = 0; i < sizeof(WRITE_RANGES) / sizeof(*WRITE_RANGES); ++i)
+    {
+        unsigned count_rects;
+        const jfnt_atlas_rect* rects;
+        ASSERT(jfnt_font_add_ranges(font, 1, WRITE_RANGES + i, &count_rects, &rects) == JFNT_RESULT_SUCCESS);
+    }
+    size_t lookups = 0;
+    for (unsigned i = 0; i < READER_COUNT; ++i)
+    {
+        ASSERT(pthread_join(threads[i], NULL) == 0);
+        lookups += readers[i].lookups;
+    }
+
+    //  Every glyph was loaded only once, so each is the one found for its codepoint
+    const jfnt_glyph* const glyphs = jfnt_font_get_glyphs(font);
+    const unsigned count = jfnt_font_get_glyph_count(font);
+    printf("%zu lookups by %u threads left the font with %u glyphs\n", lookups, READER_COUNT, count);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        int idx;
+        ASSERT(jfnt_font_find_glyphs_u32(font, '?', 1, &glyphs[i].codepoint, &idx) == JFNT_RESULT_SUCCESS);
+        ASSERT(idx == (int)i);
+    }
+
+    //  With no readers left, replaced tables can be released, and the current one stays the same
+    jfnt_font_reclaim(font);
+    ASSERT(jfnt_font_get_glyphs(font) == glyphs && jfnt_font_get_glyph_count(font) == count);
+    jfnt_font_destroy(font);
+    return 0;
+}
@@ -0,0 +1,72 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt.h"
+#include <time.h>
+
+enum {COUNT_SIZES = 12, REPEATS = 10};
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+//  Creates the font in every size, returning the average time it took per font
+static double create_all_sizes(jfnt_context* context, const char* family, const jfnt_codepoint_range* range)
+{
+    const jfnt_error_callbacks err_callbacks = {.report = test_report_callback};
+    const jfnt_font_create_info create_info =
+            {
+                    .n_ranges = 1,
+                    .codepoint_ranges = range,
+                    .error_callbacks = &err_callbacks,
+                    .context = context,
+            };
+    jfnt_font* fonts[COUNT_SIZES];
+    const double t0 = now_seconds();
+    for (unsigned i = 0; i < COUNT_SIZES; ++i)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "%s:size=%u", family, 8 + 2 * i);
+        ASSERT(jfnt_font_create_from_fc_str(name, create_info, fonts + i) == JFNT_RESULT_SUCCESS);
+    }
+    const double dt = now_seconds() - t0;
+    for (unsigned i = 0; i < COUNT_SIZES; ++i)
+    {
+        jfnt_font_destroy(fonts[i]);
+    }
+    return dt / COUNT_SIZES;
+}
+
+int main()
+{
+    static const char* const FAMILIES[] = {"DejaVu Sans", "DejaVu Sans Mono"};
+    //  Single glyph shows the fixed cost of creating a font, which is what the context saves on
+    static const jfnt_codepoint_range RANGES[] = {{.first = 0x20, .last = 0x7E}, {.first = 'A', .last = 'A'}};
+    static const char* const RANGE_NAMES[] = {"ascii", "one glyph"};
+    printf("%-18s %-10s %14s %14s\n", "family", "glyphs", "alone [ms]", "context [ms]");
+    for (unsigned i_family = 0; i_family < sizeof(FAMILIES) / sizeof(*FAMILIES); ++i_family)
+    {
+        for (unsigned i_range = 0; i_range < sizeof(RANGES) / sizeof(*RANGES); ++i_range)
+        {
+            //  Fontconfig is initialized once per process either way, so it is not part of the measurement
+            create_all_sizes(NULL, FAMILIES[i_family], RANGES + i_range);
+
+            double alone = 0, shared = 0;
+            for (unsigned repeat = 0; repeat < REPEATS; ++repeat)
+            {
+                alone += create_all_sizes(NULL, FAMILIES[i_family], RANGES + i_range);
+                jfnt_context* context;
+                ASSERT(jfnt_context_create(NULL, &context) == JFNT_RESULT_SUCCESS);
+                shared += create_all_sizes(context, FAMILIES[i_family], RANGES + i_range);
+                jfnt_context_destroy(context);
+            }
+            printf("%-18s %-10s %14.3f %14.3f\n", FAMILIES[i_family], RANGE_NAMES[i_range], alone / REPEATS * 1e3,
+                   shared / REPEATS * 1e3);
+        }
+    }
+    return 0;
+}
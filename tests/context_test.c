@@ -0,0 +1,114 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt.h"
+#include <string.h>
+
+static const jfnt_codepoint_range RANGES[] = {{.first = 0x20, .last = 0x7E}};
+static const jfnt_error_callbacks ERR_CALLBACKS =
+        {
+                .report = test_report_callback,
+        };
+
+static jfnt_font* create_font(jfnt_context* context, const char* name, int lazy)
+{
+    const jfnt_font_create_info create_info =
+            {
+                    .n_ranges = sizeof(RANGES) / sizeof(*RANGES),
+                    .codepoint_ranges = RANGES,
+                    .error_callbacks = &ERR_CALLBACKS,
+                    .lazy = lazy,
+                    .context = context,
+            };
+    return test_create_font(name, create_info, JFNT_RESULT_SUCCESS);
+}
+
+//  Fonts must have the same glyphs in the same places of the same atlas
+static void check_same_font(const jfnt_font* a, const jfnt_font* b)
+{
+    ASSERT(jfnt_font_get_glyph_count(a) == jfnt_font_get_glyph_count(b));
+    ASSERT(memcmp(jfnt_font_get_glyphs(a), jfnt_font_get_glyphs(b), sizeof(jfnt_glyph) * jfnt_font_get_glyph_count(a)) == 0);
+    unsigned wa, ha, wb, hb;
+    const unsigned char* da;
+    const unsigned char* db;
+    jfnt_font_image(a, &wa, &ha, &da);
+    jfnt_font_image(b, &wb, &hb, &db);
+    ASSERT(wa == wb && ha == hb);
+    ASSERT(memcmp(da, db, (size_t)wa * ha) == 0);
+}
+
+static const char* const NAMES[] = {"DejaVu Sans:size=9", "DejaVu Sans:size=12", "DejaVu Sans:size=16", "DejaVu Sans:size=23"};
+enum {COUNT_NAMES = sizeof(NAMES) / sizeof(*NAMES)};
+
+int main()
+{
+    jfnt_context* context;
+    JFNT_TEST_CALL(jfnt_context_create(NULL, &context), JFNT_RESULT_SUCCESS);
+
+    //  Many sizes of one face open its file only once, and give the same fonts as without a context
+    for (unsigned i = 0; i < COUNT_NAMES; ++i)
+    {
+        jfnt_font* const shared = create_font(context, NAMES[i], 0);
+        jfnt_font* const alone = create_font(NULL, NAMES[i], 0);
+        check_same_font(shared, alone);
+        jfnt_font_destroy(alone);
+        jfnt_font_destroy(shared);
+    }
+    unsigned times_opened;
+    ASSERT(jfnt_context_get_face_count(context, &times_opened) == 1);
+    ASSERT(times_opened == 1);
+    //  File of the face is mapped once for all of its sizes
+    const size_t mapped_size = jfnt_context_get_mapped_size(context);
+    printf("Context has %zu bytes of font files mapped\n", mapped_size);
+    ASSERT(mapped_size > 0);
+
+    //  Lazy fonts of different sizes on the same face must each load glyphs at their own size, even when interleaved
+    {
+        static const char32_t LATER[] = {0xE9, 0x416, 0x3A9, 0x20AC, 0xF1, 0x42F};
+        enum {COUNT_LATER = sizeof(LATER) / sizeof(*LATER)};
+        jfnt_font* shared[COUNT_NAMES];
+        jfnt_font* alone[COUNT_NAMES];
+        for (unsigned i = 0; i < COUNT_NAMES; ++i)
+        {
+            shared[i] = create_font(context, NAMES[i], 1);
+            alone[i] = create_font(NULL, NAMES[i], 1);
+        }
+        for (unsigned j = 0; j < COUNT_LATER; ++j)
+        {
+            for (unsigned i = 0; i < COUNT_NAMES; ++i)
+            {
+                int idx_shared, idx_alone;
+                ASSERT(jfnt_font_find_glyphs_u32(shared[i], '?', 1, LATER + j, &idx_shared) == JFNT_RESULT_SUCCESS);
+                ASSERT(jfnt_font_find_glyphs_u32(alone[i], '?', 1, LATER + j, &idx_alone) == JFNT_RESULT_SUCCESS);
+                ASSERT(idx_shared == idx_alone);
+            }
+        }
+        for (unsigned i = 0; i < COUNT_NAMES; ++i)
+        {
+            check_same_font(shared[i], alone[i]);
+            jfnt_font_destroy(alone[i]);
+        }
+        ASSERT(jfnt_context_get_face_count(context, &times_opened) == 1);
+        ASSERT(times_opened == 1);
+        ASSERT(jfnt_context_get_mapped_size(context) == mapped_size);
+
+        //  Faces still used by lazy fonts are not closed
+        jfnt_context_trim(context);
+        ASSERT(jfnt_context_get_face_count(context, NULL) == 1);
+        for (unsigned i = 0; i < COUNT_NAMES; ++i)
+        {
+            jfnt_font_destroy(shared[i]);
+        }
+    }
+
+    jfnt_context_trim(context);
+    ASSERT(jfnt_context_get_face_count(context, NULL) == 0);
+    ASSERT(jfnt_context_get_mapped_size(context) == 0);
+    jfnt_font_destroy(create_font(context, NAMES[0], 0));
+    ASSERT(jfnt_context_get_face_count(context, &times_opened) == 1);
+    ASSERT(times_opened == 2);
+
+    jfnt_context_destroy(context);
+    return 0;
+}
@@ -0,0 +1,118 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt_font.h"
+#include <string.h>
+
+enum {MAX_REPORTED = 4096};
+
+struct reports_T
+{
+    unsigned count_ranges;
+    jfnt_codepoint_range ranges[MAX_REPORTED];
+    size_t count_codepoints;
+};
+
+static void count_range(jfnt_font* font, char32_t first, char32_t last, const char* msg, void* param)
+{
+    (void)font;
+    (void)msg;
+    struct reports_T* const reports = param;
+    ASSERT(first <= last);
+    ASSERT(reports->count_ranges < MAX_REPORTED);
+    reports->ranges[reports->count_ranges] = (jfnt_codepoint_range){.first = first, .last = last};
+    reports->count_ranges += 1;
+    reports->count_codepoints += 1 + (size_t)(last - first);
+}
+
+static void count_char(jfnt_font* font, char32_t c, const char* msg, void* param)
+{
+    (void)font;
+    (void)c;
+    (void)msg;
+    struct reports_T* const reports = param;
+    reports->count_codepoints += 1;
+}
+
+static jfnt_font* create_font(unsigned n_ranges, const jfnt_codepoint_range* ranges, const jfnt_error_callbacks* callbacks)
+{
+    const jfnt_font_create_info create_info =
+            {
+                    .n_ranges = n_ranges,
+                    .codepoint_ranges = ranges,
+                    .error_callbacks = callbacks,
+            };
+    return test_create_font("DejaVu Sans Mono:size=12", create_info, JFNT_RESULT_SUCCESS);
+}
+
+static struct reports_T reports;
+
+int main()
+{
+    //  All of Unicode only loads the glyphs the font has, with the rest reported in a few ranges
+    {
+        const jfnt_codepoint_range all = {.first = 0, .last = 0x10FFFF};
+        const jfnt_error_callbacks callbacks =
+                {
+                        .report = test_report_callback,
+                        .unsupported_range = count_range,
+                        .char_param = &reports,
+                };
+        jfnt_font* const font = create_font(1, &all, &callbacks);
+        const unsigned count = jfnt_font_get_glyph_count(font);
+        const jfnt_glyph* const glyphs = jfnt_font_get_glyphs(font);
+        printf("Font has %u glyphs, %zu codepoints in %u ranges are missing\n", count, reports.count_codepoints, reports.count_ranges);
+        ASSERT(count + reports.count_codepoints == 0x110000);
+        ASSERT(count > 0);
+
+        //  Ranges come in order, do not touch each other and have no glyphs in them
+        for (unsigned i = 1; i < reports.count_ranges; ++i)
+        {
+            ASSERT(reports.ranges[i - 1].last + 1 < reports.ranges[i].first);
+        }
+        unsigned i_range = 0;
+        for (unsigned i = 0; i < count; ++i)
+        {
+            ASSERT(i == 0 || glyphs[i - 1].codepoint < glyphs[i].codepoint);
+            while (i_range < reports.count_ranges && reports.ranges[i_range].last < glyphs[i].codepoint)
+            {
+                i_range += 1;
+            }
+            ASSERT(i_range == reports.count_ranges || glyphs[i].codepoint < reports.ranges[i_range].first);
+        }
+        jfnt_font_destroy(font);
+    }
+
+    //  Without the range callback, each codepoint is reported on its own
+    {
+        const jfnt_codepoint_range ranges[] = {{.first = 0x20, .last = 0x52F}, {.first = 0x2000, .last = 0x22FF}};
+        struct reports_T by_range = {0};
+        struct reports_T by_char = {0};
+        const jfnt_error_callbacks range_callbacks = {.report = test_report_callback, .unsupported_range = count_range, .char_param = &by_range};
+        const jfnt_error_callbacks char_callbacks = {.report = test_report_callback, .unsupported_char = count_char, .char_param = &by_char};
+        jfnt_font* const a = create_font(2, ranges, &range_callbacks);
+        jfnt_font* const b = create_font(2, ranges, &char_callbacks);
+        ASSERT(by_range.count_codepoints == by_char.count_codepoints);
+        ASSERT(by_char.count_codepoints > 0);
+        ASSERT(jfnt_font_get_glyph_count(a) == jfnt_font_get_glyph_count(b));
+        ASSERT(jfnt_font_get_glyph_count(a) + by_char.count_codepoints == (0x52F - 0x20 + 1) + (0x22FF - 0x2000 + 1));
+        jfnt_font_destroy(b);
+        jfnt_font_destroy(a);
+    }
+
+    //  Order of ranges is kept, including overlaps, and empty ranges are ignored
+    {
+        const jfnt_codepoint_range ranges[] = {{.first = 'x', .last = 'z'}, {.first = 'a', .last = 'c'}, {.first = 'y', .last = 'y'}, {.first = 'q', .last = 'p'}};
+        const jfnt_error_callbacks callbacks = {.report = test_report_callback};
+        jfnt_font* const font = create_font(4, ranges, &callbacks);
+        static const char EXPECTED[] = "xyzabcy";
+        ASSERT(jfnt_font_get_glyph_count(font) == sizeof(EXPECTED) - 1);
+        for (unsigned i = 0; i < sizeof(EXPECTED) - 1; ++i)
+        {
+            ASSERT(jfnt_font_get_glyphs(font)[i].codepoint == (char32_t)EXPECTED[i]);
+        }
+        jfnt_font_destroy(font);
+    }
+    return 0;
+}
@@ -0,0 +1,71 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt_font.h"
+#include <string.h>
+
+//  Includes codepoints mapped to the same glyphs, such as U+2126 OHM SIGN and U+03A9 GREEK CAPITAL LETTER OMEGA
+static const jfnt_codepoint_range RANGES[] = {{.first = 0x20, .last = 0x52F}, {.first = 0x2000, .last = 0x21FF}};
+
+int main()
+{
+    const jfnt_font_create_info create_info =
+            {
+                    .n_ranges = 2,
+                    .codepoint_ranges = RANGES,
+                    .collect_stats = 1,
+            };
+    jfnt_font* const font = test_create_font("DejaVu Sans:size=16", create_info, JFNT_RESULT_SUCCESS);
+    jfnt_font_stats stats;
+    jfnt_font_get_stats(font, &stats);
+    printf("%zu of %zu glyphs shared, saving %zu bytes\n", stats.glyphs_shared, stats.glyphs_rasterized, stats.bytes_shared);
+    ASSERT(stats.glyphs_shared > 0 && stats.bytes_shared > 0);
+
+    const unsigned count = jfnt_font_get_glyph_count(font);
+    const jfnt_glyph* const glyphs = jfnt_font_get_glyphs(font);
+    unsigned w, h;
+    const unsigned char* img;
+    jfnt_font_image(font, &w, &h, &img);
+    size_t total_area = 0, shared_area = 0;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        const jfnt_glyph* const g = glyphs + i;
+        const size_t area = (size_t)g->w * g->h;
+        total_area += area;
+        for (unsigned j = 0; j < i && area; ++j)
+        {
+            //  Glyphs only ever share a place in the atlas with a glyph of the same size, which then has the same pixels
+            if (glyphs[j].offset_x == g->offset_x && glyphs[j].offset_y == g->offset_y && glyphs[j].w && glyphs[j].h)
+            {
+                ASSERT(glyphs[j].w == g->w && glyphs[j].h == g->h);
+                shared_area += area;
+                break;
+            }
+        }
+    }
+    //  Empty glyphs take up no space, so atlas only has pixels of glyphs which are not shared
+    size_t glyph_pixels;
+    jfnt_font_get_atlas_usage(font, &glyph_pixels, NULL);
+    ASSERT(shared_area == stats.bytes_shared);
+    ASSERT(glyph_pixels == total_area - shared_area);
+
+    int indices[2];
+    const char32_t omega[2] = {0x3A9, 0x2126};
+    JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(font, '?', 2, omega, indices), JFNT_RESULT_SUCCESS);
+    ASSERT(indices[0] != indices[1]);
+    ASSERT(glyphs[indices[0]].offset_x == glyphs[indices[1]].offset_x && glyphs[indices[0]].offset_y == glyphs[indices[1]].offset_y);
+
+    //  Glyphs added later share places among themselves
+    const jfnt_codepoint_range more = {.first = 0x1D00, .last = 0x1FFF};
+    unsigned count_rects;
+    const jfnt_atlas_rect* rects;
+    JFNT_TEST_CALL(jfnt_font_add_ranges(font, 1, &more, &count_rects, &rects), JFNT_RESULT_SUCCESS);
+    jfnt_font_stats new_stats;
+    jfnt_font_get_stats(font, &new_stats);
+    printf("%zu of %zu glyphs shared after adding ranges\n", new_stats.glyphs_shared, new_stats.glyphs_rasterized);
+    ASSERT(new_stats.glyphs_shared > stats.glyphs_shared);
+
+    jfnt_font_destroy(font);
+    return 0;
+}
@@ -0,0 +1,200 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt_font.h"
+#include <string.h>
+
+enum {MAX_CODEPOINT = 0x2FFF, MAX_MISSING = 4096};
+
+struct missing_T
+{
+    unsigned count;
+    jfnt_codepoint_range ranges[MAX_MISSING];
+};
+
+static void add_missing(jfnt_font* font, char32_t first, char32_t last, const char* msg, void* param)
+{
+    (void)font;
+    (void)msg;
+    struct missing_T* const missing = param;
+    ASSERT(missing->count < MAX_MISSING);
+    missing->ranges[missing->count] = (jfnt_codepoint_range){.first = first, .last = last};
+    missing->count += 1;
+}
+
+static int is_missing(const struct missing_T* missing, char32_t c)
+{
+    for (unsigned i = 0; i < missing->count; ++i)
+    {
+        if (missing->ranges[i].first <= c && c <= missing->ranges[i].last)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static jfnt_font* create_font(int fallback, int lazy, struct missing_T* missing)
+{
+    static const jfnt_codepoint_range ranges[] = {{.first = 0x20, .last = MAX_CODEPOINT}};
+    const jfnt_error_callbacks callbacks =
+            {
+                    .report = test_report_callback,
+                    .unsupported_range = add_missing,
+                    .char_param = missing,
+            };
+    const jfnt_font_create_info create_info =
+            {
+                    //  Lazy font starts out empty, so that all of its glyphs are looked for one at a time
+                    .n_ranges = lazy ? 0 : 1,
+                    .codepoint_ranges = ranges,
+                    .error_callbacks = &callbacks,
+                    .fallback = fallback,
+                    .lazy = lazy,
+                    .thread_count = 2,
+            };
+    return test_create_font("DejaVu Sans Mono:size=12", create_info, JFNT_RESULT_SUCCESS);
+}
+
+static struct missing_T alone_missing;
+static struct missing_T chain_missing;
+static struct missing_T lazy_missing;
+
+//  Allocator which fails once the given number of allocations were made, keeping count of live ones
+struct failing_T
+{
+    unsigned remaining;
+    size_t live;
+};
+
+static void* failing_allocate(void* state, size_t size)
+{
+    struct failing_T* const failing = state;
+    if (!failing->remaining)
+    {
+        return NULL;
+    }
+    failing->remaining -= 1;
+    void* const ptr = malloc(size);
+    failing->live += ptr != NULL;
+    return ptr;
+}
+
+static void* failing_reallocate(void* state, void* ptr, size_t new_size)
+{
+    struct failing_T* const failing = state;
+    if (!failing->remaining)
+    {
+        return NULL;
+    }
+    failing->remaining -= 1;
+    void* const new_ptr = realloc(ptr, new_size);
+    failing->live += !ptr && new_ptr;
+    return new_ptr;
+}
+
+static void failing_deallocate(void* state, void* ptr)
+{
+    struct failing_T* const failing = state;
+    failing->live -= ptr != NULL;
+    free(ptr);
+}
+
+//  Creation of a lazy font with a fallback chain which runs out of memory at any point, such as while the fallbacks
+//  are sorted, leaves nothing behind
+static void check_failed_allocations(void)
+{
+    const jfnt_error_callbacks callbacks = {0};
+    for (unsigned limit = 0;; ++limit)
+    {
+        struct failing_T failing = {.remaining = limit};
+        const jfnt_allocator_callbacks allocator =
+                {
+                        .allocate = failing_allocate,
+                        .reallocate = failing_reallocate,
+                        .deallocate = failing_deallocate,
+                        .state = &failing,
+                };
+        const jfnt_font_create_info create_info =
+                {
+                        .allocator_callbacks = &allocator,
+                        .error_callbacks = &callbacks,
+                        .fallback = 1,
+                        .lazy = 1,
+                };
+        jfnt_font* font;
+        const jfnt_result res = jfnt_font_create_from_fc_str("DejaVu Sans Mono:size=12", create_info, &font);
+        if (res == JFNT_RESULT_SUCCESS)
+        {
+            printf("Font with fallbacks was created once %u allocations could be made\n", limit);
+            jfnt_font_destroy(font);
+            ASSERT(failing.live == 0);
+            break;
+        }
+        ASSERT(failing.live == 0);
+    }
+}
+
+int main()
+{
+    jfnt_font* const alone = create_font(0, 0, &alone_missing);
+    jfnt_font* const chain = create_font(1, 0, &chain_missing);
+    const unsigned alone_count = jfnt_font_get_glyph_count(alone);
+    const unsigned chain_count = jfnt_font_get_glyph_count(chain);
+    const jfnt_glyph* const alone_glyphs = jfnt_font_get_glyphs(alone);
+    const jfnt_glyph* const chain_glyphs = jfnt_font_get_glyphs(chain);
+    printf("Matched face has %u glyphs, with fallbacks there are %u\n", alone_count, chain_count);
+    ASSERT(chain_count > alone_count);
+
+    //  First face gives the same glyphs either way, and the fallbacks only fill in what it does not have
+    unsigned count_fallback = 0;
+    for (unsigned i = 0; i < chain_count; ++i)
+    {
+        const jfnt_glyph* const g = chain_glyphs + i;
+        ASSERT(g->codepoint >= 0x20 && g->codepoint <= MAX_CODEPOINT);
+        ASSERT(!is_missing(&chain_missing, g->codepoint));
+        if (g->face == 0)
+        {
+            ASSERT(i < alone_count);
+            ASSERT(alone_glyphs[i].codepoint == g->codepoint && alone_glyphs[i].w == g->w && alone_glyphs[i].h == g->h);
+        }
+        else
+        {
+            ASSERT(is_missing(&alone_missing, g->codepoint));
+            count_fallback += 1;
+        }
+    }
+    ASSERT(count_fallback == chain_count - alone_count);
+
+    //  Every codepoint is either found in some face or reported
+    size_t count_chain_missing = 0;
+    for (unsigned i = 0; i < chain_missing.count; ++i)
+    {
+        count_chain_missing += chain_missing.ranges[i].last - chain_missing.ranges[i].first + 1;
+    }
+    ASSERT(count_chain_missing + chain_count == MAX_CODEPOINT - 0x20 + 1);
+
+    //  Lazy font finds the same glyphs in the same faces
+    jfnt_font* const lazy = create_font(1, 1, &lazy_missing);
+    for (unsigned i = 0; i < chain_count; ++i)
+    {
+        const jfnt_glyph* const g = chain_glyphs + i;
+        int idx;
+        JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(lazy, '?', 1, &g->codepoint, &idx), JFNT_RESULT_SUCCESS);
+        const jfnt_glyph* const lazy_g = jfnt_font_get_glyphs(lazy) + idx;
+        ASSERT(lazy_g->codepoint == g->codepoint);
+        ASSERT(lazy_g->face == g->face && lazy_g->w == g->w && lazy_g->h == g->h);
+    }
+    ASSERT(jfnt_font_get_glyph_count(lazy) == chain_count);
+
+    //  Kerning is only found between glyphs of the first face
+    ASSERT(jfnt_font_get_kerning_pair_count(chain) == jfnt_font_get_kerning_pair_count(alone));
+
+    jfnt_font_destroy(lazy);
+    jfnt_font_destroy(chain);
+    jfnt_font_destroy(alone);
+
+    check_failed_allocations();
+    return 0;
+}
@@ -0,0 +1,210 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt_font.h"
+#include <string.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+enum {MAX_WIDTH = 256, STRIDE = MAX_WIDTH * 4 + 64, ROWS = 1024, LAZY_ROWS = 64, GUARD = 0xCD};
+
+static const jfnt_codepoint_range RANGES[] = {{.first = 0x20, .last = 0x17F}};
+static const char FC_STR[] = "DejaVu Sans Mono:size=16";
+
+static jfnt_font* create_font(jfnt_pixel_format format, int lazy, void* memory, unsigned rows, jfnt_result expected)
+{
+    const jfnt_font_create_info create_info =
+            {
+                    .n_ranges = lazy ? 0 : 1,
+                    .codepoint_ranges = RANGES,
+                    .flip = 1,
+                    .atlas_padding = 1,
+                    .atlas_max_width = MAX_WIDTH,
+                    .lazy = lazy,
+                    .pixel_format = format,
+                    .atlas_memory = memory,
+                    .atlas_stride = memory ? STRIDE : 0,
+                    .atlas_rows = rows,
+            };
+    return test_create_font(FC_STR, create_info, expected);
+}
+
+//  Monochrome renderer hints glyphs differently, so they have no reference font and are compared with what it renders
+//  for the same face and size instead, flipped the same way as fonts of this test are
+static void check_mono(const jfnt_font* font, const unsigned char* img, size_t stride)
+{
+    char* const path = test_find_font_file(FC_STR);
+    FT_Library library;
+    FT_Face face;
+    ASSERT(FT_Init_FreeType(&library) == FT_Err_Ok);
+    ASSERT(FT_New_Face(library, path, 0, &face) == FT_Err_Ok);
+    unsigned size_h, size_v;
+    jfnt_font_get_sizes(font, NULL, NULL, &size_h, &size_v);
+    ASSERT(FT_Set_Char_Size(face, size_h, size_v, 0, 0) == FT_Err_Ok);
+    const jfnt_glyph* const glyphs = jfnt_font_get_glyphs(font);
+    unsigned covered = 0;
+    for (unsigned i = 0; i < jfnt_font_get_glyph_count(font); ++i)
+    {
+        const jfnt_glyph* const g = glyphs + i;
+        ASSERT(FT_Load_Char(face, g->codepoint, FT_LOAD_RENDER | FT_LOAD_TARGET_MONO) == FT_Err_Ok);
+        const FT_Bitmap* const bitmap = &face->glyph->bitmap;
+        ASSERT(bitmap->width == g->w && bitmap->rows == g->h && bitmap->pitch >= 0);
+        for (unsigned y = 0; y < g->h; ++y)
+        {
+            const unsigned char* const row = img + (size_t)(g->offset_y + y) * stride;
+            const unsigned char* const src = bitmap->buffer + (size_t)(g->h - y - 1) * bitmap->pitch;
+            for (unsigned x = 0; x < g->w; ++x)
+            {
+                const unsigned ax = g->offset_x + x;
+                const int bit = (row[ax / 8] & (0x80 >> (ax & 7))) != 0;
+                ASSERT(bit == ((src[x / 8] & (0x80 >> (x & 7))) != 0));
+                covered += bit;
+            }
+        }
+    }
+    ASSERT(covered > 0);
+    FT_Done_Face(face);
+    FT_Done_FreeType(library);
+    free(path);
+}
+
+//  Every pixel of the atlas must hold the coverage of the same pixel in the reference, converted to its format
+static void check_atlas(const jfnt_font* font, const jfnt_font* reference, jfnt_pixel_format format)
+{
+    unsigned w, h, ref_w, ref_h;
+    const unsigned char* img, * ref_img;
+    jfnt_font_image(font, &w, &h, &img);
+    jfnt_font_image(reference, &ref_w, &ref_h, &ref_img);
+    size_t stride;
+    jfnt_pixel_format actual_format;
+    jfnt_font_get_image_layout(font, &stride, &actual_format);
+    ASSERT(actual_format == format);
+    ASSERT(stride >= ((size_t)w * jfnt_pixel_format_bits(format) + 7) / 8);
+    if (format == JFNT_PIXEL_FORMAT_R1)
+    {
+        check_mono(font, img, stride);
+        return;
+    }
+    ASSERT(w == ref_w && h == ref_h);
+    for (unsigned y = 0; y < h; ++y)
+    {
+        const unsigned char* const row = img + (size_t)y * stride;
+        for (unsigned x = 0; x < w; ++x)
+        {
+            const unsigned char v = ref_img[(size_t)y * ref_w + x];
+            switch (format)
+            {
+            case JFNT_PIXEL_FORMAT_R8:
+                ASSERT(row[x] == v);
+                break;
+            case JFNT_PIXEL_FORMAT_RGBA8:
+                ASSERT(row[4 * x] == 0xFF && row[4 * x + 1] == 0xFF && row[4 * x + 2] == 0xFF && row[4 * x + 3] == v);
+                break;
+            case JFNT_PIXEL_FORMAT_RGBA8_PREMULTIPLIED:
+                ASSERT(row[4 * x] == v && row[4 * x + 1] == v && row[4 * x + 2] == v && row[4 * x + 3] == v);
+                break;
+            case JFNT_PIXEL_FORMAT_R4:
+                ASSERT((x % 2 ? row[x / 2] & 0xF : row[x / 2] >> 4) == (v * 15 + 127) / 255);
+                break;
+            }
+        }
+    }
+}
+
+int main()
+{
+    jfnt_font* const reference = create_font(JFNT_PIXEL_FORMAT_R8, 0, NULL, 0, JFNT_RESULT_SUCCESS);
+    size_t stride;
+    jfnt_font_get_image_layout(reference, &stride, NULL);
+    ASSERT(stride == MAX_WIDTH);
+
+    //  Formats with memory of their own
+    for (jfnt_pixel_format format = JFNT_PIXEL_FORMAT_RGBA8; format <= JFNT_PIXEL_FORMAT_R1; ++format)
+    {
+        jfnt_font* const font = create_font(format, 0, NULL, 0, JFNT_RESULT_SUCCESS);
+        check_atlas(font, reference, format);
+        jfnt_font_destroy(font);
+    }
+    ASSERT(create_font((jfnt_pixel_format)42, 0, NULL, 0, JFNT_RESULT_BAD_ARGUMENT) == NULL);
+
+    //  Atlas written straight into given memory, which is left alone past the end of each row
+    unsigned char* const memory = malloc((size_t)STRIDE * ROWS);
+    ASSERT(memory);
+    memset(memory, GUARD, (size_t)STRIDE * ROWS);
+    for (jfnt_pixel_format format = JFNT_PIXEL_FORMAT_R8; format <= JFNT_PIXEL_FORMAT_R1; ++format)
+    {
+        memset(memory, GUARD, (size_t)STRIDE * ROWS);
+        jfnt_font* const font = create_font(format, 0, memory, ROWS, JFNT_RESULT_SUCCESS);
+        unsigned w, h;
+        const unsigned char* img;
+        jfnt_font_image(font, &w, &h, &img);
+        ASSERT(img == memory);
+        jfnt_font_get_image_layout(font, &stride, NULL);
+        ASSERT(stride == STRIDE);
+        check_atlas(font, reference, format);
+        const size_t row_bytes = ((size_t)w * jfnt_pixel_format_bits(format) + 7) / 8;
+        for (unsigned y = 0; y < ROWS; ++y)
+        {
+            for (size_t x = y < h ? row_bytes : 0; x < STRIDE; ++x)
+            {
+                ASSERT(memory[(size_t)y * STRIDE + x] == GUARD);
+            }
+        }
+        jfnt_font_destroy(font);
+    }
+    //  Too few rows for the whole atlas
+    ASSERT(create_font(JFNT_PIXEL_FORMAT_R8, 0, memory, 8, JFNT_RESULT_ATLAS_FULL) == NULL);
+
+    //  Lazy font grows into the given rows, until there are no more left
+    jfnt_font* const lazy = create_font(JFNT_PIXEL_FORMAT_RGBA8, 1, memory, LAZY_ROWS, JFNT_RESULT_SUCCESS);
+    char32_t c;
+    jfnt_result res = JFNT_RESULT_SUCCESS;
+    for (c = RANGES[0].first; c <= RANGES[0].last && res == JFNT_RESULT_SUCCESS; ++c)
+    {
+        int idx;
+        res = jfnt_font_find_glyphs_u32(lazy, '?', 1, &c, &idx);
+        if (res == JFNT_RESULT_SUCCESS)
+        {
+            const jfnt_glyph* const g = jfnt_font_get_glyphs(lazy) + idx;
+            int ref_idx;
+            JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(reference, '?', 1, &c, &ref_idx), JFNT_RESULT_SUCCESS);
+            const jfnt_glyph* const ref = jfnt_font_get_glyphs(reference) + ref_idx;
+            unsigned ref_w, ref_h;
+            const unsigned char* ref_img;
+            jfnt_font_image(reference, &ref_w, &ref_h, &ref_img);
+            ASSERT(g->w == ref->w && g->h == ref->h);
+            for (unsigned y = 0; y < g->h; ++y)
+            {
+                for (unsigned x = 0; x < g->w; ++x)
+                {
+                    ASSERT(memory[(size_t)(g->offset_y + y) * STRIDE + (size_t)(g->offset_x + x) * 4 + 3] == ref_img[(size_t)(ref->offset_y + y) * ref_w + ref->offset_x + x]);
+                }
+            }
+        }
+    }
+    unsigned w, h;
+    const unsigned char* img;
+    jfnt_font_image(lazy, &w, &h, &img);
+    printf("Lazy font stopped at U+%04X with an atlas of %u x %u\n", (unsigned)c - 1, w, h);
+    ASSERT(res == JFNT_RESULT_ATLAS_FULL && h <= LAZY_ROWS);
+    //  Glyph which did not fit took no space, so a small one still goes into what is left, and only the glyphs of the
+    //  font count as used
+    const char32_t dot = 0x2D9;
+    int i_dot;
+    JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(lazy, '?', 1, &dot, &i_dot), JFNT_RESULT_SUCCESS);
+    ASSERT(jfnt_font_get_glyphs(lazy)[i_dot].codepoint == dot);
+    size_t glyph_pixels = 0;
+    for (unsigned i = 0; i < jfnt_font_get_glyph_count(lazy); ++i)
+    {
+        glyph_pixels += (size_t)jfnt_font_get_glyphs(lazy)[i].w * jfnt_font_get_glyphs(lazy)[i].h;
+    }
+    size_t used;
+    jfnt_font_get_atlas_usage(lazy, &used, NULL);
+    ASSERT(used == glyph_pixels);
+    jfnt_font_destroy(lazy);
+
+    free(memory);
+    jfnt_font_destroy(reference);
+    return 0;
+}
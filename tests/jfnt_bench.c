@@ -0,0 +1,277 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt.h"
+#include <fontconfig/fontconfig.h>
+#include <string.h>
+#include <time.h>
+
+//  Benchmarks of font creation and glyph lookup, written as CSV to stdout. All of them use the same font file, which is
+//  given as the first argument or else the one CMake was configured with, and which is added to fontconfig, so that
+//  creating the font from a fontconfig string finds that same file.
+
+#ifndef JFNT_BENCH_FONT
+    #error JFNT_BENCH_FONT must be the path of the font file used by the benchmarks
+#endif
+
+//  Size in pixels, which character sizes give in 26.6 points at 72 DPI
+enum {FONT_SIZE = 16, CREATE_REPEATS = 10, CORPUS_SIZE = 1 << 20, LOOKUP_REPEATS = 10};
+
+struct bench_font_T
+{
+    const char* path;
+    char* fc_str;
+    void* mem;
+    size_t mem_size;
+};
+
+struct sample_T
+{
+    unsigned iterations;
+    double min_seconds;
+    double total_seconds;
+};
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void sample_add(struct sample_T* sample, double seconds)
+{
+    if (sample->iterations == 0 || seconds < sample->min_seconds)
+    {
+        sample->min_seconds = seconds;
+    }
+    sample->iterations += 1;
+    sample->total_seconds += seconds;
+}
+
+//  Counters and stats are only reported by benchmarks which create fonts
+static void print_row(
+        const char* group, const char* name, const char* variant, const struct sample_T* sample, double items,
+        const test_allocator* counting, const jfnt_font_stats* stats)
+{
+    const double mean = sample->total_seconds / sample->iterations;
+    printf("%s,%s,%s,%u,%.0f,%.0f,%.1f,%zu,%zu,%zu,%zu\n", group, name, variant, sample->iterations,
+           sample->min_seconds * 1e9, mean * 1e9, items / mean, counting ? counting->peak_bytes : 0,
+           counting ? counting->allocations : 0, stats ? stats->glyphs_shared : 0, stats ? stats->bytes_shared : 0);
+}
+
+enum create_api_T
+{
+    CREATE_FROM_MEMORY,
+    CREATE_FROM_FILENAME,
+    CREATE_FROM_FC_STR,
+    CREATE_API_COUNT,
+};
+
+static const char* const API_NAMES[CREATE_API_COUNT] =
+        {
+                [CREATE_FROM_MEMORY] = "from_memory",
+                [CREATE_FROM_FILENAME] = "from_filename",
+                [CREATE_FROM_FC_STR] = "from_fc_str",
+        };
+
+static jfnt_font* create_font(
+        const struct bench_font_T* font, enum create_api_T api, const jfnt_allocator_callbacks* allocator,
+        unsigned n_ranges, const jfnt_codepoint_range* ranges, int lazy, int collect_stats)
+{
+    const jfnt_error_callbacks callbacks = {.report = test_report_callback};
+    const jfnt_font_create_info create_info =
+            {
+                    .allocator_callbacks = allocator,
+                    .n_ranges = n_ranges,
+                    .codepoint_ranges = ranges,
+                    .error_callbacks = &callbacks,
+                    .lazy = lazy,
+                    .collect_stats = collect_stats,
+            };
+    jfnt_font* out = NULL;
+    jfnt_result res = JFNT_RESULT_SUCCESS;
+    switch (api)
+    {
+    case CREATE_FROM_MEMORY:
+        res = jfnt_font_create_from_memory(font->mem_size, font->mem, FONT_SIZE * 64, create_info, &out);
+        break;
+    case CREATE_FROM_FILENAME:
+        res = jfnt_font_create_from_filename(font->path, FONT_SIZE * 64, create_info, &out);
+        break;
+    case CREATE_FROM_FC_STR:
+        res = jfnt_font_create_from_fc_str(font->fc_str, create_info, &out);
+        break;
+    case CREATE_API_COUNT:
+        break;
+    }
+    ASSERT(res == JFNT_RESULT_SUCCESS);
+    return out;
+}
+
+struct range_set_T
+{
+    const char* name;
+    unsigned count;
+    jfnt_codepoint_range ranges[3];
+};
+
+static const struct range_set_T RANGE_SETS[] =
+        {
+                {"ascii", 1, {{0x20, 0x7E}}},
+                {"latin", 1, {{0x20, 0x24F}}},
+                {"european", 3, {{0x20, 0x24F}, {0x370, 0x3FF}, {0x400, 0x4FF}}},
+                {"bmp", 1, {{0x20, 0xFFFF}}},
+        };
+
+static void bench_create(const struct bench_font_T* font)
+{
+    for (unsigned i_set = 0; i_set < sizeof(RANGE_SETS) / sizeof(*RANGE_SETS); ++i_set)
+    {
+        const struct range_set_T* const set = RANGE_SETS + i_set;
+        for (enum create_api_T api = CREATE_FROM_MEMORY; api < CREATE_API_COUNT; ++api)
+        {
+            test_allocator counting = {0};
+            const jfnt_allocator_callbacks allocator = test_allocator_callbacks(&counting);
+            struct sample_T sample = {0};
+            unsigned glyphs = 0;
+            //  First creation warms up fontconfig and the page cache, and is not measured
+            jfnt_font_destroy(create_font(font, api, &allocator, set->count, set->ranges, 0, 0));
+            counting = (test_allocator){0};
+            for (unsigned repeat = 0; repeat < CREATE_REPEATS; ++repeat)
+            {
+                const double t0 = now_seconds();
+                jfnt_font* const f = create_font(font, api, &allocator, set->count, set->ranges, 0, 0);
+                sample_add(&sample, now_seconds() - t0);
+                glyphs = jfnt_font_get_glyph_count(f);
+                jfnt_font_destroy(f);
+            }
+            ASSERT(counting.live_bytes == 0);
+            //  Allocations are reported per font
+            counting.allocations /= CREATE_REPEATS;
+            //  Atlas space saved by sharing glyphs comes from a font of its own, so that collecting it is not timed
+            jfnt_font* const f = create_font(font, api, NULL, set->count, set->ranges, 0, 1);
+            jfnt_font_stats stats;
+            jfnt_font_get_stats(f, &stats);
+            jfnt_font_destroy(f);
+            print_row("create", set->name, API_NAMES[api], &sample, (double)glyphs, &counting, &stats);
+        }
+    }
+}
+
+struct corpus_T
+{
+    const char* name;
+    const char* sample;
+};
+
+static const struct corpus_T CORPORA[] =
+        {
+                {"ascii", "2026-10-17 12:34:56.789 INFO worker[42]: processed request id=0x1f3a in 12.5 ms\n"},
+                {"latin", "Größere Übungen für Straßenbahnfahrer: élève, garçon, où, naïve, señor año.\n"},
+                {"cyrillic", "Съешь же ещё этих мягких французских булок, да выпей чаю.\n"},
+                {"greek", "Ξεσκεπάζω την ψυχοφθόρα βδελυγμία, ταχίστη αλώπηξ βαφής ψημένη γη.\n"},
+                {"cjk", "敏捷的棕色狐狸跳过了懒狗。日本語のテキストも含まれています。\n"},
+                {"mixed", "Hello, Привет, Γειά σου, 你好, こんにちは, 😀 — ¡Olé!\n"},
+        };
+
+//  Repeats the sample, only whole, until the corpus is full, and decodes it, returning the number of codepoints
+static size_t fill_corpus(const char* sample, char* text, char32_t* codepoints)
+{
+    const size_t sample_size = strlen(sample);
+    size_t size = 0;
+    while (size + sample_size < CORPUS_SIZE)
+    {
+        memcpy(text + size, sample, sample_size);
+        size += sample_size;
+    }
+    text[size] = 0;
+    size_t count = 0;
+    for (size_t pos = 0; pos < size; ++count)
+    {
+        const unsigned char b = (unsigned char)text[pos];
+        const unsigned len = b < 0x80 ? 1 : b < 0xE0 ? 2 : b < 0xF0 ? 3 : 4;
+        char32_t c = len == 1 ? b : len == 2 ? b & 0x1F : len == 3 ? b & 0x0F : b & 0x07;
+        for (unsigned i = 1; i < len; ++i)
+        {
+            c = (c << 6) | ((unsigned char)text[pos + i] & 0x3F);
+        }
+        codepoints[count] = c;
+        pos += len;
+    }
+    return count;
+}
+
+static void bench_lookup(const struct bench_font_T* font)
+{
+    char* const text = malloc(CORPUS_SIZE);
+    char32_t* const codepoints = malloc(sizeof(*codepoints) * CORPUS_SIZE);
+    int* const indices = malloc(sizeof(*indices) * CORPUS_SIZE);
+    ASSERT(text && codepoints && indices);
+    static const jfnt_codepoint_range BMP = {0x20, 0xFFFF};
+    for (int lazy = 0; lazy < 2; ++lazy)
+    {
+        jfnt_font* const f = create_font(font, CREATE_FROM_MEMORY, NULL, lazy ? 0 : 1, &BMP, lazy, 0);
+        for (unsigned i_corpus = 0; i_corpus < sizeof(CORPORA) / sizeof(*CORPORA); ++i_corpus)
+        {
+            const size_t count = fill_corpus(CORPORA[i_corpus].sample, text, codepoints);
+            //  Lazy font loads its glyphs during the first pass, which is not measured
+            ASSERT(jfnt_font_find_glyphs_u32(f, '?', count, codepoints, indices) == JFNT_RESULT_SUCCESS);
+
+            struct sample_T u32 = {0}, utf8 = {0};
+            for (unsigned repeat = 0; repeat < LOOKUP_REPEATS; ++repeat)
+            {
+                double t0 = now_seconds();
+                ASSERT(jfnt_font_find_glyphs_u32(f, '?', count, codepoints, indices) == JFNT_RESULT_SUCCESS);
+                sample_add(&u32, now_seconds() - t0);
+
+                size_t decoded;
+                t0 = now_seconds();
+                ASSERT(jfnt_font_find_glyphs_utf8(f, text, '?', count, &decoded, indices) == JFNT_RESULT_SUCCESS);
+                sample_add(&utf8, now_seconds() - t0);
+                ASSERT(decoded == count);
+            }
+            char name[64];
+            snprintf(name, sizeof(name), "%s_%s", lazy ? "lazy" : "eager", CORPORA[i_corpus].name);
+            print_row("find_glyphs", name, "u32", &u32, (double)count, NULL, NULL);
+            print_row("find_glyphs", name, "utf8", &utf8, (double)count, NULL, NULL);
+        }
+        jfnt_font_destroy(f);
+    }
+    free(indices);
+    free(codepoints);
+    free(text);
+}
+
+int main(int argc, const char* argv[])
+{
+    struct bench_font_T font = {.path = argc > 1 ? argv[1] : JFNT_BENCH_FONT};
+    FILE* const file = fopen(font.path, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "Could not open the font file \"%s\"\n", font.path);
+        return EXIT_FAILURE;
+    }
+    fseek(file, 0, SEEK_END);
+    font.mem_size = (size_t)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    font.mem = malloc(font.mem_size);
+    ASSERT(font.mem && fread(font.mem, 1, font.mem_size, file) == font.mem_size);
+    fclose(file);
+
+    //  Font is matched by its file, so that the host's own fonts are never picked instead
+    ASSERT(FcInit() && FcConfigAppFontAddFile(NULL, (const FcChar8*)font.path));
+    const size_t fc_len = strlen(font.path) + 32;
+    font.fc_str = malloc(fc_len);
+    ASSERT(font.fc_str);
+    snprintf(font.fc_str, fc_len, ":file=%s:pixelsize=%u", font.path, FONT_SIZE);
+
+    printf("group,name,variant,iterations,min_ns,mean_ns,items_per_s,peak_bytes,allocations,shared_glyphs,shared_bytes\n");
+    bench_create(&font);
+    bench_lookup(&font);
+
+    free(font.fc_str);
+    free(font.mem);
+    return 0;
+}
@@ -0,0 +1,104 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt.h"
+#include <string.h>
+#include <time.h>
+#include <fontconfig/fontconfig.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+enum {CHAR_SIZE = 15 * 64, RUN_LENGTH = 1 << 16, REPEATS = 50};
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+int main()
+{
+    FcPattern* const pattern = FcNameParse((const FcChar8*)"DejaVu Sans");
+    FcConfigSubstitute(NULL, pattern, FcMatchPattern);
+    FcDefaultSubstitute(pattern);
+    FcResult result;
+    FcPattern* const match = FcFontMatch(NULL, pattern, &result);
+    ASSERT(match);
+    FcChar8* path;
+    ASSERT(FcPatternGetString(match, FC_FILE, 0, &path) == FcResultMatch);
+
+    const jfnt_codepoint_range ranges[] = {{.first = 0x20, .last = 0x7E}};
+    const jfnt_error_callbacks err_callbacks = {.report = test_report_callback};
+    const jfnt_font_create_info create_info =
+            {
+                    .n_ranges = sizeof(ranges) / sizeof(*ranges),
+                    .codepoint_ranges = ranges,
+                    .error_callbacks = &err_callbacks,
+            };
+    jfnt_font* font;
+    JFNT_TEST_CALL(jfnt_font_create_from_filename((const char*)path, CHAR_SIZE, create_info, &font), JFNT_RESULT_SUCCESS);
+    FT_Library library;
+    FT_Face face;
+    ASSERT(FT_Init_FreeType(&library) == FT_Err_Ok);
+    ASSERT(FT_New_Face(library, (const char*)path, 0, &face) == FT_Err_Ok);
+    ASSERT(FT_Set_Char_Size(face, CHAR_SIZE, CHAR_SIZE, 0, 0) == FT_Err_Ok);
+    printf("%s: %u kerning pairs\n", path, jfnt_font_get_kerning_pair_count(font));
+
+    //  English-like text, so that a realistic fraction of pairs has kerning
+    static const char SAMPLE[] = "AVAST, Ye Olde Tavern! We'll gladly pay Tom's way to Lyon. \"Quoted\", y'all? ";
+    const size_t sample_length = sizeof(SAMPLE) - 1;
+    int* const indices = malloc(sizeof(*indices) * RUN_LENGTH);
+    FT_UInt* const ids = malloc(sizeof(*ids) * RUN_LENGTH);
+    int* const kerning = malloc(sizeof(*kerning) * RUN_LENGTH);
+    ASSERT(indices && ids && kerning);
+    for (size_t i = 0; i < RUN_LENGTH; ++i)
+    {
+        const char c = SAMPLE[i % sample_length];
+        size_t count;
+        ASSERT(jfnt_font_find_glyphs_utf8(font, (char[2]){c, 0}, '?', 1, &count, indices + i) == JFNT_RESULT_SUCCESS);
+        ids[i] = FT_Get_Char_Index(face, (FT_ULong)c);
+    }
+
+    long long checksum_ft = 0;
+    double t0 = now_seconds();
+    for (unsigned repeat = 0; repeat < REPEATS; ++repeat)
+    {
+        for (size_t i = 0; i + 1 < RUN_LENGTH; ++i)
+        {
+            FT_Vector v;
+            FT_Get_Kerning(face, ids[i], ids[i + 1], FT_KERNING_DEFAULT, &v);
+            checksum_ft += v.x >> 6;
+        }
+    }
+    const double dt_ft = now_seconds() - t0;
+
+    long long checksum_jfnt = 0;
+    t0 = now_seconds();
+    for (unsigned repeat = 0; repeat < REPEATS; ++repeat)
+    {
+        ASSERT(jfnt_font_get_kerning(font, RUN_LENGTH, indices, kerning) == JFNT_RESULT_SUCCESS);
+        for (size_t i = 0; i < RUN_LENGTH; ++i)
+        {
+            checksum_jfnt += kerning[i];
+        }
+    }
+    const double dt_jfnt = now_seconds() - t0;
+    ASSERT(checksum_ft == checksum_jfnt);
+
+    const double pairs = (double)(RUN_LENGTH - 1) * REPEATS;
+    printf("%-16s %10.2f ns/pair\n", "FT_Get_Kerning", dt_ft / pairs * 1e9);
+    printf("%-16s %10.2f ns/pair\n", "jfnt run", dt_jfnt / pairs * 1e9);
+    printf("Speedup: %.1fx\n", dt_ft / dt_jfnt);
+
+    free(kerning);
+    free(ids);
+    free(indices);
+    FT_Done_Face(face);
+    FT_Done_FreeType(library);
+    jfnt_font_destroy(font);
+    FcPatternDestroy(match);
+    FcPatternDestroy(pattern);
+    return 0;
+}
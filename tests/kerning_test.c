@@ -0,0 +1,151 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt.h"
+#include <unistd.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+enum {CHAR_SIZE = 15 * 64};
+static const jfnt_codepoint_range RANGES[] = {{.first = 0x20, .last = 0x17F}};
+enum {COUNT_RANGES = sizeof(RANGES) / sizeof(*RANGES)};
+
+static jfnt_font* create_font(const char* path, int lazy, const char* cache_path)
+{
+    jfnt_font* font;
+    const jfnt_error_callbacks err_callbacks =
+            {
+                    .report = test_report_callback,
+            };
+    const jfnt_font_create_info create_info =
+            {
+                    .n_ranges = COUNT_RANGES,
+                    .codepoint_ranges = RANGES,
+                    .error_callbacks = &err_callbacks,
+                    .lazy = lazy,
+                    .cache_path = cache_path,
+            };
+    JFNT_TEST_CALL(jfnt_font_create_from_filename(path, CHAR_SIZE, create_info, &font), JFNT_RESULT_SUCCESS);
+    return font;
+}
+
+//  Every pair of glyphs must have the same kerning as FreeType gives for it. Returns number of pairs with kerning.
+static unsigned check_all_pairs(const jfnt_font* font, FT_Face face)
+{
+    const jfnt_glyph* const glyphs = jfnt_font_get_glyphs(font);
+    const unsigned count = jfnt_font_get_glyph_count(font);
+    int* const indices = malloc(sizeof(*indices) * 2 * count);
+    int* const kerning = malloc(sizeof(*kerning) * 2 * count);
+    ASSERT(indices && kerning);
+    unsigned non_zero = 0;
+    for (unsigned left = 0; left < count; ++left)
+    {
+        //  Run of left, 0, left, 1, left, 2, ... checks pairs in both directions at once
+        for (unsigned right = 0; right < count; ++right)
+        {
+            indices[2 * right] = (int)left;
+            indices[2 * right + 1] = (int)right;
+        }
+        ASSERT(jfnt_font_get_kerning(font, 2 * count, indices, kerning) == JFNT_RESULT_SUCCESS);
+        const FT_UInt left_id = FT_Get_Char_Index(face, glyphs[left].codepoint);
+        for (unsigned right = 0; right < count; ++right)
+        {
+            const FT_UInt right_id = FT_Get_Char_Index(face, glyphs[right].codepoint);
+            FT_Vector v;
+            ASSERT(FT_Get_Kerning(face, left_id, right_id, FT_KERNING_DEFAULT, &v) == FT_Err_Ok);
+            ASSERT(kerning[2 * right] == v.x >> 6);
+            ASSERT(FT_Get_Kerning(face, right_id, left_id, FT_KERNING_DEFAULT, &v) == FT_Err_Ok);
+            ASSERT(right + 1 == count || kerning[2 * right + 1] == v.x >> 6);
+            non_zero += kerning[2 * right] != 0;
+        }
+        ASSERT(kerning[2 * count - 1] == 0);
+    }
+    free(kerning);
+    free(indices);
+    return non_zero;
+}
+
+int main()
+{
+    char* const path = test_find_font_file("DejaVu Sans");
+    printf("Testing with \"%s\"\n", path);
+    FT_Library library;
+    FT_Face face;
+    ASSERT(FT_Init_FreeType(&library) == FT_Err_Ok);
+    ASSERT(FT_New_Face(library, path, 0, &face) == FT_Err_Ok);
+    ASSERT(FT_Set_Char_Size(face, CHAR_SIZE, CHAR_SIZE, 0, 0) == FT_Err_Ok);
+
+    jfnt_font* const font = create_font(path, 0, NULL);
+    const unsigned non_zero = check_all_pairs(font, face);
+    printf("Font has %u pairs with kerning\n", non_zero);
+    ASSERT(non_zero == jfnt_font_get_kerning_pair_count(font));
+    if (FT_HAS_KERNING(face))
+    {
+        ASSERT(non_zero > 0);
+    }
+
+    //  Lazy font has the same kerning once it loads the same glyphs, in a different order
+    jfnt_font* const lazy_font = create_font(path, 1, NULL);
+    for (char32_t c = 0x17F; c >= 0x20; --c)
+    {
+        int idx;
+        ASSERT(jfnt_font_find_glyphs_u32(lazy_font, '?', 1, &c, &idx) == JFNT_RESULT_SUCCESS);
+    }
+    check_all_pairs(lazy_font, face);
+    jfnt_font_destroy(lazy_font);
+
+    //  Kerning survives the round trip through the cache file
+    static const char CACHE_PATH[] = "kerning_test.cache";
+    unlink(CACHE_PATH);
+    jfnt_font_destroy(create_font(path, 0, CACHE_PATH));
+    jfnt_font* const cached_font = create_font(path, 0, CACHE_PATH);
+    ASSERT(check_all_pairs(cached_font, face) == non_zero);
+    jfnt_font_destroy(cached_font);
+    unlink(CACHE_PATH);
+
+    //  Layout moves the pen by the kerning of each pair, and only when asked to
+    {
+        static const char TEXT[] = "AVATAR Wavy To. LT";
+        enum {LENGTH = sizeof(TEXT) - 1};
+        int indices[LENGTH];
+        int kerning[LENGTH];
+        size_t count;
+        JFNT_TEST_CALL(jfnt_font_find_glyphs_utf8(font, TEXT, '?', LENGTH, &count, indices), JFNT_RESULT_SUCCESS);
+        ASSERT(count == LENGTH);
+        JFNT_TEST_CALL(jfnt_font_get_kerning(font, LENGTH, indices, kerning), JFNT_RESULT_SUCCESS);
+        jfnt_quad plain[LENGTH], kerned[LENGTH];
+        jfnt_layout_info info = {.origin_x = 10.0f};
+        float plain_end, kerned_end;
+        size_t written;
+        JFNT_TEST_CALL(jfnt_layout_run(font, &info, LENGTH, indices, plain, &written, &plain_end, NULL), JFNT_RESULT_SUCCESS);
+        info.kerning = 1;
+        JFNT_TEST_CALL(jfnt_layout_run_utf8(font, &info, TEXT, '?', LENGTH, kerned, &written, &kerned_end, NULL), JFNT_RESULT_SUCCESS);
+        int total = 0;
+        for (unsigned i = 0; i < LENGTH; ++i)
+        {
+            ASSERT(kerned[i].x0 == plain[i].x0 + (float)total);
+            total += kerning[i];
+        }
+        ASSERT(kerned_end == plain_end + (float)total);
+        if (FT_HAS_KERNING(face))
+        {
+            ASSERT(total != 0);
+        }
+    }
+
+    //  Invalid indices are rejected
+    {
+        int indices[3] = {0, (int)jfnt_font_get_glyph_count(font), 1};
+        int kerning[3];
+        JFNT_TEST_CALL(jfnt_font_get_kerning(font, 3, indices, kerning), JFNT_RESULT_BAD_ARGUMENT);
+        indices[1] = -1;
+        JFNT_TEST_CALL(jfnt_font_get_kerning(font, 3, indices, kerning), JFNT_RESULT_BAD_ARGUMENT);
+    }
+
+    jfnt_font_destroy(font);
+    FT_Done_Face(face);
+    FT_Done_FreeType(library);
+    free(path);
+    return 0;
+}
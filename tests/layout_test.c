@@ -0,0 +1,200 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt.h"
+#include <string.h>
+#include <math.h>
+
+//  Quads with an extra color attribute after them, to check that the stride is respected
+struct vertex_T
+{
+    jfnt_quad quad;
+    float color[4];
+};
+
+//  Library multiplies by the reciprocal of the atlas size instead of dividing
+static int close_enough(float a, float b)
+{
+    return fabsf(a - b) <= 1e-6f;
+}
+
+static jfnt_font* create_font(int flip)
+{
+    const jfnt_codepoint_range ranges[] = {{.first = 0x20, .last = 0x7E}};
+    const jfnt_font_create_info create_info =
+            {
+                    .n_ranges = sizeof(ranges) / sizeof(*ranges),
+                    .codepoint_ranges = ranges,
+                    .flip = flip,
+                    .atlas_padding = 1,
+            };
+    return test_create_font("Monospace:size=16", create_info, JFNT_RESULT_SUCCESS);
+}
+
+static jfnt_font* create_lazy_font(void)
+{
+    const jfnt_codepoint_range ranges[] = {{.first = 0x20, .last = 0x7E}};
+    const jfnt_font_create_info create_info =
+            {
+                    .n_ranges = sizeof(ranges) / sizeof(*ranges),
+                    .codepoint_ranges = ranges,
+                    .atlas_padding = 1,
+                    .lazy = 1,
+            };
+    return test_create_font("DejaVu Sans:pixelsize=32", create_info, JFNT_RESULT_SUCCESS);
+}
+
+static size_t encode_utf8(char32_t c, char* out)
+{
+    if (c < 0x80)
+    {
+        out[0] = (char)c;
+        return 1;
+    }
+    if (c < 0x800)
+    {
+        out[0] = (char)(0xC0 | (c >> 6));
+        out[1] = (char)(0x80 | (c & 0x3F));
+        return 2;
+    }
+    out[0] = (char)(0xE0 | (c >> 12));
+    out[1] = (char)(0x80 | ((c >> 6) & 0x3F));
+    out[2] = (char)(0x80 | (c & 0x3F));
+    return 3;
+}
+
+//  Runs longer than one chunk make a lazy font's atlas grow while they are looked up, and quads of earlier chunks
+//  must still be the same as those laid out from the indices once the whole run was looked up
+static void check_lazy_run(int utf8)
+{
+    enum {RUN_LENGTH = 1024};
+    static const jfnt_codepoint_range RUN_RANGES[] = {{.first = 0x41, .last = 0x5A}, {.first = 0x400, .last = 0x4FF}, {.first = 0x1E00, .last = 0x1EFF}, {.first = 0x2200, .last = 0x22FF}};
+    char32_t codepoints[RUN_LENGTH];
+    char text[RUN_LENGTH * 3 + 1];
+    size_t len = 0;
+    for (unsigned i = 0; i < RUN_LENGTH; ++i)
+    {
+        const jfnt_codepoint_range r = RUN_RANGES[i % 4];
+        codepoints[i] = r.first + i / 4 % (r.last - r.first + 1);
+        len += encode_utf8(codepoints[i], text + len);
+    }
+    text[len] = 0;
+
+    jfnt_font* const font = create_lazy_font();
+    unsigned atlas_w, before_h, after_h;
+    const unsigned char* atlas;
+    jfnt_font_image(font, &atlas_w, &before_h, &atlas);
+    static jfnt_quad quads[RUN_LENGTH], from_indices[RUN_LENGTH];
+    const jfnt_layout_info info = {0};
+    size_t written;
+    if (utf8)
+    {
+        JFNT_TEST_CALL(jfnt_layout_run_utf8(font, &info, text, '?', RUN_LENGTH, quads, &written, NULL, NULL), JFNT_RESULT_SUCCESS);
+    }
+    else
+    {
+        JFNT_TEST_CALL(jfnt_layout_run_u32(font, &info, '?', RUN_LENGTH, codepoints, quads, &written, NULL, NULL), JFNT_RESULT_SUCCESS);
+    }
+    ASSERT(written == RUN_LENGTH);
+    jfnt_font_image(font, &atlas_w, &after_h, &atlas);
+    printf("Atlas grew from %u to %u rows during the run\n", before_h, after_h);
+    ASSERT(after_h > before_h);
+
+    int indices[RUN_LENGTH];
+    JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(font, '?', RUN_LENGTH, codepoints, indices), JFNT_RESULT_SUCCESS);
+    JFNT_TEST_CALL(jfnt_layout_run(font, &info, RUN_LENGTH, indices, from_indices, &written, NULL, NULL), JFNT_RESULT_SUCCESS);
+    for (unsigned i = 0; i < RUN_LENGTH; ++i)
+    {
+        ASSERT(quads[i].x0 == from_indices[i].x0 && quads[i].u0 == from_indices[i].u0 && quads[i].u1 == from_indices[i].u1);
+        ASSERT(close_enough(quads[i].v0, from_indices[i].v0) && close_enough(quads[i].v1, from_indices[i].v1));
+    }
+    jfnt_font_destroy(font);
+}
+
+int main()
+{
+    static const char TEXT[] = "Hello, world! gjpqy";
+    enum {LENGTH = sizeof(TEXT) - 1};
+    for (int flip = 0; flip < 2; ++flip)
+    {
+        jfnt_font* const font = create_font(flip);
+        const jfnt_glyph* const glyphs = jfnt_font_get_glyphs(font);
+        unsigned atlas_w, atlas_h;
+        const unsigned char* atlas;
+        jfnt_font_image(font, &atlas_w, &atlas_h, &atlas);
+
+        int indices[LENGTH];
+        size_t count;
+        JFNT_TEST_CALL(jfnt_font_find_glyphs_utf8(font, TEXT, '?', LENGTH, &count, indices), JFNT_RESULT_SUCCESS);
+        ASSERT(count == LENGTH);
+
+        for (int y_up = 0; y_up < 2; ++y_up)
+        {
+            struct vertex_T vertices[LENGTH];
+            memset(vertices, 0xAB, sizeof(vertices));
+            const jfnt_layout_info info = {.origin_x = 10.0f, .origin_y = 100.0f, .y_up = y_up, .stride = sizeof(*vertices)};
+            size_t written;
+            float pen_x, pen_y;
+            JFNT_TEST_CALL(jfnt_layout_run(font, &info, count, indices, vertices, &written, &pen_x, &pen_y), JFNT_RESULT_SUCCESS);
+            ASSERT(written == count);
+
+            //  Same as what every renderer did by hand before
+            float x = 10.0f;
+            for (size_t i = 0; i < count; ++i)
+            {
+                const jfnt_glyph* const g = glyphs + indices[i];
+                const jfnt_quad* const q = &vertices[i].quad;
+                ASSERT(q->x0 == x + g->left && q->x1 == q->x0 + g->w);
+                if (y_up)
+                {
+                    ASSERT(q->y0 == 100.0f + g->top && q->y1 == q->y0 - g->h);
+                }
+                else
+                {
+                    ASSERT(q->y0 == 100.0f - g->top && q->y1 == q->y0 + g->h);
+                }
+                ASSERT(close_enough(q->u0, (float)g->offset_x / (float)atlas_w));
+                ASSERT(close_enough(q->u1, (float)(g->offset_x + g->w) / (float)atlas_w));
+                const float v_top = (float)g->offset_y / (float)atlas_h;
+                const float v_bottom = (float)(g->offset_y + g->h) / (float)atlas_h;
+                ASSERT(close_enough(q->v0, flip ? v_bottom : v_top) && close_enough(q->v1, flip ? v_top : v_bottom));
+                //  Rest of the vertex is not touched
+                const unsigned char* const color = (const unsigned char*)vertices[i].color;
+                for (unsigned j = 0; j < sizeof(vertices[i].color); ++j)
+                {
+                    ASSERT(color[j] == 0xAB);
+                }
+                x += g->advance_x;
+            }
+            ASSERT(pen_x == x && pen_y == 100.0f);
+        }
+
+        //  Spaces have no pixels, so they are left out when asked to
+        jfnt_quad quads[LENGTH];
+        const jfnt_layout_info skip_info = {.skip_empty = 1};
+        size_t written;
+        JFNT_TEST_CALL(jfnt_layout_run_utf8(font, &skip_info, TEXT, '?', LENGTH, quads, &written, NULL, NULL), JFNT_RESULT_SUCCESS);
+        ASSERT(written == LENGTH - 2);
+
+        //  Codepoint variant gives the same quads as laying out the indices
+        char32_t codepoints[LENGTH];
+        for (unsigned i = 0; i < LENGTH; ++i)
+        {
+            codepoints[i] = (unsigned char)TEXT[i];
+        }
+        jfnt_quad from_indices[LENGTH];
+        const jfnt_layout_info plain_info = {0};
+        JFNT_TEST_CALL(jfnt_layout_run(font, &plain_info, count, indices, from_indices, &written, NULL, NULL), JFNT_RESULT_SUCCESS);
+        JFNT_TEST_CALL(jfnt_layout_run_u32(font, &plain_info, '?', LENGTH, codepoints, quads, &written, NULL, NULL), JFNT_RESULT_SUCCESS);
+        ASSERT(written == LENGTH && memcmp(quads, from_indices, sizeof(quads)) == 0);
+
+        const jfnt_layout_info bad_info = {.stride = sizeof(jfnt_quad) - 1};
+        JFNT_TEST_CALL(jfnt_layout_run(font, &bad_info, count, indices, quads, &written, NULL, NULL), JFNT_RESULT_BAD_ARGUMENT);
+
+        jfnt_font_destroy(font);
+    }
+    check_lazy_run(0);
+    check_lazy_run(1);
+    return 0;
+}
@@ -0,0 +1,130 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt_font.h"
+#include <string.h>
+
+static const jfnt_codepoint_range RANGES[] = {{.first = 0x20, .last = 0x7E}};
+//  None of these are in the ranges of the font, with the last block being noncharacters, which no face has
+static const jfnt_codepoint_range LOOKED_UP[] = {{.first = 0x400, .last = 0x52F}, {.first = 0x1E00, .last = 0x1EFF}, {.first = 0xFDD0, .last = 0xFDDF}};
+enum {LOOKUP_COUNT = (0x52F - 0x400 + 1) + (0x1EFF - 0x1E00 + 1) + (0xFDDF - 0xFDD0 + 1)};
+
+static void count_unsupported(jfnt_font* font, char32_t c, const char* msg, void* param)
+{
+    (void)font;
+    (void)c;
+    (void)msg;
+    *(unsigned*)param += 1;
+}
+
+static void look_up(const jfnt_font* font, int* indices)
+{
+    char32_t codepoints[LOOKUP_COUNT];
+    unsigned n = 0;
+    for (unsigned i = 0; i < sizeof(LOOKED_UP) / sizeof(*LOOKED_UP); ++i)
+    {
+        for (char32_t c = LOOKED_UP[i].first; c <= LOOKED_UP[i].last; ++c)
+        {
+            codepoints[n++] = c;
+        }
+    }
+    ASSERT(n == LOOKUP_COUNT);
+    JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(font, '?', n, codepoints, indices), JFNT_RESULT_SUCCESS);
+    const jfnt_glyph* const glyphs = jfnt_font_get_glyphs(font);
+    int i_replace;
+    const char32_t replace = '?';
+    JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(font, 0, 1, &replace, &i_replace), JFNT_RESULT_SUCCESS);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        ASSERT(glyphs[indices[i]].codepoint == codepoints[i] || indices[i] == i_replace);
+    }
+}
+
+int main()
+{
+    unsigned unsupported = 0;
+    const jfnt_error_callbacks callbacks =
+            {
+                    .report = test_report_callback,
+                    .unsupported_char = count_unsupported,
+                    .char_param = &unsupported,
+            };
+    const jfnt_font_create_info create_info =
+            {
+                    .n_ranges = 1,
+                    .codepoint_ranges = RANGES,
+                    .error_callbacks = &callbacks,
+                    .atlas_padding = 1,
+                    .lazy = 1,
+            };
+    jfnt_font* const font = test_create_font("DejaVu Sans:size=16", create_info, JFNT_RESULT_SUCCESS);
+    const unsigned initial_count = jfnt_font_get_glyph_count(font);
+    ASSERT(initial_count == RANGES[0].last - RANGES[0].first + 1);
+    unsigned first, count;
+    jfnt_font_take_new_glyphs(font, &first, &count);
+    ASSERT(count == 0);
+
+    //  Glyph of the font's ranges, which must stay where it was when the atlas grows
+    const char32_t a = 'A';
+    int i_a;
+    JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(font, 0, 1, &a, &i_a), JFNT_RESULT_SUCCESS);
+    const jfnt_glyph g_a = jfnt_font_get_glyphs(font)[i_a];
+    unsigned width, height;
+    const unsigned char* img;
+    jfnt_font_image(font, &width, &height, &img);
+    unsigned char* const pixels_a = malloc((size_t)g_a.w * g_a.h);
+    ASSERT(pixels_a);
+    for (unsigned row = 0; row < g_a.h; ++row)
+    {
+        memcpy(pixels_a + (size_t)row * g_a.w, img + (size_t)(g_a.offset_y + row) * width + g_a.offset_x, g_a.w);
+    }
+
+    //  Codepoints outside the ranges get their glyphs added to the end, and codepoints the face does not have are
+    //  reported once and replaced
+    int indices[LOOKUP_COUNT];
+    look_up(font, indices);
+    const unsigned loaded_count = jfnt_font_get_glyph_count(font);
+    const unsigned loaded_unsupported = unsupported;
+    printf("Lookup added %u glyphs, with %u codepoints unsupported\n", loaded_count - initial_count, unsupported);
+    ASSERT(unsupported >= 0xFDDF - 0xFDD0 + 1);
+    ASSERT(loaded_count > initial_count && loaded_count - initial_count + unsupported == LOOKUP_COUNT);
+    jfnt_font_take_new_glyphs(font, &first, &count);
+    ASSERT(first == initial_count && count == loaded_count - initial_count);
+    const jfnt_glyph* const glyphs = jfnt_font_get_glyphs(font);
+    for (unsigned i = first; i < first + count; ++i)
+    {
+        ASSERT(glyphs[i].codepoint >= 0x400);
+        for (unsigned j = first; j < i; ++j)
+        {
+            ASSERT(glyphs[i].codepoint != glyphs[j].codepoint);
+        }
+    }
+    ASSERT(memcmp(glyphs + i_a, &g_a, sizeof(g_a)) == 0);
+
+    //  Atlas grew down, without moving what was already in it
+    unsigned new_width, new_height;
+    jfnt_font_image(font, &new_width, &new_height, &img);
+    printf("Atlas grew from %ux%u to %ux%u\n", width, height, new_width, new_height);
+    ASSERT(new_width == width && new_height > height);
+    for (unsigned row = 0; row < g_a.h; ++row)
+    {
+        ASSERT(memcmp(pixels_a + (size_t)row * g_a.w, img + (size_t)(g_a.offset_y + row) * width + g_a.offset_x, g_a.w) == 0);
+    }
+    for (unsigned i = 0; i < loaded_count; ++i)
+    {
+        ASSERT(glyphs[i].offset_y + glyphs[i].h <= new_height);
+    }
+
+    //  Looking the same codepoints up again loads nothing
+    int again[LOOKUP_COUNT];
+    look_up(font, again);
+    ASSERT(memcmp(indices, again, sizeof(indices)) == 0);
+    ASSERT(jfnt_font_get_glyph_count(font) == loaded_count && unsupported == loaded_unsupported);
+    jfnt_font_take_new_glyphs(font, &first, &count);
+    ASSERT(first == loaded_count && count == 0);
+
+    free(pixels_a);
+    jfnt_font_destroy(font);
+    return 0;
+}
@@ -0,0 +1,80 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt_font.h"
+
+static const jfnt_codepoint_range RANGES[] = {{.first = 0x20, .last = 0x7E}, {.first = 0x400, .last = 0x4FF}};
+
+static jfnt_font* create_font(int lazy)
+{
+    const jfnt_font_create_info create_info =
+            {
+                    .n_ranges = 2,
+                    .codepoint_ranges = RANGES,
+                    .lazy = lazy,
+            };
+    return test_create_font("DejaVu Sans:size=16", create_info, JFNT_RESULT_SUCCESS);
+}
+
+static char32_t highest_codepoint(const jfnt_font* font)
+{
+    const jfnt_glyph* const glyphs = jfnt_font_get_glyphs(font);
+    char32_t highest = 0;
+    for (unsigned i = 0; i < jfnt_font_get_glyph_count(font); ++i)
+    {
+        if (glyphs[i].codepoint > highest)
+        {
+            highest = glyphs[i].codepoint;
+        }
+    }
+    return highest;
+}
+
+//  Codepoints which the font has no glyphs for, nor can it load them, all resolve to the replacement
+static void check_unsupported(const jfnt_font* font, unsigned count, const char32_t* codepoints)
+{
+    const unsigned glyph_count = jfnt_font_get_glyph_count(font);
+    const char32_t replace = '?';
+    int i_replace;
+    JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(font, 0, 1, &replace, &i_replace), JFNT_RESULT_SUCCESS);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        int idx = -1;
+        JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(font, replace, 1, codepoints + i, &idx), JFNT_RESULT_SUCCESS);
+        ASSERT(idx == i_replace);
+    }
+    ASSERT(jfnt_font_get_glyph_count(font) == glyph_count);
+}
+
+//  Table is within the bound its documentation gives for the highest codepoint it covers
+static void check_memory(const jfnt_font* font, char32_t highest, unsigned min_pages)
+{
+    const size_t memory = jfnt_font_get_lookup_memory(font);
+    const size_t bound = ((size_t)highest / 256 + 1) * (sizeof(void*) + 1024);
+    printf("Lookup up to U+%04X takes %zu bytes, bound is %zu\n", (unsigned)highest, memory, bound);
+    ASSERT(memory <= bound);
+    ASSERT(memory >= (size_t)min_pages * 1024);
+}
+
+int main()
+{
+    //  Eager font only has its ranges, so anything above its last glyph, on pages between its ranges, or past the
+    //  last codepoint there is, must not be found
+    jfnt_font* const eager = create_font(0);
+    const char32_t highest = highest_codepoint(eager);
+    ASSERT(highest <= RANGES[1].last);
+    const char32_t eager_missing[] = {highest + 1, RANGES[1].last + 1, 0x100, 0x2FF, 0xFFFF, 0x10FFFF, 0x110000, 0xFFFFFFFF};
+    check_unsupported(eager, sizeof(eager_missing) / sizeof(*eager_missing), eager_missing);
+    check_memory(eager, highest, 2);
+    jfnt_font_destroy(eager);
+
+    //  Lazy font covers all codepoints, and tries to load ones it has not seen, but that never adds glyphs for
+    //  noncharacters or codepoints past U+10FFFF
+    jfnt_font* const lazy = create_font(1);
+    const char32_t lazy_missing[] = {0xFDD0, 0xFFFF, 0x10FFFE, 0x10FFFF, 0x110000, 0xFFFFFFFF};
+    check_unsupported(lazy, sizeof(lazy_missing) / sizeof(*lazy_missing), lazy_missing);
+    check_memory(lazy, 0x10FFFF, 2);
+    jfnt_font_destroy(lazy);
+    return 0;
+}
@@ -0,0 +1,123 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt_font.h"
+#include <string.h>
+
+static const jfnt_codepoint_range RANGES[] = {{.first = 0x20, .last = 0x17F}};
+
+static jfnt_font* create_font(jfnt_pixel_format format, int lazy, jfnt_render_mode render_mode, jfnt_result expected)
+{
+    const jfnt_font_create_info create_info =
+            {
+                    .n_ranges = lazy ? 0 : 1,
+                    .codepoint_ranges = RANGES,
+                    .atlas_padding = 1,
+                    .lazy = lazy,
+                    .pixel_format = format,
+                    .render_mode = render_mode,
+            };
+    return test_create_font("DejaVu Sans Mono:pixelsize=16", create_info, expected);
+}
+
+//  Reads the whole atlas as 8-bit coverage, checking that its rows are as long as the format needs
+static unsigned char* read_atlas(const jfnt_font* font, jfnt_pixel_format format, unsigned* p_w, unsigned* p_h)
+{
+    unsigned w, h;
+    const unsigned char* img;
+    jfnt_font_image(font, &w, &h, &img);
+    size_t stride;
+    jfnt_pixel_format actual_format;
+    jfnt_font_get_image_layout(font, &stride, &actual_format);
+    ASSERT(actual_format == format);
+    ASSERT(stride == ((size_t)w * jfnt_pixel_format_bits(format) + 7) / 8);
+    unsigned char* const pixels = malloc((size_t)w * h);
+    ASSERT(pixels);
+    jfnt_font_image_to_r8(font, 0, 0, w, h, pixels, w);
+    *p_w = w;
+    *p_h = h;
+    return pixels;
+}
+
+//  Reading any part of the atlas, whether it begins and ends on whole bytes or not, gives the same pixels as reading all
+static void check_parts(const jfnt_font* font, const unsigned char* pixels, unsigned w, unsigned h)
+{
+    unsigned char part[256];
+    for (unsigned x = 0; x < 16 && x < w; ++x)
+    {
+        for (unsigned pw = 1; pw <= 200 && x + pw <= w; pw += 13)
+        {
+            const unsigned y = h / 2;
+            jfnt_font_image_to_r8(font, x, y, pw, 1, part, sizeof(part));
+            ASSERT(memcmp(part, pixels + (size_t)y * w + x, pw) == 0);
+        }
+    }
+}
+
+int main()
+{
+    ASSERT(jfnt_pixel_format_bits(JFNT_PIXEL_FORMAT_R8) == 8 && jfnt_pixel_format_bits(JFNT_PIXEL_FORMAT_RGBA8) == 32);
+    ASSERT(jfnt_pixel_format_bits(JFNT_PIXEL_FORMAT_R4) == 4 && jfnt_pixel_format_bits(JFNT_PIXEL_FORMAT_R1) == 1);
+    ASSERT(jfnt_pixel_format_bits((jfnt_pixel_format)42) == 0);
+
+    jfnt_font* const reference = create_font(JFNT_PIXEL_FORMAT_R8, 0, JFNT_RENDER_MODE_COVERAGE, JFNT_RESULT_SUCCESS);
+    unsigned ref_w, ref_h;
+    unsigned char* const ref_pixels = read_atlas(reference, JFNT_PIXEL_FORMAT_R8, &ref_w, &ref_h);
+
+    //  Same glyphs in the same places, with coverage rounded to 16 levels
+    jfnt_font* font = create_font(JFNT_PIXEL_FORMAT_R4, 0, JFNT_RENDER_MODE_COVERAGE, JFNT_RESULT_SUCCESS);
+    unsigned w, h;
+    unsigned char* pixels = read_atlas(font, JFNT_PIXEL_FORMAT_R4, &w, &h);
+    ASSERT(w == ref_w && h == ref_h);
+    for (size_t i = 0; i < (size_t)w * h; ++i)
+    {
+        ASSERT(pixels[i] == (ref_pixels[i] * 15 + 127) / 255 * 17);
+    }
+    check_parts(font, pixels, w, h);
+    free(pixels);
+    jfnt_font_destroy(font);
+
+    //  Monochrome rendering is hinted differently, so glyphs only have to be there, with nothing but full coverage
+    font = create_font(JFNT_PIXEL_FORMAT_R1, 0, JFNT_RENDER_MODE_COVERAGE, JFNT_RESULT_SUCCESS);
+    pixels = read_atlas(font, JFNT_PIXEL_FORMAT_R1, &w, &h);
+    size_t covered = 0;
+    for (size_t i = 0; i < (size_t)w * h; ++i)
+    {
+        ASSERT(pixels[i] == 0 || pixels[i] == 0xFF);
+        covered += pixels[i] != 0;
+    }
+    ASSERT(covered > 0);
+    check_parts(font, pixels, w, h);
+    printf("Atlas of %u x %u takes %zu bytes as R8 and %zu bytes as R1\n", w, h, (size_t)ref_w * ref_h, (size_t)h * ((w + 7) / 8));
+    free(pixels);
+    jfnt_font_destroy(font);
+
+    //  Lazily loaded glyphs are expanded before they are written
+    font = create_font(JFNT_PIXEL_FORMAT_R1, 1, JFNT_RENDER_MODE_COVERAGE, JFNT_RESULT_SUCCESS);
+    const char32_t c = 'W';
+    int idx;
+    JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(font, '?', 1, &c, &idx), JFNT_RESULT_SUCCESS);
+    const jfnt_glyph* const g = jfnt_font_get_glyphs(font) + idx;
+    ASSERT(g->w > 0 && g->h > 0);
+    unsigned char glyph_pixels[64 * 64];
+    ASSERT(g->w <= 64 && g->h <= 64);
+    jfnt_font_image_to_r8(font, g->offset_x, g->offset_y, g->w, g->h, glyph_pixels, 64);
+    covered = 0;
+    for (unsigned y = 0; y < g->h; ++y)
+    {
+        for (unsigned x = 0; x < g->w; ++x)
+        {
+            ASSERT(glyph_pixels[y * 64 + x] == 0 || glyph_pixels[y * 64 + x] == 0xFF);
+            covered += glyph_pixels[y * 64 + x] != 0;
+        }
+    }
+    ASSERT(covered > 0);
+    jfnt_font_destroy(font);
+
+    ASSERT(create_font(JFNT_PIXEL_FORMAT_R1, 0, JFNT_RENDER_MODE_SDF, JFNT_RESULT_BAD_ARGUMENT) == NULL);
+
+    free(ref_pixels);
+    jfnt_font_destroy(reference);
+    return 0;
+}
@@ -0,0 +1,53 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt_font.h"
+#include <string.h>
+
+enum {TEST_RANGE_FIRST = 0, TEST_RANGE_LAST = 0x52F};
+
+static jfnt_font* create_font(unsigned thread_count)
+{
+    const jfnt_codepoint_range ranges[] =
+            {
+                    [0] = { .first = TEST_RANGE_FIRST, .last = TEST_RANGE_LAST },
+                    [1] = { .first = 0x2000, .last = 0x22FF },
+            };
+    const jfnt_font_create_info create_info =
+            {
+                    .n_ranges = sizeof(ranges) / sizeof(*ranges),
+                    .codepoint_ranges = ranges,
+                    .flip = 1,
+                    .atlas_padding = 1,
+                    .thread_count = thread_count,
+            };
+    return test_create_font("Monospace:size=24", create_info, JFNT_RESULT_SUCCESS);
+}
+
+int main()
+{
+    //  Fonts rasterized on multiple threads must be identical to the one rasterized on a single thread
+    jfnt_font* const serial = create_font(1);
+    const unsigned count = jfnt_font_get_glyph_count(serial);
+    unsigned w, h;
+    const unsigned char* img;
+    jfnt_font_image(serial, &w, &h, &img);
+
+    const unsigned thread_counts[] = {2, 3, 4, 8};
+    for (unsigned i = 0; i < sizeof(thread_counts) / sizeof(*thread_counts); ++i)
+    {
+        jfnt_font* const parallel = create_font(thread_counts[i]);
+        ASSERT(jfnt_font_get_glyph_count(parallel) == count);
+        ASSERT(memcmp(jfnt_font_get_glyphs(parallel), jfnt_font_get_glyphs(serial), sizeof(jfnt_glyph) * count) == 0);
+        unsigned pw, ph;
+        const unsigned char* pimg;
+        jfnt_font_image(parallel, &pw, &ph, &pimg);
+        ASSERT(pw == w && ph == h);
+        ASSERT(memcmp(pimg, img, (size_t)w * h) == 0);
+        jfnt_font_destroy(parallel);
+    }
+
+    jfnt_font_destroy(serial);
+    return 0;
+}
@@ -29,6 +29,7 @@ int main()
                     .codepoint_ranges = ranges,
                     .error_callbacks = &err_callbacks,
                     .flip = 1,
+                    .atlas_padding = 1,
             };
 
     //  Create the font
@@ -38,14 +39,20 @@ int main()
     const jfnt_glyph* glyphs = jfnt_font_get_glyphs(font_monospace_fc);
     setlocale(LC_ALL, "en_US.utf8");
 
-    for (unsigned i = 0; i < (TEST_RANGE_LAST - TEST_RANGE_FIRST + 1); ++i)
+    const unsigned glyph_count = jfnt_font_get_glyph_count(font_monospace_fc);
+    ASSERT(glyph_count <= (TEST_RANGE_LAST - TEST_RANGE_FIRST + 1));
+    for (unsigned i = 0; i < glyph_count; ++i)
     {
         jfnt_glyph g = glyphs[i];
         printf(
-                "Glyph %u: {.codepoint = \"%lc\", .top = %hd, .left = %hd, .w = %hu, .h = %hu, advance_x = %hu, .advance_y = %hu, .offset_x = %u}\n",
-                i, g.codepoint, g.top, g.left, g.w, g.h, g.advance_x, g.advance_y, g.offset_x);
+                "Glyph %u: {.codepoint = \"%lc\", .top = %hd, .left = %hd, .w = %hu, .h = %hu, advance_x = %hu, .advance_y = %hu, .offset_x = %u, .offset_y = %u}\n",
+                i, g.codepoint, g.top, g.left, g.w, g.h, g.advance_x, g.advance_y, g.offset_x, g.offset_y);
     }
 
+    size_t glyph_pixels, atlas_pixels;
+    const double fill_ratio = jfnt_font_get_atlas_usage(font_monospace_fc, &glyph_pixels, &atlas_pixels);
+    printf("Atlas fill: %zu of %zu pixels (%.1f %%)\n", glyph_pixels, atlas_pixels, 100.0 * fill_ratio);
+
     FILE* const f_out = fopen("raster_test.png", "wb");
     ASSERT(f_out != NULL);
 
@@ -0,0 +1,55 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt_font.h"
+
+static const jfnt_codepoint_range RANGES[] = {{.first = 0x20, .last = 0x7E}};
+static const jfnt_codepoint_range MORE_RANGES[] = {{.first = 0x400, .last = 0x4FF}};
+
+//  Fonts with more threads allocate from all of them, which the counts allow for
+static jfnt_font* create_font(test_allocator* counts, int lazy, size_t budget, unsigned thread_count)
+{
+    const jfnt_allocator_callbacks allocator = test_allocator_callbacks(counts);
+    const jfnt_font_create_info create_info =
+            {
+                    .allocator_callbacks = &allocator,
+                    .n_ranges = 1,
+                    .codepoint_ranges = RANGES,
+                    .lazy = lazy,
+                    .atlas_budget = budget,
+                    .thread_count = thread_count,
+            };
+    return test_create_font("DejaVu Sans:size=16", create_info, JFNT_RESULT_SUCCESS);
+}
+
+int main()
+{
+    //  Nothing is left behind by creation or by adding ranges, whether scratch is kept by the font or not
+    for (int lazy = 0; lazy < 2; ++lazy)
+    {
+        for (unsigned thread_count = 1; thread_count <= 4; thread_count *= 4)
+        {
+            test_allocator counts = {0};
+            jfnt_font* const font = create_font(&counts, lazy, 0, thread_count);
+            printf("Font with lazy = %d and %u threads was created with %zu allocations\n", lazy, thread_count, counts.allocations);
+            unsigned count_rects;
+            const jfnt_atlas_rect* rects;
+            JFNT_TEST_CALL(jfnt_font_add_ranges(font, 1, MORE_RANGES, &count_rects, &rects), JFNT_RESULT_SUCCESS);
+            jfnt_font_destroy(font);
+            ASSERT(counts.live == 0);
+        }
+    }
+
+    //  Errors which fit the stack buffer are reported without allocating
+    test_allocator counts = {0};
+    jfnt_font* const font = create_font(&counts, 1, 512 * 512, 1);
+    const size_t before = counts.allocations;
+    unsigned count_rects;
+    const jfnt_atlas_rect* rects;
+    JFNT_TEST_CALL(jfnt_font_add_ranges(font, 1, MORE_RANGES, &count_rects, &rects), JFNT_RESULT_UNSUPPORTED);
+    ASSERT(counts.allocations == before);
+    jfnt_font_destroy(font);
+    ASSERT(counts.live == 0);
+    return 0;
+}
@@ -0,0 +1,141 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt.h"
+#include <string.h>
+
+static const jfnt_codepoint_range RANGES[] = {{.first = 0x20, .last = 0x7E}};
+static jfnt_font* create_font(
+        jfnt_context* context, jfnt_render_mode mode, unsigned spread, int lazy, jfnt_result expected)
+{
+    const jfnt_font_create_info create_info =
+            {
+                    .n_ranges = sizeof(RANGES) / sizeof(*RANGES),
+                    .codepoint_ranges = RANGES,
+                    .render_mode = mode,
+                    .sdf_spread = spread,
+                    .lazy = lazy,
+                    .context = context,
+            };
+    return test_create_font("DejaVu Sans:size=40", create_info, expected);
+}
+
+static const jfnt_glyph* find_glyph(const jfnt_font* font, char32_t c)
+{
+    int idx;
+    ASSERT(jfnt_font_find_glyphs_u32(font, 0, 1, &c, &idx) == JFNT_RESULT_SUCCESS);
+    ASSERT(idx >= 0);
+    return jfnt_font_get_glyphs(font) + idx;
+}
+
+static unsigned char atlas_pixel(const jfnt_font* font, const jfnt_glyph* g, unsigned x, unsigned y)
+{
+    unsigned w, h;
+    const unsigned char* data;
+    jfnt_font_image(font, &w, &h, &data);
+    return data[(size_t)(g->offset_y + y) * w + g->offset_x + x];
+}
+
+//  Distance field of a glyph goes from outside at its edges, over 128 at the outline, to inside
+static void check_distance_field(const jfnt_font* font, const jfnt_glyph* g, unsigned spread)
+{
+    ASSERT(g->w > 2 * spread && g->h > 2 * spread);
+    unsigned char max = 0;
+    for (unsigned y = 0; y < g->h; ++y)
+    {
+        for (unsigned x = 0; x < g->w; ++x)
+        {
+            const unsigned char v = atlas_pixel(font, g, x, y);
+            max = v > max ? v : max;
+        }
+    }
+    ASSERT(max > 128);
+    ASSERT(atlas_pixel(font, g, 0, 0) < 128);
+    ASSERT(atlas_pixel(font, g, g->w - 1, g->h - 1) < 128);
+}
+
+int main()
+{
+    jfnt_font* const coverage = create_font(NULL, JFNT_RENDER_MODE_COVERAGE, 0, 0, JFNT_RESULT_SUCCESS);
+    jfnt_font* const sdf = create_font(NULL, JFNT_RENDER_MODE_SDF, 6, 0, JFNT_RESULT_SUCCESS);
+    unsigned spread;
+    float pixel_size;
+    ASSERT(jfnt_font_get_render_mode(coverage, &spread, &pixel_size) == JFNT_RENDER_MODE_COVERAGE && spread == 0);
+    ASSERT(jfnt_font_get_render_mode(sdf, &spread, &pixel_size) == JFNT_RENDER_MODE_SDF && spread == 6);
+    ASSERT(pixel_size > 0.0f);
+
+    //  Distance field glyphs are extended by the spread on each side
+    static const char TEXT[] = "AHWgo";
+    for (const char* p = TEXT; *p; ++p)
+    {
+        const jfnt_glyph* const c = find_glyph(coverage, (char32_t)*p);
+        const jfnt_glyph* const s = find_glyph(sdf, (char32_t)*p);
+        check_distance_field(sdf, s, 6);
+        //  Distance field is of the unhinted outline, so it may be off by a pixel or so
+        ASSERT(s->w >= c->w + 2 * 6 - 2 && s->w <= c->w + 2 * 6 + 2);
+        ASSERT(s->left >= c->left - 6 - 2 && s->left <= c->left - 6 + 2);
+        ASSERT(s->top >= c->top + 6 - 2 && s->top <= c->top + 6 + 2);
+        ASSERT(s->advance_x >= c->advance_x - 1 && s->advance_x <= c->advance_x + 1);
+    }
+
+    //  Laying out at twice the scale doubles every metric
+    {
+        int indices[sizeof(TEXT) - 1];
+        size_t count;
+        JFNT_TEST_CALL(jfnt_font_find_glyphs_utf8(sdf, TEXT, '?', sizeof(TEXT) - 1, &count, indices), JFNT_RESULT_SUCCESS);
+        jfnt_quad normal[sizeof(TEXT) - 1], doubled[sizeof(TEXT) - 1];
+        jfnt_layout_info info = {.kerning = 1};
+        float end_normal, end_doubled;
+        size_t written;
+        JFNT_TEST_CALL(jfnt_layout_run(sdf, &info, count, indices, normal, &written, &end_normal, NULL), JFNT_RESULT_SUCCESS);
+        info.scale = 2.0f;
+        JFNT_TEST_CALL(jfnt_layout_run(sdf, &info, count, indices, doubled, &written, &end_doubled, NULL), JFNT_RESULT_SUCCESS);
+        for (size_t i = 0; i < count; ++i)
+        {
+            ASSERT(doubled[i].x0 == 2 * normal[i].x0 && doubled[i].x1 == 2 * normal[i].x1);
+            ASSERT(doubled[i].y0 == 2 * normal[i].y0 && doubled[i].y1 == 2 * normal[i].y1);
+            ASSERT(doubled[i].u0 == normal[i].u0 && doubled[i].v1 == normal[i].v1);
+        }
+        ASSERT(end_doubled == 2 * end_normal);
+        info.scale = -1.0f;
+        JFNT_TEST_CALL(jfnt_layout_run(sdf, &info, count, indices, doubled, &written, &end_doubled, NULL), JFNT_RESULT_BAD_ARGUMENT);
+    }
+
+    //  Fonts sharing a context each render with their own mode and spread, also when loading lazily
+    {
+        jfnt_context* context;
+        JFNT_TEST_CALL(jfnt_context_create(NULL, &context), JFNT_RESULT_SUCCESS);
+        jfnt_font* const shared_sdf = create_font(context, JFNT_RENDER_MODE_SDF, 6, 1, JFNT_RESULT_SUCCESS);
+        jfnt_font* const shared_wide = create_font(context, JFNT_RENDER_MODE_SDF, 12, 1, JFNT_RESULT_SUCCESS);
+        jfnt_font* const shared_coverage = create_font(context, JFNT_RENDER_MODE_COVERAGE, 0, 1, JFNT_RESULT_SUCCESS);
+        const jfnt_glyph* const a_shared = find_glyph(shared_sdf, 'A');
+        const jfnt_glyph* const a_alone = find_glyph(sdf, 'A');
+        ASSERT(a_shared->w == a_alone->w && a_shared->h == a_alone->h);
+        ASSERT(a_shared->left == a_alone->left && a_shared->top == a_alone->top);
+        static const char32_t LATER[] = {0xE9, 0x416, 0x3A9};
+        for (unsigned i = 0; i < sizeof(LATER) / sizeof(*LATER); ++i)
+        {
+            const jfnt_glyph* const c = find_glyph(shared_coverage, LATER[i]);
+            const jfnt_glyph* const narrow = find_glyph(shared_sdf, LATER[i]);
+            const jfnt_glyph* const wide = find_glyph(shared_wide, LATER[i]);
+            check_distance_field(shared_sdf, narrow, 6);
+            check_distance_field(shared_wide, wide, 12);
+            ASSERT(wide->w == narrow->w + 2 * 6);
+            ASSERT(c->w < narrow->w);
+        }
+        jfnt_font_destroy(shared_coverage);
+        jfnt_font_destroy(shared_wide);
+        jfnt_font_destroy(shared_sdf);
+        jfnt_context_destroy(context);
+    }
+
+    //  Options which can not work are rejected
+    ASSERT(create_font(NULL, JFNT_RENDER_MODE_MSDF, 0, 0, JFNT_RESULT_UNSUPPORTED) == NULL);
+    ASSERT(create_font(NULL, JFNT_RENDER_MODE_SDF, 1, 0, JFNT_RESULT_BAD_ARGUMENT) == NULL);
+    ASSERT(create_font(NULL, JFNT_RENDER_MODE_SDF, 33, 0, JFNT_RESULT_BAD_ARGUMENT) == NULL);
+
+    jfnt_font_destroy(sdf);
+    jfnt_font_destroy(coverage);
+    return 0;
+}
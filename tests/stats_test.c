@@ -0,0 +1,78 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt_font.h"
+#include <string.h>
+
+//  Private use area has no glyphs in DejaVu Sans
+static const jfnt_codepoint_range RANGES[] = {{.first = 0x20, .last = 0x7E}, {.first = 0xE000, .last = 0xE00F}};
+
+static jfnt_font* create_font(int collect_stats, int lazy)
+{
+    const jfnt_font_create_info create_info =
+            {
+                    .n_ranges = lazy ? 0 : 2,
+                    .codepoint_ranges = RANGES,
+                    .lazy = lazy,
+                    .collect_stats = collect_stats,
+            };
+    return test_create_font("DejaVu Sans:size=16", create_info, JFNT_RESULT_SUCCESS);
+}
+
+static void print_stats(const jfnt_font_stats* stats)
+{
+    for (jfnt_phase phase = JFNT_PHASE_MATCH; phase < JFNT_PHASE_COUNT; ++phase)
+    {
+        printf("%10s: %8.3f ms\n", jfnt_phase_name(phase), (double)stats->phase_ns[phase] / 1e6);
+    }
+    printf("%zu glyphs rasterized, %zu missed, %zu allocations of %zu bytes, %zu lookups (%zu loaded, %zu unsupported), atlas %.1f%% full\n",
+           stats->glyphs_rasterized, stats->glyphs_missed, stats->allocations, stats->bytes_allocated, stats->lookups,
+           stats->lookups_loaded, stats->lookups_unsupported, stats->atlas_fill * 100.0);
+}
+
+int main()
+{
+    jfnt_font_stats stats;
+    const char32_t text[] = {'H', 'i', 0xE000, 'H'};
+    int indices[4];
+
+    jfnt_font* font = create_font(1, 0);
+    jfnt_font_get_stats(font, &stats);
+    print_stats(&stats);
+    ASSERT(stats.phase_ns[JFNT_PHASE_MATCH] > 0 && stats.phase_ns[JFNT_PHASE_OPEN_FACE] > 0);
+    ASSERT(stats.phase_ns[JFNT_PHASE_RASTERIZE] > 0 && stats.phase_ns[JFNT_PHASE_PACK] > 0);
+    ASSERT(stats.phase_ns[JFNT_PHASE_CACHE] == 0);
+    ASSERT(stats.glyphs_rasterized == jfnt_font_get_glyph_count(font));
+    ASSERT(stats.glyphs_missed == RANGES[1].last - RANGES[1].first + 1);
+    ASSERT(stats.allocations > 0 && stats.bytes_allocated > 0);
+    ASSERT(stats.lookups == 0 && stats.atlas_fill > 0.0);
+    JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(font, '?', 4, text, indices), JFNT_RESULT_SUCCESS);
+    jfnt_font_get_stats(font, &stats);
+    ASSERT(stats.lookups >= 4 && stats.lookups_unsupported == 1 && stats.lookups_loaded == 0);
+    jfnt_font_destroy(font);
+
+    //  Lazy fonts count the glyphs they load as they are first looked up
+    font = create_font(1, 1);
+    JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(font, '?', 4, text, indices), JFNT_RESULT_SUCCESS);
+    jfnt_font_get_stats(font, &stats);
+    print_stats(&stats);
+    ASSERT(stats.lookups_loaded == 4 && stats.lookups_unsupported == 1);
+    ASSERT(stats.glyphs_rasterized == jfnt_font_get_glyph_count(font) && stats.glyphs_missed == 1);
+    ASSERT(stats.phase_ns[JFNT_PHASE_RASTERIZE] > 0 && stats.phase_ns[JFNT_PHASE_BLIT] > 0);
+    jfnt_font_destroy(font);
+
+    //  Nothing is collected unless asked for
+    font = create_font(0, 0);
+    JFNT_TEST_CALL(jfnt_font_find_glyphs_u32(font, '?', 4, text, indices), JFNT_RESULT_SUCCESS);
+    jfnt_font_get_stats(font, &stats);
+    for (jfnt_phase phase = JFNT_PHASE_MATCH; phase < JFNT_PHASE_COUNT; ++phase)
+    {
+        ASSERT(stats.phase_ns[phase] == 0);
+    }
+    ASSERT(stats.glyphs_rasterized == 0 && stats.allocations == 0 && stats.lookups == 0 && stats.atlas_fill == 0.0);
+    jfnt_font_destroy(font);
+
+    ASSERT(strcmp(jfnt_phase_name(JFNT_PHASE_RASTERIZE), "rasterize") == 0);
+    return 0;
+}
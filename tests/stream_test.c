@@ -0,0 +1,90 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../include/jfnt_font.h"
+#include <string.h>
+
+static const char TEXT[] =
+        "plain ASCII, Größe und Übung, Съешь же ещё этих булок, 敏捷的棕色狐狸, 😀🚀🌍 and back to ASCII\n"
+        "\xF0\x9F\xA6\x8A\xE2\x9C\xA8\xC3\xA9\xE4\xB8\xAD";
+
+enum {MAX_INDICES = sizeof(TEXT)};
+
+//  Feeds the text in chunks of chunk_size, asking for at most max_count indices at a time
+static size_t decode_in_chunks(const jfnt_font* font, size_t size, const char* text, size_t chunk_size, size_t max_count, int* indices)
+{
+    jfnt_utf8_stream stream;
+    jfnt_utf8_stream_reset(&stream);
+    size_t count = 0;
+    for (size_t chunk = 0; chunk < size; chunk += chunk_size)
+    {
+        const size_t chunk_end = chunk + chunk_size < size ? chunk + chunk_size : size;
+        size_t pos = chunk;
+        do
+        {
+            size_t consumed, found;
+            JFNT_TEST_CALL(jfnt_font_find_glyphs_utf8_stream(font, &stream, chunk_end - pos, text + pos, '?', max_count, indices + count, &consumed, &found), JFNT_RESULT_SUCCESS);
+            ASSERT(consumed <= chunk_end - pos);
+            //  Either all of the chunk is used up, or the output was filled
+            ASSERT(consumed == chunk_end - pos || found == max_count);
+            pos += consumed;
+            count += found;
+        } while (pos < chunk_end);
+    }
+    ASSERT(stream.count_pending == 0);
+    return count;
+}
+
+int main()
+{
+    const jfnt_codepoint_range ranges[] = {{.first = 0x20, .last = 0x52F}};
+    const jfnt_font_create_info create_info =
+            {
+                    .n_ranges = sizeof(ranges) / sizeof(*ranges),
+                    .codepoint_ranges = ranges,
+                    .lazy = 1,
+            };
+    jfnt_font* const font = test_create_font("Monospace:size=12", create_info, JFNT_RESULT_SUCCESS);
+
+    int expected[MAX_INDICES];
+    size_t expected_count;
+    JFNT_TEST_CALL(jfnt_font_find_glyphs_utf8(font, TEXT, '?', MAX_INDICES, &expected_count, expected), JFNT_RESULT_SUCCESS);
+
+    //  Every way of cutting the text up must give the same result as decoding all of it at once
+    const size_t size = sizeof(TEXT) - 1;
+    for (size_t chunk_size = 1; chunk_size <= 17; ++chunk_size)
+    {
+        const size_t max_counts[] = {1, 3, MAX_INDICES};
+        for (unsigned i = 0; i < sizeof(max_counts) / sizeof(*max_counts); ++i)
+        {
+            int indices[MAX_INDICES];
+            const size_t count = decode_in_chunks(font, size, TEXT, chunk_size, max_counts[i], indices);
+            ASSERT(count == expected_count);
+            ASSERT(memcmp(indices, expected, sizeof(*indices) * count) == 0);
+        }
+    }
+
+    //  Sequence which only turns out to be invalid in the next chunk
+    {
+        jfnt_utf8_stream stream;
+        jfnt_utf8_stream_reset(&stream);
+        int indices[4];
+        size_t consumed, found;
+        JFNT_TEST_CALL(jfnt_font_find_glyphs_utf8_stream(font, &stream, 2, "a\xE2", '?', 4, indices, &consumed, &found), JFNT_RESULT_SUCCESS);
+        ASSERT(consumed == 2 && found == 1 && stream.count_pending == 1);
+        JFNT_TEST_CALL(jfnt_font_find_glyphs_utf8_stream(font, &stream, 2, "\x82" "b", '?', 4, indices, &consumed, &found), JFNT_RESULT_BAD_ENCODING);
+        ASSERT(consumed == 1 && stream.count_pending == 0);
+        JFNT_TEST_CALL(jfnt_font_find_glyphs_utf8_stream(font, &stream, 1, "b", '?', 4, indices, &consumed, &found), JFNT_RESULT_SUCCESS);
+        ASSERT(consumed == 1 && found == 1);
+
+        //  Overlong and surrogate sequences are rejected at their position
+        JFNT_TEST_CALL(jfnt_font_find_glyphs_utf8_stream(font, &stream, 3, "x\xC0\x80", '?', 4, indices, &consumed, &found), JFNT_RESULT_BAD_ENCODING);
+        ASSERT(consumed == 1 && found == 1);
+        JFNT_TEST_CALL(jfnt_font_find_glyphs_utf8_stream(font, &stream, 3, "\xED\xA0\x80", '?', 4, indices, &consumed, &found), JFNT_RESULT_BAD_ENCODING);
+        ASSERT(consumed == 0 && found == 0);
+    }
+
+    jfnt_font_destroy(font);
+    return 0;
+}
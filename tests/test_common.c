@@ -3,6 +3,8 @@
 //
 
 #include "test_common.h"
+#include <string.h>
+#include <fontconfig/fontconfig.h>
 
 void test_report_callback(const char* msg, const char* function, const char* file, int line, void* param)
 {
@@ -15,3 +17,107 @@ void test_unsupported_char(jfnt_font* font, char32_t c, const char* msg, void* p
     (void) param;
     fprintf(stderr, "Unsupported char \"%lc\" by font %p, reason: %s\n", (wchar_t)c, font, msg);
 }
+
+char* test_find_font_file(const char* name)
+{
+    FcPattern* const pattern = FcNameParse((const FcChar8*)name);
+    ASSERT(pattern);
+    FcConfigSubstitute(NULL, pattern, FcMatchPattern);
+    FcDefaultSubstitute(pattern);
+    FcResult result;
+    FcPattern* const match = FcFontMatch(NULL, pattern, &result);
+    ASSERT(match);
+    FcChar8* file;
+    ASSERT(FcPatternGetString(match, FC_FILE, 0, &file) == FcResultMatch);
+    char* const path = strdup((const char*)file);
+    FcPatternDestroy(match);
+    FcPatternDestroy(pattern);
+    return path;
+}
+
+jfnt_font* test_create_font(const char* fc_str, jfnt_font_create_info create_info, jfnt_result expected)
+{
+    static const jfnt_error_callbacks callbacks = {.report = test_report_callback};
+    if (!create_info.error_callbacks)
+    {
+        create_info.error_callbacks = &callbacks;
+    }
+    jfnt_font* font = NULL;
+    JFNT_TEST_CALL(jfnt_font_create_from_fc_str(fc_str, create_info, &font), expected);
+    return expected == JFNT_RESULT_SUCCESS ? font : NULL;
+}
+
+//  Size of each allocation is kept in front of it, so that live bytes can be tracked on release
+union test_size_header_T
+{
+    size_t size;
+    long double align;
+};
+
+static void test_count_bytes(test_allocator* counts, size_t old_size, size_t new_size)
+{
+    //  Sizes wrap around when they shrink, which adds up right all the same
+    const size_t live_bytes = __atomic_add_fetch(&counts->live_bytes, new_size - old_size, __ATOMIC_RELAXED);
+    size_t peak = __atomic_load_n(&counts->peak_bytes, __ATOMIC_RELAXED);
+    while (live_bytes > peak && !__atomic_compare_exchange_n(&counts->peak_bytes, &peak, live_bytes, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+static void* test_allocate(void* state, size_t size)
+{
+    test_allocator* const counts = state;
+    __atomic_fetch_add(&counts->allocations, 1, __ATOMIC_RELAXED);
+    union test_size_header_T* const header = malloc(sizeof(*header) + size);
+    if (!header)
+    {
+        return NULL;
+    }
+    header->size = size;
+    __atomic_fetch_add(&counts->live, 1, __ATOMIC_RELAXED);
+    test_count_bytes(counts, 0, size);
+    return header + 1;
+}
+
+static void* test_reallocate(void* state, void* ptr, size_t new_size)
+{
+    test_allocator* const counts = state;
+    if (!ptr)
+    {
+        return test_allocate(state, new_size);
+    }
+    __atomic_fetch_add(&counts->allocations, 1, __ATOMIC_RELAXED);
+    union test_size_header_T* const header = (union test_size_header_T*)ptr - 1;
+    const size_t old_size = header->size;
+    union test_size_header_T* const new_header = realloc(header, sizeof(*new_header) + new_size);
+    if (!new_header)
+    {
+        return NULL;
+    }
+    new_header->size = new_size;
+    test_count_bytes(counts, old_size, new_size);
+    return new_header + 1;
+}
+
+static void test_deallocate(void* state, void* ptr)
+{
+    test_allocator* const counts = state;
+    if (!ptr)
+    {
+        return;
+    }
+    union test_size_header_T* const header = (union test_size_header_T*)ptr - 1;
+    __atomic_fetch_sub(&counts->live, 1, __ATOMIC_RELAXED);
+    test_count_bytes(counts, header->size, 0);
+    free(header);
+}
+
+jfnt_allocator_callbacks test_allocator_callbacks(test_allocator* counts)
+{
+    return (jfnt_allocator_callbacks)
+            {
+                    .allocate = test_allocate,
+                    .reallocate = test_reallocate,
+                    .deallocate = test_deallocate,
+                    .state = counts,
+            };
+}
@@ -7,8 +7,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "../include/jfnt_error.h"
+#include "../include/jfnt_font.h"
 #include <uchar.h>
-typedef struct jfnt_font_T jfnt_font;
 
 #ifndef NDEBUG
     #ifdef __GNUC__
@@ -28,4 +28,24 @@ void test_report_callback(const char* msg, const char* function, const char* fil
 
 void test_unsupported_char(jfnt_font* font, char32_t c, const char* msg, void* param);
 
+//  Path of the file fontconfig picks for the name, which must be freed
+char* test_find_font_file(const char* name);
+
+//  Creates a font from a fontconfig string and checks the result is the expected one, returning NULL when it is not a
+//  success. Errors are reported with test_report_callback, unless the create info has callbacks of its own.
+jfnt_font* test_create_font(const char* fc_str, jfnt_font_create_info create_info, jfnt_result expected);
+
+//  Counts what goes through the allocator callbacks returned by test_allocator_callbacks. Counting is atomic, so the
+//  same counts can be used by fonts which rasterize on more threads and by worker pools.
+struct test_allocator_T
+{
+    size_t allocations;         //  Calls to allocate and reallocate
+    size_t live;                //  Blocks allocated, but not yet deallocated
+    size_t live_bytes;
+    size_t peak_bytes;
+};
+typedef struct test_allocator_T test_allocator;
+
+jfnt_allocator_callbacks test_allocator_callbacks(test_allocator* counts);
+
 #endif //JFNT_TEST_COMMON_H
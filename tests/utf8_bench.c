@@ -0,0 +1,79 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../source/jfnt_utf8.h"
+#include <string.h>
+#include <time.h>
+
+struct corpus_T
+{
+    const char* name;
+    const char* sample;
+};
+
+static const struct corpus_T CORPORA[] =
+        {
+                {"ascii", "2026-10-17 12:34:56.789 INFO worker[42]: processed request id=0x1f3a in 12.5 ms\n"},
+                {"latin", "Größere Übungen für Straßenbahnfahrer: élève, garçon, où, naïve, señor año.\n"},
+                {"cyrillic", "Съешь же ещё этих мягких французских булок, да выпей чаю.\n"},
+                {"cjk", "敏捷的棕色狐狸跳过了懒狗。日本語のテキストも含まれています。\n"},
+                {"emoji", "😀😃😄😁 🚀🌍🔥 👍🎉✨ 🐱🐶🦊🦄 \n"},
+        };
+
+static const char* const ISA_NAMES[] = {[JFNT_UTF8_ISA_SCALAR] = "scalar", [JFNT_UTF8_ISA_SSE2] = "sse2", [JFNT_UTF8_ISA_AVX2] = "avx2"};
+
+enum {CORPUS_SIZE = 4 << 20, OUT_CHUNK = 4096, REPEATS = 20};
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+int main()
+{
+    unsigned char* const text = malloc(CORPUS_SIZE);
+    char32_t* const out = malloc(sizeof(*out) * OUT_CHUNK);
+    ASSERT(text && out);
+    const jfnt_utf8_isa best = jfnt_utf8_best_isa();
+
+    printf("%-10s %-8s %10s %12s\n", "corpus", "decoder", "MB/s", "Mcp/s");
+    for (unsigned i_corpus = 0; i_corpus < sizeof(CORPORA) / sizeof(*CORPORA); ++i_corpus)
+    {
+        //  Sample is repeated, but only whole, so that the corpus is valid
+        const size_t sample_size = strlen(CORPORA[i_corpus].sample);
+        size_t size = 0;
+        while (size + sample_size <= CORPUS_SIZE)
+        {
+            memcpy(text + size, CORPORA[i_corpus].sample, sample_size);
+            size += sample_size;
+        }
+
+        for (jfnt_utf8_isa isa = JFNT_UTF8_ISA_SCALAR; isa <= best; ++isa)
+        {
+            size_t total_codepoints = 0;
+            const double t0 = now_seconds();
+            for (unsigned repeat = 0; repeat < REPEATS; ++repeat)
+            {
+                size_t pos = 0;
+                while (pos < size)
+                {
+                    size_t consumed, written;
+                    const jfnt_utf8_status status = jfnt_utf8_decode_isa(isa, text + pos, size - pos, out, OUT_CHUNK, &consumed, &written);
+                    ASSERT(status == JFNT_UTF8_OK);
+                    pos += consumed;
+                    total_codepoints += written;
+                }
+            }
+            const double dt = now_seconds() - t0;
+            printf("%-10s %-8s %10.1f %12.1f\n", CORPORA[i_corpus].name, ISA_NAMES[isa],
+                   (double)size * REPEATS / dt * 1e-6, (double)total_codepoints / dt * 1e-6);
+        }
+    }
+
+    free(out);
+    free(text);
+    return 0;
+}
@@ -0,0 +1,193 @@
+//
+// Created by jan on 17.10.2026.
+//
+#include "test_common.h"
+#include "../source/jfnt_utf8.h"
+#include <string.h>
+
+static size_t encode(char32_t c, unsigned char* out)
+{
+    if (c < 0x80)
+    {
+        out[0] = (unsigned char)c;
+        return 1;
+    }
+    if (c < 0x800)
+    {
+        out[0] = (unsigned char)(0xC0 | (c >> 6));
+        out[1] = (unsigned char)(0x80 | (c & 0x3F));
+        return 2;
+    }
+    if (c < 0x10000)
+    {
+        out[0] = (unsigned char)(0xE0 | (c >> 12));
+        out[1] = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+        out[2] = (unsigned char)(0x80 | (c & 0x3F));
+        return 3;
+    }
+    out[0] = (unsigned char)(0xF0 | (c >> 18));
+    out[1] = (unsigned char)(0x80 | ((c >> 12) & 0x3F));
+    out[2] = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+    out[3] = (unsigned char)(0x80 | (c & 0x3F));
+    return 4;
+}
+
+static unsigned next_random(unsigned* state)
+{
+    *state = *state * 1103515245u + 12345u;
+    return *state >> 8;
+}
+
+//  Codepoints of mixed lengths in runs, so that every kernel gets blocks which end at any point
+static char32_t random_codepoint(unsigned* state, unsigned run_class)
+{
+    static const char32_t class_ranges[4][2] = {{0x00, 0x7F}, {0x80, 0x7FF}, {0x800, 0xFFFF}, {0x10000, 0x10FFFF}};
+    for (;;)
+    {
+        const char32_t first = class_ranges[run_class][0];
+        const char32_t last = class_ranges[run_class][1];
+        const char32_t c = first + next_random(state) % (last - first + 1);
+        if ((c < 0xD800 || c > 0xDFFF) && c != 0)
+        {
+            return c;
+        }
+    }
+}
+
+struct invalid_case_T
+{
+    const char* bytes;
+    jfnt_utf8_status status;
+};
+
+static const struct invalid_case_T INVALID_CASES[] =
+        {
+                {"\x80", JFNT_UTF8_BAD_LEAD},
+                {"\xBF", JFNT_UTF8_BAD_LEAD},
+                {"\xF8\x88\x80\x80\x80", JFNT_UTF8_BAD_LEAD},
+                {"\xFF", JFNT_UTF8_BAD_LEAD},
+                {"\xC3\x28", JFNT_UTF8_BAD_CONTINUATION},
+                {"\xE2\x82\x28", JFNT_UTF8_BAD_CONTINUATION},
+                {"\xF0\x9F\x98\x28", JFNT_UTF8_BAD_CONTINUATION},
+                {"\xC0\x80", JFNT_UTF8_OVERLONG},
+                {"\xC1\xBF", JFNT_UTF8_OVERLONG},
+                {"\xE0\x80\xAF", JFNT_UTF8_OVERLONG},
+                {"\xE0\x9F\xBF", JFNT_UTF8_OVERLONG},
+                {"\xF0\x80\x80\xAF", JFNT_UTF8_OVERLONG},
+                {"\xF0\x8F\xBF\xBF", JFNT_UTF8_OVERLONG},
+                {"\xED\xA0\x80", JFNT_UTF8_SURROGATE},
+                {"\xED\xBF\xBF", JFNT_UTF8_SURROGATE},
+                {"\xF4\x90\x80\x80", JFNT_UTF8_TOO_LARGE},
+                {"\xF5\x80\x80\x80", JFNT_UTF8_TOO_LARGE},
+                {"\xF7\xBF\xBF\xBF", JFNT_UTF8_TOO_LARGE},
+        };
+
+enum {MAX_CODEPOINTS = 1 << 16};
+
+int main()
+{
+    const jfnt_utf8_isa best = jfnt_utf8_best_isa();
+    printf("Best decoder: %d\n", (int)best);
+
+    unsigned char* const text = malloc(4 * MAX_CODEPOINTS + 64);
+    char32_t* const expected = malloc(sizeof(*expected) * MAX_CODEPOINTS);
+    char32_t* const decoded = malloc(sizeof(*decoded) * MAX_CODEPOINTS);
+    ASSERT(text && expected && decoded);
+
+    //  Valid text must decode the same with every implementation
+    unsigned state = 1;
+    size_t size = 0;
+    size_t count = 0;
+    while (count < MAX_CODEPOINTS - 64)
+    {
+        const unsigned run_class = next_random(&state) % 4;
+        const unsigned run_length = 1 + next_random(&state) % 40;
+        for (unsigned i = 0; i < run_length; ++i)
+        {
+            expected[count] = random_codepoint(&state, run_class);
+            size += encode(expected[count], text + size);
+            count += 1;
+        }
+    }
+    for (jfnt_utf8_isa isa = JFNT_UTF8_ISA_SCALAR; isa <= best; ++isa)
+    {
+        size_t consumed, written;
+        ASSERT(jfnt_utf8_decode_isa(isa, text, size, decoded, MAX_CODEPOINTS, &consumed, &written) == JFNT_UTF8_OK);
+        ASSERT(consumed == size);
+        ASSERT(written == count);
+        ASSERT(memcmp(decoded, expected, sizeof(*expected) * count) == 0);
+
+        //  Output limit must stop decoding exactly after that many codepoints
+        const size_t limits[] = {1, 15, 16, 17, 31, 33, 1000};
+        for (unsigned i = 0; i < sizeof(limits) / sizeof(*limits); ++i)
+        {
+            ASSERT(jfnt_utf8_decode_isa(isa, text, size, decoded, limits[i], &consumed, &written) == JFNT_UTF8_OK);
+            ASSERT(written == limits[i]);
+            ASSERT(memcmp(decoded, expected, sizeof(*expected) * written) == 0);
+            size_t expected_consumed = 0;
+            for (size_t j = 0; j < written; ++j)
+            {
+                unsigned char tmp[4];
+                expected_consumed += encode(expected[j], tmp);
+            }
+            ASSERT(consumed == expected_consumed);
+        }
+    }
+
+    //  Invalid sequences must be found at the exact position, regardless of what precedes and follows them
+    static const char32_t fillers[] = {'a', 0xE9, 0x4E2D, 0x1F600};
+    for (unsigned i_case = 0; i_case < sizeof(INVALID_CASES) / sizeof(*INVALID_CASES); ++i_case)
+    {
+        const struct invalid_case_T* const test_case = INVALID_CASES + i_case;
+        for (unsigned i_filler = 0; i_filler < sizeof(fillers) / sizeof(*fillers); ++i_filler)
+        {
+            for (unsigned n_before = 0; n_before < 40; ++n_before)
+            {
+                size = 0;
+                for (unsigned i = 0; i < n_before; ++i)
+                {
+                    size += encode(fillers[i_filler], text + size);
+                }
+                const size_t bad_offset = size;
+                const size_t bad_length = strlen(test_case->bytes);
+                memcpy(text + size, test_case->bytes, bad_length);
+                size += bad_length;
+                for (unsigned i = 0; i < 40; ++i)
+                {
+                    size += encode(fillers[i_filler], text + size);
+                }
+                for (jfnt_utf8_isa isa = JFNT_UTF8_ISA_SCALAR; isa <= best; ++isa)
+                {
+                    size_t consumed, written;
+                    const jfnt_utf8_status status = jfnt_utf8_decode_isa(isa, text, size, decoded, MAX_CODEPOINTS, &consumed, &written);
+                    if (status != test_case->status || consumed != bad_offset || written != n_before)
+                    {
+                        fprintf(stderr, "Case %u, filler %u, offset %zu, decoder %d: got %s at %zu\n", i_case,
+                                i_filler, bad_offset, (int)isa, jfnt_utf8_status_message(status), consumed);
+                        ASSERT(0);
+                    }
+                }
+            }
+        }
+    }
+
+    //  Sequences cut off by the end of input are reported as such, so that the rest may be supplied later
+    static const char* const truncated[] = {"\xC3", "\xE2\x82", "\xF0\x9F", "\xF0\x9F\x98"};
+    for (unsigned i_case = 0; i_case < sizeof(truncated) / sizeof(*truncated); ++i_case)
+    {
+        memset(text, 'x', 40);
+        const size_t length = strlen(truncated[i_case]);
+        memcpy(text + 40, truncated[i_case], length);
+        for (jfnt_utf8_isa isa = JFNT_UTF8_ISA_SCALAR; isa <= best; ++isa)
+        {
+            size_t consumed, written;
+            ASSERT(jfnt_utf8_decode_isa(isa, text, 40 + length, decoded, MAX_CODEPOINTS, &consumed, &written) == JFNT_UTF8_TRUNCATED);
+            ASSERT(consumed == 40 && written == 40);
+        }
+    }
+
+    free(decoded);
+    free(expected);
+    free(text);
+    return 0;
+}